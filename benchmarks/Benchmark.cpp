@@ -0,0 +1,85 @@
+#include "Benchmark.hpp"
+
+#include "decision-graph/util/Str.hpp"
+
+#include "rfcommon/HighresTimer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static volatile int64_t sink;
+
+// ----------------------------------------------------------------------------
+void doNotOptimize(int64_t value)
+{
+    sink = sink + value;
+}
+
+// ----------------------------------------------------------------------------
+BenchmarkRunner::BenchmarkRunner(double minTimeMs, int minIterations, const char* filter)
+    : minTimeMs_(minTimeMs)
+    , minIterations_(minIterations)
+    , filter_(filter)
+{}
+
+// ----------------------------------------------------------------------------
+void BenchmarkRunner::run(const char* name, int64_t itemsPerIteration, const std::function<void()>& func)
+{
+    if (filter_.notEmpty() && strstr(name, filter_.cStr()) == nullptr)
+        return;
+
+    fprintf(stderr, "%-40s ", name);
+    fflush(stderr);
+
+    // One untimed run to warm up caches and allocators
+    func();
+
+    rfcommon::Vector<double> samples;
+    double totalNs = 0.0;
+    while (samples.count() < minIterations_ || totalNs < minTimeMs_ * 1e6)
+    {
+        rfcommon::HighresTimer timer;
+        timer.start();
+        func();
+        timer.stop();
+
+        const double ns = static_cast<double>(timer.timePassedNS());
+        samples.push(ns);
+        totalNs += ns;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    Result& result = results_.emplace();
+    result.name = name;
+    result.iterations = samples.count();
+    result.itemsPerIteration = itemsPerIteration;
+    result.minNs = samples.front();
+    result.medianNs = samples[samples.count() / 2];
+    result.meanNs = totalNs / samples.count();
+    result.maxNs = samples.back();
+
+    fprintf(stderr, "%8d iterations, median %12.0f ns\n", result.iterations, result.medianNs);
+}
+
+// ----------------------------------------------------------------------------
+rfcommon::String BenchmarkRunner::toJSON(const rfcommon::String& context) const
+{
+    rfcommon::String out;
+    StrAppendf(&out, "{\n  \"context\": %s,\n  \"benchmarks\": [", context.cStr());
+    for (int i = 0; i != results_.count(); ++i)
+    {
+        const Result& r = results_[i];
+        const double itemsPerSecond = r.medianNs > 0.0 ? r.itemsPerIteration * 1e9 / r.medianNs : 0.0;
+        StrAppendf(&out,
+            "%s\n    {\"name\": \"%s\", \"iterations\": %d, \"items_per_iteration\": %lld, "
+            "\"min_ns\": %.0f, \"median_ns\": %.0f, \"mean_ns\": %.0f, \"max_ns\": %.0f, "
+            "\"items_per_second\": %.1f}",
+            i == 0 ? "" : ",",
+            r.name.cStr(), r.iterations, static_cast<long long>(r.itemsPerIteration),
+            r.minNs, r.medianNs, r.meanNs, r.maxNs,
+            itemsPerSecond);
+    }
+    StrAppendf(&out, "\n  ]\n}\n");
+    return out;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "rfcommon/String.hpp"
+#include "rfcommon/Vector.hpp"
+
+#include <cstdint>
+#include <functional>
+
+/*!
+ * \brief Runs benchmarks and collects their results.
+ *
+ * Every benchmark is run repeatedly until both a minimum number of
+ * iterations and a minimum total time are reached. Each iteration is timed
+ * separately so the results include the spread as well as the average.
+ */
+class BenchmarkRunner
+{
+public:
+    struct Result
+    {
+        rfcommon::String name;
+        int iterations;
+        int64_t itemsPerIteration;
+        double minNs;
+        double medianNs;
+        double meanNs;
+        double maxNs;
+    };
+
+    BenchmarkRunner(double minTimeMs, int minIterations, const char* filter);
+
+    /*!
+     * \brief Runs the benchmark unless it is excluded by the filter.
+     * "itemsPerIteration" is used to report a throughput, e.g. the number
+     * of states searched by one call.
+     */
+    void run(const char* name, int64_t itemsPerIteration, const std::function<void()>& func);
+
+    const rfcommon::Vector<Result>& results() const { return results_; }
+
+    /*!
+     * \brief Formats all results as a JSON document. "context" is inserted
+     * as is and should be a JSON object describing the data set.
+     */
+    rfcommon::String toJSON(const rfcommon::String& context) const;
+
+private:
+    const double minTimeMs_;
+    const int minIterations_;
+    const rfcommon::String filter_;
+    rfcommon::Vector<Result> results_;
+};
+
+/*!
+ * \brief Keeps the compiler from optimizing away results of benchmarked
+ * code.
+ */
+void doNotOptimize(int64_t value);
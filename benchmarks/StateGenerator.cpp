@@ -0,0 +1,158 @@
+#include "StateGenerator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+namespace {
+
+// The most common motions of a typical fighter. Generated alphabets larger
+// than this are filled with numbered special moves
+const char* commonMotions[] = {
+    "wait", "walk", "dash", "run", "turn", "turn_dash", "jump_squat",
+    "jump_f", "jump_b", "jump_aerial_f", "fall", "landing_light",
+    "landing_heavy", "squat", "squat_wait", "guard_on", "guard", "guard_off",
+    "escape", "escape_f", "escape_b", "escape_air", "attack_11", "attack_12",
+    "attack_13", "attack_dash", "attack_s3_s", "attack_hi3", "attack_lw3",
+    "attack_s4_s", "attack_hi4", "attack_lw4", "attack_air_n", "attack_air_f",
+    "attack_air_b", "attack_air_hi", "attack_air_lw", "landing_air_n",
+    "landing_air_f", "landing_air_b", "landing_air_hi", "landing_air_lw",
+    "catch", "catch_dash", "catch_wait", "throw_f", "throw_b", "throw_hi",
+    "throw_lw", "special_n", "special_s", "special_hi", "special_lw",
+    "cliff_catch", "cliff_wait", "cliff_climb", "cliff_jump", "cliff_attack",
+    "damage_n", "damage_air", "damage_fly", "down_wait", "down_stand",
+    "passive", "passive_stand_f", "passive_stand_b"
+};
+
+}
+
+// ----------------------------------------------------------------------------
+StateGenerator::StateGenerator(const Config& config)
+    : config_(config)
+    , states_(new States(rfcommon::FighterID::fromValue(1), "Player", "Fighter"))
+    , opponentStates_(new States(rfcommon::FighterID::fromValue(2), "Opponent", "Fighter"))
+{
+    const int commonCount = static_cast<int>(sizeof(commonMotions) / sizeof(*commonMotions));
+    for (int i = 0; i != config_.alphabetSize; ++i)
+    {
+        char name[32];
+        if (i < commonCount)
+            snprintf(name, sizeof(name), "%s", commonMotions[i]);
+        else
+            snprintf(name, sizeof(name), "special_%d", i - commonCount);
+        hash40s_.push(name);
+        motions_.push(labels_.addHash40(name));
+    }
+
+    // Like real user labels, some labels map to several motions, e.g. "nair"
+    // maps to both "attack_air_n" and "landing_air_n"
+    const int labelCount = std::min(config_.userLabelCount, config_.alphabetSize);
+    for (int i = 0; i != labelCount; ++i)
+    {
+        char label[16];
+        snprintf(label, sizeof(label), "label%d", i);
+        userLabels_.push(label);
+        for (int m = i; m < config_.alphabetSize && m <= i + labelCount * (i % 3); m += labelCount)
+            labels_.addUserLabel(label, motions_[m]);
+    }
+
+    // Successors are drawn from a global Zipf distribution, so motions with
+    // low indices are frequent. The probability of taking a successor then
+    // falls off with its rank
+    std::mt19937 rng(config_.seed);
+    rfcommon::Vector<double> globalCDF;
+    double sum = 0.0;
+    for (int i = 0; i != config_.alphabetSize; ++i)
+        globalCDF.push(sum += 1.0 / std::pow(i + 1, config_.skew));
+    std::uniform_real_distribution<double> uniform(0.0, sum);
+
+    const int successorCount = std::min(config_.successorCount, config_.alphabetSize);
+    for (int motionIdx = 0; motionIdx != config_.alphabetSize; ++motionIdx)
+    {
+        const int first = successors_.count();
+        while (successors_.count() - first < successorCount)
+        {
+            const int candidate = static_cast<int>(
+                std::lower_bound(globalCDF.begin(), globalCDF.end(), uniform(rng)) - globalCDF.begin());
+            const int idx = std::min(candidate, config_.alphabetSize - 1);
+            if (std::find(successors_.begin() + first, successors_.end(), idx) == successors_.end())
+                successors_.push(idx);
+        }
+
+        double cdf = 0.0;
+        for (int rank = 0; rank != successorCount; ++rank)
+            successorCDF_.push(cdf += 1.0 / std::pow(rank + 1, config_.skew));
+        for (int rank = 0; rank != successorCount; ++rank)
+            successorCDF_[first + rank] /= cdf;
+    }
+
+    for (int session = 0; session != config_.sessionCount; ++session)
+    {
+        const int start = states_->count();
+        generateSession(states_.get(), config_.seed * 7919u + session * 2u);
+        sessions_.emplace(start, states_->count());
+
+        const int opponentStart = opponentStates_->count();
+        generateSession(opponentStates_.get(), config_.seed * 7919u + session * 2u + 1);
+        opponentSessions_.emplace(opponentStart, opponentStates_->count());
+    }
+}
+
+// ----------------------------------------------------------------------------
+StateGenerator::~StateGenerator()
+{}
+
+// ----------------------------------------------------------------------------
+void StateGenerator::generateSession(States* states, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::uniform_int_distribution<int> duration(4, 30);
+    std::normal_distribution<float> step(0.0f, 8.0f);
+
+    const int successorCount = std::min(config_.successorCount, config_.alphabetSize);
+    int motionIdx = 0;
+    int frame = 0;
+    float x = 0.0f, y = 0.0f;
+    float damage = 0.0f;
+    float shield = 50.0f;
+
+    while (frame < config_.sessionFrames)
+    {
+        const bool opponentInHitlag = chance(rng) < config_.hitChance;
+        const bool opponentInShieldlag = !opponentInHitlag && chance(rng) < config_.shieldChance;
+        const bool inHitlag = chance(rng) < config_.hitChance * 0.5;
+        const bool inHitstun = inHitlag && chance(rng) < 0.8;
+        const bool inShieldlag = !inHitlag && chance(rng) < config_.shieldChance;
+
+        const float prevY = y;
+        x = std::max(-150.0f, std::min(150.0f, x + step(rng)));
+        y = chance(rng) < 0.5 ? 0.0f : std::max(0.0f, std::min(120.0f, y + step(rng)));
+        if (inHitlag)
+            damage += 8.0f;
+        shield = inShieldlag ? std::max(0.0f, shield - 5.0f) : std::min(50.0f, shield + 1.0f);
+
+        states->push(State(
+            State::SideData(
+                rfcommon::FrameIndex::fromValue(frame),
+                rfcommon::Vec2::fromValues(x, y),
+                damage,
+                shield),
+            motions_[motionIdx],
+            rfcommon::FighterStatus::fromValue(static_cast<uint16_t>(motionIdx % 500)),
+            inHitlag, inHitstun, inShieldlag,
+            opponentInHitlag, opponentInHitlag, opponentInShieldlag));
+        states->back().flags |= State::makeKinematicFlags(y > prevY, y < prevY, y == 0.0f);
+
+        // Pick the next motion
+        const double r = chance(rng);
+        const int first = motionIdx * successorCount;
+        const int rank = static_cast<int>(
+            std::lower_bound(successorCDF_.begin() + first, successorCDF_.begin() + first + successorCount, r)
+            - (successorCDF_.begin() + first));
+        motionIdx = successors_[first + std::min(rank, successorCount - 1)];
+
+        frame += duration(rng);
+    }
+}
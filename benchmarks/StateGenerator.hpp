@@ -0,0 +1,79 @@
+#pragma once
+
+#include "decision-graph/models/Sequence.hpp"
+
+#include "rfcommon/MotionLabels.hpp"
+#include "rfcommon/String.hpp"
+#include "rfcommon/Vector.hpp"
+
+#include <cstdint>
+#include <memory>
+
+/*!
+ * \brief Generates synthetic state lists for two fighters, with the same
+ * layout SequenceSearchModel produces from real replays.
+ *
+ * Motions follow a Markov chain. Every motion has a handful of likely
+ * successors whose probabilities follow a Zipf distribution, so like in real
+ * games, a few transitions (e.g. dash -> run) dominate while most are rare.
+ * Both fighters cover the same frames so the data can be used with
+ * Query::findAllOverlapping().
+ */
+class StateGenerator
+{
+public:
+    struct Config
+    {
+        int alphabetSize = 80;       // Number of distinct motions
+        int userLabelCount = 24;     // Labels mapping to 1-3 motions each
+        int successorCount = 8;      // Likely successors per motion
+        double skew = 1.2;           // Zipf exponent of the successor distribution
+        int sessionCount = 20;
+        int sessionFrames = 28800;   // 8 minutes at 60 fps
+        double hitChance = 0.12;
+        double shieldChance = 0.05;
+        uint32_t seed = 1;
+    };
+
+    explicit StateGenerator(const Config& config);
+    ~StateGenerator();
+
+    const Config& config() const { return config_; }
+    const rfcommon::MotionLabels& labels() const { return labels_; }
+
+    const States& states() const { return *states_; }
+    const States& opponentStates() const { return *opponentStates_; }
+
+    /*!
+     * \brief One range per session into states() and opponentStates().
+     */
+    const rfcommon::Vector<Range>& sessions() const { return sessions_; }
+    const rfcommon::Vector<Range>& opponentSessions() const { return opponentSessions_; }
+
+    /*!
+     * \brief The hash40 string and the user label of a motion. Useful for
+     * building query text. Lower indices are more frequent.
+     */
+    const char* hash40(int motionIdx) const { return hash40s_[motionIdx].cStr(); }
+    const char* userLabel(int labelIdx) const { return userLabels_[labelIdx].cStr(); }
+
+private:
+    void generateSession(States* states, uint32_t seed);
+
+private:
+    const Config config_;
+    rfcommon::MotionLabels labels_;
+    rfcommon::Vector<rfcommon::String> hash40s_;
+    rfcommon::Vector<rfcommon::String> userLabels_;
+    rfcommon::Vector<rfcommon::FighterMotion> motions_;
+
+    // Successor table, "successorCount" entries per motion, and the
+    // cumulative probabilities to pick them
+    rfcommon::Vector<int> successors_;
+    rfcommon::Vector<double> successorCDF_;
+
+    std::unique_ptr<States> states_;
+    std::unique_ptr<States> opponentStates_;
+    rfcommon::Vector<Range> sessions_;
+    rfcommon::Vector<Range> opponentSessions_;
+};
@@ -0,0 +1,336 @@
+#include "Benchmark.hpp"
+#include "StateGenerator.hpp"
+
+#include "decision-graph/models/Graph.hpp"
+#include "decision-graph/models/GraphLayout.hpp"
+#include "decision-graph/models/Query.hpp"
+#include "decision-graph/parsers/QueryASTNode.hpp"
+#include "decision-graph/util/Arena.hpp"
+#include "decision-graph/util/Str.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#if !defined(BENCHMARK_REVISION)
+#   define BENCHMARK_REVISION "unknown"
+#endif
+
+namespace {
+
+struct Options
+{
+    StateGenerator::Config data;
+    double minTimeMs = 500.0;
+    int minIterations = 5;
+    const char* filter = "";
+    const char* output = nullptr;
+};
+
+// ----------------------------------------------------------------------------
+void printUsage(const char* prog)
+{
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --alphabet <n>      Number of distinct motions (default 80)\n"
+        "  --labels <n>        Number of user labels (default 24)\n"
+        "  --successors <n>    Likely successors per motion (default 8)\n"
+        "  --skew <x>          Zipf exponent of transitions (default 1.2)\n"
+        "  --sessions <n>      Number of sessions (default 20)\n"
+        "  --frames <n>        Frames per session (default 28800)\n"
+        "  --seed <n>          Random seed (default 1)\n"
+        "  --min-time <ms>     Minimum time per benchmark (default 500)\n"
+        "  --min-iterations <n>  Minimum iterations per benchmark (default 5)\n"
+        "  --filter <text>     Only run benchmarks whose name contains <text>\n"
+        "  --output <file>     Write JSON results to <file> instead of stdout\n",
+        prog);
+}
+
+// ----------------------------------------------------------------------------
+bool parseOptions(int argc, char** argv, Options* opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (i + 1 >= argc)
+            return false;
+        const char* value = argv[++i];
+
+        if (strcmp(arg, "--alphabet") == 0)            opts->data.alphabetSize = atoi(value);
+        else if (strcmp(arg, "--labels") == 0)         opts->data.userLabelCount = atoi(value);
+        else if (strcmp(arg, "--successors") == 0)     opts->data.successorCount = atoi(value);
+        else if (strcmp(arg, "--skew") == 0)           opts->data.skew = atof(value);
+        else if (strcmp(arg, "--sessions") == 0)       opts->data.sessionCount = atoi(value);
+        else if (strcmp(arg, "--frames") == 0)         opts->data.sessionFrames = atoi(value);
+        else if (strcmp(arg, "--seed") == 0)           opts->data.seed = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        else if (strcmp(arg, "--min-time") == 0)       opts->minTimeMs = atof(value);
+        else if (strcmp(arg, "--min-iterations") == 0) opts->minIterations = atoi(value);
+        else if (strcmp(arg, "--filter") == 0)         opts->filter = value;
+        else if (strcmp(arg, "--output") == 0)         opts->output = value;
+        else return false;
+    }
+
+    return opts->data.alphabetSize >= 2
+        && opts->data.userLabelCount >= 1
+        && opts->data.successorCount >= 1
+        && opts->data.sessionCount >= 1
+        && opts->data.sessionFrames >= 1;
+}
+
+// ----------------------------------------------------------------------------
+// Queries covering the different kinds of AST nodes. They are built from the
+// generated labels so they produce matches on any data set
+rfcommon::Vector<rfcommon::String> makeQueries(const StateGenerator& gen)
+{
+    const int labels = std::min(gen.config().userLabelCount, gen.config().alphabetSize);
+    const int motions = gen.config().alphabetSize;
+    auto L = [&gen, labels](int i) { return gen.userLabel(i % labels); };
+    auto H = [&gen, motions](int i) { return gen.hash40(i % motions); };
+
+    rfcommon::Vector<rfcommon::String> queries;
+    auto add = [&queries](const char* fmt, auto... args) {
+        rfcommon::String q;
+        StrAppendf(&q, fmt, args...);
+        queries.push(q);
+    };
+
+    add("%s -> %s", L(0), L(1));
+    add("%s -> %s -> %s", H(0), H(1), H(2));
+    add("(%s | %s)+ -> %s hit", L(2), L(3), L(4));
+    add("%s -> .* -> %s", L(5), L(6));
+    add("!%s 2,4 -> %s", L(0), L(7));
+    add("rising %s -> falling %s", L(8), L(9));
+    add("%s? -> (%s -> %s)+ -> %s os", L(10), L(1), L(2), L(11));
+    add("grounded %s -> . -> %s whiff", H(3), L(12));
+    return queries;
+}
+
+// ----------------------------------------------------------------------------
+rfcommon::String makeContext(const Options& opts, const StateGenerator& gen, int queryCount)
+{
+    rfcommon::String ctx;
+    StrAppendf(&ctx,
+        "{\"revision\": \"%s\", \"compiler\": \"%s\", "
+        "\"alphabet\": %d, \"labels\": %d, \"successors\": %d, \"skew\": %.3f, "
+        "\"sessions\": %d, \"frames_per_session\": %d, \"seed\": %u, "
+        "\"states\": %d, \"opponent_states\": %d, \"queries\": %d}",
+        BENCHMARK_REVISION,
+#if defined(__clang__)
+        "clang " __clang_version__,
+#elif defined(__GNUC__)
+        "gcc " __VERSION__,
+#elif defined(_MSC_VER)
+        "msvc",
+#else
+        "unknown",
+#endif
+        opts.data.alphabetSize, opts.data.userLabelCount, opts.data.successorCount, opts.data.skew,
+        opts.data.sessionCount, opts.data.sessionFrames, opts.data.seed,
+        gen.states().count(), gen.opponentStates().count(), queryCount);
+    return ctx;
+}
+
+}
+
+// ----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    Options opts;
+    if (parseOptions(argc, argv, &opts) == false)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    fprintf(stderr, "Generating data...\n");
+    const StateGenerator gen(opts.data);
+    const States& states = gen.states();
+    const States& oppStates = gen.opponentStates();
+    const rfcommon::Vector<Range>& sessions = gen.sessions();
+    const rfcommon::Vector<Range>& oppSessions = gen.opponentSessions();
+    const rfcommon::FighterID fighterID = states.fighterID;
+
+    // Parse and compile once up front. This also validates the queries
+    const rfcommon::Vector<rfcommon::String> queryStrings = makeQueries(gen);
+    Arena astArena;
+    rfcommon::Vector<QueryASTNode*> asts;
+    rfcommon::Vector<std::unique_ptr<Query>> queries;
+    for (const rfcommon::String& text : queryStrings)
+    {
+        QueryASTNode* ast = Query::parse(text, &astArena);
+        if (ast == nullptr)
+        {
+            fprintf(stderr, "Failed to parse query \"%s\"\n", text.cStr());
+            return 1;
+        }
+
+        rfcommon::String error;
+        Query* query = Query::compileAST(ast, &gen.labels(), fighterID, &error, &astArena);
+        if (query == nullptr)
+        {
+            fprintf(stderr, "Failed to compile query \"%s\": %s\n", text.cStr(), error.cStr());
+            return 1;
+        }
+
+        asts.push(ast);
+        queries.emplace(query);
+    }
+
+    BenchmarkRunner runner(opts.minTimeMs, opts.minIterations, opts.filter);
+
+    // ------------------------------------------------------------------------
+    // Query engine
+    // ------------------------------------------------------------------------
+
+    // Same as SequenceSearchModel::compileQuery(), which resets its arena
+    // before every compile
+    Arena arena;
+    runner.run("query/parse", queryStrings.count(), [&] {
+        for (const rfcommon::String& text : queryStrings)
+        {
+            arena.reset();
+            QueryASTNode* ast = Query::parse(text, &arena);
+            doNotOptimize(reinterpret_cast<intptr_t>(ast));
+        }
+    });
+
+    runner.run("query/compile", asts.count(), [&] {
+        for (const QueryASTNode* ast : asts)
+        {
+            arena.reset();
+            rfcommon::String error;
+            std::unique_ptr<Query> query(Query::compileAST(ast, &gen.labels(), fighterID, &error, &arena));
+            doNotOptimize(reinterpret_cast<intptr_t>(query.get()));
+        }
+    });
+
+    for (int q = 0; q != queries.count(); ++q)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "query/find_all/q%d", q);
+        runner.run(name, states.count(), [&] {
+            int64_t matches = 0;
+            for (const Range& session : sessions)
+                matches += queries[q]->findAll(states, session).count();
+            doNotOptimize(matches);
+        });
+    }
+
+    // The opponent side uses a different query, as it would when searching
+    // for e.g. "player's nair while opponent shields"
+    for (int q = 0; q + 1 < queries.count(); q += 2)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "query/find_all_overlapping/q%d_q%d", q, q + 1);
+        runner.run(name, states.count() + oppStates.count(), [&] {
+            int64_t matches = 0;
+            for (int s = 0; s != sessions.count(); ++s)
+                matches += queries[q]->findAllOverlapping(
+                    queries[q + 1].get(),
+                    states, sessions[s],
+                    oppStates, oppSessions[s]).count();
+            doNotOptimize(matches);
+        });
+    }
+
+    // ------------------------------------------------------------------------
+    // Graph engine
+    // ------------------------------------------------------------------------
+
+    rfcommon::Vector<Range> matches;
+    for (const Range& session : sessions)
+        matches.push(queries[3]->findAll(states, session));
+
+    runner.run("graph/add_states/sessions", states.count(), [&] {
+        Graph graph;
+        graph.addStates(states, sessions);
+        doNotOptimize(graph.edges.count());
+    });
+
+    runner.run("graph/add_states/matches", matches.count(), [&] {
+        Graph graph;
+        graph.addStates(states, matches);
+        doNotOptimize(graph.edges.count());
+    });
+
+    // Matches of a query usually form many small islands, whereas the full
+    // session graph is mostly one large island
+    Graph sessionGraph;
+    sessionGraph.addStates(states, sessions);
+    Graph matchGraph;
+    matchGraph.addStates(states, matches);
+
+    runner.run("graph/islands/sessions", sessionGraph.nodes.count(), [&] {
+        doNotOptimize(sessionGraph.islands().count());
+    });
+
+    runner.run("graph/islands/matches", matchGraph.nodes.count(), [&] {
+        doNotOptimize(matchGraph.islands().count());
+    });
+
+    rfcommon::Vector<Graph> islands = sessionGraph.islands();
+    int largest = 0;
+    for (int i = 1; i < islands.count(); ++i)
+        if (islands[largest].nodes.count() < islands[i].nodes.count())
+            largest = i;
+    const Graph& island = islands[largest];
+
+    runner.run("graph/outgoing_tree", island.nodes.count(), [&] {
+        doNotOptimize(island.outgoingTree().nodes.count());
+    });
+
+    runner.run("graph/incoming_tree", island.nodes.count(), [&] {
+        doNotOptimize(island.incomingTree().nodes.count());
+    });
+
+    runner.run("graph/neighborhood_tree", island.nodes.count(), [&] {
+        doNotOptimize(island.neighborhoodTree(3, 3, 4).nodes.count());
+    });
+
+    // ------------------------------------------------------------------------
+    // Graph layout. The optimal engine is only run on a tree, because it
+    // takes far too long on dense graphs
+    // ------------------------------------------------------------------------
+
+    const Graph tree = island.neighborhoodTree(3, 3, 4);
+    auto runLayout = [&runner](const char* name, const Graph& graph, GraphLayout::Engine engine) {
+        rfcommon::Vector<double> widths;
+        rfcommon::Vector<double> heights;
+        for (int i = 0; i != graph.nodes.count(); ++i)
+        {
+            widths.push(120.0);
+            heights.push(30.0);
+        }
+        runner.run(name, graph.nodes.count(), [&] {
+            doNotOptimize(GraphLayout::compute(graph, widths, heights, engine).nodeCount());
+        });
+    };
+
+    runLayout("layout/optimal/tree", tree, GraphLayout::OPTIMAL);
+    runLayout("layout/fast/tree", tree, GraphLayout::FAST);
+    runLayout("layout/fast/island", island, GraphLayout::FAST);
+    runLayout("layout/compact/island", island, GraphLayout::COMPACT);
+    runLayout("layout/force_directed/island", island, GraphLayout::FORCE_DIRECTED);
+
+    // ------------------------------------------------------------------------
+    // Results
+    // ------------------------------------------------------------------------
+
+    const rfcommon::String json = runner.toJSON(makeContext(opts, gen, queryStrings.count()));
+    if (opts.output)
+    {
+        FILE* fp = fopen(opts.output, "w");
+        if (fp == nullptr)
+        {
+            fprintf(stderr, "Failed to open \"%s\" for writing\n", opts.output);
+            return 1;
+        }
+        fwrite(json.cStr(), 1, json.length(), fp);
+        fclose(fp);
+    }
+    else
+        fwrite(json.cStr(), 1, json.length(), stdout);
+
+    return 0;
+}
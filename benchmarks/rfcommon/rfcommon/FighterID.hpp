@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+namespace rfcommon {
+
+class FighterID
+{
+public:
+    typedef uint8_t Type;
+
+    static FighterID fromValue(Type value) { return FighterID(value); }
+    static FighterID makeInvalid() { return FighterID(255); }
+
+    Type value() const { return value_; }
+    bool isValid() const { return value_ != 255; }
+
+    bool operator==(FighterID rhs) const { return value_ == rhs.value_; }
+    bool operator!=(FighterID rhs) const { return value_ != rhs.value_; }
+
+private:
+    explicit FighterID(Type value) : value_(value) {}
+
+    Type value_;
+};
+
+}
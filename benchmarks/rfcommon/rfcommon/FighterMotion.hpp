@@ -0,0 +1,69 @@
+#pragma once
+
+#include "rfcommon/Hashers.hpp"
+#include "rfcommon/String.hpp"
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+namespace rfcommon {
+
+/*!
+ * A hash40 value: The upper 8 bits are the length of the string, the lower
+ * 32 bits are its CRC32.
+ */
+class FighterMotion
+{
+public:
+    typedef uint64_t Type;
+
+    static FighterMotion fromValue(Type value) { return FighterMotion(value); }
+    static FighterMotion fromParts(uint8_t upper, uint32_t lower) { return FighterMotion((static_cast<Type>(upper) << 32) | lower); }
+    static FighterMotion makeInvalid() { return FighterMotion(0); }
+
+    static FighterMotion fromHexString(const char* str)
+    {
+        if (str[0] != '0' || (str[1] != 'x' && str[1] != 'X'))
+            return makeInvalid();
+        char* end;
+        const unsigned long long value = strtoull(str + 2, &end, 16);
+        if (*end != '\0' || value > 0xFFFFFFFFFFull)
+            return makeInvalid();
+        return FighterMotion(static_cast<Type>(value));
+    }
+
+    Type value() const { return value_; }
+    uint32_t lower() const { return static_cast<uint32_t>(value_); }
+    uint8_t upper() const { return static_cast<uint8_t>(value_ >> 32); }
+    bool isValid() const { return value_ != 0; }
+
+    String toHex() const
+    {
+        char buf[24];
+        snprintf(buf, sizeof(buf), "0x%" PRIx64, value_);
+        return buf;
+    }
+
+    bool operator==(FighterMotion rhs) const { return value_ == rhs.value_; }
+    bool operator!=(FighterMotion rhs) const { return value_ != rhs.value_; }
+    bool operator<(FighterMotion rhs) const { return value_ < rhs.value_; }
+
+private:
+    explicit FighterMotion(Type value) : value_(value) {}
+
+    Type value_;
+};
+
+template <>
+struct Hasher<FighterMotion>
+{
+    typedef uint32_t HashType;
+    HashType operator()(FighterMotion motion) const
+    {
+        return hash32_combine(motion.lower(), motion.upper());
+    }
+};
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+namespace rfcommon {
+
+class FighterStatus
+{
+public:
+    typedef uint16_t Type;
+
+    static FighterStatus fromValue(Type value) { return FighterStatus(value); }
+    static FighterStatus makeInvalid() { return FighterStatus(0xFFFF); }
+
+    Type value() const { return value_; }
+    bool isValid() const { return value_ != 0xFFFF; }
+
+    bool operator==(FighterStatus rhs) const { return value_ == rhs.value_; }
+    bool operator!=(FighterStatus rhs) const { return value_ != rhs.value_; }
+
+private:
+    explicit FighterStatus(Type value) : value_(value) {}
+
+    Type value_;
+};
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+namespace rfcommon {
+
+class FrameIndex
+{
+public:
+    typedef uint32_t Type;
+
+    static FrameIndex fromValue(Type value) { return FrameIndex(value); }
+
+    Type index() const { return value_; }
+
+    bool operator==(FrameIndex rhs) const { return value_ == rhs.value_; }
+    bool operator!=(FrameIndex rhs) const { return value_ != rhs.value_; }
+    bool operator< (FrameIndex rhs) const { return value_ <  rhs.value_; }
+    bool operator<=(FrameIndex rhs) const { return value_ <= rhs.value_; }
+    bool operator> (FrameIndex rhs) const { return value_ >  rhs.value_; }
+    bool operator>=(FrameIndex rhs) const { return value_ >= rhs.value_; }
+
+private:
+    explicit FrameIndex(Type value) : value_(value) {}
+
+    Type value_;
+};
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "rfcommon/Hashers.hpp"
+#include "rfcommon/Vector.hpp"
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+
+namespace rfcommon {
+
+template <typename T>
+struct HashMapCompare
+{
+    bool operator()(const T& a, const T& b) const { return a == b; }
+};
+
+template <typename K, typename V, typename H=Hasher<K>, typename C=HashMapCompare<K>, typename S=int>
+class HashMap
+{
+    struct StdHasher
+    {
+        std::size_t operator()(const K& key) const { return static_cast<std::size_t>(H()(key)); }
+    };
+
+    typedef std::unordered_map<K, V, StdHasher, C> Map;
+
+public:
+    /*!
+     * Like rfcommon's iterators, both "it->key()" and "(*it).value()"
+     * work. Dereferencing returns the iterator itself.
+     */
+    class Iterator
+    {
+    public:
+        Iterator(typename Map::iterator it) : it_(it) {}
+
+        const K& key() const { return it_->first; }
+        V& value() const { return it_->second; }
+
+        const Iterator* operator->() const { return this; }
+        const Iterator& operator*() const { return *this; }
+        Iterator& operator++() { ++it_; return *this; }
+        bool operator==(const Iterator& rhs) const { return it_ == rhs.it_; }
+        bool operator!=(const Iterator& rhs) const { return it_ != rhs.it_; }
+
+    private:
+        friend class HashMap;
+        typename Map::iterator it_;
+    };
+    typedef Iterator ConstIterator;
+
+    S count() const { return static_cast<S>(map_.size()); }
+    void reserve(S count) { map_.reserve(count); }
+    void clear() { map_.clear(); }
+    void clearCompact() { Map().swap(map_); }
+
+    Iterator begin() const { return Iterator(mut().begin()); }
+    Iterator end() const { return Iterator(mut().end()); }
+    Iterator find(const K& key) const { return Iterator(mut().find(key)); }
+
+    //! Returns end() if the key already exists
+    Iterator insertIfNew(const K& key, const V& value)
+    {
+        auto result = map_.emplace(key, value);
+        return result.second ? Iterator(result.first) : end();
+    }
+
+    //! Returns the existing entry if the key already exists
+    Iterator insertOrGet(const K& key, const V& value)
+    {
+        return Iterator(map_.emplace(key, value).first);
+    }
+
+    Iterator insertAlways(const K& key, const V& value)
+    {
+        auto result = map_.emplace(key, value);
+        if (result.second == false)
+            result.first->second = value;
+        return Iterator(result.first);
+    }
+
+    Iterator erase(Iterator it) { return Iterator(map_.erase(it.it_)); }
+    bool erase(const K& key) { return map_.erase(key) > 0; }
+
+private:
+    Map& mut() const { return const_cast<Map&>(map_); }
+
+private:
+    Map map_;
+};
+
+}
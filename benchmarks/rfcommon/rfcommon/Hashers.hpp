@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Benchmark stand-in for rfcommon. Only the parts of the API the decision
+ * graph engines use are provided, backed by the standard library.
+ */
+
+namespace rfcommon {
+
+inline uint32_t hash32_jenkins_oaat(const void* key, int len)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(key);
+    uint32_t h = 0;
+    for (int i = 0; i != len; ++i)
+    {
+        h += p[i];
+        h += h << 10;
+        h ^= h >> 6;
+    }
+    h += h << 3;
+    h ^= h >> 11;
+    h += h << 15;
+    return h;
+}
+
+inline uint32_t hash32_combine(uint32_t lhs, uint32_t rhs)
+{
+    lhs ^= rhs + 0x9e3779b9 + (lhs << 6) + (lhs >> 2);
+    return lhs;
+}
+
+template <typename T>
+struct Hasher
+{
+    typedef uint32_t HashType;
+    HashType operator()(const T& value) const
+    {
+        return hash32_jenkins_oaat(&value, sizeof(T));
+    }
+};
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace rfcommon {
+
+class HighresTimer
+{
+public:
+    void start() { start_ = std::chrono::steady_clock::now(); }
+    void stop() { stop_ = std::chrono::steady_clock::now(); }
+
+    uint64_t timePassedNS() const
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(stop_ - start_).count());
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point stop_;
+};
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "rfcommon/FighterID.hpp"
+#include "rfcommon/FighterMotion.hpp"
+#include "rfcommon/String.hpp"
+#include "rfcommon/Vector.hpp"
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+namespace rfcommon {
+
+/*!
+ * The real class loads hash40 strings and user labels from disk. The
+ * stand-in is filled by the benchmark's data generator instead. User labels
+ * are shared by all fighters.
+ */
+class MotionLabels
+{
+public:
+    static FighterMotion makeHash40(const char* str)
+    {
+        uint32_t crc = 0xFFFFFFFF;
+        const int len = static_cast<int>(strlen(str));
+        for (int i = 0; i != len; ++i)
+        {
+            crc ^= static_cast<uint8_t>(str[i]);
+            for (int b = 0; b != 8; ++b)
+                crc = (crc >> 1) ^ (0xEDB88320 & (0u - (crc & 1)));
+        }
+        return FighterMotion::fromParts(static_cast<uint8_t>(len), ~crc);
+    }
+
+    FighterMotion addHash40(const char* str)
+    {
+        const FighterMotion motion = makeHash40(str);
+        hash40s_.emplace(motion.value(), str);
+        motions_.emplace(str, motion);
+        return motion;
+    }
+
+    void addUserLabel(const char* label, FighterMotion motion)
+    {
+        userLabels_[label].push(motion);
+        notations_.emplace(motion.value(), label);
+    }
+
+    FighterMotion toMotion(const char* hash40) const
+    {
+        auto it = motions_.find(hash40);
+        return it != motions_.end() ? it->second : FighterMotion::makeInvalid();
+    }
+
+    SmallVector<FighterMotion, 4> toMotions(FighterID fighterID, const char* label) const
+    {
+        (void)fighterID;
+        auto it = userLabels_.find(label);
+        return it != userLabels_.end() ? it->second : SmallVector<FighterMotion, 4>();
+    }
+
+    const char* toHash40(FighterMotion motion) const
+    {
+        auto it = hash40s_.find(motion.value());
+        return it != hash40s_.end() ? it->second.c_str() : nullptr;
+    }
+
+    const char* toPreferredNotation(FighterID fighterID, FighterMotion motion) const
+    {
+        (void)fighterID;
+        auto it = notations_.find(motion.value());
+        return it != notations_.end() ? it->second.c_str() : nullptr;
+    }
+
+private:
+    std::unordered_map<FighterMotion::Type, std::string> hash40s_;
+    std::unordered_map<std::string, FighterMotion> motions_;
+    std::unordered_map<std::string, SmallVector<FighterMotion, 4>> userLabels_;
+    std::unordered_map<FighterMotion::Type, std::string> notations_;
+};
+
+}
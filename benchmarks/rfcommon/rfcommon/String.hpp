@@ -0,0 +1,65 @@
+#pragma once
+
+#include "rfcommon/Hashers.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace rfcommon {
+
+class String
+{
+public:
+    String() {}
+    String(const char* str) : s_(str ? str : "") {}
+    String(const char* str, int len) : s_(str, len) {}
+
+    static String decimal(int64_t value) { return String(std::to_string(value).c_str()); }
+
+    const char* cStr() const { return s_.c_str(); }
+    const char* data() const { return s_.data(); }
+    int length() const { return static_cast<int>(s_.size()); }
+    int count() const { return static_cast<int>(s_.size()); }
+    bool isEmpty() const { return s_.empty(); }
+    bool notEmpty() const { return !s_.empty(); }
+
+    char operator[](int i) const { return s_[i]; }
+
+    String& operator+=(const String& rhs) { s_ += rhs.s_; return *this; }
+    String& operator+=(const char* rhs) { s_ += rhs; return *this; }
+    String& operator+=(char c) { s_ += c; return *this; }
+    String operator+(const String& rhs) const { String s(*this); s += rhs; return s; }
+    String operator+(const char* rhs) const { String s(*this); s += rhs; return s; }
+
+    bool operator==(const String& rhs) const { return s_ == rhs.s_; }
+    bool operator!=(const String& rhs) const { return s_ != rhs.s_; }
+    bool operator==(const char* rhs) const { return s_ == rhs; }
+    bool operator!=(const char* rhs) const { return s_ != rhs; }
+
+private:
+    std::string s_;
+};
+
+inline String operator+(const char* lhs, const String& rhs) { return String(lhs) + rhs; }
+
+template <int N>
+class SmallString : public String
+{
+public:
+    SmallString() {}
+    SmallString(const char* str) : String(str) {}
+    SmallString(const char* str, int len) : String(str, len) {}
+    SmallString(const String& str) : String(str) {}
+};
+
+template <>
+struct Hasher<String>
+{
+    typedef uint32_t HashType;
+    HashType operator()(const String& str) const
+    {
+        return hash32_jenkins_oaat(str.cStr(), str.length());
+    }
+};
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+namespace rfcommon {
+
+class Vec2
+{
+public:
+    Vec2() : x_(0.0f), y_(0.0f) {}
+    Vec2(float x, float y) : x_(x), y_(y) {}
+
+    static Vec2 fromValues(float x, float y) { return Vec2(x, y); }
+
+    float x() const { return x_; }
+    float y() const { return y_; }
+
+private:
+    float x_, y_;
+};
+
+}
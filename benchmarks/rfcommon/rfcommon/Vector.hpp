@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+namespace rfcommon {
+
+template <typename T, typename S=int>
+class Vector
+{
+public:
+    Vector() {}
+    Vector(std::initializer_list<T> init) : v_(init) {}
+
+    static Vector makeResized(S count) { Vector v; v.v_.resize(count); return v; }
+    static Vector makeReserved(S count) { Vector v; v.v_.reserve(count); return v; }
+
+    S count() const { return static_cast<S>(v_.size()); }
+    S capacity() const { return static_cast<S>(v_.capacity()); }
+    bool isEmpty() const { return v_.empty(); }
+    bool notEmpty() const { return !v_.empty(); }
+
+    T* data() { return v_.data(); }
+    const T* data() const { return v_.data(); }
+
+    T& operator[](S i) { return v_[i]; }
+    const T& operator[](S i) const { return v_[i]; }
+    T& at(S i) { return v_.at(i); }
+    const T& at(S i) const { return v_.at(i); }
+
+    T& front() { return v_.front(); }
+    const T& front() const { return v_.front(); }
+    T& back() { return v_.back(); }
+    const T& back() const { return v_.back(); }
+    // back(1) is the last element, back(2) the one before it, etc.
+    T& back(S n) { return v_[v_.size() - n]; }
+    const T& back(S n) const { return v_[v_.size() - n]; }
+
+    T* push(const T& value) { v_.push_back(value); return &v_.back(); }
+    T* push(T&& value) { v_.push_back(std::move(value)); return &v_.back(); }
+    template <typename S2>
+    void push(const Vector<T, S2>& other) { v_.insert(v_.end(), other.begin(), other.end()); }
+
+    template <typename... Args>
+    T& emplace(Args&&... args) { v_.emplace_back(std::forward<Args>(args)...); return v_.back(); }
+
+    void insert(S i, const T& value) { v_.insert(v_.begin() + i, value); }
+    void erase(S i) { v_.erase(v_.begin() + i); }
+    void erase(S i, S n) { v_.erase(v_.begin() + i, v_.begin() + i + n); }
+    void pop() { v_.pop_back(); }
+    T popValue() { T value = std::move(v_.back()); v_.pop_back(); return value; }
+
+    void resize(S count) { v_.resize(count); }
+    void reserve(S count) { v_.reserve(count); }
+    void clear() { v_.clear(); }
+    void clearCompact() { v_.clear(); v_.shrink_to_fit(); }
+
+    T* begin() { return v_.data(); }
+    T* end() { return v_.data() + v_.size(); }
+    const T* begin() const { return v_.data(); }
+    const T* end() const { return v_.data() + v_.size(); }
+
+    T* findFirst(const T& value) { return std::find(begin(), end(), value); }
+    const T* findFirst(const T& value) const { return std::find(begin(), end(), value); }
+
+private:
+    std::vector<T> v_;
+};
+
+/*!
+ * The real SmallVector keeps up to N elements inline. The stand-in always
+ * allocates, which only affects absolute timings, not the comparison between
+ * two versions of the engines.
+ */
+template <typename T, int N, typename S=int>
+class SmallVector : public Vector<T, S>
+{
+public:
+    SmallVector() {}
+    SmallVector(std::initializer_list<T> init) : Vector<T, S>(init) {}
+
+    static SmallVector makeResized(S count) { SmallVector v; v.resize(count); return v; }
+    static SmallVector makeReserved(S count) { SmallVector v; v.reserve(count); return v; }
+};
+
+}
@@ -6,8 +6,11 @@
 #include "rfcommon/MotionLabelsListener.hpp"
 #include <memory>
 
+class Diagnostics;
 class GraphModel;
 class LabelMapper;
+class PipelineCounter;
+class PipelineHistogram;
 class RegionScene;
 class SequenceSearchModel;
 class VisualizerModel;
@@ -96,11 +99,21 @@ private:
     void onFrameDataNewFrame(int frameIdx, const rfcommon::Frame<4>& frame) override final;
 
 private:
+    void finishRealtime();
+
+private:
+    std::unique_ptr<Diagnostics> diagnostics_;
     std::unique_ptr<SequenceSearchModel> seqSearchModel_;
     std::unique_ptr<GraphModel> graphModel_;
     std::unique_ptr<RegionScene> regionModel_;
     std::unique_ptr<VisualizerModel> visualizerModel_;
     rfcommon::Reference<rfcommon::Session> activeSession_;
     rfcommon::MotionLabels* labels_;
-    int noNotifyFrames_ = 0;
+
+    struct Timings
+    {
+        PipelineCounter* frames;
+        PipelineHistogram* fps;
+        PipelineHistogram* addFrame;
+    } timings_;
 };
@@ -0,0 +1,7 @@
+#pragma once
+
+class FrameSchedulerListener
+{
+public:
+    virtual void onFrameSchedulerUpdate() = 0;
+};
@@ -2,5 +2,7 @@
 
 class GraphModelListener
 {
-	virtual void onGraphModelPreferredLayerChanged() = 0;
+public:
+    virtual void onGraphModelPreferredLayerChanged() = 0;
+    virtual void onGraphModelLayoutFinished() = 0;
 };
@@ -0,0 +1,8 @@
+#pragma once
+
+class RegionSceneListener
+{
+public:
+    virtual void onRegionAdded(int regionIdx) = 0;
+    virtual void onRegionRemoved(int regionIdx) = 0;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "decision-graph/models/Graph.hpp"
+
+#include "rfcommon/String.hpp"
+#include "rfcommon/Vector.hpp"
+
+#include <cstdint>
+
+class SequenceSearchModel;
+
+namespace rfcommon {
+    class MotionLabels;
+}
+
+/*!
+ * \brief Data derived from the search results that more than one view is
+ * interested in.
+ *
+ * Everything is computed lazily the first time it is asked for and then
+ * kept until the results change. SequenceSearchModel calls invalidate()
+ * whenever that happens, so each artifact is computed at most once per
+ * results generation no matter how many views read it.
+ *
+ * References returned by this class stay valid until the next call to
+ * invalidate(). Views should not hold on to them past onQueriesApplied().
+ */
+class AnalysisCache
+{
+public:
+    struct SequenceTimings
+    {
+        //! The merged match that occurs most often across all queries, or nullptr
+        const Sequence* sequence = nullptr;
+        //! Number of frames between the first and last state of every occurrence
+        rfcommon::Vector<int> frameDurations;
+    };
+
+    AnalysisCache(const SequenceSearchModel* model, const rfcommon::MotionLabels* labels);
+    ~AnalysisCache();
+
+    /*!
+     * \brief Drops all cached data. Called by the model whenever matches,
+     * queries or POVs change.
+     */
+    void invalidate();
+    uint32_t generation() const { return generation_; }
+
+    /*!
+     * \brief Graph built from all merged matches of a query.
+     */
+    const Graph& mergedGraph(int queryIdx);
+    const rfcommon::Vector<Graph>& islands(int queryIdx);
+
+    /*!
+     * \brief Island with the most nodes, or nullptr if there are no matches.
+     */
+    const Graph* largestIsland(int queryIdx);
+
+    /*!
+     * \brief Unlimited outgoing/incoming trees of the largest island, and
+     * the unique sequences found by walking them.
+     */
+    const Graph& outgoingTree(int queryIdx);
+    const Graph& incomingTree(int queryIdx);
+    const rfcommon::Vector<Graph::UniqueSequence>& outgoingSequences(int queryIdx);
+    const rfcommon::Vector<Graph::UniqueSequence>& incomingSequences(int queryIdx);
+
+    /*!
+     * \brief Finds the most common merged match over all queries.
+     */
+    const SequenceTimings& mostCommonSequence();
+
+    /*!
+     * \brief Every match of a query in a session, converted to a string.
+     */
+    const rfcommon::Vector<rfcommon::String>& matchStrings(int queryIdx, int sessionIdx);
+
+private:
+    struct QueryAnalysis
+    {
+        Graph mergedGraph;
+        rfcommon::Vector<Graph> islands;
+        Graph outgoingTree;
+        Graph incomingTree;
+        rfcommon::Vector<Graph::UniqueSequence> outgoingSequences;
+        rfcommon::Vector<Graph::UniqueSequence> incomingSequences;
+        rfcommon::Vector<rfcommon::Vector<rfcommon::String>> sessionMatchStrings;
+        int largestIsland = -1;
+        bool hasGraph = false;
+        bool hasTrees = false;
+        bool hasMatchStrings = false;
+    };
+
+    QueryAnalysis& sync(int queryIdx);
+    void syncAll();
+    const States* playerStates() const;
+
+private:
+    const SequenceSearchModel* const model_;
+    const rfcommon::MotionLabels* const labels_;
+
+    rfcommon::Vector<QueryAnalysis> queries_;
+    SequenceTimings timings_;
+    uint32_t generation_ = 0;
+    uint32_t syncedGeneration_ = uint32_t(-1);
+    bool hasTimings_ = false;
+};
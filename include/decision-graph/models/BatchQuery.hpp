@@ -0,0 +1,147 @@
+#pragma once
+
+#include "rfcommon/FrameIndex.hpp"
+#include "rfcommon/String.hpp"
+#include "rfcommon/Vector.hpp"
+
+#include <QString>
+#include <QThreadPool>
+
+#include <cstdint>
+#include <cstdio>
+
+namespace rfcommon {
+    class MotionLabels;
+}
+
+/*!
+ * \brief Runs a list of queries over many replay files without any UI.
+ *
+ * Every file is loaded into its own SequenceSearchModel on a thread pool,
+ * and the queries are compiled and applied the same way the plugin does it
+ * (see SequenceSearchModel::compileQuery() and applyQuery()). Queries are
+ * compiled once per file, because compilation depends on the fighters in
+ * the file.
+ *
+ * Files can either be replays or state caches (see StateCache), which are
+ * detected by their ".dgsc" extension. Loading a cache skips decoding the
+ * replay and classifying its frames. If a cache directory is set, a cache is
+ * written for each replay that was loaded, so a second run over the same
+ * replays only has to read the caches.
+ *
+ * Results are kept per file in the order the files were passed in, so the
+ * output does not depend on which thread finished first.
+ */
+class BatchQuery
+{
+public:
+    struct Match
+    {
+        int fileIdx;
+        int queryIdx;
+        rfcommon::FrameIndex::Type startFrame;
+        rfcommon::FrameIndex::Type endFrame;
+        rfcommon::String sequence;
+    };
+
+    struct QueryStats
+    {
+        rfcommon::String firstError;
+        uint64_t compileTimeNS = 0;
+        uint64_t applyTimeNS = 0;
+        uint64_t maxApplyTimeNS = 0;
+        int filesCompiled = 0;
+        int filesFailed = 0;
+        int filesMatched = 0;
+        int matchCount = 0;
+    };
+
+    BatchQuery(const rfcommon::MotionLabels* labels);
+    ~BatchQuery();
+
+    /*!
+     * \brief Adds a query. Same as SequenceSearchModel::setQuery(), pass an
+     * empty string to disable the opponent query.
+     */
+    void addQuery(const char* playerQuery, const char* opponentQuery);
+    int queryCount() const { return queries_.count(); }
+
+    /*!
+     * \brief Selects the fighter queries are applied to by the player's
+     * name (or tag). If the player is not in a file, or if no name is set,
+     * the first fighter is used.
+     */
+    void setPlayerName(const char* name);
+
+    /*!
+     * \brief If set, a state cache is written into this directory for every
+     * replay that is loaded.
+     */
+    void setCacheDirectory(const QString& dir);
+
+    void setMaxThreadCount(int count);
+
+    /*!
+     * \brief Processes all files and blocks until done. Results of a
+     * previous run are discarded. Returns false if any file failed to load.
+     */
+    bool run(const rfcommon::Vector<QString>& fileNames);
+
+    int fileCount() const { return files_.count(); }
+    int failedFileCount() const;
+    const rfcommon::Vector<Match>& matches(int fileIdx) const { return files_[fileIdx].matches; }
+    const QueryStats& queryStats(int queryIdx) const { return queryStats_[queryIdx]; }
+    uint64_t loadTimeNS() const;
+    uint64_t wallTimeNS() const { return wallTimeNS_; }
+
+    /*!
+     * \brief Writes one line per match as tab separated values, with a
+     * header line.
+     */
+    void writeMatches(FILE* out) const;
+
+    /*!
+     * \brief Writes per-query counts and timings as tab separated values,
+     * followed by a summary of the whole run. Load errors are listed too.
+     */
+    void writeStats(FILE* out) const;
+
+private:
+    struct QueryStrings
+    {
+        rfcommon::String player;
+        rfcommon::String opponent;
+    };
+
+    struct QueryResult
+    {
+        rfcommon::String error;
+        uint64_t compileTimeNS = 0;
+        uint64_t applyTimeNS = 0;
+        int matchCount = 0;
+        bool compiled = false;
+    };
+
+    struct FileResult
+    {
+        QString fileName;
+        rfcommon::String sessionName;
+        rfcommon::String error;
+        rfcommon::Vector<QueryResult> queries;
+        rfcommon::Vector<Match> matches;
+        uint64_t loadTimeNS = 0;
+        bool loaded = false;
+    };
+
+    void processFile(int fileIdx);
+
+private:
+    const rfcommon::MotionLabels* const labels_;
+    QThreadPool threadPool_;
+    rfcommon::Vector<QueryStrings> queries_;
+    rfcommon::Vector<FileResult> files_;
+    rfcommon::Vector<QueryStats> queryStats_;
+    rfcommon::String playerName_;
+    QString cacheDir_;
+    uint64_t wallTimeNS_ = 0;
+};
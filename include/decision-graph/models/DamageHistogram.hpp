@@ -0,0 +1,83 @@
+#pragma once
+
+#include "rfcommon/Vector.hpp"
+
+#include <cstdint>
+
+class Range;
+class States;
+
+/*!
+ * \brief Counts at which damage percent the player was when each match
+ * started, in buckets of a configurable size.
+ *
+ * The damage values of every (query, session) pair are kept sorted. The count
+ * of a bucket is the difference between the positions of its two edges in
+ * the sorted values, which is a binary search per edge. Changing the bucket
+ * size therefore never has to look at the states again, and the counts of a
+ * query are the sum of its per-session counts, so re-applying a query only
+ * re-sorts sessions whose matches actually changed.
+ */
+class DamageHistogram
+{
+public:
+    DamageHistogram();
+    ~DamageHistogram();
+
+    void clear();
+
+    /*!
+     * \brief Resizes the table of partial results. This clears all data if
+     * the size changes.
+     */
+    void setSize(int queryCount, int sessionCount);
+    int queryCount() const { return queryCount_; }
+    int sessionCount() const { return sessionCount_; }
+
+    /*!
+     * \brief Replaces the damage values of one query in one session. Returns
+     * false if the matches are the same as last time and nothing was done.
+     */
+    bool updateSession(int queryIdx, int sessionIdx, const States& states, const rfcommon::Vector<Range>& matches);
+
+    void setBucketSize(float percent);
+    float bucketSize() const { return bucketSize_; }
+
+    /*!
+     * \brief Number of buckets needed to cover the highest damage value of
+     * all queries. Bucket "i" covers the range [i*size, (i+1)*size).
+     */
+    int bucketCount() const;
+
+    /*!
+     * \brief Number of matches per bucket for a query over all sessions. The
+     * returned vector has bucketCount() entries.
+     */
+    const rfcommon::Vector<int>& counts(int queryIdx);
+
+private:
+    struct Partial
+    {
+        rfcommon::Vector<float> sortedDamage;
+        uint64_t signature = 0;
+        bool valid = false;
+    };
+
+    struct QueryCounts
+    {
+        rfcommon::Vector<int> buckets;
+        bool dirty = true;
+    };
+
+    Partial& partial(int queryIdx, int sessionIdx)
+        { return partials_[queryIdx * sessionCount_ + sessionIdx]; }
+
+    void invalidateCounts();
+
+private:
+    rfcommon::Vector<Partial> partials_;
+    rfcommon::Vector<QueryCounts> queryCounts_;
+    int queryCount_ = 0;
+    int sessionCount_ = 0;
+    float bucketSize_ = 20.0f;
+};
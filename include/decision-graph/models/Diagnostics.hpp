@@ -0,0 +1,86 @@
+#pragma once
+
+#include "decision-graph/models/PipelineMetrics.hpp"
+
+#include "rfcommon/HashMap.hpp"
+#include "rfcommon/String.hpp"
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QThreadPool>
+
+#include <cstdint>
+
+/*!
+ * \brief Collects debug dumps (DOT files of query ASTs, NFAs and graphs) and
+ * writes them to disk on a background thread.
+ *
+ * Disabled by default. Producing a dump usually means building extra data
+ * structures and serializing them, so callers should always ask
+ * shouldWrite() first and skip all of that work if it returns false:
+ *
+ * ```cpp
+ * if (diagnostics->shouldWrite("query.dot"))
+ *     diagnostics->write("query.dot", query->toDOT(labels, fighterID));
+ * ```
+ *
+ * Each file name is rate limited separately, so typing into the query box
+ * doesn't produce a write for every keystroke.
+ *
+ * Unlike the dumps, the stage timings in metrics() are always recorded.
+ */
+class Diagnostics
+{
+public:
+    Diagnostics();
+
+    /*!
+     * \brief Waits for all pending writes to finish.
+     */
+    ~Diagnostics();
+
+    void setEnabled(bool enable);
+    bool isEnabled() const { return enabled_; }
+
+    /*!
+     * \brief Directory files are written to. An empty string means the
+     * current working directory. The directory is created if it does not
+     * exist.
+     */
+    void setOutputDirectory(const QString& dir);
+    const QString& outputDirectory() const { return outputDir_; }
+
+    /*!
+     * \brief Minimum time in milliseconds between two writes to the same
+     * file.
+     */
+    void setMinInterval(int ms);
+    int minInterval() const { return minIntervalMs_; }
+
+    /*!
+     * \brief Returns true if a dump with this name is due. Returning true
+     * counts as a write for the purpose of rate limiting, so follow up with
+     * a call to write().
+     */
+    bool shouldWrite(const char* name);
+
+    /*!
+     * \brief Queues the content to be written to a file in the output
+     * directory. Returns immediately.
+     */
+    void write(const char* name, const rfcommon::String& content);
+
+    /*!
+     * \brief Timings and counters of each stage of the pipeline.
+     */
+    PipelineMetrics* metrics() { return &metrics_; }
+
+private:
+    PipelineMetrics metrics_;
+    QThreadPool writerPool_;
+    QElapsedTimer clock_;
+    QString outputDir_;
+    rfcommon::HashMap<rfcommon::String, int64_t> lastWrite_;
+    int minIntervalMs_ = 1000;
+    bool enabled_ = false;
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "rfcommon/Vector.hpp"
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <cstdint>
+
+class FrameSchedulerListener;
+class PipelineCounter;
+class PipelineHistogram;
+class PipelineMetrics;
+
+/*!
+ * \brief Keeps the work done per frame of a live game within a fixed CPU
+ * budget.
+ *
+ * Frames arrive at 60 fps. Every frame is ingested right away, because that
+ * is cheap. Matching queries gets a slice of what is left of the budget (see
+ * SequenceSearchModel::continueApplyAllQueries()), and expensive consumers
+ * of the results, such as the graph or the pie charts, share the rest.
+ *
+ * Expensive consumers register with addConsumer() and call deferUpdate()
+ * when they would otherwise update. While realtime mode is enabled, the
+ * update is postponed and the scheduler calls
+ * FrameSchedulerListener::onFrameSchedulerUpdate() at the end of a later
+ * frame instead. The duration of every update is measured, and consumers
+ * that cost more than their share of the budget are updated less often, so
+ * each consumer settles at the highest rate it can afford. A consumer is
+ * never postponed for longer than MAX_UPDATE_INTERVAL_NS, even if that means
+ * going over budget. If no frame arrives for a while, e.g. because the game
+ * is paused, the deferred updates are flushed by a timer instead.
+ *
+ * Outside of realtime mode nothing is deferred and consumers update
+ * immediately, as before. Main thread only.
+ */
+class FrameScheduler
+{
+public:
+    static constexpr int64_t FRAME_INTERVAL_NS = 1000000000 / 60;
+    static constexpr int64_t MAX_UPDATE_INTERVAL_NS = 1000000000;
+
+    explicit FrameScheduler(PipelineMetrics* metrics, int64_t budgetNS=FRAME_INTERVAL_NS / 2);
+    ~FrameScheduler();
+
+    /*!
+     * \brief CPU time the plugin may spend on one frame. Defaults to half a
+     * frame, which leaves the rest to ReFramed and to painting.
+     */
+    void setBudget(int64_t budgetNS);
+    int64_t budget() const { return budgetNS_; }
+
+    /*!
+     * \brief The name is used for the consumer's entry in the pipeline
+     * metrics, e.g. "graph" records into "frame.graph".
+     */
+    void addConsumer(FrameSchedulerListener* consumer, const char* name);
+    void removeConsumer(FrameSchedulerListener* consumer);
+
+    /*!
+     * \brief Returns true if the consumer should not update now, because
+     * the scheduler will call it back later. Returns false if the consumer
+     * should update immediately, which is always the case outside of
+     * realtime mode.
+     */
+    bool deferUpdate(FrameSchedulerListener* consumer);
+
+    /*!
+     * \brief Enabled while a live game or training session is running.
+     * Disabling it runs all deferred updates.
+     */
+    void setRealtime(bool enable);
+    bool isRealtime() const { return realtime_; }
+
+    void beginFrame();
+
+    /*!
+     * \brief How long matching may take in this frame. Matching gets at most
+     * half of the budget, so consumers are not starved.
+     */
+    int64_t matchBudget() const;
+
+    /*!
+     * \brief Runs the deferred updates that are due, as long as they fit into
+     * what is left of the budget.
+     */
+    void endFrame();
+
+    /*!
+     * \brief Runs all deferred updates now, regardless of the budget.
+     */
+    void flush();
+
+private:
+    struct Consumer
+    {
+        FrameSchedulerListener* listener;
+        PipelineHistogram* cost;
+        int64_t lastUpdateNS;
+        double costNS;  // Moving average of the duration of an update
+        bool pending;
+    };
+
+    int findConsumer(FrameSchedulerListener* consumer) const;
+    int64_t elapsedNS() const;
+    int64_t updateInterval(const Consumer& consumer) const;
+    void runUpdate(int consumerIdx);
+
+private:
+    PipelineMetrics* const metrics_;
+    rfcommon::Vector<Consumer> consumers_;
+    QElapsedTimer clock_;
+    QTimer idleTimer_;
+    int64_t budgetNS_;
+    int64_t frameStartNS_ = 0;
+    bool realtime_ = false;
+
+    struct Timings
+    {
+        PipelineHistogram* frame;
+        PipelineHistogram* consumers;
+        PipelineCounter* overBudget;
+    } timings_;
+};
@@ -4,9 +4,15 @@
 #include "decision-graph/models/Node.hpp"
 #include "decision-graph/models/Sequence.hpp"
 
+#include "rfcommon/HashMap.hpp"
+#include "rfcommon/String.hpp"
 #include "rfcommon/Vector.hpp"
 
+#include <cassert>
+
+class DisjointSet;
 class LabelMapper;
+class TransitionMatrix;
 
 class Graph
 {
@@ -25,44 +31,142 @@ public:
         int weight;
     };
 
+    /*!
+     * \brief A view into the list of edge indices connected to a node.
+     */
+    class EdgeList
+    {
+    public:
+        EdgeList(const int* begin, const int* end) : begin_(begin), end_(end) {}
+
+        const int* begin() const { return begin_; }
+        const int* end() const { return end_; }
+        int count() const { return static_cast<int>(end_ - begin_); }
+        int operator[](int i) const { return begin_[i]; }
+
+    private:
+        const int* begin_;
+        const int* end_;
+    };
+
     void clear();
 
+    /*!
+     * \brief Builds the adjacency lists (stored in compressed sparse row
+     * format) from the list of edges. This must be called after nodes or
+     * edges are added and before the graph is traversed. Functions that
+     * return new graphs, such as islands() or outgoingTree(), already do
+     * this.
+     */
+    void finalize();
+
+    EdgeList outgoingEdges(int nodeIdx) const
+    {
+        assert(outgoingOffsets_.count() == nodes.count() + 1);
+        return EdgeList(
+            outgoingEdges_.data() + outgoingOffsets_[nodeIdx],
+            outgoingEdges_.data() + outgoingOffsets_[nodeIdx + 1]);
+    }
+
+    EdgeList incomingEdges(int nodeIdx) const
+    {
+        assert(incomingOffsets_.count() == nodes.count() + 1);
+        return EdgeList(
+            incomingEdges_.data() + incomingOffsets_[nodeIdx],
+            incomingEdges_.data() + incomingOffsets_[nodeIdx + 1]);
+    }
+
     Graph& addStates(const States& states, const rfcommon::Vector<Range>& ranges);
     Graph& addStates(const States& states, const rfcommon::Vector<Sequence>& sequences);
 
+    /*!
+     * \brief Appends all nodes and edges of another graph. You need to call
+     * finalize() after you're done adding islands.
+     */
     Graph& addIsland(const Graph& other);
 
     int findHighestThroughputNode() const;
     int findHighestThroughputEdge() const;
 
+    /*!
+     * \brief Returns the row-normalized transition probabilities between
+     * nodes. Keep the result around and call TransitionMatrix::update() if
+     * the graph changes instead of calling this repeatedly.
+     */
+    TransitionMatrix transitionMatrix() const;
+
     /*!
      * \brief Returns a list of all unconnected sub-graphs. If the graph is
      * fully connected then this will return a list of 1 graph.
      */
     rfcommon::Vector<Graph> islands() const;
 
+    /*!
+     * \brief Same as islands(), but uses precomputed connected components.
+     * GraphBuilder maintains these as edges are added.
+     */
+    rfcommon::Vector<Graph> islands(DisjointSet& components) const;
+
     /*!
      * \brief Tries to eliminate all edge connections that loop back into the
      * graph. The result is a graph with no cycles and mostly sink leaf nodes.
-     * The first node in the graph is the root node of the tree.
+     * The first node in the graph is the root node of the tree, which is the
+     * node with the highest throughput.
+     *
+     * The tree is expanded breadth-first. At most "maxDepth" levels are
+     * expanded, and for each level, only the "maxBranches" heaviest edges are
+     * followed. Negative values mean no limit.
      * \note Assumes every node in the graph is connected
      */
-    Graph outgoingTree(const States& states) const;
+    Graph outgoingTree(int maxDepth=-1, int maxBranches=-1) const;
 
     /*!
      * \brief Tries to eliminate all edge connections that loop out of the
      * graph. The result is a graph with no cycles and mostly source leaf nodes.
-     * The first node in the graph is the root node of the tree.
+     * The first node in the graph is the root node of the tree, which is the
+     * node with the highest throughput.
+     *
+     * See outgoingTree() for the meaning of "maxDepth" and "maxBranches".
      * \note Assumes every node in the graph is connected
      */
-    Graph incomingTree(const States& states) const;
+    Graph incomingTree(int maxDepth=-1, int maxBranches=-1) const;
+
+    /*!
+     * \brief Combines the outgoing and incoming trees of the node with the
+     * highest throughput into a single graph. A depth of 0 disables that
+     * direction. Nodes that appear in the outgoing tree are not repeated in
+     * the incoming tree.
+     */
+    Graph neighborhoodTree(int outgoingDepth, int incomingDepth, int maxBranches=-1) const;
+
+    /*!
+     * \brief Same as above, but looks the root up in an up to date
+     * transition matrix of this graph instead of summing up the edge weights
+     * of every node.
+     */
+    Graph neighborhoodTree(const TransitionMatrix& transitions, int outgoingDepth, int incomingDepth, int maxBranches=-1) const;
 
     rfcommon::Vector<UniqueSequence> treeToUniuqeOutgoingSequences() const;
 
     rfcommon::Vector<UniqueSequence> treeToUniqueIncomingSequences() const;
 
-    void exportDOT(const char* fileName, const States& states, const rfcommon::MotionLabels* labels) const;
+    /*!
+     * \brief Returns the graph in graphviz DOT format, for debugging.
+     */
+    rfcommon::String toDOT(const States& states, const rfcommon::MotionLabels* labels) const;
 
     rfcommon::Vector<Node> nodes;
     rfcommon::Vector<Edge> edges;
+
+private:
+    Graph neighborhoodTreeFrom(int root, int outgoingDepth, int incomingDepth, int maxBranches) const;
+    void expandTree(Graph* tree, rfcommon::HashMap<int, int>* emitted, int root, bool outgoing, int maxDepth, int maxBranches) const;
+
+private:
+    // Offsets into the edge index arrays, one entry per node + 1. The edges
+    // of node "n" are found in the range [offsets[n], offsets[n+1])
+    rfcommon::Vector<int> outgoingOffsets_;
+    rfcommon::Vector<int> incomingOffsets_;
+    rfcommon::Vector<int> outgoingEdges_;
+    rfcommon::Vector<int> incomingEdges_;
 };
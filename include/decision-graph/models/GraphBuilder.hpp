@@ -0,0 +1,89 @@
+#pragma once
+
+#include "decision-graph/models/Edge.hpp"
+#include "decision-graph/models/State.hpp"
+#include "decision-graph/util/DisjointSet.hpp"
+
+#include "rfcommon/HashMap.hpp"
+#include "rfcommon/Vector.hpp"
+
+class Graph;
+class Range;
+class Sequence;
+class States;
+
+/*!
+ * \brief Constructs a graph from ranges or sequences of states.
+ *
+ * Unlike Graph::addStates(), which has to re-create its lookup tables from
+ * all existing nodes and edges every time it is called, the builder keeps
+ * its lookup tables alive for as long as it exists. This makes it possible
+ * to feed it new matches as they arrive (e.g. during a live session) and
+ * only pay for the states that were actually added.
+ *
+ * The builder operates on a graph it does not own. Any changes made to the
+ * graph by anyone other than the builder will not be reflected in the
+ * lookup tables, so make sure to call reset() if that happens.
+ *
+ * Note that the builder does not update the graph's adjacency lists. Call
+ * Graph::finalize() once you are done adding states.
+ */
+class GraphBuilder
+{
+public:
+    /*!
+     * \brief Attaches the builder to an empty graph.
+     */
+    explicit GraphBuilder(Graph* graph);
+
+    /*!
+     * \brief Attaches the builder to a graph. If the graph already contains
+     * nodes and edges, the lookup tables are initialized from them, which
+     * requires the list of states the graph was constructed from.
+     */
+    GraphBuilder(Graph* graph, const States& states);
+    ~GraphBuilder();
+
+    /*!
+     * \brief Clears the graph and all lookup tables.
+     */
+    void clear();
+
+    /*!
+     * \brief Re-creates the lookup tables from the current contents of the
+     * graph.
+     */
+    void reset(const States& states);
+
+    /*!
+     * \brief Adds every range starting at index "firstIdx". Passing the
+     * number of ranges that were previously added lets you only process
+     * new matches.
+     */
+    GraphBuilder& addStates(const States& states, const rfcommon::Vector<Range>& ranges, int firstIdx = 0);
+    GraphBuilder& addStates(const States& states, const rfcommon::Vector<Sequence>& sequences, int firstIdx = 0);
+
+    GraphBuilder& addStates(const States& states, const Range& range);
+    GraphBuilder& addStates(const States& states, const Sequence& sequence);
+
+    Graph* graph() const { return graph_; }
+
+    /*!
+     * \brief Connected components of the graph, updated as nodes and edges
+     * are added. Can be passed to Graph::islands().
+     */
+    DisjointSet& components() { return components_; }
+
+private:
+    int addNode(const States& states, int stateIdx);
+    void addEdge(int fromNodeIdx, int toNodeIdx);
+
+private:
+    Graph* graph_;
+
+    // Maps state to a node index so we can look up existing nodes for a given state
+    rfcommon::HashMap<State, int, State::HasherNoSideData, State::CompareNoSideData> stateLookup_;
+    // Maps edge connections to edge index so we can look up existing connections
+    rfcommon::HashMap<EdgeConnection, int, EdgeConnection::Hasher> edgeLookup_;
+    DisjointSet components_;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "decision-graph/util/SpatialGrid.hpp"
+#include "rfcommon/Vector.hpp"
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QStaticText>
+
+class Graph;
+class GraphLayout;
+
+/*!
+ * \brief Draws an entire laid out graph as a single scene item.
+ *
+ * Creating one QGraphicsItem per node, label, edge and arrow head gets very
+ * slow for large graphs, both when building the scene and when clearing it.
+ * Instead, all geometry is stored in flat arrays and drawn in paint(). A
+ * spatial grid is used to only draw what is exposed, and to hit test nodes.
+ * Text layouts are cached by label, since many labels repeat.
+ */
+class GraphItem : public QGraphicsItem
+{
+public:
+    GraphItem();
+    ~GraphItem();
+
+    /*!
+     * \brief Calculates node rectangles, edge paths and arrow heads from the
+     * layout. Clears all labels.
+     */
+    void setGeometry(const Graph& graph, const GraphLayout& layout);
+
+    /*!
+     * \brief Sets the text drawn inside each node. If the hash40 arrays are
+     * not empty, three lines are drawn per node.
+     */
+    void setNodeLabels(
+            const rfcommon::Vector<QString>& labels,
+            const rfcommon::Vector<QString>& hash40Strings,
+            const rfcommon::Vector<QString>& hash40Values);
+
+    /*!
+     * \brief Sets the text drawn next to the arrow head of each edge.
+     */
+    void setEdgeLabels(const rfcommon::Vector<QString>& labels);
+
+    /*!
+     * \brief Returns the index of the node at the position (in item
+     * coordinates), or -1 if there is none.
+     */
+    int nodeAt(const QPointF& pos) const;
+
+    /*!
+     * \brief Only the nodes are hit by the mouse, not the empty space in
+     * between them. Uses nodeAt(), so the scene can hit test large graphs
+     * without testing every node.
+     */
+    bool contains(const QPointF& pos) const override;
+
+    QRectF boundingRect() const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+private:
+    const QStaticText& staticText(const QString& text) const;
+
+private:
+    QRectF bounds_;
+
+    rfcommon::Vector<QRectF> nodeRects_;
+
+    // The points of edge "e" are in [edgePointOffsets_[e], edgePointOffsets_[e+1])
+    rfcommon::Vector<int> edgePointOffsets_;
+    rfcommon::Vector<QPointF> edgePoints_;
+    // 3 points per edge
+    rfcommon::Vector<QPointF> arrowHeads_;
+    rfcommon::Vector<QPointF> edgeLabelAnchors_;
+    rfcommon::Vector<double> edgeLabelAngles_;
+
+    rfcommon::Vector<QString> nodeLabels_;
+    rfcommon::Vector<QString> hash40Strings_;
+    rfcommon::Vector<QString> hash40Values_;
+    rfcommon::Vector<QString> edgeLabels_;
+
+    SpatialGrid nodeGrid_;
+    SpatialGrid edgeGrid_;
+
+    mutable QHash<QString, QStaticText> textCache_;
+};
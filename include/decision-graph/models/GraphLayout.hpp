@@ -0,0 +1,95 @@
+#pragma once
+
+#include "rfcommon/Vector.hpp"
+
+class Graph;
+
+/*!
+ * \brief Node positions and edge bend points calculated by the layout
+ * engine, stored in flat arrays.
+ *
+ * Computing a layout does not touch any Qt objects or any of the state data,
+ * only the graph's topology and the node sizes passed in, which makes it safe
+ * to run on a worker thread.
+ */
+class GraphLayout
+{
+public:
+    enum Engine
+    {
+        /*! Picks one of the engines below depending on graph size and on
+         *  how long previous layouts took */
+        AUTO,
+        /*! Sugiyama with LP based ranking and coordinate assignment. Looks
+         *  best, but gets very slow for large graphs */
+        OPTIMAL,
+        /*! Sugiyama with longest path ranking and FastHierarchyLayout */
+        FAST,
+        /*! Like FAST but with Coffman-Graham ranking, which limits the
+         *  number of nodes per layer */
+        COMPACT,
+        /*! Multilevel force directed layout (FMMM). Edges are straight
+         *  lines. Used for graphs too large for a hierarchical layout */
+        FORCE_DIRECTED
+    };
+
+    /*!
+     * \brief Remembers how long optimal layouts took so AUTO can predict
+     * whether the next one will fit into the time budget.
+     */
+    class CostEstimate
+    {
+    public:
+        /*!
+         * \brief Predicted time in milliseconds for an optimal layout of the
+         * graph, or -1 if there is no data yet.
+         */
+        double predictOptimalMs(const Graph& graph) const;
+        void update(const Graph& graph, Engine engine, double elapsedMs);
+
+    private:
+        double optimalMsPerUnit_ = -1.0;
+    };
+
+    GraphLayout();
+    ~GraphLayout();
+
+    /*!
+     * \brief Chooses which engine to use for AUTO. Graphs above certain
+     * node or edge counts always use a faster engine. Below that, the
+     * optimal engine is used unless its predicted time exceeds the budget.
+     */
+    static Engine selectEngine(const Graph& graph, int timeBudgetMs, const CostEstimate& estimate);
+
+    /*!
+     * \brief Lays out the graph. The widths and heights arrays must have one
+     * entry per node. Passing AUTO is the same as passing OPTIMAL.
+     */
+    static GraphLayout compute(
+            const Graph& graph,
+            const rfcommon::Vector<double>& widths,
+            const rfcommon::Vector<double>& heights,
+            Engine engine = OPTIMAL);
+
+    static const char* engineName(Engine engine);
+
+    int nodeCount() const { return nodeX.count(); }
+    int edgeCount() const { return bendOffsets.count() > 0 ? bendOffsets.count() - 1 : 0; }
+    int bendCount(int edgeIdx) const { return bendOffsets[edgeIdx + 1] - bendOffsets[edgeIdx]; }
+
+    // Center position and size of each node
+    rfcommon::Vector<double> nodeX;
+    rfcommon::Vector<double> nodeY;
+    rfcommon::Vector<double> nodeW;
+    rfcommon::Vector<double> nodeH;
+
+    // The bend points of edge "e" are found in the range
+    // [bendOffsets[e], bendOffsets[e+1])
+    rfcommon::Vector<int> bendOffsets;
+    rfcommon::Vector<double> bendX;
+    rfcommon::Vector<double> bendY;
+
+    // The engine that produced this layout and how long it took
+    Engine engine = OPTIMAL;
+    double elapsedMs = 0.0;
+};
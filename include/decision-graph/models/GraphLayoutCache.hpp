@@ -0,0 +1,75 @@
+#pragma once
+
+#include "decision-graph/models/GraphLayout.hpp"
+
+#include "rfcommon/Vector.hpp"
+#include <cstdint>
+
+class Graph;
+
+/*!
+ * \brief Remembers recently calculated layouts so identical graphs don't
+ * have to be laid out again.
+ *
+ * Layouts only depend on the graph's topology, the size of each node and
+ * the engine, so that is what the cache is keyed by. Labels and edge
+ * weights are not part of the key. Node sizes are rounded to whole units so
+ * a label that is a fraction of a pixel wider still hits the cache.
+ *
+ * Entries are evicted in least-recently-used order once the capacity is
+ * reached.
+ */
+class GraphLayoutCache
+{
+public:
+    class Key
+    {
+    public:
+        Key();
+        Key(const Graph& graph,
+            const rfcommon::Vector<double>& widths,
+            const rfcommon::Vector<double>& heights,
+            GraphLayout::Engine engine);
+
+        uint32_t hash() const { return hash_; }
+
+        // Compares the full topology, the hash alone could collide
+        bool operator==(const Key& other) const;
+        bool operator!=(const Key& other) const { return !(*this == other); }
+
+    private:
+        uint32_t hash_;
+        GraphLayout::Engine engine_;
+        int nodeCount_;
+        // Pairs of (from, to) for each edge
+        rfcommon::Vector<int> edges_;
+        // Pairs of (width, height) for each node, rounded up
+        rfcommon::Vector<int> sizes_;
+    };
+
+    explicit GraphLayoutCache(int capacity = 16);
+    ~GraphLayoutCache();
+
+    /*!
+     * \brief Returns the cached layout, or nullptr if there is none. The
+     * pointer is valid until the next call to insert() or clear().
+     */
+    const GraphLayout* find(const Key& key);
+
+    void insert(const Key& key, const GraphLayout& layout);
+    void clear();
+
+    int count() const { return entries_.count(); }
+
+private:
+    struct Entry
+    {
+        Key key;
+        GraphLayout layout;
+        uint64_t lastUsed;
+    };
+
+    rfcommon::Vector<Entry> entries_;
+    uint64_t useCounter_ = 0;
+    int capacity_;
+};
@@ -1,11 +1,26 @@
 #pragma once
 
+#include "decision-graph/listeners/FrameSchedulerListener.hpp"
+#include "decision-graph/listeners/GraphModelListener.hpp"
 #include "decision-graph/listeners/SequenceSearchListener.hpp"
+#include "decision-graph/models/Graph.hpp"
+#include "decision-graph/models/GraphBuilder.hpp"
+#include "decision-graph/models/GraphLayout.hpp"
+#include "decision-graph/models/GraphLayoutCache.hpp"
+#include "decision-graph/models/GraphPruner.hpp"
+#include "decision-graph/models/TransitionMatrix.hpp"
+#include "rfcommon/HashMap.hpp"
+#include "rfcommon/ListenerDispatcher.hpp"
 #include "rfcommon/String.hpp"
 #include <QGraphicsScene>
+#include <QThreadPool>
+
+#include <atomic>
+#include <memory>
 
 class SequenceSearchModel;
-class Graph;
+class GraphItem;
+class PipelineHistogram;
 
 namespace rfcommon {
     class MotionLabels;
@@ -14,6 +29,7 @@ namespace rfcommon {
 class GraphModel
         : public QGraphicsScene
         , public SequenceSearchListener
+        , public FrameSchedulerListener
 {
 public:
     enum MergeBehavior
@@ -30,26 +46,103 @@ public:
     void setPreferredLayer(int layerIdx);
     void setOutgoingTreeSize(int size);
     void setIncomingTreeSize(int size);
+    void setTreeBranchesPerLevel(int branches);
     void setUseLargestIsland(bool enable);
     void setFixEdges(bool enable);
     void setMergeQualifiers(bool enable);
     void setShowHash40Values(bool enable);
     void setShowQualifiers(bool enable);
 
+    /*!
+     * Before the graph is laid out, edges lighter than the minimum weight or
+     * the given percentile (whichever is larger) are removed, and only the
+     * "maxNodes" nodes with the highest throughput are kept (0 = no limit).
+     * If aggregation is enabled, anything removed is summarized into "other"
+     * nodes.
+     */
+    void setPruneMinWeight(int weight);
+    void setPrunePercentile(int percentile);
+    void setPruneMaxNodes(int count);
+    void setPruneAggregate(bool enable);
+
+    /*!
+     * With AUTO, the engine is chosen based on graph size. If the optimal
+     * engine is predicted to take longer than the time budget (in
+     * milliseconds, 0 = unlimited), the fast engine is used instead.
+     */
+    void setLayoutEngine(GraphLayout::Engine engine);
+    void setLayoutTimeBudget(int ms);
+
     MergeBehavior mergeBehavior() const { return mergeBehavior_; }
     int preferredLayer() const { return preferredLayer_; }
     int outgoingTreeSize() const { return outgoingTree_; }
     int incomingTreeSize() const { return incomingTree_; }
+    int treeBranchesPerLevel() const { return treeBranches_; }
     bool useLargestIsland() const { return useLargestIsland_; }
     bool showHash40Values() const { return showHash40Values_; }
     bool showQualifiers() const { return showQualifiers_; }
+    int pruneMinWeight() const { return pruneMinWeight_; }
+    int prunePercentile() const { return prunePercentile_; }
+    int pruneMaxNodes() const { return pruneMaxNodes_; }
+    bool pruneAggregate() const { return pruneAggregate_; }
+    GraphLayout::Engine layoutEngine() const { return layoutEngine_; }
+    int layoutTimeBudget() const { return layoutTimeBudget_; }
+
+    /*!
+     * \brief The engine used for the layout currently shown, and how long
+     * it took in milliseconds.
+     */
+    GraphLayout::Engine lastLayoutEngine() const { return lastLayoutEngine_; }
+    double lastLayoutTime() const { return lastLayoutTime_; }
+    bool lastLayoutCached() const { return lastLayoutCached_; }
 
     int availableLayersCount() const;
     rfcommon::String availableLayerName(int idx) const;
 
+    /*!
+     * \brief Transition probabilities of the full graph (before trees,
+     * islands or pruning are applied). Only brought up to date when it is
+     * accessed after the graph changed, so graphs nobody asks about don't
+     * pay for it.
+     */
+    const TransitionMatrix& transitions() const;
+
+    rfcommon::ListenerDispatcher<GraphModelListener> dispatcher;
+
 private:
+    /*!
+     * \brief Updates the graph, selects the part of it to display, and lays
+     * it out.
+     */
     void redrawGraph();
 
+    /*!
+     * \brief Prunes the previously selected graph and starts laying it out on
+     * a worker thread. Used when only display settings changed. The scene is
+     * updated once the layout finishes.
+     */
+    void relayoutGraph();
+
+    struct LayoutJob;
+    void onLayoutFinished(const std::shared_ptr<LayoutJob>& job);
+
+    /*!
+     * \brief Updates the text of the labels currently in the scene without
+     * rebuilding it. Only valid if the job's layout matches the one on
+     * screen.
+     */
+    void relabelScene(const LayoutJob& job);
+    void clearScene();
+
+    /*!
+     * \brief Adds any new matches to the graph. If previously added matches
+     * have changed in the mean time, then the graph is rebuilt from scratch.
+     */
+    void updateGraph();
+    void invalidateGraph();
+
+    rfcommon::String motionString(rfcommon::FighterID fighterID, const State& state) const;
+
 private:
     void onNewSessions() override;
     void onClearAll() override;
@@ -59,6 +152,8 @@ private:
     void onQueryCompiled(int queryIdx, bool success, const char* error, bool oppSuccess, const char* oppError) override;
     void onQueriesApplied() override;
 
+    void onFrameSchedulerUpdate() override;
+
 private:
     SequenceSearchModel* searchModel_;
     rfcommon::MotionLabels* labels_;
@@ -67,9 +162,75 @@ private:
     int preferredLayer_ = -1;
     int outgoingTree_ = 0;
     int incomingTree_ = 0;
+    int treeBranches_ = 5;
     bool useLargestIsland_ = false;
     bool fixEdges_ = true;
     bool mergeQualifiers_ = false;
     bool showHash40Values_ = false;
     bool showQualifiers_ = true;
+    int pruneMinWeight_ = 1;
+    int prunePercentile_ = 0;
+    int pruneMaxNodes_ = 0;
+    bool pruneAggregate_ = true;
+    GraphLayout::Engine layoutEngine_ = GraphLayout::AUTO;
+    int layoutTimeBudget_ = 2000;
+    GraphLayout::Engine lastLayoutEngine_ = GraphLayout::OPTIMAL;
+    double lastLayoutTime_ = 0.0;
+    bool lastLayoutCached_ = false;
+
+    // The graph is built incrementally. We track how many matches of each
+    // query were added so realtime updates only have to process new matches
+    // instead of rebuilding everything
+    struct AppliedQuery
+    {
+        AppliedQuery() : lastMatch(0, 0) {}
+
+        // Number of matches added to the graph
+        int matchCount = 0;
+        // Copy of the last match added to the graph. If this no longer
+        // matches the query results, the graph needs to be rebuilt
+        Range lastMatch;
+        // Used by LABEL_MERGE to map labels to the first state with that label
+        rfcommon::HashMap<rfcommon::String, int> labelLookup;
+    };
+
+    Graph graph_;
+    GraphBuilder graphBuilder_;
+    rfcommon::Vector<AppliedQuery> appliedQueries_;
+    mutable TransitionMatrix transitions_;
+    mutable bool transitionsDirty_ = true;
+    int graphPOV_ = -1;
+
+    // The part of the graph selected for display (trees, islands), before
+    // pruning
+    Graph selectedGraph_;
+    GraphPruner graphPruner_;
+
+    // Layouts run on a separate thread. Each request increments the
+    // generation, and results from older generations are thrown away
+    QThreadPool layoutThreadPool_;
+    std::atomic<int> layoutGeneration_ = 0;
+    // Only accessed from the layout thread
+    GraphLayout::CostEstimate layoutCost_;
+
+    GraphLayoutCache layoutCache_;
+
+    struct Timings
+    {
+        PipelineHistogram* build;
+        PipelineHistogram* islands;
+        PipelineHistogram* tree;
+        PipelineHistogram* layout;
+        PipelineHistogram* scene;
+    } timings_;
+
+    // The graph currently on screen, so labels can be changed without
+    // rebuilding the scene. The item is owned by the scene
+    struct DisplayedGraph
+    {
+        GraphLayoutCache::Key key;
+        bool showHash40Values = false;
+        GraphItem* item = nullptr;
+    };
+    DisplayedGraph displayed_;
 };
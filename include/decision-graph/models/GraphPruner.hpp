@@ -0,0 +1,63 @@
+#pragma once
+
+#include "rfcommon/Vector.hpp"
+
+class Graph;
+
+/*!
+ * \brief Reduces a graph to its most important nodes and edges before it is
+ * handed to the layout engine.
+ *
+ * Edges are dropped if their weight falls below a threshold, and nodes are
+ * dropped if they are not among the N nodes with the highest throughput.
+ * Optionally, the weight of everything that was dropped is folded into two
+ * "other" summary nodes, so the weights of the remaining nodes still add up.
+ * One is a sink for the dropped edges leaving a kept node, the other is a
+ * source for the dropped edges entering one. Their stateIdx is
+ * OTHER_OUTGOING and OTHER_INCOMING respectively.
+ *
+ * Sorting the edges and nodes is the expensive part, and is done once when
+ * the graph is set. Changing the threshold afterwards only requires calling
+ * prune() again.
+ */
+class GraphPruner
+{
+public:
+    static constexpr int OTHER_OUTGOING = -1;
+    static constexpr int OTHER_INCOMING = -2;
+
+    GraphPruner();
+    ~GraphPruner();
+
+    /*!
+     * \brief Sets the graph to prune and builds the sorted edge and node
+     * indices. Must be called again if the graph is modified. The graph
+     * must outlive the pruner or be unset with clear().
+     */
+    void setGraph(const Graph* graph);
+    void clear();
+
+    /*!
+     * \brief Returns the edge weight below which the given percentage of
+     * edges fall. Returns 1 if there are no edges.
+     */
+    int weightAtPercentile(int percentile) const;
+
+    /*!
+     * \brief Creates the pruned graph.
+     * \param[in] minWeight Edges with a smaller weight than this are removed.
+     * \param[in] maxNodes Only keep this many nodes with the highest
+     * throughput. 0 means no limit.
+     * \param[in] aggregate If true, connections to removed nodes and edges
+     * are summarized into the two "other" nodes instead of being dropped.
+     */
+    Graph prune(int minWeight, int maxNodes, bool aggregate) const;
+
+private:
+    const Graph* graph_ = nullptr;
+
+    // Edge indices sorted by weight, heaviest first
+    rfcommon::Vector<int> edgesByWeight_;
+    // Node indices sorted by throughput, highest first
+    rfcommon::Vector<int> nodesByThroughput_;
+};
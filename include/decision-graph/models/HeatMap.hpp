@@ -0,0 +1,112 @@
+#pragma once
+
+#include "rfcommon/Vector.hpp"
+
+#include <QImage>
+
+#include <cstdint>
+
+class Range;
+class States;
+
+/*!
+ * \brief Bins fighter positions into a fixed-resolution grid spanning the
+ * stage and renders it as an image.
+ *
+ * Each session has its own partial grid, and the total is maintained by
+ * adding and subtracting partials. Re-binning a session whose matches did not
+ * change is skipped entirely, so adding a session to a large set of replays
+ * only costs as much as binning that one session.
+ *
+ * The grid is smoothed with a separable gaussian blur and colorized when
+ * image() is called. The result is cached until the grid or one of the
+ * display settings changes.
+ */
+class HeatMap
+{
+public:
+    HeatMap(int width=250, int height=175);
+    ~HeatMap();
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+    /*!
+     * \brief Area of stage space covered by the grid. Positions outside of
+     * this area are ignored. Changing the extents clears all data.
+     */
+    void setExtents(float left, float right, float bottom, float top);
+    float left() const { return left_; }
+    float right() const { return right_; }
+    float bottom() const { return bottom_; }
+    float top() const { return top_; }
+
+    /*!
+     * \brief Standard deviation of the blur in grid cells. 0 disables
+     * blurring.
+     */
+    void setBlurRadius(float sigma);
+    float blurRadius() const { return sigma_; }
+
+    /*!
+     * \brief Maps counts logarithmically instead of linearly, which makes
+     * rarely visited areas easier to see.
+     */
+    void setLogScale(bool enable);
+    bool logScale() const { return logScale_; }
+
+    void clear();
+
+    /*!
+     * \brief Resizes the list of partial grids. Sessions that are removed are
+     * subtracted from the total.
+     */
+    void setSessionCount(int count);
+    int sessionCount() const { return sessions_.count(); }
+
+    /*!
+     * \brief Replaces the contents of a session's grid with the positions of
+     * all states in the given range lists. Returns false if the ranges are
+     * identical to the last call and nothing had to be done.
+     */
+    bool updateSession(int sessionIdx, const States& states, const rfcommon::Vector<const rfcommon::Vector<Range>*>& rangeLists);
+
+    /*!
+     * \brief Total number of positions binned over all sessions.
+     */
+    uint64_t sampleCount() const { return sampleCount_; }
+
+    /*!
+     * \brief Returns the colorized heat map. The first row of the image is
+     * the top of the stage.
+     */
+    const QImage& image();
+
+private:
+    void binRange(rfcommon::Vector<uint32_t>* grid, const States& states, const Range& range) const;
+    void blur(rfcommon::Vector<float>* values) const;
+
+private:
+    struct Session
+    {
+        rfcommon::Vector<uint32_t> grid;
+        uint64_t signature = 0;
+        uint64_t sampleCount = 0;
+    };
+
+    const int width_;
+    const int height_;
+    float left_ = -250.0f;
+    float right_ = 250.0f;
+    float bottom_ = -150.0f;
+    float top_ = 200.0f;
+    float sigma_ = 1.5f;
+    bool logScale_ = true;
+
+    rfcommon::Vector<Session> sessions_;
+    rfcommon::Vector<uint32_t> total_;
+    uint64_t sampleCount_ = 0;
+
+    QImage image_;
+    bool imageDirty_ = true;
+};
@@ -8,18 +8,10 @@ class Node
 public:
     Node(int stateIdx) : stateIdx(stateIdx) {}
 
+    // Connections are not stored per node. See Graph::outgoingEdges() and
+    // Graph::incomingEdges()
+    //
+    // stateIdx is negative for summary nodes created by GraphPruner. See
+    // GraphPruner::OTHER_OUTGOING and GraphPruner::OTHER_INCOMING
     int stateIdx;
-    rfcommon::Vector<int> outgoingEdges;
-    rfcommon::Vector<int> incomingEdges;
-
-    // Only hashes the node state, not the outgoing/incoming connections,
-    // since we only care about unique states when building the graph
-    /*
-    struct StateHasher {
-        typedef State::HasherNoSideData::HashType HashType;
-        HashType operator()(const Node& node) const {
-            State::HasherNoSideData h;
-            return h(node.state);
-        }
-    };*/
 };
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "rfcommon/HighresTimer.hpp"
+#include "rfcommon/String.hpp"
+#include "rfcommon/Vector.hpp"
+
+#include <QElapsedTimer>
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/*!
+ * \brief Distribution of values recorded by one pipeline stage, usually
+ * durations in nanoseconds.
+ *
+ * Values are counted in log-linear buckets: Every power of two is split into
+ * SUB_BUCKETS buckets of equal width, so percentiles are accurate to within
+ * 1/SUB_BUCKETS of the value regardless of its magnitude. Recording a value
+ * is a handful of relaxed atomic operations and never allocates, so
+ * histograms can be updated from worker threads and are always on.
+ */
+class PipelineHistogram
+{
+public:
+    enum Unit
+    {
+        NANOSECONDS,
+        COUNT
+    };
+
+    PipelineHistogram(const char* name, Unit unit);
+
+    void add(uint64_t value);
+    void reset();
+
+    const rfcommon::String& name() const { return name_; }
+    Unit unit() const { return unit_; }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    uint64_t last() const { return last_.load(std::memory_order_relaxed); }
+    double mean() const;
+
+    /*!
+     * \brief Approximate value below which "p" (0-1) of all recorded values
+     * lie. Returns 0 if nothing was recorded.
+     */
+    uint64_t percentile(double p) const;
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int BUCKET_COUNT = 64 * SUB_BUCKETS;
+
+    static int bucketIdx(uint64_t value);
+    static uint64_t bucketUpperBound(int bucketIdx);
+
+    const rfcommon::String name_;
+    const Unit unit_;
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+    std::atomic<uint64_t> last_;
+    std::atomic<uint32_t> buckets_[BUCKET_COUNT];
+};
+
+/*!
+ * \brief A value that only ever goes up, e.g. the number of frames received.
+ */
+class PipelineCounter
+{
+public:
+    explicit PipelineCounter(const char* name);
+
+    void add(int64_t amount = 1) { value_.fetch_add(amount, std::memory_order_relaxed); }
+    void reset() { value_.store(0, std::memory_order_relaxed); }
+
+    const rfcommon::String& name() const { return name_; }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    const rfcommon::String name_;
+    std::atomic<int64_t> value_;
+};
+
+/*!
+ * \brief Times a scope and records the duration into a histogram when it
+ * ends, or when stop() is called.
+ *
+ * ```cpp
+ * {
+ *     PipelineTimer timer(compileTime_);
+ *     query = Query::compileAST(...);
+ * }
+ * ```
+ */
+class PipelineTimer
+{
+public:
+    explicit PipelineTimer(PipelineHistogram* histogram)
+        : histogram_(histogram)
+    {
+        timer_.start();
+    }
+
+    ~PipelineTimer() { stop(); }
+
+    uint64_t stop()
+    {
+        if (histogram_ == nullptr)
+            return 0;
+        timer_.stop();
+        const uint64_t ns = timer_.timePassedNS();
+        histogram_->add(ns);
+        histogram_ = nullptr;
+        return ns;
+    }
+
+private:
+    PipelineHistogram* histogram_;
+    rfcommon::HighresTimer timer_;
+};
+
+/*!
+ * \brief Named counters and histograms for every stage of the pipeline, from
+ * receiving frames over compiling and applying queries to updating the views.
+ *
+ * Stages look up their histograms once (usually in their constructor) and
+ * keep the pointer, which stays valid for the lifetime of this object. Look
+ * ups create the entry if it does not exist yet and must happen on the main
+ * thread. Recording values is thread safe.
+ *
+ * Names are grouped by a prefix, e.g. "query.compile" or "view.heatmap", and
+ * are listed in alphabetical order by toString().
+ */
+class PipelineMetrics
+{
+public:
+    PipelineMetrics();
+    ~PipelineMetrics();
+
+    PipelineHistogram* histogram(const char* name, PipelineHistogram::Unit unit = PipelineHistogram::NANOSECONDS);
+    PipelineCounter* counter(const char* name);
+
+    /*!
+     * \brief Counts an event and, about once per second, records how many
+     * events arrived per second into "rate". Used to measure the rate at
+     * which frames are received. Pauses longer than a few seconds are not
+     * counted as a slow rate. Main thread only.
+     */
+    void tickRate(PipelineHistogram* rate, PipelineCounter* events);
+
+    /*!
+     * \brief Clears all recorded values. Registered names are kept.
+     */
+    void reset();
+
+    /*!
+     * \brief Formats all counters and histograms as a plain text table.
+     */
+    rfcommon::String toString() const;
+
+    /*!
+     * \brief Writes toString() to a file. Returns false if the file could
+     * not be written.
+     */
+    bool dump(const QString& fileName) const;
+
+private:
+    rfcommon::Vector<std::unique_ptr<PipelineHistogram>> histograms_;
+    rfcommon::Vector<std::unique_ptr<PipelineCounter>> counters_;
+
+    struct RateWindow
+    {
+        PipelineHistogram* rate;
+        int64_t startNS;
+        int64_t startCount;
+    };
+    rfcommon::Vector<RateWindow> rateWindows_;
+    QElapsedTimer clock_;
+};
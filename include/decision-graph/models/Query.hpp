@@ -3,11 +3,14 @@
 #include "decision-graph/models/Sequence.hpp"
 #include "rfcommon/Vector.hpp"
 #include "rfcommon/FighterID.hpp"
+#include "rfcommon/String.hpp"
 #include <cstdint>
 
+class Arena;
 class LabelMapper;
 class Query;
 class Range;
+class RegionIndex;
 struct QueryASTNode;
 
 /*!
@@ -23,13 +26,23 @@ public:
         MATCH_STATUS = 0x04,  // Match the status value
     };
 
-    enum ContextQualifier
+    /*!
+     * \brief Qualifiers use the same bits as State::flags, so a state can be
+     * tested without translating anything. Qualifiers of the same group are
+     * alternatives (e.g. "hit|whiff"), but qualifiers of different groups
+     * must all apply (e.g. "rising nair hit").
+     */
+    enum ContextQualifier : uint16_t
     {
-        HIT       = 0x01,  // Move connected with the opponent
-        WHIFF     = 0x02,  // Move did not connect with the opponent or shield
-        SHIELD    = 0x04,  // Move connected with shield
-        RISING    = 0x08,  // Move is rising (y1 > y0)
-        FALLING   = 0x10   // Move is falling (y1 < y0)
+        HIT       = State::OPPONENT_IN_HITLAG,     // Move connected with the opponent
+        WHIFF     = State::WHIFF,                  // Move did not connect with the opponent or shield
+        SHIELD    = State::OPPONENT_IN_SHIELDLAG,  // Move connected with shield
+        RISING    = State::RISING,                 // Move is rising (y1 > y0)
+        FALLING   = State::FALLING,                // Move is falling (y1 < y0)
+        GROUNDED  = State::GROUNDED,               // Move started on the ground
+
+        INTERACTION_QUALIFIERS = HIT | WHIFF | SHIELD,
+        KINEMATIC_QUALIFIERS = RISING | FALLING | GROUNDED
     };
 
     /*!
@@ -43,13 +56,13 @@ public:
      * \brief Creates a wildcard which matches any hash40 (motion) or status value.
      * You can additionally specify the context in which these motion values occur.
      */
-    static Matcher wildCard(uint8_t ctxQualFlags);
+    static Matcher wildCard(uint16_t ctxQualFlags);
 
     /*!
      * \brief Creates a state that only matches hash40 (motion) values. Hit
      * type, status, and fighter flags don't matter.
      */
-    static Matcher motion(rfcommon::FighterMotion motion, uint8_t contextQualifierFlags);
+    static Matcher motion(rfcommon::FighterMotion motion, uint16_t contextQualifierFlags);
 
     //! Set this matcher as the stop condition
     Matcher& setAcceptCondition()
@@ -61,24 +74,31 @@ public:
     bool isWildcard() const
         { return !(matchFlags_ & (MATCH_MOTION | MATCH_STATUS)); }
 
-    bool inContext(ContextQualifier flag) { return !!(ctxQualFlags_ & flag); }
+    bool inContext(ContextQualifier flag) const { return !!(ctxQualFlags_ & flag); }
 
     bool matches(const State& node) const;
 
-    rfcommon::Vector<int, int16_t> next;
+    /*!
+     * \brief Outgoing transitions of this matcher are stored in the range
+     * [nextBegin(), nextEnd()) of the query's transition array.
+     */
+    int nextBegin() const { return nextBegin_; }
+    int nextEnd() const { return nextEnd_; }
 
 private:
     friend class Query;
     Matcher(
             rfcommon::FighterMotion motion,
             rfcommon::FighterStatus status,
-            uint8_t ctxQualFlags,
+            uint16_t ctxQualFlags,
             uint8_t matchFlags);
 
     rfcommon::FighterMotion motion_;
     rfcommon::FighterStatus status_;
-    uint8_t ctxQualFlags_;
+    uint16_t ctxQualFlags_;
     uint8_t matchFlags_;
+    int nextBegin_;
+    int nextEnd_;
 };
 
 class Query
@@ -87,11 +107,12 @@ public:
     /*!
      * \brief Parse a string into an AST
      * \param[in] text A string to parse.
-     * \return Returns the root node of the AST if successful. The node must
-     * be freed using QueryASTNode::destroyRecurse(). If parsing fails then
-     * nullptr is returned.
+     * \param[in] arena All nodes and labels of the AST are allocated from
+     * this arena, and are freed when the arena is reset or destroyed.
+     * \return Returns the root node of the AST if successful. If parsing
+     * fails then nullptr is returned.
      */
-    static QueryASTNode* parse(const rfcommon::String& text);
+    static QueryASTNode* parse(const rfcommon::String& text, Arena* arena);
 
     /*!
      * \brief Compiles an AST into a NFA, which can then be executed to find
@@ -104,10 +125,13 @@ public:
      * it is intended for.
      * \param[out] error If an error occurs then more information is written
      * to this string.
+     * \param[in] arena Temporary data used during compilation is allocated
+     * from this arena. Usually the same arena the AST was parsed into.
      * \return Returns the compiled query if successful. Use "delete" to delete
-     * the query later. The AST can be freed after compilation.
+     * the query later. The query does not reference the AST or the arena, so
+     * both can be freed after compilation.
      */
-    static Query* compileAST(const QueryASTNode* ast, const rfcommon::MotionLabels* labels, rfcommon::FighterID fighterID, rfcommon::String* error);
+    static Query* compileAST(const QueryASTNode* ast, const rfcommon::MotionLabels* labels, rfcommon::FighterID fighterID, rfcommon::String* error, Arena* arena);
 
     /*!
      * \brief Finds the first match within the specified range.
@@ -140,6 +164,41 @@ public:
             const States& states, const Range& range,
             const States& otherStates, const Range& otherRange) const;
 
+    /*!
+     * \brief Same as findAll(), but the search can be split over multiple
+     * calls. Only matches starting before "stopIdx" are searched for, and
+     * they are appended to "matches". Matches can still end anywhere in
+     * "range".
+     * \param[in,out] startIdx Where the search continues. Set it to
+     * range.startIdx before the first call. The search is complete once it
+     * reaches range.endIdx.
+     */
+    void continueFindAll(
+            const States& states, const Range& range,
+            int* startIdx, int stopIdx,
+            rfcommon::Vector<Range>* matches) const;
+
+    /*!
+     * \brief Same as findAllOverlapping(), but the search can be split over
+     * multiple calls. See continueFindAll().
+     * \param[in,out] otherStartIdx Where the search continues in the other
+     * state list. Set it to otherRange.startIdx before the first call.
+     */
+    void continueFindAllOverlapping(
+            const Query* otherQuery,
+            const States& states, const Range& range,
+            const States& otherStates, const Range& otherRange,
+            int* startIdx, int* otherStartIdx, int stopIdx,
+            rfcommon::Vector<Range>* matches) const;
+
+    /*!
+     * \brief Only states whose position is inside at least one of the
+     * regions in "regionMask" can be matched. A mask of 0 removes the
+     * constraint. The region index must outlive the query.
+     */
+    void setRegionConstraint(const RegionIndex* regions, uint32_t regionMask);
+    uint32_t regionMask() const { return regionMask_; }
+
     /*!
      * \brief Returns groups of motion values that would match the same label.
      * 
@@ -150,10 +209,21 @@ public:
     const rfcommon::Vector<rfcommon::SmallVector<rfcommon::FighterMotion, 4>>& mergeableMotions() const
         { return mergeableLabels_; }
 
-    void exportDOT(const char* filename, const rfcommon::MotionLabels* labels, rfcommon::FighterID fighterID);
+    /*!
+     * \brief Number of states in the NFA.
+     */
+    int matcherCount() const { return matchers_.count(); }
+
+    /*!
+     * \brief Returns the NFA in graphviz DOT format, for debugging.
+     */
+    rfcommon::String toDOT(const rfcommon::MotionLabels* labels, rfcommon::FighterID fighterID) const;
 
 private:
     friend class QueryBuilder;
     rfcommon::Vector<Matcher> matchers_;
+    rfcommon::Vector<int> transitions_;  // Indices into matchers_, see Matcher::nextBegin()
     rfcommon::Vector<rfcommon::SmallVector<rfcommon::FighterMotion, 4>> mergeableLabels_;
+    const RegionIndex* regions_ = nullptr;
+    uint32_t regionMask_ = 0;
 };
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "decision-graph/models/SequenceSearchModel.hpp"
+
+#include "rfcommon/Vector.hpp"
+
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <memory>
+
+/*!
+ * \brief Applies queries on a worker thread once the user stops editing
+ * them.
+ *
+ * Applying a query also causes the graph to be laid out again and every
+ * view to update, which is far too slow to do on every keystroke. Queries
+ * are still compiled immediately so errors show up while typing, but
+ * schedule() only restarts an idle timer. When it expires, each scheduled
+ * query is matched on a worker (see SequenceSearchModel::prepareApply()) and
+ * the results are published on the main thread, followed by a single
+ * notifyQueriesApplied() once all of them are done.
+ *
+ * Scheduling a query again while it is being matched cancels the running
+ * job. Results of jobs that were superseded, or whose data changed while
+ * they were running, are never published. In the latter case, the query is
+ * scheduled again, because nothing else would match it.
+ *
+ * Nothing is scheduled while FrameScheduler::isRealtime() is set. During live
+ * games, SequenceSearchModel::continueApplyAllQueries() matches every query
+ * again as frames come in, and new frames would reject every job anyway.
+ */
+class QueryApplyScheduler : public QObject
+{
+public:
+    explicit QueryApplyScheduler(SequenceSearchModel* model, int idleIntervalMs=250);
+    ~QueryApplyScheduler();
+
+    void schedule(int queryIdx);
+
+    /*!
+     * \brief Forgets the query and shifts the indices of the queries after
+     * it, which stay scheduled. Call this before removing the query from the
+     * model.
+     */
+    void removeQuery(int queryIdx);
+
+    /*!
+     * \brief Forgets all scheduled queries and cancels the running job.
+     */
+    void cancelAll();
+
+private:
+    void startNextJob();
+    void onJobFinished(const std::shared_ptr<SequenceSearchModel::ApplyJob>& job);
+
+private:
+    SequenceSearchModel* const model_;
+    QTimer idleTimer_;
+    QThreadPool threadPool_;
+    rfcommon::Vector<int> pendingQueries_;
+    std::shared_ptr<SequenceSearchModel::ApplyJob> runningJob_;
+    bool anyApplied_ = false;
+};
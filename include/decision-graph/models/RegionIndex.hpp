@@ -0,0 +1,85 @@
+#pragma once
+
+#include "rfcommon/Vector.hpp"
+
+#include <QRectF>
+
+#include <cstdint>
+
+/*!
+ * \brief Answers "which regions contain this position" with a single table
+ * lookup, so queries can filter large numbers of states by position.
+ *
+ * Stage space is divided into a uniform grid. Every cell stores a bit mask
+ * of the regions that cover it completely, and a second mask of regions
+ * whose edge passes through it. Only positions in an edge cell need to be
+ * compared against the actual rectangles, which is a small fraction of the
+ * stage. Positions outside of the grid fall back to comparing against all
+ * regions.
+ *
+ * Areas use stage coordinates where y points up. As with QRectF, top() is
+ * the lowest y coordinate.
+ */
+class RegionIndex
+{
+public:
+    static constexpr int MAX_REGIONS = 32;
+
+    RegionIndex(float left=-300.0f, float right=300.0f, float bottom=-200.0f, float top=250.0f, float cellSize=4.0f);
+    ~RegionIndex();
+
+    /*!
+     * \brief Adds or moves a region. Only the cells covered by the region's
+     * old and new areas are updated.
+     */
+    void setRegion(int regionIdx, const QRectF& area);
+    void removeRegion(int regionIdx);
+    void clear();
+
+    bool hasRegion(int regionIdx) const { return !!(usedMask_ & (1u << regionIdx)); }
+    uint32_t usedMask() const { return usedMask_; }
+    const QRectF& regionArea(int regionIdx) const { return areas_[regionIdx]; }
+
+    /*!
+     * \brief Returns the bit mask of all regions containing the position.
+     */
+    uint32_t lookup(float x, float y) const { return lookup(x, y, usedMask_); }
+
+    /*!
+     * \brief Returns true if the position is inside any of the regions in
+     * "regionMask".
+     */
+    bool contains(uint32_t regionMask, float x, float y) const { return lookup(x, y, regionMask) != 0; }
+
+private:
+    uint32_t lookup(float x, float y, uint32_t regionMask) const
+    {
+        const float fx = (x - left_) * invCellSize_;
+        const float fy = (y - bottom_) * invCellSize_;
+        if (fx >= 0.0f && fy >= 0.0f && fx < cellsX_ && fy < cellsY_)
+        {
+            const int cell = static_cast<int>(fy) * cellsX_ + static_cast<int>(fx);
+            const uint32_t inside = inside_[cell] & regionMask;
+            const uint32_t edge = edge_[cell] & regionMask & ~inside;
+            return edge ? inside | testAreas(x, y, edge) : inside;
+        }
+
+        return testAreas(x, y, regionMask & usedMask_);
+    }
+
+    uint32_t testAreas(float x, float y, uint32_t regionMask) const;
+    void rasterize(int regionIdx, const QRectF& area, bool set);
+
+private:
+    const float left_;
+    const float bottom_;
+    const float cellSize_;
+    const float invCellSize_;
+    const int cellsX_;
+    const int cellsY_;
+
+    rfcommon::Vector<uint32_t> inside_;
+    rfcommon::Vector<uint32_t> edge_;
+    QRectF areas_[MAX_REGIONS];
+    uint32_t usedMask_ = 0;
+};
@@ -2,9 +2,24 @@
 
 #include <QGraphicsRectItem>
 
+/*!
+ * \brief A rectangle drawn in the region editor. The scene uses y pointing
+ * down, so the item's rectangle is mirrored vertically to get the area in
+ * stage space (see stageArea()).
+ */
 class RegionItem : public QGraphicsRectItem
 {
 public:
-    RegionItem();
+    RegionItem(int regionIdx);
     ~RegionItem();
+
+    int regionIdx() const { return regionIdx_; }
+    QRectF stageArea() const;
+
+protected:
+    QVariant itemChange(GraphicsItemChange change, const QVariant& value) override;
+    void mouseReleaseEvent(QGraphicsSceneMouseEvent* event) override;
+
+private:
+    const int regionIdx_;
 };
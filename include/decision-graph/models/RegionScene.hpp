@@ -1,10 +1,39 @@
 #pragma once
 
+#include "decision-graph/models/RegionIndex.hpp"
+#include "rfcommon/ListenerDispatcher.hpp"
+
 #include <QGraphicsScene>
 
+class RegionItem;
+class RegionSceneListener;
+class SequenceSearchModel;
+
+/*!
+ * \brief Holds the regions drawn in the region editor and keeps the search
+ * model's region index in sync with them.
+ */
 class RegionScene : public QGraphicsScene
 {
 public:
-    RegionScene();
+    RegionScene(SequenceSearchModel* model);
     ~RegionScene();
+
+    /*!
+     * \brief Adds a region covering an area in stage space (y pointing up).
+     * Returns nullptr if the maximum number of regions was reached.
+     */
+    RegionItem* addRegion(const QRectF& stageArea);
+    void removeRegion(RegionItem* item);
+    RegionItem* region(int regionIdx) const { return items_[regionIdx]; }
+
+    // Called by RegionItem
+    void onRegionMoved(RegionItem* item);
+    void onRegionEdited(RegionItem* item);
+
+    rfcommon::ListenerDispatcher<RegionSceneListener> dispatcher;
+
+private:
+    SequenceSearchModel* const model_;
+    RegionItem* items_[RegionIndex::MAX_REGIONS] = {};
 };
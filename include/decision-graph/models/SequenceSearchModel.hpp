@@ -2,15 +2,27 @@
 
 #include "decision-graph/models/Sequence.hpp"
 #include "decision-graph/models/Graph.hpp"
+#include "decision-graph/models/RegionIndex.hpp"
+#include "decision-graph/models/SequenceTrie.hpp"
+#include "decision-graph/models/StageLibrary.hpp"
+#include "decision-graph/util/Arena.hpp"
 
 #include "rfcommon/ListenerDispatcher.hpp"
 #include "rfcommon/TimeStamp.hpp"
 #include "rfcommon/Vector.hpp"
 
+#include <atomic>
 #include <memory>
 
+class AnalysisCache;
+class Diagnostics;
+class FrameScheduler;
+class PipelineCounter;
+class PipelineHistogram;
 class Query;
 class SequenceSearchListener;
+class StageGeometry;
+class StateCache;
 
 namespace rfcommon {
     class FrameData;
@@ -22,7 +34,8 @@ namespace rfcommon {
 class SequenceSearchModel
 {
 public:
-    SequenceSearchModel(const rfcommon::MotionLabels* labels);
+    SequenceSearchModel(const rfcommon::MotionLabels* labels, Diagnostics* diagnostics);
+    ~SequenceSearchModel();
 
     /*
      * Allocates and prepares a new entry in the sessions structures. You
@@ -34,6 +47,16 @@ public:
     void notifyNewSessions();
     int sessionCount() const;
     const char* sessionName(int sessionIdx) const;
+    const char* sessionStageName(int sessionIdx) const;
+    const rfcommon::TimeStamp& sessionTimeStarted(int sessionIdx) const;
+
+    /*!
+     * \brief Adds a complete session from a state cache. The states were
+     * already classified when the cache was written, so this skips
+     * addFrame() entirely. Call notifyNewSessions() afterwards, like with
+     * startNewSession().
+     */
+    void addCachedSession(const StateCache& cache);
 
     /*
      * Clears all data and notifies the UI to reset everything. This is mostly
@@ -61,10 +84,12 @@ public:
     int playerPOV() const { return playerPOV_; }
     int opponentPOV() const { return opponentPOV_; }
     int fighterCount() const { return fighterStates_.count(); }
-    const rfcommon::String& playerName(int fighterIdx) const { return fighterStates_[fighterIdx].playerName; }
-    const rfcommon::String& fighterName(int fighterIdx) const { return fighterStates_[fighterIdx].fighterName; }
-    rfcommon::FighterID fighterID(int fighterIdx) const { return fighterStates_[fighterIdx].fighterID; }
-    const States& fighterStates(int fighterIdx) const { return fighterStates_[fighterIdx]; }
+    const rfcommon::String& playerName(int fighterIdx) const { return fighterStates_[fighterIdx]->playerName; }
+    const Range& sessionStateRange(int sessionIdx, int fighterIdx) const { return sessions_[sessionIdx].fighterStatesRange[fighterIdx]; }
+    const StageGeometry* sessionStage(int sessionIdx) const { return sessions_[sessionIdx].stage; }
+    const rfcommon::String& fighterName(int fighterIdx) const { return fighterStates_[fighterIdx]->fighterName; }
+    rfcommon::FighterID fighterID(int fighterIdx) const { return fighterStates_[fighterIdx]->fighterID; }
+    const States& fighterStates(int fighterIdx) const { return *fighterStates_[fighterIdx]; }
 
     /*
      * Adding a query will create a new empty entry in the list of queries and
@@ -110,6 +135,103 @@ public:
     bool applyAllQueries();
     void notifyQueriesApplied();
 
+    /*!
+     * \brief Same as applyAllQueries(), but the work is spread over multiple
+     * calls so it can be done in time slices during live games.
+     *
+     * Each call continues where the previous one left off, and matches one
+     * query against a few states of a session at a time until "budgetNS" is
+     * used up. Nothing is matched if "budgetNS" is 0, otherwise at least one
+     * chunk of states is. A query's results are replaced once all of its
+     * sessions are matched. Returns true when the last query was applied and any of them
+     * was applied successfully, at which point you should call
+     * notifyQueriesApplied(). The next call starts a new pass.
+     *
+     * Adding frames does not restart a pass, because frames are only ever
+     * appended to the last session. Any other change the results depend on
+     * does.
+     */
+    bool continueApplyAllQueries(int64_t budgetNS);
+
+    /*!
+     * \brief Decides how much work is done per frame during live games.
+     * Expensive views register with it to be updated at a lower rate.
+     */
+    FrameScheduler* frameScheduler() const { return frameScheduler_.get(); }
+
+    /*!
+     * \brief Everything needed to apply one query away from the model, and
+     * the results of doing so.
+     *
+     * The compiled queries are copied when the job is prepared. The states of
+     * both POVs and the region index are shared with the model instead. The
+     * model copies them before modifying them while a job still holds a
+     * reference (see mutableFighterStates()), so the job can run on a worker
+     * thread while the model keeps receiving frames and edits. Setting
+     * "cancelled" makes runApply() stop at the next session boundary.
+     */
+    struct ApplyJob
+    {
+        ApplyJob(
+                std::shared_ptr<const States> states,
+                std::shared_ptr<const States> oppStates,
+                std::shared_ptr<const RegionIndex> regions);
+        ~ApplyJob();
+
+        const std::shared_ptr<const States> states;
+        const std::shared_ptr<const States> oppStates;
+        const std::shared_ptr<const RegionIndex> regions;
+        std::unique_ptr<Query> query;
+        std::unique_ptr<Query> oppQuery;
+        rfcommon::Vector<Range> sessionRanges;
+        rfcommon::Vector<Range> oppSessionRanges;
+
+        rfcommon::Vector<rfcommon::Vector<Range>> sessionMatches;
+        rfcommon::Vector<rfcommon::Vector<Sequence>> sessionMergedMatches;
+
+        uint64_t generation;
+        int queryIdx;
+        std::atomic<bool> cancelled;
+    };
+
+    /*!
+     * \brief Asynchronous version of applyQuery(), split into three steps.
+     *
+     * prepareApply() snapshots the query on the main thread. Returns nullptr
+     * for the same reasons applyQuery() would return false.
+     *
+     * runApply() does the matching. It only touches the job, so it may be
+     * called from any thread.
+     *
+     * finishApply() publishes the results on the main thread. If anything
+     * the results depend on changed since the job was prepared (frames,
+     * sessions, POVs, query strings, regions), or if the job was cancelled,
+     * the results are discarded and false is returned. Otherwise, call
+     * notifyQueriesApplied() as with applyQuery().
+     */
+    std::shared_ptr<ApplyJob> prepareApply(int queryIdx) const;
+    void runApply(ApplyJob* job) const;
+    bool finishApply(ApplyJob* job);
+
+    /*!
+     * \brief Regions are rectangles in stage space drawn in the region
+     * editor. A query can be constrained to only match states inside of
+     * certain regions by passing a bit mask of region indices. Changing a
+     * region or a query's mask takes effect the next time the query is
+     * applied.
+     */
+    void setRegion(int regionIdx, const QRectF& area);
+    void removeRegion(int regionIdx);
+    const RegionIndex& regionIndex() const { return regionIndex_; }
+    void setQueryRegions(int queryIdx, uint32_t regionMask);
+    uint32_t queryRegions(int queryIdx) const { return queryRegionMasks_[queryIdx]; }
+
+    /*!
+     * \brief Re-applies only the queries that are constrained to the
+     * specified region. Returns true if any query was applied.
+     */
+    bool applyQueriesUsingRegion(int regionIdx);
+
     const rfcommon::Vector<Range>& matches(int queryIdx) const
         { return queryResults_[queryIdx].matches; }
     const rfcommon::Vector<Sequence>& mergedMatches(int queryIdx) const
@@ -119,13 +241,96 @@ public:
     const rfcommon::Vector<Sequence>& sessionMergedMatches(int queryIdx, int sessionIdx) const
         { return queryResults_[queryIdx].sessionMergedMatches[sessionIdx]; }
 
+    /*!
+     * \brief Every merged match is interned into a trie while the query is
+     * applied. The ID of mergedMatches(queryIdx)[i] is
+     * mergedMatchSequenceIDs(queryIdx)[i]. Equal IDs mean the matches have
+     * the same motion/status values, so counting and grouping matches does
+     * not require comparing states.
+     */
+    const SequenceTrie& sequenceTrie() const { return sequenceTrie_; }
+    const rfcommon::Vector<int>& mergedMatchSequenceIDs(int queryIdx) const
+        { return queryResults_[queryIdx].mergedMatchSequenceIDs; }
+
+    /*!
+     * \brief Debug dumps of queries and graphs. Views can use this too.
+     */
+    Diagnostics* diagnostics() const { return diagnostics_; }
+
+    /*!
+     * \brief Graphs, trees and strings derived from the current results.
+     * Shared by all views so each one is only computed once per apply.
+     */
+    AnalysisCache* analysis() const { return analysis_.get(); }
+
+    /*!
+     * \brief Stage geometry used to classify positions when frames are
+     * added. Each state's stageFlags() are computed from the geometry of the
+     * session it belongs to, and are 0 if the stage is unknown.
+     */
+    StageLibrary* stageLibrary() { return &stageLibrary_; }
+
     rfcommon::ListenerDispatcher<SequenceSearchListener> dispatcher;
 
 private:
+    struct SessionFighter
+    {
+        rfcommon::FighterID fighterID;
+        rfcommon::String playerName;
+        rfcommon::String fighterName;
+    };
+
+    void beginSession(
+            const rfcommon::TimeStamp& timeStarted,
+            const rfcommon::String& sessionName,
+            const char* stageName,
+            const rfcommon::SmallVector<SessionFighter, 8>& fighters);
+
+    void matchSession(
+            const Query* query, const Query* oppQuery,
+            const States& states, const Range& range,
+            const States& oppStates, const Range& oppRange,
+            rfcommon::Vector<Range>* matches,
+            rfcommon::Vector<Sequence>* mergedMatches) const;
+    void mergeMatches(
+            const Query* query, const States& states,
+            const rfcommon::Vector<Range>& matches,
+            rfcommon::Vector<Sequence>* mergedMatches) const;
+    void collectResults(int queryIdx);
+    void dumpResults(int queryIdx);
+
+    /*!
+     * \brief Returns the states of a fighter for modification. If an apply
+     * job is still reading them, they are copied first, so the job keeps
+     * seeing the version it was prepared with.
+     */
+    States& mutableFighterStates(int fighterIdx);
+
     const rfcommon::MotionLabels* const labels_;
+    Diagnostics* const diagnostics_;
 
-    // Accumulates all states spanned over all sessions for every unique fighter
-    rfcommon::Vector<States> fighterStates_;
+    struct Timings
+    {
+        PipelineHistogram* parse;
+        PipelineHistogram* compile;
+        PipelineHistogram* nfaSize;
+        PipelineHistogram* apply;
+        PipelineHistogram* applyAsync;
+        PipelineHistogram* applySlice;
+        PipelineCounter* applyDiscarded;
+        PipelineHistogram* matchSession;
+        PipelineHistogram* merge;
+    } timings_;
+    std::unique_ptr<AnalysisCache> analysis_;
+    StageLibrary stageLibrary_;
+    RegionIndex regionIndex_;
+    // Copy of regionIndex_ handed to apply jobs. Only made again after the
+    // regions changed
+    mutable std::shared_ptr<const RegionIndex> regionSnapshot_;
+
+    // Accumulates all states spanned over all sessions for every unique
+    // fighter. Shared with apply jobs, see mutableFighterStates()
+    rfcommon::Vector<std::shared_ptr<States>> fighterStates_;
 
     struct Session
     {
@@ -137,6 +342,9 @@ private:
         // be empty
         rfcommon::Vector<Range> fighterStatesRange;
         rfcommon::String sessionName;
+        rfcommon::String stageName;
+        // May be null if the stage has no geometry
+        const StageGeometry* stage;
     };
     rfcommon::Vector<Session> sessions_;
 
@@ -166,14 +374,44 @@ private:
     {
         rfcommon::Vector<Range> matches;
         rfcommon::Vector<Sequence> mergedMatches;
+        rfcommon::Vector<int> mergedMatchSequenceIDs;
         rfcommon::Vector<rfcommon::Vector<Range>> sessionMatches;
         rfcommon::Vector<rfcommon::Vector<Sequence>> sessionMergedMatches;
     };
 
     rfcommon::Vector<QueryStrings> queryStrings_;
+    rfcommon::Vector<uint32_t> queryRegionMasks_;
     rfcommon::Vector<QueryResult> queryResults_;
     rfcommon::Vector<QueryNFAs> compiledQueries_;
 
+    // ASTs and compile temporaries of the query currently being compiled.
+    // Reset at the start of every compile, so its blocks are reused
+    Arena compileArena_;
+
+    // Interned merged matches of all queries for the player POV
+    SequenceTrie sequenceTrie_;
+
+    // Incremented whenever anything a query's results depend on changes, so
+    // results of asynchronous applies can be discarded if they are out of date
+    uint64_t applyGeneration_ = 0;
+
+    // Progress of continueApplyAllQueries(). Results of the query being
+    // matched are collected here until all of its sessions are done.
+    // startIdx and oppStartIdx are where matching continues within the
+    // session, or -1 if the session wasn't started yet
+    struct SlicedApply
+    {
+        rfcommon::Vector<rfcommon::Vector<Range>> sessionMatches;
+        rfcommon::Vector<rfcommon::Vector<Sequence>> sessionMergedMatches;
+        uint64_t generation = 0;
+        int queryIdx = 0;
+        int sessionIdx = 0;
+        int startIdx = -1;
+        int oppStartIdx = -1;
+        bool anyApplied = false;
+    } slicedApply_;
+    std::unique_ptr<FrameScheduler> frameScheduler_;
+
     rfcommon::FighterID previousFighterID_;
     rfcommon::String previousPlayerName_;
     rfcommon::FighterID previousOpponentID_;
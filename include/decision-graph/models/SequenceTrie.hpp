@@ -0,0 +1,117 @@
+#pragma once
+
+#include "rfcommon/Hashers.hpp"
+#include "rfcommon/HashMap.hpp"
+#include "rfcommon/Vector.hpp"
+
+#include <cstdint>
+
+class Sequence;
+class State;
+class States;
+
+/*!
+ * \brief Interns sequences of states so that equal sequences share a single
+ * ID.
+ *
+ * Two sequences are equal if their states have the same motion and status
+ * values, in the same order. Side data (position, damage, etc.) and flags are
+ * ignored. Every distinct motion/status pair is assigned a dense "state class"
+ * ID, and sequences are stored as paths of state classes in a prefix tree.
+ * The ID of a sequence is the index of the trie node its path ends on.
+ *
+ * Each node counts how many inserted sequences end on it, so looking up how
+ * often a sequence occurred, or which sequence occurred most often, does not
+ * require going over the sequences again.
+ *
+ * Nodes are not removed individually. Releasing a sequence only decrements
+ * its count, which keeps IDs stable while other queries still hold them.
+ * Once the last sequence is released, the trie clears itself.
+ */
+class SequenceTrie
+{
+public:
+    SequenceTrie();
+    ~SequenceTrie();
+
+    void clear();
+
+    /*!
+     * \brief Adds the sequence and returns its ID.
+     */
+    int insert(const States& states, const Sequence& seq);
+
+    /*!
+     * \brief Undoes one insert() of a sequence with this ID.
+     */
+    void release(int sequenceID);
+
+    /*!
+     * \brief Number of times a sequence with this ID is currently inserted.
+     */
+    int count(int sequenceID) const { return nodes_[sequenceID].count; }
+
+    /*!
+     * \brief Number of states in the sequence.
+     */
+    int length(int sequenceID) const { return nodes_[sequenceID].depth; }
+
+    /*!
+     * \brief Reconstructs a sequence of state indices with this ID. Each
+     * index is taken from the first sequence that created the trie node, so
+     * the states are suitable for labeling but may come from different
+     * matches. Use the original match if side data is needed.
+     */
+    Sequence sequence(int sequenceID) const;
+
+    /*!
+     * \brief Returns the ID with the highest count, or -1 if nothing is
+     * inserted.
+     */
+    int mostCommon() const;
+
+    /*!
+     * \brief Returns the IDs of all sequences with a non-zero count.
+     */
+    rfcommon::Vector<int> uniqueSequences() const;
+
+    int stateClassCount() const { return classCount_; }
+    int nodeCount() const { return nodes_.count(); }
+
+private:
+    int stateClass(const State& state);
+
+    struct Node
+    {
+        Node(int parent, int stateIdx, int depth)
+            : parent(parent), stateIdx(stateIdx), depth(depth), count(0)
+        {}
+
+        int parent;
+        int stateIdx;
+        int depth;
+        int count;
+    };
+
+    struct KeyHasher
+    {
+        typedef uint32_t HashType;
+        HashType operator()(uint64_t key) const {
+            return rfcommon::hash32_combine(
+                static_cast<uint32_t>(key),
+                static_cast<uint32_t>(key >> 32));
+        }
+    };
+
+    // Node 0 is the root and represents the empty sequence
+    rfcommon::Vector<Node> nodes_;
+    // Maps (motion << 16 | status) to a dense state class ID
+    rfcommon::HashMap<uint64_t, int, KeyHasher> classes_;
+    // Maps (parent node << 32 | state class) to the child node
+    rfcommon::HashMap<uint64_t, int, KeyHasher> children_;
+    int classCount_ = 0;
+    int totalCount_ = 0;
+
+    mutable int mostCommon_ = -1;
+    mutable bool mostCommonDirty_ = false;
+};
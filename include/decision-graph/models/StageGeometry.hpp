@@ -0,0 +1,97 @@
+#pragma once
+
+#include "decision-graph/util/SpatialGrid.hpp"
+#include "rfcommon/Vector.hpp"
+
+#include <QRectF>
+#include <QString>
+
+#include <cstdint>
+
+/*!
+ * \brief Collision geometry of a stage, loaded from the game's binary LVD
+ * ("level data") files.
+ *
+ * Only what is needed to classify fighter positions is kept: The surfaces
+ * fighters can stand on, ledge positions and the blast zones. Everything is
+ * stored in flat arrays, and the surfaces are indexed with a uniform grid so
+ * classifying a position only looks at the few surfaces near it.
+ *
+ * The classification of a position is returned as a set of bits (see
+ * "Flag"). This is computed once per state when frames are added, so queries
+ * and visualizations only have to test a bit instead of doing any geometry.
+ */
+class StageGeometry
+{
+public:
+    enum Flag : uint8_t
+    {
+        GROUNDED = 0x01,  // Standing on the main stage
+        PLATFORM = 0x02,  // Standing on a drop-through platform
+        LEDGE    = 0x04,  // Close to one of the ledges
+        OFFSTAGE = 0x08,  // Horizontally beyond or below the main stage
+    };
+
+    struct Segment
+    {
+        float x0, y0, x1, y1;
+        bool isPlatform;
+    };
+
+    StageGeometry();
+    ~StageGeometry();
+
+    /*!
+     * \brief Memory-maps and parses an LVD file. Returns false if the file
+     * could not be opened, is malformed, or has no main stage (only
+     * platforms), in which case the geometry is left empty.
+     */
+    bool load(const QString& fileName);
+    bool load(const uint8_t* data, int size);
+    void clear();
+
+    bool isEmpty() const { return surfaces_.count() == 0; }
+
+    /*!
+     * \brief Line segments fighters can stand on. Walls and ceilings are not
+     * included.
+     */
+    const rfcommon::Vector<Segment>& surfaces() const { return surfaces_; }
+    const rfcommon::Vector<QPointF>& ledges() const { return ledges_; }
+    const rfcommon::Vector<QPointF>& spawns() const { return spawns_; }
+
+    /*!
+     * \brief Area outside of which a fighter is KO'd. "top()" of the rect
+     * is the lowest y coordinate (QRectF conventions), not the top of the
+     * stage.
+     */
+    const QRectF& blastZone() const { return blastZone_; }
+    const QRectF& cameraBounds() const { return cameraBounds_; }
+
+    /*!
+     * \brief Horizontal extent of the main stage's floor and the y
+     * coordinate of its lowest point.
+     */
+    float stageLeft() const { return stageLeft_; }
+    float stageRight() const { return stageRight_; }
+    float stageBottom() const { return stageBottom_; }
+
+    /*!
+     * \brief Returns a combination of "Flag" bits for a position.
+     */
+    uint8_t classify(float x, float y) const;
+
+private:
+    void buildIndex();
+
+private:
+    rfcommon::Vector<Segment> surfaces_;
+    rfcommon::Vector<QPointF> ledges_;
+    rfcommon::Vector<QPointF> spawns_;
+    QRectF blastZone_;
+    QRectF cameraBounds_;
+    SpatialGrid surfaceIndex_;
+    float stageLeft_ = 0.0f;
+    float stageRight_ = 0.0f;
+    float stageBottom_ = 0.0f;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "rfcommon/String.hpp"
+#include "rfcommon/Vector.hpp"
+
+#include <QString>
+
+#include <memory>
+
+class StageGeometry;
+
+/*!
+ * \brief Finds and loads the LVD file belonging to a stage. Stages are
+ * looked up by the name ReFramed uses for them, e.g. "Battlefield" or
+ * "Final Destination", and are only loaded once.
+ *
+ * Files are expected in "<dataDir>/<stage dir>/normal/param/", where the
+ * stage directory is the game's internal name of the stage (e.g. "end" for
+ * Final Destination). By default, dataDir is the "decision-graph/stage"
+ * directory that is installed next to the plugin.
+ */
+class StageLibrary
+{
+public:
+    StageLibrary();
+    explicit StageLibrary(const QString& dataDir);
+    ~StageLibrary();
+
+    /*!
+     * \brief Returns "decision-graph/stage" in the directory the plugin (or
+     * the batch runner) was loaded from. Falls back to "data/stage" relative
+     * to the working directory, which is where the data lives in the source
+     * tree.
+     */
+    static QString defaultDataDir();
+
+    /*!
+     * \brief Changing the directory forgets all previously loaded stages.
+     */
+    void setDataDir(const QString& dataDir);
+    const QString& dataDir() const { return dataDir_; }
+
+    /*!
+     * \brief Returns the geometry of a stage, or nullptr if the stage is
+     * unknown or its file could not be loaded. Failures are remembered so
+     * the file system is only searched once per stage.
+     */
+    const StageGeometry* find(const char* stageName);
+
+private:
+    QString findFile(const char* stageName) const;
+
+private:
+    struct Entry
+    {
+        rfcommon::String stageName;
+        std::unique_ptr<StageGeometry> geometry;
+    };
+
+    QString dataDir_;
+    rfcommon::Vector<Entry> entries_;
+};
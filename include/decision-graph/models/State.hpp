@@ -21,6 +21,28 @@ public:
         SHIELD_LAG,
     };
 
+    /*!
+     * \brief Bits stored in "flags". Everything a query qualifier can test
+     * is computed once when the state is added, so matching a qualifier is a
+     * single mask test.
+     */
+    enum Flag : uint16_t
+    {
+        IN_HITLAG             = 0x0001,
+        IN_HITSTUN            = 0x0002,
+        IN_SHIELDLAG          = 0x0004,
+        OPPONENT_IN_HITLAG    = 0x0008,
+        OPPONENT_IN_HITSTUN   = 0x0010,
+        OPPONENT_IN_SHIELDLAG = 0x0020,
+        WHIFF                 = 0x0040,  // Opponent neither in hitlag nor in shieldlag
+        RISING                = 0x0080,  // y increased since the previous frame
+        FALLING               = 0x0100,  // y decreased since the previous frame
+        GROUNDED              = 0x0200,  // Standing on the stage or a platform
+
+        // Upper 4 bits hold StageGeometry::Flag
+        STAGE_FLAGS_SHIFT     = 12,
+    };
+
     State(
             const SideData& sideData,
             rfcommon::FighterMotion motion,
@@ -31,18 +53,54 @@ public:
         , sideData(sideData)
         , status(status)
         , flags(makeFlags(inHitlag, inHitstun, inShieldlag, oppInHitlag, oppInHitstun, oppInShieldlag))
+    {
+        if (!(flags & (OPPONENT_IN_HITLAG | OPPONENT_IN_SHIELDLAG)))
+            flags |= WHIFF;
+    }
+
+    /*!
+     * \brief Restores a state with flags that were computed earlier, e.g.
+     * when loading a StateCache.
+     */
+    State(
+            const SideData& sideData,
+            rfcommon::FighterMotion motion,
+            rfcommon::FighterStatus status,
+            uint16_t flags)
+        : motion(motion)
+        , sideData(sideData)
+        , status(status)
+        , flags(flags)
     {}
 
-    static uint8_t makeFlags(
+    static uint16_t makeFlags(
             bool inHitlag, bool inHitstun, bool inShieldlag,
             bool opponentInHitlag, bool opponentInHitstun, bool opponentInShieldlag)
     {
-        return  (static_cast<uint8_t>(inHitlag) << 0)
-              | (static_cast<uint8_t>(inHitstun) << 1)
-              | (static_cast<uint8_t>(inShieldlag) << 2)
-              | (static_cast<uint8_t>(opponentInHitlag) << 3)
-              | (static_cast<uint8_t>(opponentInHitstun) << 4)
-              | (static_cast<uint8_t>(opponentInShieldlag) << 5);
+        return  (static_cast<uint16_t>(inHitlag) << 0)
+              | (static_cast<uint16_t>(inHitstun) << 1)
+              | (static_cast<uint16_t>(inShieldlag) << 2)
+              | (static_cast<uint16_t>(opponentInHitlag) << 3)
+              | (static_cast<uint16_t>(opponentInHitstun) << 4)
+              | (static_cast<uint16_t>(opponentInShieldlag) << 5);
+    }
+
+    static uint16_t makeKinematicFlags(bool isRising, bool isFalling, bool isGrounded)
+    {
+        return  (static_cast<uint16_t>(isRising) << 7)
+              | (static_cast<uint16_t>(isFalling) << 8)
+              | (static_cast<uint16_t>(isGrounded) << 9);
+    }
+
+    /*!
+     * \brief A move can start before it connects. This adds interaction
+     * flags from later frames and keeps the derived WHIFF bit consistent.
+     */
+    void addInteractionFlags(uint16_t interactionFlags)
+    {
+        flags |= interactionFlags;
+        if (flags & (OPPONENT_IN_HITLAG | OPPONENT_IN_SHIELDLAG))
+            flags &= ~WHIFF;
     }
 
     InteractionQualifier interaction() const
@@ -60,12 +118,22 @@ public:
         return NO_INTERACTION;
     }
 
-    bool inHitlag() const { return !!(flags & 0x01); }
-    bool inHitstun() const { return !!(flags & 0x02); }
-    bool inShieldlag() const { return !!(flags & 0x04); }
-    bool opponentInHitlag() const { return !!(flags & 0x08); }
-    bool opponentInHitstun() const { return !!(flags & 0x10); }
-    bool opponentInShieldlag() const { return !!(flags & 0x20); }
+    bool inHitlag() const { return !!(flags & IN_HITLAG); }
+    bool inHitstun() const { return !!(flags & IN_HITSTUN); }
+    bool inShieldlag() const { return !!(flags & IN_SHIELDLAG); }
+    bool opponentInHitlag() const { return !!(flags & OPPONENT_IN_HITLAG); }
+    bool opponentInHitstun() const { return !!(flags & OPPONENT_IN_HITSTUN); }
+    bool opponentInShieldlag() const { return !!(flags & OPPONENT_IN_SHIELDLAG); }
+    bool isRising() const { return !!(flags & RISING); }
+    bool isFalling() const { return !!(flags & FALLING); }
+    bool isGrounded() const { return !!(flags & GROUNDED); }
+
+    //! See StageGeometry::Flag
+    uint8_t stageFlags() const { return static_cast<uint8_t>(flags >> STAGE_FLAGS_SHIFT); }
+    void setStageFlags(uint8_t stageFlags)
+    {
+        flags = (flags & ((1 << STAGE_FLAGS_SHIFT) - 1)) | static_cast<uint16_t>(stageFlags << STAGE_FLAGS_SHIFT);
+    }
 
     // Data not relevant when comparing states
     struct SideData
@@ -87,10 +155,38 @@ public:
         const rfcommon::FrameIndex frameIndex;
     };
 
+    // We only hash motion, status and flags, and NOT timings/position/shield/damage,
+    // because for the purpose of searching for unique states and building graphs,
+    // those values are irrelevant
+    struct HasherNoSideData
+    {
+        typedef uint32_t HashType;
+        HashType operator()(const State& node) const {
+            const uint32_t motion_l = node.motion.lower();
+            const uint16_t status = node.status.value();
+            const uint8_t motion_h = node.motion.upper();
+            const uint8_t interaction = node.interaction();
+
+            const uint32_t a = motion_l;
+            const uint32_t b = (status << 16) | (motion_h << 8) | (interaction << 0);
+            return rfcommon::hash32_combine(a, b);
+        }
+    };
+
+    struct CompareNoSideData
+    {
+        bool operator()(const State& a, const State& b) const {
+            return
+                a.motion == b.motion &&
+                a.status == b.status &&
+                a.interaction() == b.interaction();
+        }
+    };
+
     const rfcommon::FighterMotion motion;        // u64
     const SideData sideData;                     // f32, f32, f32, f32, u32
     const rfcommon::FighterStatus status;        // u16
-    uint8_t flags;                               // u8
+    uint16_t flags;                              // u16, see Flag
 
 private:
     bool operator==(const State& other) const { return false; }
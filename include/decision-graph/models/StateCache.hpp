@@ -0,0 +1,74 @@
+#pragma once
+
+#include "decision-graph/models/Sequence.hpp"
+
+#include "rfcommon/String.hpp"
+#include "rfcommon/Vector.hpp"
+
+#include <QString>
+
+#include <cstdint>
+
+class SequenceSearchModel;
+
+/*!
+ * \brief The classified states of a single session, in a compact binary
+ * format that loads without decoding a replay.
+ *
+ * Decoding replay files and running every frame through
+ * SequenceSearchModel::addFrame() dominates the time it takes to query a
+ * large number of replays. The cache stores the result of that step, i.e.
+ * the states of each fighter including their flags, so re-running queries
+ * over the same replays only has to read a flat file.
+ *
+ * The format is little-endian:
+ *
+ *   "DGSC", u32 version, u64 timeStarted (ms since epoch),
+ *   str sessionName, str stageName, u8 fighterCount,
+ *   fighterCount * {
+ *       u8 fighterID, str playerName, str fighterName, u32 stateCount,
+ *       stateCount * {
+ *           u64 motion, u32 frameIndex, f32 x, f32 y, f32 damage, f32 shield,
+ *           u16 status, u16 flags
+ *       }
+ *   }
+ *
+ * where "str" is a u16 length followed by that many bytes of UTF-8.
+ */
+class StateCache
+{
+public:
+    StateCache();
+    ~StateCache();
+
+    void clear();
+
+    /*!
+     * \brief Copies the states of a session out of the model. Fighters that
+     * have no states in the session are skipped. Returns false if the
+     * session index is out of range.
+     */
+    bool copyFrom(const SequenceSearchModel& model, int sessionIdx);
+
+    bool save(const QString& fileName) const;
+
+    /*!
+     * \brief Reads a cache file. Returns false if the file could not be
+     * opened, has a different version, or is malformed, in which case the
+     * cache is left empty.
+     */
+    bool load(const QString& fileName);
+    bool load(const uint8_t* data, int size);
+
+    uint64_t timeStarted() const { return timeStarted_; }
+    const rfcommon::String& sessionName() const { return sessionName_; }
+    const rfcommon::String& stageName() const { return stageName_; }
+    int fighterCount() const { return fighterStates_.count(); }
+    const States& fighterStates(int fighterIdx) const { return fighterStates_[fighterIdx]; }
+
+private:
+    rfcommon::Vector<States> fighterStates_;
+    rfcommon::String sessionName_;
+    rfcommon::String stageName_;
+    uint64_t timeStarted_ = 0;
+};
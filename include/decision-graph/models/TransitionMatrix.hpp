@@ -0,0 +1,136 @@
+#pragma once
+
+#include "rfcommon/Vector.hpp"
+
+class Graph;
+
+/*!
+ * \brief Row-normalized transition probabilities between the nodes of a
+ * graph, stored in compressed sparse row format.
+ *
+ * Row "n" holds every node reachable from "n" in one step, together with
+ * the probability of taking that edge (its weight divided by the total
+ * outgoing weight of "n"). This lets views answer "what does the player do
+ * after X, and how often" in O(degree) without extracting trees.
+ *
+ * Per-node incoming/outgoing totals and the entropy of each row (how
+ * predictable the next option is) are maintained alongside. The stationary
+ * distribution is computed on demand and cached until the next change.
+ */
+class TransitionMatrix
+{
+public:
+    /*!
+     * \brief A view into one row of the matrix.
+     */
+    class Row
+    {
+    public:
+        Row(const int* targets, const int* edges, const double* probabilities, int count)
+            : targets_(targets), edges_(edges), probabilities_(probabilities), count_(count) {}
+
+        int count() const { return count_; }
+        int target(int i) const { return targets_[i]; }
+        int edge(int i) const { return edges_[i]; }
+        double probability(int i) const { return probabilities_[i]; }
+
+    private:
+        const int* targets_;
+        const int* edges_;
+        const double* probabilities_;
+        int count_;
+    };
+
+    TransitionMatrix();
+    explicit TransitionMatrix(const Graph& graph);
+    ~TransitionMatrix();
+
+    /*!
+     * \brief Rebuilds the matrix from scratch. The graph must be finalized.
+     */
+    void build(const Graph& graph);
+
+    /*!
+     * \brief Brings the matrix up to date with the graph. If only edge
+     * weights changed, only the affected rows are recalculated. If nodes or
+     * edges were added, the matrix is rebuilt.
+     */
+    void update(const Graph& graph);
+
+    /*!
+     * \brief Changes the weight of a single edge and recalculates its row.
+     */
+    void setEdgeWeight(int edgeIdx, int weight);
+
+    void clear();
+
+    int nodeCount() const { return outgoingTotals_.count(); }
+    int edgeCount() const { return targets_.count(); }
+
+    Row row(int nodeIdx) const
+    {
+        const int begin = rowOffsets_[nodeIdx];
+        return Row(
+            targets_.data() + begin,
+            edges_.data() + begin,
+            probabilities_.data() + begin,
+            rowOffsets_[nodeIdx + 1] - begin);
+    }
+
+    /*!
+     * \brief Probability of going from one node to the other in one step,
+     * or 0 if they aren't connected. O(out-degree).
+     */
+    double probability(int fromNodeIdx, int toNodeIdx) const;
+
+    int outgoingTotal(int nodeIdx) const { return outgoingTotals_[nodeIdx]; }
+    int incomingTotal(int nodeIdx) const { return incomingTotals_[nodeIdx]; }
+
+    /*!
+     * \brief The smaller of the incoming and outgoing totals. Same definition
+     * as Graph::findHighestThroughputNode().
+     */
+    int throughput(int nodeIdx) const;
+    int highestThroughputNode() const;
+
+    /*!
+     * \brief Shannon entropy of the node's outgoing probabilities in bits.
+     * 0 means the next option is always the same.
+     */
+    double entropy(int nodeIdx) const { return entropies_[nodeIdx]; }
+
+    /*!
+     * \brief Long-run fraction of time spent in each node, calculated by
+     * power iteration.
+     *
+     * Decision graphs usually have dead ends and are rarely irreducible, so
+     * like PageRank, with probability (1 - damping) the walk jumps to a
+     * random node. Dead ends always jump to a random node.
+     */
+    const rfcommon::Vector<double>& stationaryDistribution(
+            double damping = 0.85,
+            int maxIterations = 100,
+            double tolerance = 1e-9) const;
+
+private:
+    void updateRow(int nodeIdx);
+
+private:
+    // Entries of row "n" are in [rowOffsets_[n], rowOffsets_[n+1])
+    rfcommon::Vector<int> rowOffsets_;
+    rfcommon::Vector<int> targets_;
+    rfcommon::Vector<int> edges_;
+    rfcommon::Vector<int> weights_;
+    rfcommon::Vector<double> probabilities_;
+
+    // Maps a graph edge index to its position in the arrays above
+    rfcommon::Vector<int> edgeEntries_;
+    rfcommon::Vector<int> edgeSources_;
+
+    rfcommon::Vector<int> outgoingTotals_;
+    rfcommon::Vector<int> incomingTotals_;
+    rfcommon::Vector<double> entropies_;
+
+    mutable rfcommon::Vector<double> stationary_;
+    mutable double stationaryDamping_ = -1.0;
+};
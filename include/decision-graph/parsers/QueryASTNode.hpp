@@ -1,8 +1,18 @@
 #pragma once
 
 #include "rfcommon/String.hpp"
+#include <cstdint>
 #include <new>
 
+class Arena;
+
+/*!
+ * \brief Node of the tree produced by Query::parse().
+ *
+ * Nodes, and the label strings they point to, are allocated from the arena
+ * passed to the parser and are never freed individually. The tree is valid
+ * until the arena is reset or destroyed.
+ */
 struct QueryASTNode
 {
     enum Type
@@ -23,7 +33,8 @@ struct QueryASTNode
         WHIFF   = 0x0008,
         RISING  = 0x0010,
         FALLING = 0x0020,
-        IDJ     = 0x0040
+        IDJ     = 0x0040,
+        GROUNDED = 0x0080
     };
 
     struct Statement {
@@ -56,10 +67,10 @@ struct QueryASTNode
     };
 
     struct Labels {
-        Labels(const char* label) : label(label) {}
+        Labels(const char* label) : label(label), oppLabel("") {}
         Labels(const char* label, const char* oppLabel) : label(label), oppLabel(oppLabel) {}
-        rfcommon::SmallString<7> label;
-        rfcommon::SmallString<7> oppLabel;
+        const char* label;
+        const char* oppLabel;
     };
 
 private:
@@ -71,23 +82,25 @@ private:
     QueryASTNode(const char* label) : type(LABEL), labels(label) {}
     QueryASTNode(const char* label, const char* oppLabel) : type(LABEL), labels(label, oppLabel) {}
     QueryASTNode(ContextQualifier contextQualifier) : type(CONTEXT_QUALIFIER), contextQualifier(contextQualifier) {}
-    ~QueryASTNode() {}
 
 public:
-    static QueryASTNode* newStatement(QueryASTNode* child, QueryASTNode* next);
-    static QueryASTNode* newRepitition(QueryASTNode* child, int minreps, int maxreps);
-    static QueryASTNode* newUnion(QueryASTNode* child, QueryASTNode* next);
-    static QueryASTNode* newInversion(QueryASTNode* child);
-    static QueryASTNode* newWildcard();
-    static QueryASTNode* newLabel(const char* label);
-    static QueryASTNode* newLabel(const char* label, const char* oppLabel);
-    static QueryASTNode* newContextQualifier(QueryASTNode* child, uint8_t contextQualifierFlags);
-    static QueryASTNode* newDamageRange(QueryASTNode* child, int lower, int upper);
-
-    static void destroySingle(QueryASTNode* node);
-    static void destroyRecurse(QueryASTNode* node);
+    /*
+     * Label strings are not copied. They have to live as long as the arena,
+     * which is the case for strings returned by the scanner.
+     */
+    static QueryASTNode* newStatement(Arena* arena, QueryASTNode* child, QueryASTNode* next);
+    static QueryASTNode* newRepitition(Arena* arena, QueryASTNode* child, int minreps, int maxreps);
+    static QueryASTNode* newUnion(Arena* arena, QueryASTNode* child, QueryASTNode* next);
+    static QueryASTNode* newInversion(Arena* arena, QueryASTNode* child);
+    static QueryASTNode* newWildcard(Arena* arena);
+    static QueryASTNode* newLabel(Arena* arena, const char* label);
+    static QueryASTNode* newLabel(Arena* arena, const char* label, const char* oppLabel);
+    static QueryASTNode* newContextQualifier(Arena* arena, QueryASTNode* child, uint8_t contextQualifierFlags);
 
-    void exportDOT(const char* filename) const;
+    /*!
+     * \brief Returns the tree in graphviz DOT format, for debugging.
+     */
+    rfcommon::String toDOT() const;
 
     union {
         Statement statement;
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*!
+ * \brief Monotonic allocator for short-lived data that is freed all at once,
+ * such as the AST and temporaries of a query compilation.
+ *
+ * Allocating is a pointer bump. Memory is taken from a list of blocks and is
+ * only given back when the arena is reset or destroyed. Destructors are
+ * never called, so only trivially destructible types can be created.
+ *
+ * reset() keeps the largest block around, so an arena that is reused for
+ * similar work (e.g. compiling the same query after every keystroke) stops
+ * allocating from the heap after the first few uses.
+ */
+class Arena
+{
+public:
+    explicit Arena(int blockSize=4096);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(int size, int align=alignof(std::max_align_t))
+    {
+        const uintptr_t p = (reinterpret_cast<uintptr_t>(head_) + (align - 1)) & ~static_cast<uintptr_t>(align - 1);
+        if (p + size > reinterpret_cast<uintptr_t>(end_))
+            return allocateBlock(size, align);
+        head_ = reinterpret_cast<char*>(p + size);
+        return reinterpret_cast<void*>(p);
+    }
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena never calls destructors");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    /*!
+     * \brief Uninitialized storage for "count" objects of type T.
+     */
+    template <typename T>
+    T* allocateArray(int count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena never calls destructors");
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    /*!
+     * \brief Copies "len" characters and appends a null terminator.
+     */
+    char* strdup(const char* str, int len)
+    {
+        char* dup = static_cast<char*>(allocate(len + 1, 1));
+        memcpy(dup, str, len);
+        dup[len] = '\0';
+        return dup;
+    }
+
+    /*!
+     * \brief Invalidates everything allocated so far. The largest block is
+     * kept for the next use.
+     */
+    void reset();
+
+    /*!
+     * \brief Total size of all blocks currently held.
+     */
+    int capacity() const;
+
+private:
+    void* allocateBlock(int size, int align);
+
+    struct Block
+    {
+        Block* next;
+        int size;
+    };
+
+    Block* blocks_ = nullptr;
+    char* head_ = nullptr;
+    char* end_ = nullptr;
+    const int blockSize_;
+};
+
+/*!
+ * \brief Growable array whose storage comes from an arena.
+ *
+ * Growing allocates a new buffer twice the size and leaves the old one to
+ * the arena. Elements are copied with memcpy, so T must be trivially
+ * copyable. Copying an ArenaVector is shallow: both copies refer to the same
+ * elements, so only use one of them afterwards. Use assign() or push() with
+ * another vector to copy elements.
+ */
+template <typename T>
+class ArenaVector
+{
+    static_assert(std::is_trivially_copyable<T>::value, "ArenaVector elements are copied with memcpy");
+
+public:
+    explicit ArenaVector(Arena* arena) : arena_(arena) {}
+
+    T* begin() { return data_; }
+    T* end() { return data_ + count_; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + count_; }
+
+    T& operator[](int idx) { return data_[idx]; }
+    const T& operator[](int idx) const { return data_[idx]; }
+    T& back(int n=1) { return data_[count_ - n]; }
+
+    int count() const { return count_; }
+
+    void push(const T& value)
+    {
+        if (count_ == capacity_)
+            grow(count_ + 1);
+        data_[count_++] = value;
+    }
+
+    void push(const ArenaVector& other)
+    {
+        if (count_ + other.count_ > capacity_)
+            grow(count_ + other.count_);
+        if (other.count_ > 0)
+            memcpy(data_ + count_, other.data_, sizeof(T) * other.count_);
+        count_ += other.count_;
+    }
+
+    void assign(const ArenaVector& other)
+    {
+        count_ = 0;
+        push(other);
+    }
+
+    void pop() { count_--; }
+    void clear() { count_ = 0; }
+
+    void erase(int idx)
+    {
+        memmove(data_ + idx, data_ + idx + 1, sizeof(T) * (count_ - idx - 1));
+        count_--;
+    }
+
+private:
+    void grow(int required)
+    {
+        int capacity = capacity_ ? capacity_ * 2 : 4;
+        while (capacity < required)
+            capacity *= 2;
+
+        T* data = arena_->allocateArray<T>(capacity);
+        if (count_ > 0)
+            memcpy(data, data_, sizeof(T) * count_);
+        data_ = data;
+        capacity_ = capacity;
+    }
+
+    Arena* arena_;
+    T* data_ = nullptr;
+    int count_ = 0;
+    int capacity_ = 0;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "rfcommon/Vector.hpp"
+
+/*!
+ * \brief Union-find structure over the integers [0..count). Used to find
+ * connected components in a graph in near-linear time.
+ */
+class DisjointSet
+{
+public:
+    DisjointSet();
+    explicit DisjointSet(int count);
+
+    void clear();
+
+    /*!
+     * \brief Adds a new element in its own set and returns its index.
+     */
+    int add();
+
+    /*!
+     * \brief Returns the representative element of the set "idx" belongs to.
+     * Two elements are in the same set if they have the same representative.
+     */
+    int find(int idx)
+    {
+        // Path halving
+        while (parents_[idx] != idx)
+        {
+            parents_[idx] = parents_[parents_[idx]];
+            idx = parents_[idx];
+        }
+        return idx;
+    }
+
+    /*!
+     * \brief Merges the sets of the two elements. Returns false if they were
+     * already in the same set.
+     */
+    bool unite(int a, int b);
+
+    int count() const { return parents_.count(); }
+    int setCount() const { return setCount_; }
+
+private:
+    rfcommon::Vector<int> parents_;
+    rfcommon::Vector<int> sizes_;
+    int setCount_ = 0;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "rfcommon/Vector.hpp"
+
+#include <QPointF>
+#include <QVector>
+
+/*!
+ * \brief Multi-resolution representation of a time series for plotting.
+ *
+ * Level 0 holds the raw samples. Each level above it stores the minimum and
+ * maximum of pairs of entries of the level below, so level "k" summarizes
+ * blocks of 2^(k+1) samples. When drawing, the coarsest level that still has
+ * enough blocks to fill the requested number of points is chosen, and each
+ * block is drawn as a vertical line from its minimum to its maximum. Peaks
+ * are never lost this way, regardless of how far out the plot is zoomed.
+ *
+ * Samples must be appended in order of increasing x. Appending updates only
+ * the last block of every level, so building the pyramid incrementally costs
+ * O(log n) per sample.
+ */
+class MinMaxPyramid
+{
+public:
+    MinMaxPyramid();
+    ~MinMaxPyramid();
+
+    void clear();
+    void append(double x, float y);
+    int count() const { return x_.count(); }
+    int levelCount() const { return levels_.count(); }
+
+    double firstX() const { return x_.front(); }
+    double lastX() const { return x_.back(); }
+
+    /*!
+     * \brief Appends at most roughly "maxPoints" points covering the range
+     * [xMin, xMax] to "out". One sample on either side of the range is
+     * included so lines leaving the visible area are drawn correctly.
+     */
+    void query(double xMin, double xMax, int maxPoints, QVector<QPointF>* out) const;
+
+private:
+    struct Block
+    {
+        double xFirst, xLast;
+        float min, max;
+    };
+
+    void buildLevel(int level);
+
+private:
+    rfcommon::Vector<double> x_;
+    rfcommon::Vector<float> y_;
+    rfcommon::Vector<rfcommon::Vector<Block>> levels_;
+};
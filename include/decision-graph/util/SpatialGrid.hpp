@@ -0,0 +1,83 @@
+#pragma once
+
+#include "rfcommon/Vector.hpp"
+#include <QRectF>
+#include <cstdint>
+
+/*!
+ * \brief Uniform grid over a set of bounding boxes. Answers "which boxes
+ * overlap this area" without looking at every box, which is used to only
+ * draw and hit test what is actually visible.
+ *
+ * Boxes overlapping several cells are stored in each of them. Queries
+ * report each box at most once.
+ */
+class SpatialGrid
+{
+public:
+    SpatialGrid();
+    ~SpatialGrid();
+
+    /*!
+     * \brief Builds the grid. The index passed to query callbacks is the
+     * index into the "boxes" array.
+     */
+    void build(const rfcommon::Vector<QRectF>& boxes);
+    void clear();
+
+    /*!
+     * \brief Calls "f(int idx)" for every box whose grid cells overlap the
+     * area. The box itself may not actually intersect the area, so callers
+     * that need exact results must check for themselves.
+     */
+    template <typename F>
+    void query(const QRectF& area, F&& f) const
+    {
+        if (cellsX_ == 0 || cellsY_ == 0)
+            return;
+
+        int x1, y1, x2, y2;
+        if (cellRange(area, &x1, &y1, &x2, &y2) == false)
+            return;
+
+        // Boxes spanning multiple cells would be reported more than once
+        // otherwise
+        if (++stamp_ == 0)
+        {
+            for (auto& s : stamps_)
+                s = 0;
+            stamp_ = 1;
+        }
+
+        for (int y = y1; y <= y2; ++y)
+            for (int x = x1; x <= x2; ++x)
+            {
+                const int cell = y * cellsX_ + x;
+                for (int i = cellOffsets_[cell]; i != cellOffsets_[cell + 1]; ++i)
+                {
+                    const int idx = cellItems_[i];
+                    if (stamps_[idx] == stamp_)
+                        continue;
+                    stamps_[idx] = stamp_;
+                    f(idx);
+                }
+            }
+    }
+
+private:
+    bool cellRange(const QRectF& area, int* x1, int* y1, int* x2, int* y2) const;
+
+private:
+    QRectF bounds_;
+    double cellW_ = 1.0;
+    double cellH_ = 1.0;
+    int cellsX_ = 0;
+    int cellsY_ = 0;
+
+    // Box indices of cell "c" are in [cellOffsets_[c], cellOffsets_[c+1])
+    rfcommon::Vector<int> cellOffsets_;
+    rfcommon::Vector<int> cellItems_;
+
+    mutable rfcommon::Vector<uint32_t> stamps_;
+    mutable uint32_t stamp_ = 0;
+};
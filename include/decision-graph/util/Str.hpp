@@ -1,4 +1,13 @@
 #pragma once
 
+namespace rfcommon {
+    class String;
+}
+
 char* StrDup(const char* s);
 void StrFree(char* s);
+
+/*!
+ * \brief printf-style formatting, appended to the end of "str".
+ */
+void StrAppendf(rfcommon::String* str, const char* fmt, ...);
@@ -1,14 +1,23 @@
 #pragma once
 
 #include "decision-graph/listeners/SequenceSearchListener.hpp"
+#include "decision-graph/models/DamageHistogram.hpp"
 #include <QWidget>
 
+class PipelineHistogram;
 class SequenceSearchModel;
 
+class QwtPlot;
+class QwtPlotHistogram;
+
 namespace rfcommon {
     class MotionLabels;
 }
 
+/*!
+ * \brief Shows how often each query matched depending on the player's damage
+ * percent at the start of the match.
+ */
 class DamageView
         : public QWidget
         , public SequenceSearchListener
@@ -17,6 +26,13 @@ public:
     explicit DamageView(SequenceSearchModel* model, rfcommon::MotionLabels* labels, QWidget* parent=nullptr);
     ~DamageView();
 
+    void setBucketSize(int percent);
+    int bucketSize() const { return static_cast<int>(histogram_.bucketSize()); }
+
+private:
+    void updateHistogram();
+    void updatePlot();
+
 private:
     void onNewSessions() override;
     void onClearAll() override;
@@ -28,5 +44,9 @@ private:
 
 private:
     SequenceSearchModel* model_;
+    PipelineHistogram* updateTime_;
     rfcommon::MotionLabels* labels_;
+    QwtPlot* plot_;
+    rfcommon::Vector<QwtPlotHistogram*> plotData_;
+    DamageHistogram histogram_;
 };
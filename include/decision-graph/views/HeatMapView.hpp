@@ -1,22 +1,40 @@
 #pragma once
 
+#include "decision-graph/listeners/FrameSchedulerListener.hpp"
 #include "decision-graph/listeners/SequenceSearchListener.hpp"
+#include "decision-graph/models/HeatMap.hpp"
 #include <QWidget>
 
+class PipelineHistogram;
 class SequenceSearchModel;
 
 namespace rfcommon {
     class MotionLabels;
 }
 
+/*!
+ * \brief Shows where on the stage the player was during all matched states.
+ */
 class HeatMapView
         : public QWidget
         , public SequenceSearchListener
+        , public FrameSchedulerListener
 {
 public:
     explicit HeatMapView(SequenceSearchModel* model, rfcommon::MotionLabels* labels, QWidget* parent=nullptr);
     ~HeatMapView();
 
+    void setBlurRadius(float sigma);
+    float blurRadius() const { return heatMap_.blurRadius(); }
+    void setLogScale(bool enable);
+    bool logScale() const { return heatMap_.logScale(); }
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    void updateHeatMap();
+
 private:
     void onNewSessions() override;
     void onClearAll() override;
@@ -26,7 +44,11 @@ private:
     void onQueryCompiled(int queryIdx, bool success, const char* error, bool oppSuccess, const char* oppError) override;
     void onQueriesApplied() override;
 
+    void onFrameSchedulerUpdate() override;
+
 private:
     SequenceSearchModel* model_;
+    PipelineHistogram* updateTime_;
     rfcommon::MotionLabels* labels_;
+    HeatMap heatMap_;
 };
@@ -1,8 +1,10 @@
 #pragma once
 
+#include "decision-graph/listeners/FrameSchedulerListener.hpp"
 #include "decision-graph/listeners/SequenceSearchListener.hpp"
 #include <QWidget>
 
+class PipelineHistogram;
 class SequenceSearchModel;
 
 class QStackedWidget;
@@ -23,6 +25,7 @@ class QValueAxis;
 class PieChartView 
         : public QWidget
         , public SequenceSearchListener
+        , public FrameSchedulerListener
 {
 public:
     explicit PieChartView(SequenceSearchModel* model, rfcommon::MotionLabels* labels, QWidget* parent=nullptr);
@@ -42,8 +45,11 @@ private:
     void onQueryCompiled(int queryIdx, bool success, const char* error, bool oppSuccess, const char* oppError) override;
     void onQueriesApplied() override;
 
+    void onFrameSchedulerUpdate() override;
+
 private:
     SequenceSearchModel* model_;
+    PipelineHistogram* updateTime_;
     rfcommon::MotionLabels* labels_;
     QStackedWidget* pieStack_;
 
@@ -1,14 +1,27 @@
 #pragma once
 
 #include "decision-graph/listeners/SequenceSearchListener.hpp"
+#include "decision-graph/util/MinMaxPyramid.hpp"
 #include <QWidget>
 
+class PipelineHistogram;
 class SequenceSearchModel;
 
+class QwtPlot;
+class QwtPlotCurve;
+
 namespace rfcommon {
     class MotionLabels;
 }
 
+/*!
+ * \brief Plots the player's shield health over time, with all sessions laid
+ * out one after another, and marks where matches started.
+ *
+ * The series is stored in a MinMaxPyramid, so only a few thousand points are
+ * handed to Qwt no matter how long the sessions are or how far the plot is
+ * zoomed out. Only states added since the last update are appended.
+ */
 class ShieldHealthView
         : public QWidget
         , public SequenceSearchListener
@@ -17,6 +30,13 @@ public:
     explicit ShieldHealthView(SequenceSearchModel* model, rfcommon::MotionLabels* labels, QWidget* parent=nullptr);
     ~ShieldHealthView();
 
+private:
+    void clearSeries();
+    void updateSeries();
+    void updateMatches();
+    void updateVisibleRange();
+    void refreshCurves();
+
 private:
     void onNewSessions() override;
     void onClearAll() override;
@@ -28,5 +48,20 @@ private:
 
 private:
     SequenceSearchModel* model_;
+    PipelineHistogram* updateTime_;
     rfcommon::MotionLabels* labels_;
+    QwtPlot* plot_;
+    QwtPlotCurve* shieldCurve_;
+    QwtPlotCurve* matchCurve_;
+
+    MinMaxPyramid shield_;
+    // X offset of each session on the time axis
+    rfcommon::Vector<double> sessionOffsets_;
+    // Index of the next state of the player to append to the series
+    int nextStateIdx_ = 0;
+    // End of the series the last time the visible range was updated
+    double followedX_ = 0.0;
+
+    // Start of every match, sorted by time
+    rfcommon::Vector<QPointF> matches_;
 };
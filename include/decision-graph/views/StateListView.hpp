@@ -7,6 +7,7 @@ namespace rfcommon {
     class MotionLabels;
 }
 
+class PipelineHistogram;
 class SequenceSearchModel;
 class QTextEdit;
 
@@ -32,6 +33,7 @@ private:
 
 private:
     SequenceSearchModel* model_;
+    PipelineHistogram* updateTime_;
     rfcommon::MotionLabels* labels_;
 
     QTextEdit* textEdit_;
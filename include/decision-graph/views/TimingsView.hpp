@@ -3,6 +3,7 @@
 #include "decision-graph/listeners/SequenceSearchListener.hpp"
 #include <QWidget>
 
+class PipelineHistogram;
 class SequenceSearchModel;
 
 class QwtPlot;
@@ -31,6 +32,7 @@ private:
 
 private:
     SequenceSearchModel* model_;
+    PipelineHistogram* updateTime_;
     rfcommon::MotionLabels* labels_;
     QwtPlot* relativePlot_;
     QwtPlotHistogram* relativeData_;
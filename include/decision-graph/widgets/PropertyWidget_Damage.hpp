@@ -2,14 +2,16 @@
 
 #include "decision-graph/widgets/PropertyWidget.hpp"
 
+class DamageView;
+
 class PropertyWidget_Damage : public PropertyWidget
 {
 public:
-    PropertyWidget_Damage(SequenceSearchModel* model, QWidget* parent=nullptr);
+    PropertyWidget_Damage(DamageView* damageView, SequenceSearchModel* model, QWidget* parent=nullptr);
     ~PropertyWidget_Damage();
 
     QVector<QWidget*> scrollIgnoreWidgets() override { return {}; }
 
 private:
-
+    DamageView* damageView_;
 };
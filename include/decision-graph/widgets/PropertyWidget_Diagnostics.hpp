@@ -0,0 +1,12 @@
+#pragma once
+
+#include "decision-graph/widgets/PropertyWidget.hpp"
+
+class PropertyWidget_Diagnostics : public PropertyWidget
+{
+public:
+    PropertyWidget_Diagnostics(SequenceSearchModel* model, QWidget* parent=nullptr);
+    ~PropertyWidget_Diagnostics();
+
+    QVector<QWidget*> scrollIgnoreWidgets() override { return {}; }
+};
@@ -6,6 +6,7 @@
 
 class GraphModel;
 class QComboBox;
+class QLabel;
 
 class PropertyWidget_Graph
         : public PropertyWidget
@@ -23,6 +24,7 @@ private:
 
 private:
     void onGraphModelPreferredLayerChanged() override;
+    void onGraphModelLayoutFinished() override;
 
 private:
     void onMotionLabelsLoaded() override;
@@ -45,4 +47,5 @@ private:
     GraphModel* graphModel_;
     rfcommon::MotionLabels* labels_;
     QComboBox* comboBox_layer;
+    QLabel* label_layoutTime;
 };
@@ -2,14 +2,16 @@
 
 #include "decision-graph/widgets/PropertyWidget.hpp"
 
+class HeatMapView;
+
 class PropertyWidget_HeatMap : public PropertyWidget
 {
 public:
-    PropertyWidget_HeatMap(SequenceSearchModel* model, QWidget* parent=nullptr);
+    PropertyWidget_HeatMap(HeatMapView* heatMapView, SequenceSearchModel* model, QWidget* parent=nullptr);
     ~PropertyWidget_HeatMap();
 
     QVector<QWidget*> scrollIgnoreWidgets() override { return {}; }
 
 private:
-
+    HeatMapView* heatMapView_;
 };
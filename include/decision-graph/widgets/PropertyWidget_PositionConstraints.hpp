@@ -1,15 +1,47 @@
 #pragma once
 
+#include "decision-graph/listeners/RegionSceneListener.hpp"
+#include "decision-graph/listeners/SequenceSearchListener.hpp"
 #include "decision-graph/widgets/PropertyWidget.hpp"
 
-class PropertyWidget_PositionConstraints : public PropertyWidget
+class RegionScene;
+
+class QCheckBox;
+class QComboBox;
+class QVBoxLayout;
+
+class PropertyWidget_PositionConstraints
+        : public PropertyWidget
+        , public SequenceSearchListener
+        , public RegionSceneListener
 {
 public:
-    PropertyWidget_PositionConstraints(SequenceSearchModel* model, QWidget* parent=nullptr);
+    PropertyWidget_PositionConstraints(RegionScene* regionScene, SequenceSearchModel* model, QWidget* parent=nullptr);
     ~PropertyWidget_PositionConstraints();
 
     QVector<QWidget*> scrollIgnoreWidgets() override { return {}; }
 
 private:
+    void updateQueries();
+    void updateRegions();
+    void onRegionToggled();
+
+private:
+    void onNewSessions() override;
+    void onClearAll() override;
+    void onDataAdded() override;
+    void onPOVChanged() override;
+    void onQueriesChanged() override;
+    void onQueryCompiled(int queryIdx, bool success, const char* error, bool oppSuccess, const char* oppError) override;
+    void onQueriesApplied() override;
 
+private:
+    void onRegionAdded(int regionIdx) override;
+    void onRegionRemoved(int regionIdx) override;
+
+private:
+    RegionScene* regionScene_;
+    QComboBox* comboBox_query;
+    QVBoxLayout* layout_regions;
+    QVector<QCheckBox*> checkBoxes_;
 };
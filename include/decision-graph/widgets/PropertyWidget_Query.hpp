@@ -1,6 +1,7 @@
 #pragma once
 
 #include "decision-graph/listeners/SequenceSearchListener.hpp"
+#include "decision-graph/models/QueryApplyScheduler.hpp"
 #include "decision-graph/widgets/PropertyWidget.hpp"
 
 #include "rfcommon/Vector.hpp"
@@ -47,4 +48,5 @@ private:
 
     QToolButton* toolButton_addQuery;
     rfcommon::Vector<QueryBox> queryBoxes_;
+    QueryApplyScheduler applyScheduler_;
 };
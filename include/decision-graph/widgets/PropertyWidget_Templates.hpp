@@ -4,6 +4,7 @@
 
 #include <QDir>
 
+class DamageView;
 class QListWidget;
 
 class PropertyWidget_Templates : public PropertyWidget
@@ -11,7 +12,7 @@ class PropertyWidget_Templates : public PropertyWidget
     Q_OBJECT
 
 public:
-    PropertyWidget_Templates(SequenceSearchModel* model, QWidget* parent=nullptr);
+    PropertyWidget_Templates(DamageView* damageView, SequenceSearchModel* model, QWidget* parent=nullptr);
     ~PropertyWidget_Templates();
 
     QVector<QWidget*> scrollIgnoreWidgets() override { return {}; }
@@ -26,5 +27,6 @@ private:
     bool loadTemplate(const QString& filePath);
 
 private:
+    DamageView* damageView_;
     QListWidget* listWidget;
 };
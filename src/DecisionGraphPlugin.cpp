@@ -1,15 +1,14 @@
 #include "decision-graph/DecisionGraphPlugin.hpp"
 #include "decision-graph/views/SequenceSearchView.hpp"
+#include "decision-graph/models/Diagnostics.hpp"
+#include "decision-graph/models/FrameScheduler.hpp"
 #include "decision-graph/models/GraphModel.hpp"
 #include "decision-graph/models/Query.hpp"
 #include "decision-graph/models/RegionScene.hpp"
 #include "decision-graph/models/SequenceSearchModel.hpp"
 #include "decision-graph/models/VisualizerInterface.hpp"
 
-#include "decision-graph/models/RegionItem.hpp"
-
 #include "rfcommon/FrameData.hpp"
-#include "rfcommon/HighresTimer.hpp"
 #include "rfcommon/MotionLabels.hpp"
 #include "rfcommon/ReplayFilename.hpp"
 #include "rfcommon/Session.hpp"
@@ -17,15 +16,20 @@
 // ----------------------------------------------------------------------------
 DecisionGraphPlugin::DecisionGraphPlugin(RFPluginFactory* factory, rfcommon::PluginContext* pluginCtx, rfcommon::MotionLabels* labels)
     : Plugin(factory)
-    , seqSearchModel_(new SequenceSearchModel(labels))
+    , diagnostics_(new Diagnostics)
+    , seqSearchModel_(new SequenceSearchModel(labels, diagnostics_.get()))
     , graphModel_(new GraphModel(seqSearchModel_.get(), labels))
-    , regionModel_(new RegionScene)
+    , regionModel_(new RegionScene(seqSearchModel_.get()))
     , visualizerModel_(new VisualizerModel(seqSearchModel_.get(), pluginCtx, factory))
     , labels_(labels)
 {
-    RegionItem* item = new RegionItem;
-    item->setRect(0, 0, 300, 150);
-    regionModel_->addItem(item);
+    // Start with a region covering the center of most stages
+    regionModel_->addRegion(QRectF(-50, 0, 100, 40));
+
+    PipelineMetrics* metrics = diagnostics_->metrics();
+    timings_.frames = metrics->counter("ingest.frames");
+    timings_.fps = metrics->histogram("ingest.fps", PipelineHistogram::COUNT);
+    timings_.addFrame = metrics->histogram("ingest.add_frame");
 
     labels_->dispatcher.addListener(this);
 }
@@ -74,6 +78,7 @@ void DecisionGraphPlugin::onProtocolTrainingStarted(rfcommon::Session* training)
     assert(activeSession_.isNull());
     activeSession_ = training;
     activeSession_->tryGetFrameData()->dispatcher.addListener(this);
+    seqSearchModel_->frameScheduler()->setRealtime(true);
 }
 void DecisionGraphPlugin::onProtocolTrainingResumed(rfcommon::Session* training)
 {
@@ -91,6 +96,7 @@ void DecisionGraphPlugin::onProtocolTrainingResumed(rfcommon::Session* training)
     assert(activeSession_.isNull());
     activeSession_ = training;
     activeSession_->tryGetFrameData()->dispatcher.addListener(this);
+    seqSearchModel_->frameScheduler()->setRealtime(true);
 }
 void DecisionGraphPlugin::onProtocolTrainingReset(rfcommon::Session* oldTraining, rfcommon::Session* newTraining)
 {
@@ -109,6 +115,7 @@ void DecisionGraphPlugin::onProtocolTrainingEnded(rfcommon::Session* training)
 {
     activeSession_->tryGetFrameData()->dispatcher.removeListener(this);
     activeSession_.drop();
+    finishRealtime();
 }
 void DecisionGraphPlugin::onProtocolGameStarted(rfcommon::Session* game)
 {
@@ -120,6 +127,7 @@ void DecisionGraphPlugin::onProtocolGameStarted(rfcommon::Session* game)
     assert(activeSession_.isNull());
     activeSession_ = game;
     activeSession_->tryGetFrameData()->dispatcher.addListener(this);
+    seqSearchModel_->frameScheduler()->setRealtime(true);
 }
 void DecisionGraphPlugin::onProtocolGameResumed(rfcommon::Session* game)
 {
@@ -137,12 +145,24 @@ void DecisionGraphPlugin::onProtocolGameResumed(rfcommon::Session* game)
     assert(activeSession_.isNull());
     activeSession_ = game;
     activeSession_->tryGetFrameData()->dispatcher.addListener(this);
+    seqSearchModel_->frameScheduler()->setRealtime(true);
 }
 void DecisionGraphPlugin::onProtocolGameEnded(rfcommon::Session* game)
 {
     assert(activeSession_.notNull());
     activeSession_->tryGetFrameData()->dispatcher.removeListener(this);
     activeSession_.drop();
+    finishRealtime();
+}
+void DecisionGraphPlugin::finishRealtime()
+{
+    // Results of the last frames may still be waiting for their turn. Once
+    // the game is over there is no reason to hold anything back. Queries are
+    // applied while still in realtime mode, so the consumers only defer the
+    // update, and leaving realtime mode runs each of them exactly once
+    if (seqSearchModel_->applyAllQueries())
+        seqSearchModel_->notifyQueriesApplied();
+    seqSearchModel_->frameScheduler()->setRealtime(false);
 }
 
 // ----------------------------------------------------------------------------
@@ -261,20 +281,24 @@ void DecisionGraphPlugin::onFrameDataNewUniqueFrame(int frameIdx, const rfcommon
 {
     assert(activeSession_.notNull());
 
+    diagnostics_->metrics()->tickRate(timings_.fps, timings_.frames);
+
+    FrameScheduler* scheduler = seqSearchModel_->frameScheduler();
+    scheduler->beginFrame();
+
+    // Ingesting is cheap and is always done
+    PipelineTimer addFrameTimer(timings_.addFrame);
     seqSearchModel_->addFrame(frameIdx, activeSession_->tryGetFrameData());
     seqSearchModel_->notifyFramesAdded();
+    addFrameTimer.stop();
+
+    // Matching continues where it left off in the previous frame. Cheap
+    // views update as soon as a pass completes, expensive ones are deferred
+    // to the scheduler
+    if (seqSearchModel_->continueApplyAllQueries(scheduler->matchBudget()))
+        seqSearchModel_->notifyQueriesApplied();
 
-    if (noNotifyFrames_-- <= 0)
-    {
-        rfcommon::HighresTimer timer;
-        timer.start();
-            if (seqSearchModel_->applyAllQueries())
-                seqSearchModel_->notifyQueriesApplied();
-        timer.stop();
-
-        noNotifyFrames_ = timer.timePassedNS() * 60 / 1e9;
-        noNotifyFrames_ *= 2;  // Give some leeway
-    }
+    scheduler->endFrame();
 }
 void DecisionGraphPlugin::onFrameDataNewFrame(int frameIdx, const rfcommon::Frame<4>& frame) {}
 
@@ -0,0 +1,208 @@
+#include "decision-graph/models/BatchQuery.hpp"
+
+#include "rfcommon/MotionLabels.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void printUsage(const char* prog)
+{
+    fprintf(stderr,
+        "Usage: %s [options] <files or directories...>\n"
+        "\n"
+        "Runs queries over replay files (.rfr) or state caches (.dgsc). Directories\n"
+        "are searched for both.\n"
+        "\n"
+        "  --labels <file>       Motion labels file used to compile queries (required)\n"
+        "  --query <query>       Adds a query. Can be given multiple times\n"
+        "  --opponent <query>    Opponent query of the previous --query\n"
+        "  --queries <file>      Adds one query per line. An opponent query can follow\n"
+        "                        the player query, separated by a tab\n"
+        "  --files <file>        Adds one replay or cache file per line\n"
+        "  --player <name>       Player whose states are searched (default: first)\n"
+        "  --cache-dir <dir>     Writes a state cache for every replay loaded\n"
+        "  --threads <n>         Number of worker threads (default: all cores)\n"
+        "  --matches <file>      Writes the match table here instead of stdout\n"
+        "  --stats <file>        Writes query stats here instead of stderr\n",
+        prog);
+}
+
+static bool readLines(const char* fileName, QStringList* lines)
+{
+    QFile file(QString::fromUtf8(fileName));
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text) == false)
+        return false;
+
+    QTextStream stream(&file);
+    while (stream.atEnd() == false)
+    {
+        const QString line = stream.readLine();
+        if (line.trimmed().isEmpty() || line.startsWith('#'))
+            continue;
+        lines->append(line);
+    }
+    return true;
+}
+
+static void addPath(const QString& path, rfcommon::Vector<QString>* fileNames)
+{
+    if (QFileInfo(path).isDir() == false)
+    {
+        fileNames->push(path);
+        return;
+    }
+
+    QDir dir(path);
+    const QStringList entries = dir.entryList({"*.rfr", "*.dgsc"}, QDir::Files, QDir::Name);
+    for (const QString& entry : entries)
+        fileNames->push(dir.filePath(entry));
+}
+
+static FILE* openOutput(const char* fileName, FILE* fallback)
+{
+    if (fileName == nullptr)
+        return fallback;
+    FILE* fp = fopen(fileName, "wb");
+    if (fp == nullptr)
+        fprintf(stderr, "Failed to open \"%s\" for writing\n", fileName);
+    return fp;
+}
+
+int main(int argc, char** argv)
+{
+    const char* labelsFile = nullptr;
+    const char* playerName = nullptr;
+    const char* cacheDir = nullptr;
+    const char* matchesFile = nullptr;
+    const char* statsFile = nullptr;
+    int threadCount = 0;
+
+    struct QueryArg { rfcommon::String player, opponent; };
+    rfcommon::Vector<QueryArg> queries;
+    rfcommon::Vector<QString> fileNames;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "Missing value for %s\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            return argv[++i];
+        };
+
+        if (strcmp(argv[i], "--labels") == 0)
+            labelsFile = value();
+        else if (strcmp(argv[i], "--query") == 0)
+            queries.push({value(), ""});
+        else if (strcmp(argv[i], "--opponent") == 0)
+        {
+            if (queries.count() == 0)
+            {
+                fprintf(stderr, "--opponent must follow a --query\n");
+                return EXIT_FAILURE;
+            }
+            queries.back().opponent = value();
+        }
+        else if (strcmp(argv[i], "--queries") == 0)
+        {
+            const char* fileName = value();
+            QStringList lines;
+            if (readLines(fileName, &lines) == false)
+            {
+                fprintf(stderr, "Failed to read queries from \"%s\"\n", fileName);
+                return EXIT_FAILURE;
+            }
+            for (const QString& line : lines)
+            {
+                const QStringList parts = line.split('\t');
+                queries.push({
+                    parts[0].trimmed().toUtf8().constData(),
+                    parts.size() > 1 ? parts[1].trimmed().toUtf8().constData() : ""
+                });
+            }
+        }
+        else if (strcmp(argv[i], "--files") == 0)
+        {
+            const char* fileName = value();
+            QStringList lines;
+            if (readLines(fileName, &lines) == false)
+            {
+                fprintf(stderr, "Failed to read file list from \"%s\"\n", fileName);
+                return EXIT_FAILURE;
+            }
+            for (const QString& line : lines)
+                addPath(line.trimmed(), &fileNames);
+        }
+        else if (strcmp(argv[i], "--player") == 0)
+            playerName = value();
+        else if (strcmp(argv[i], "--cache-dir") == 0)
+            cacheDir = value();
+        else if (strcmp(argv[i], "--threads") == 0)
+            threadCount = atoi(value());
+        else if (strcmp(argv[i], "--matches") == 0)
+            matchesFile = value();
+        else if (strcmp(argv[i], "--stats") == 0)
+            statsFile = value();
+        else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+        {
+            printUsage(argv[0]);
+            return EXIT_SUCCESS;
+        }
+        else if (argv[i][0] == '-')
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else
+            addPath(QString::fromUtf8(argv[i]), &fileNames);
+    }
+
+    if (labelsFile == nullptr || queries.count() == 0 || fileNames.count() == 0)
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    rfcommon::MotionLabels labels;
+    if (labels.load(labelsFile) == false)
+    {
+        fprintf(stderr, "Failed to load motion labels from \"%s\"\n", labelsFile);
+        return EXIT_FAILURE;
+    }
+
+    BatchQuery batch(&labels);
+    for (const QueryArg& query : queries)
+        batch.addQuery(query.player.cStr(), query.opponent.cStr());
+    if (playerName)
+        batch.setPlayerName(playerName);
+    if (cacheDir)
+        batch.setCacheDirectory(QString::fromUtf8(cacheDir));
+    if (threadCount > 0)
+        batch.setMaxThreadCount(threadCount);
+
+    const bool allLoaded = batch.run(fileNames);
+
+    FILE* matchesOut = openOutput(matchesFile, stdout);
+    FILE* statsOut = openOutput(statsFile, stderr);
+    if (matchesOut == nullptr || statsOut == nullptr)
+        return EXIT_FAILURE;
+
+    batch.writeMatches(matchesOut);
+    batch.writeStats(statsOut);
+
+    if (matchesOut != stdout)
+        fclose(matchesOut);
+    if (statsOut != stderr)
+        fclose(statsOut);
+
+    return allLoaded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,194 @@
+#include "decision-graph/models/AnalysisCache.hpp"
+#include "decision-graph/models/GraphBuilder.hpp"
+#include "decision-graph/models/SequenceSearchModel.hpp"
+
+// ----------------------------------------------------------------------------
+AnalysisCache::AnalysisCache(const SequenceSearchModel* model, const rfcommon::MotionLabels* labels)
+    : model_(model)
+    , labels_(labels)
+{}
+
+// ----------------------------------------------------------------------------
+AnalysisCache::~AnalysisCache()
+{}
+
+// ----------------------------------------------------------------------------
+void AnalysisCache::invalidate()
+{
+    generation_++;
+}
+
+// ----------------------------------------------------------------------------
+void AnalysisCache::syncAll()
+{
+    if (syncedGeneration_ == generation_ && queries_.count() == model_->queryCount())
+        return;
+
+    queries_.clear();
+    for (int i = 0; i != model_->queryCount(); ++i)
+        queries_.emplace();
+
+    timings_.sequence = nullptr;
+    timings_.frameDurations.clear();
+    hasTimings_ = false;
+    syncedGeneration_ = generation_;
+}
+
+// ----------------------------------------------------------------------------
+AnalysisCache::QueryAnalysis& AnalysisCache::sync(int queryIdx)
+{
+    syncAll();
+    return queries_[queryIdx];
+}
+
+// ----------------------------------------------------------------------------
+const States* AnalysisCache::playerStates() const
+{
+    if (model_->playerPOV() < 0)
+        return nullptr;
+    return &model_->fighterStates(model_->playerPOV());
+}
+
+// ----------------------------------------------------------------------------
+const Graph& AnalysisCache::mergedGraph(int queryIdx)
+{
+    QueryAnalysis& q = sync(queryIdx);
+    if (q.hasGraph)
+        return q.mergedGraph;
+    q.hasGraph = true;
+
+    const States* states = playerStates();
+    if (states == nullptr)
+        return q.mergedGraph;
+
+    GraphBuilder builder(&q.mergedGraph);
+    builder.addStates(*states, model_->mergedMatches(queryIdx));
+    q.mergedGraph.finalize();
+
+    // The builder already tracks connected components, so get the islands
+    // while we still have them
+    q.islands = q.mergedGraph.islands(builder.components());
+    for (int i = 0; i != q.islands.count(); ++i)
+        if (q.largestIsland < 0 || q.islands[q.largestIsland].nodes.count() < q.islands[i].nodes.count())
+            q.largestIsland = i;
+
+    return q.mergedGraph;
+}
+
+// ----------------------------------------------------------------------------
+const rfcommon::Vector<Graph>& AnalysisCache::islands(int queryIdx)
+{
+    mergedGraph(queryIdx);
+    return queries_[queryIdx].islands;
+}
+
+// ----------------------------------------------------------------------------
+const Graph* AnalysisCache::largestIsland(int queryIdx)
+{
+    mergedGraph(queryIdx);
+    const QueryAnalysis& q = queries_[queryIdx];
+    return q.largestIsland >= 0 ? &q.islands[q.largestIsland] : nullptr;
+}
+
+// ----------------------------------------------------------------------------
+const Graph& AnalysisCache::outgoingTree(int queryIdx)
+{
+    outgoingSequences(queryIdx);
+    return queries_[queryIdx].outgoingTree;
+}
+
+// ----------------------------------------------------------------------------
+const Graph& AnalysisCache::incomingTree(int queryIdx)
+{
+    outgoingSequences(queryIdx);
+    return queries_[queryIdx].incomingTree;
+}
+
+// ----------------------------------------------------------------------------
+const rfcommon::Vector<Graph::UniqueSequence>& AnalysisCache::outgoingSequences(int queryIdx)
+{
+    const Graph* island = largestIsland(queryIdx);
+    QueryAnalysis& q = queries_[queryIdx];
+    if (q.hasTrees)
+        return q.outgoingSequences;
+    q.hasTrees = true;
+
+    if (island == nullptr)
+        return q.outgoingSequences;
+
+    q.outgoingTree = island->outgoingTree();
+    q.incomingTree = island->incomingTree();
+    q.outgoingSequences = q.outgoingTree.treeToUniuqeOutgoingSequences();
+    q.incomingSequences = q.incomingTree.treeToUniqueIncomingSequences();
+
+    return q.outgoingSequences;
+}
+
+// ----------------------------------------------------------------------------
+const rfcommon::Vector<Graph::UniqueSequence>& AnalysisCache::incomingSequences(int queryIdx)
+{
+    outgoingSequences(queryIdx);
+    return queries_[queryIdx].incomingSequences;
+}
+
+// ----------------------------------------------------------------------------
+const AnalysisCache::SequenceTimings& AnalysisCache::mostCommonSequence()
+{
+    syncAll();
+    if (hasTimings_)
+        return timings_;
+    hasTimings_ = true;
+
+    const States* states = playerStates();
+    if (states == nullptr)
+        return timings_;
+
+    // Matches were interned while the queries were applied, so finding equal
+    // sequences only requires comparing IDs
+    const int mostCommonID = model_->sequenceTrie().mostCommon();
+    if (mostCommonID < 0)
+        return timings_;
+
+    for (int queryIdx = 0; queryIdx != model_->queryCount(); ++queryIdx)
+    {
+        const auto& matches = model_->mergedMatches(queryIdx);
+        const auto& sequenceIDs = model_->mergedMatchSequenceIDs(queryIdx);
+        if (sequenceIDs.count() != matches.count())
+            continue;  // Not applied since the POV changed
+
+        for (int i = 0; i != matches.count(); ++i)
+            if (sequenceIDs[i] == mostCommonID)
+            {
+                const Sequence& seq = matches[i];
+                if (timings_.sequence == nullptr)
+                    timings_.sequence = &seq;
+
+                const auto& first = (*states)[seq.idxs.front()];
+                const auto& last = (*states)[seq.idxs.back()];
+                timings_.frameDurations.push(
+                    last.sideData.frameIndex.index() - first.sideData.frameIndex.index());
+            }
+    }
+
+    return timings_;
+}
+
+// ----------------------------------------------------------------------------
+const rfcommon::Vector<rfcommon::String>& AnalysisCache::matchStrings(int queryIdx, int sessionIdx)
+{
+    QueryAnalysis& q = sync(queryIdx);
+    if (q.hasMatchStrings == false)
+    {
+        q.hasMatchStrings = true;
+        q.sessionMatchStrings.clear();
+        for (int i = 0; i != model_->sessionCount(); ++i)
+            q.sessionMatchStrings.emplace();
+
+        if (const States* states = playerStates())
+            for (int i = 0; i != model_->sessionCount(); ++i)
+                for (const Range& range : model_->sessionMatches(queryIdx, i))
+                    q.sessionMatchStrings[i].push(toString(*states, range, labels_));
+    }
+
+    return q.sessionMatchStrings[sessionIdx];
+}
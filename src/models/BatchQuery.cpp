@@ -0,0 +1,318 @@
+#include "decision-graph/listeners/SequenceSearchListener.hpp"
+#include "decision-graph/models/BatchQuery.hpp"
+#include "decision-graph/models/Diagnostics.hpp"
+#include "decision-graph/models/SequenceSearchModel.hpp"
+#include "decision-graph/models/StateCache.hpp"
+
+#include "rfcommon/FrameData.hpp"
+#include "rfcommon/HighresTimer.hpp"
+#include "rfcommon/MappingInfo.hpp"
+#include "rfcommon/Metadata.hpp"
+#include "rfcommon/Session.hpp"
+
+#include <QDir>
+#include <QFileInfo>
+
+namespace {
+
+/*!
+ * \brief The model reports compile errors through the listener interface
+ * only, so this keeps the messages of the last compiled query.
+ */
+class CompileErrorListener : public SequenceSearchListener
+{
+public:
+    rfcommon::String error;
+
+private:
+    void onNewSessions() override {}
+    void onClearAll() override {}
+    void onDataAdded() override {}
+    void onPOVChanged() override {}
+    void onQueriesChanged() override {}
+    void onQueryCompiled(int queryIdx, bool success, const char* error, bool oppSuccess, const char* oppError) override
+    {
+        this->error = "";
+        if (success == false)
+            this->error = error;
+        if (oppSuccess == false)
+            this->error += rfcommon::String(this->error.length() ? "; opponent: " : "opponent: ") + oppError;
+    }
+    void onQueriesApplied() override {}
+};
+
+}
+
+// ----------------------------------------------------------------------------
+BatchQuery::BatchQuery(const rfcommon::MotionLabels* labels)
+    : labels_(labels)
+{}
+
+// ----------------------------------------------------------------------------
+BatchQuery::~BatchQuery()
+{
+    threadPool_.waitForDone();
+}
+
+// ----------------------------------------------------------------------------
+void BatchQuery::addQuery(const char* playerQuery, const char* opponentQuery)
+{
+    queries_.push({playerQuery, opponentQuery});
+}
+
+// ----------------------------------------------------------------------------
+void BatchQuery::setPlayerName(const char* name)
+{
+    playerName_ = name;
+}
+
+// ----------------------------------------------------------------------------
+void BatchQuery::setCacheDirectory(const QString& dir)
+{
+    cacheDir_ = dir;
+}
+
+// ----------------------------------------------------------------------------
+void BatchQuery::setMaxThreadCount(int count)
+{
+    threadPool_.setMaxThreadCount(count);
+}
+
+// ----------------------------------------------------------------------------
+bool BatchQuery::run(const rfcommon::Vector<QString>& fileNames)
+{
+    rfcommon::HighresTimer timer;
+    timer.start();
+
+    // Every job only writes to its own entry, so the vector must not be
+    // resized while jobs are running
+    files_.clearCompact();
+    files_.resize(fileNames.count());
+    for (int i = 0; i != fileNames.count(); ++i)
+        files_[i].fileName = fileNames[i];
+
+    if (cacheDir_.isEmpty() == false)
+        QDir().mkpath(cacheDir_);
+
+    for (int i = 0; i != fileNames.count(); ++i)
+        threadPool_.start([this, i] { processFile(i); });
+    threadPool_.waitForDone();
+
+    // Accumulate stats in file order
+    queryStats_.clearCompact();
+    queryStats_.resize(queryCount());
+    for (const FileResult& file : files_)
+        for (int queryIdx = 0; queryIdx != file.queries.count(); ++queryIdx)
+        {
+            const QueryResult& result = file.queries[queryIdx];
+            QueryStats& stats = queryStats_[queryIdx];
+            if (result.compiled == false)
+            {
+                stats.filesFailed++;
+                if (stats.firstError.length() == 0)
+                    stats.firstError = result.error;
+                continue;
+            }
+
+            stats.filesCompiled++;
+            stats.filesMatched += result.matchCount > 0 ? 1 : 0;
+            stats.matchCount += result.matchCount;
+            stats.compileTimeNS += result.compileTimeNS;
+            stats.applyTimeNS += result.applyTimeNS;
+            if (stats.maxApplyTimeNS < result.applyTimeNS)
+                stats.maxApplyTimeNS = result.applyTimeNS;
+        }
+
+    timer.stop();
+    wallTimeNS_ = timer.timePassedNS();
+
+    return failedFileCount() == 0;
+}
+
+// ----------------------------------------------------------------------------
+void BatchQuery::processFile(int fileIdx)
+{
+    FileResult& file = files_[fileIdx];
+
+    // Models register their metrics when they are constructed, and the
+    // metric registry is main thread only, so every job gets its own
+    Diagnostics diagnostics;
+    SequenceSearchModel model(labels_, &diagnostics);
+
+    rfcommon::HighresTimer timer;
+    timer.start();
+    if (file.fileName.endsWith(".dgsc", Qt::CaseInsensitive))
+    {
+        StateCache cache;
+        if (cache.load(file.fileName) == false)
+        {
+            file.error = "Failed to load state cache";
+            return;
+        }
+        model.addCachedSession(cache);
+    }
+    else
+    {
+        rfcommon::Reference<rfcommon::Session> session = rfcommon::Session::load(nullptr, file.fileName.toUtf8().constData());
+        if (session.isNull())
+        {
+            file.error = "Failed to load replay";
+            return;
+        }
+
+        const rfcommon::MappingInfo* map = session->tryGetMappingInfo();
+        const rfcommon::Metadata* mdata = session->tryGetMetadata();
+        const rfcommon::FrameData* fdata = session->tryGetFrameData();
+        if (map == nullptr || mdata == nullptr || fdata == nullptr)
+        {
+            file.error = "Replay has no frame data";
+            return;
+        }
+
+        model.startNewSession(map, mdata);
+        model.addAllFrames(fdata);
+
+        if (cacheDir_.isEmpty() == false)
+        {
+            StateCache cache;
+            const QString cacheName = QFileInfo(file.fileName).completeBaseName() + ".dgsc";
+            if (cache.copyFrom(model, 0) == false || cache.save(QDir(cacheDir_).filePath(cacheName)) == false)
+                file.error = "Failed to write state cache";
+        }
+    }
+    timer.stop();
+    file.loadTimeNS = timer.timePassedNS();
+    file.sessionName = model.sessionName(0);
+    file.loaded = true;
+
+    if (model.fighterCount() < 2)
+    {
+        file.error = "Session has less than 2 fighters";
+        file.loaded = false;
+        return;
+    }
+
+    // Same POV logic as the UI: The opponent is whoever the player is not
+    int playerIdx = 0;
+    for (int i = 0; i != model.fighterCount(); ++i)
+        if (model.playerName(i) == playerName_)
+        {
+            playerIdx = i;
+            break;
+        }
+    model.setPlayerPOV(playerIdx);
+    model.setOpponentPOV(playerIdx == 0 ? 1 : 0);
+
+    CompileErrorListener listener;
+    model.dispatcher.addListener(&listener);
+
+    const States& states = model.fighterStates(model.playerPOV());
+    file.queries.resize(queryCount());
+    for (int queryIdx = 0; queryIdx != queryCount(); ++queryIdx)
+    {
+        QueryResult& result = file.queries[queryIdx];
+        model.addQuery();
+        model.setQuery(queryIdx, queries_[queryIdx].player.cStr(), queries_[queryIdx].opponent.cStr());
+
+        timer.start();
+        result.compiled = model.compileQuery(queryIdx);
+        timer.stop();
+        result.compileTimeNS = timer.timePassedNS();
+        if (result.compiled == false)
+        {
+            result.error = listener.error;
+            continue;
+        }
+
+        timer.start();
+        model.applyQuery(queryIdx);
+        timer.stop();
+        result.applyTimeNS = timer.timePassedNS();
+
+        const rfcommon::Vector<Range>& matches = model.matches(queryIdx);
+        result.matchCount = matches.count();
+        for (const Range& range : matches)
+        {
+            if (range.startIdx == range.endIdx)
+                continue;
+            file.matches.push({
+                fileIdx,
+                queryIdx,
+                states[range.startIdx].sideData.frameIndex.index(),
+                states[range.endIdx - 1].sideData.frameIndex.index(),
+                toString(states, range, labels_)
+            });
+        }
+    }
+
+    model.dispatcher.removeListener(&listener);
+}
+
+// ----------------------------------------------------------------------------
+int BatchQuery::failedFileCount() const
+{
+    int count = 0;
+    for (const FileResult& file : files_)
+        count += file.loaded ? 0 : 1;
+    return count;
+}
+
+// ----------------------------------------------------------------------------
+uint64_t BatchQuery::loadTimeNS() const
+{
+    uint64_t total = 0;
+    for (const FileResult& file : files_)
+        total += file.loadTimeNS;
+    return total;
+}
+
+// ----------------------------------------------------------------------------
+void BatchQuery::writeMatches(FILE* out) const
+{
+    fprintf(out, "file\tsession\tquery\tstart_frame\tend_frame\tsequence\n");
+    for (const FileResult& file : files_)
+    {
+        const QByteArray fileName = file.fileName.toUtf8();
+        for (const Match& match : file.matches)
+            fprintf(out, "%s\t%s\t%d\t%d\t%d\t%s\n",
+                fileName.constData(),
+                file.sessionName.cStr(),
+                match.queryIdx,
+                static_cast<int>(match.startFrame),
+                static_cast<int>(match.endFrame),
+                match.sequence.cStr());
+    }
+}
+
+// ----------------------------------------------------------------------------
+void BatchQuery::writeStats(FILE* out) const
+{
+    fprintf(out, "query\tplayer\topponent\tfiles_compiled\tfiles_failed\tfiles_matched\tmatches\tcompile_ms\tapply_ms\tmax_apply_ms\terror\n");
+    for (int queryIdx = 0; queryIdx != queryStats_.count(); ++queryIdx)
+    {
+        const QueryStats& stats = queryStats_[queryIdx];
+        fprintf(out, "%d\t%s\t%s\t%d\t%d\t%d\t%d\t%.3f\t%.3f\t%.3f\t%s\n",
+            queryIdx,
+            queries_[queryIdx].player.cStr(),
+            queries_[queryIdx].opponent.cStr(),
+            stats.filesCompiled,
+            stats.filesFailed,
+            stats.filesMatched,
+            stats.matchCount,
+            stats.compileTimeNS / 1e6,
+            stats.applyTimeNS / 1e6,
+            stats.maxApplyTimeNS / 1e6,
+            stats.firstError.cStr());
+    }
+
+    fprintf(out, "\n# files: %d, failed: %d, load: %.3f ms, wall time: %.3f ms, threads: %d\n",
+        files_.count(),
+        failedFileCount(),
+        loadTimeNS() / 1e6,
+        wallTimeNS_ / 1e6,
+        threadPool_.maxThreadCount());
+
+    for (const FileResult& file : files_)
+        if (file.error.length() > 0)
+            fprintf(out, "# %s: %s\n", file.fileName.toUtf8().constData(), file.error.cStr());
+}
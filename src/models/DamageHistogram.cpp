@@ -0,0 +1,133 @@
+#include "decision-graph/models/DamageHistogram.hpp"
+#include "decision-graph/models/Sequence.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// ----------------------------------------------------------------------------
+DamageHistogram::DamageHistogram()
+{}
+
+// ----------------------------------------------------------------------------
+DamageHistogram::~DamageHistogram()
+{}
+
+// ----------------------------------------------------------------------------
+void DamageHistogram::clear()
+{
+    partials_.clear();
+    queryCounts_.clear();
+    queryCount_ = 0;
+    sessionCount_ = 0;
+}
+
+// ----------------------------------------------------------------------------
+void DamageHistogram::setSize(int queryCount, int sessionCount)
+{
+    if (queryCount_ == queryCount && sessionCount_ == sessionCount)
+        return;
+
+    clear();
+    queryCount_ = queryCount;
+    sessionCount_ = sessionCount;
+    for (int i = 0; i != queryCount * sessionCount; ++i)
+        partials_.emplace();
+    for (int i = 0; i != queryCount; ++i)
+        queryCounts_.emplace();
+}
+
+// ----------------------------------------------------------------------------
+bool DamageHistogram::updateSession(int queryIdx, int sessionIdx, const States& states, const rfcommon::Vector<Range>& matches)
+{
+    Partial& p = partial(queryIdx, sessionIdx);
+
+    uint64_t signature = 14695981039346656037ull;
+    auto mix = [&signature](uint64_t value) {
+        signature = (signature ^ value) * 1099511628211ull;
+    };
+    mix(matches.count());
+    for (const Range& range : matches)
+    {
+        mix(range.startIdx);
+        mix(range.endIdx);
+    }
+
+    if (p.valid && p.signature == signature)
+        return false;
+
+    p.sortedDamage.clear();
+    p.sortedDamage.reserve(matches.count());
+    for (const Range& range : matches)
+        p.sortedDamage.push(states[range.startIdx].sideData.damage);
+    std::sort(p.sortedDamage.begin(), p.sortedDamage.end());
+
+    p.signature = signature;
+    p.valid = true;
+
+    // The highest damage value may have changed, which changes the number
+    // of buckets for every query
+    invalidateCounts();
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+void DamageHistogram::setBucketSize(float percent)
+{
+    if (bucketSize_ == percent)
+        return;
+
+    bucketSize_ = percent;
+    invalidateCounts();
+}
+
+// ----------------------------------------------------------------------------
+void DamageHistogram::invalidateCounts()
+{
+    for (QueryCounts& c : queryCounts_)
+        c.dirty = true;
+}
+
+// ----------------------------------------------------------------------------
+int DamageHistogram::bucketCount() const
+{
+    float maxDamage = -1.0f;
+    for (const Partial& p : partials_)
+        if (p.sortedDamage.count() > 0)
+            maxDamage = std::max(maxDamage, p.sortedDamage.back());
+
+    if (maxDamage < 0.0f)
+        return 0;
+    return static_cast<int>(std::floor(maxDamage / bucketSize_)) + 1;
+}
+
+// ----------------------------------------------------------------------------
+const rfcommon::Vector<int>& DamageHistogram::counts(int queryIdx)
+{
+    QueryCounts& c = queryCounts_[queryIdx];
+    if (c.dirty == false)
+        return c.buckets;
+    c.dirty = false;
+
+    const int buckets = bucketCount();
+    c.buckets.resize(buckets);
+    std::fill(c.buckets.begin(), c.buckets.end(), 0);
+
+    for (int sessionIdx = 0; sessionIdx != sessionCount_; ++sessionIdx)
+    {
+        const rfcommon::Vector<float>& values = partial(queryIdx, sessionIdx).sortedDamage;
+        if (values.count() == 0)
+            continue;
+
+        // Each bucket edge is found with a binary search. The search range
+        // shrinks as we go, since edges are increasing
+        const float* lower = values.begin();
+        for (int i = 0; i != buckets; ++i)
+        {
+            const float* upper = std::lower_bound(lower, values.end(), (i + 1) * bucketSize_);
+            c.buckets[i] += static_cast<int>(upper - lower);
+            lower = upper;
+        }
+    }
+
+    return c.buckets;
+}
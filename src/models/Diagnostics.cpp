@@ -0,0 +1,70 @@
+#include "decision-graph/models/Diagnostics.hpp"
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+
+// ----------------------------------------------------------------------------
+Diagnostics::Diagnostics()
+{
+    // A single thread keeps writes to the same file in order
+    writerPool_.setMaxThreadCount(1);
+    clock_.start();
+}
+
+// ----------------------------------------------------------------------------
+Diagnostics::~Diagnostics()
+{
+    writerPool_.waitForDone();
+}
+
+// ----------------------------------------------------------------------------
+void Diagnostics::setEnabled(bool enable)
+{
+    enabled_ = enable;
+}
+
+// ----------------------------------------------------------------------------
+void Diagnostics::setOutputDirectory(const QString& dir)
+{
+    outputDir_ = dir;
+}
+
+// ----------------------------------------------------------------------------
+void Diagnostics::setMinInterval(int ms)
+{
+    minIntervalMs_ = ms;
+    lastWrite_.clear();
+}
+
+// ----------------------------------------------------------------------------
+bool Diagnostics::shouldWrite(const char* name)
+{
+    if (enabled_ == false)
+        return false;
+
+    const int64_t now = clock_.elapsed();
+    auto it = lastWrite_.insertOrGet(rfcommon::String(name), -1);
+    if (it->value() >= 0 && now - it->value() < minIntervalMs_)
+        return false;
+
+    it->value() = now;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+void Diagnostics::write(const char* name, const rfcommon::String& content)
+{
+    const QString dir = outputDir_.isEmpty() ? QDir::currentPath() : outputDir_;
+    const QString path = QDir(dir).filePath(QString::fromUtf8(name));
+    const QByteArray data(content.cStr(), content.length());
+
+    writerPool_.start([dir, path, data] {
+        QDir().mkpath(dir);
+
+        QFile file(path);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate) == false)
+            return;
+        file.write(data);
+    });
+}
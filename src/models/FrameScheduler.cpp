@@ -0,0 +1,233 @@
+#include "decision-graph/listeners/FrameSchedulerListener.hpp"
+#include "decision-graph/models/FrameScheduler.hpp"
+#include "decision-graph/models/PipelineMetrics.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Every consumer may use this fraction of the budget, averaged over time
+constexpr double CONSUMER_SHARE = 0.25;
+
+// Weight of a new measurement in the moving average of a consumer's cost
+constexpr double COST_SMOOTHING = 0.3;
+
+// If no frame arrives for this long, e.g. because the game is paused, the
+// deferred updates are run anyway
+constexpr int IDLE_FLUSH_INTERVAL_MS = 100;
+
+}
+
+// ----------------------------------------------------------------------------
+FrameScheduler::FrameScheduler(PipelineMetrics* metrics, int64_t budgetNS)
+    : metrics_(metrics)
+    , budgetNS_(budgetNS)
+{
+    timings_.frame = metrics_->histogram("frame.total");
+    timings_.consumers = metrics_->histogram("frame.consumers");
+    timings_.overBudget = metrics_->counter("frame.over_budget");
+
+    idleTimer_.setSingleShot(true);
+    idleTimer_.setInterval(IDLE_FLUSH_INTERVAL_MS);
+    QObject::connect(&idleTimer_, &QTimer::timeout, [this] { flush(); });
+
+    clock_.start();
+}
+
+// ----------------------------------------------------------------------------
+FrameScheduler::~FrameScheduler()
+{}
+
+// ----------------------------------------------------------------------------
+void FrameScheduler::setBudget(int64_t budgetNS)
+{
+    budgetNS_ = budgetNS;
+}
+
+// ----------------------------------------------------------------------------
+void FrameScheduler::addConsumer(FrameSchedulerListener* consumer, const char* name)
+{
+    const rfcommon::String metricName = rfcommon::String("frame.") + name;
+    consumers_.push({consumer, metrics_->histogram(metricName.cStr()), 0, 0.0, false});
+}
+
+// ----------------------------------------------------------------------------
+void FrameScheduler::removeConsumer(FrameSchedulerListener* consumer)
+{
+    const int consumerIdx = findConsumer(consumer);
+    if (consumerIdx >= 0)
+        consumers_.erase(consumerIdx);
+}
+
+// ----------------------------------------------------------------------------
+bool FrameScheduler::deferUpdate(FrameSchedulerListener* consumer)
+{
+    if (realtime_ == false)
+        return false;
+
+    // Unknown consumers can't be called back later
+    const int consumerIdx = findConsumer(consumer);
+    if (consumerIdx < 0)
+        return false;
+
+    consumers_[consumerIdx].pending = true;
+
+    // Between frames, make sure the update happens even if no frame follows.
+    // During a frame, endFrame() takes care of it
+    if (idleTimer_.isActive() == false)
+        idleTimer_.start();
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+void FrameScheduler::setRealtime(bool enable)
+{
+    if (realtime_ == enable)
+        return;
+
+    realtime_ = enable;
+    if (realtime_ == false)
+        flush();
+}
+
+// ----------------------------------------------------------------------------
+void FrameScheduler::beginFrame()
+{
+    frameStartNS_ = elapsedNS();
+    idleTimer_.stop();
+}
+
+// ----------------------------------------------------------------------------
+int64_t FrameScheduler::matchBudget() const
+{
+    const int64_t remaining = budgetNS_ - (elapsedNS() - frameStartNS_);
+    return std::max<int64_t>(0, std::min(remaining, budgetNS_ / 2));
+}
+
+// ----------------------------------------------------------------------------
+void FrameScheduler::endFrame()
+{
+    const int64_t consumersStartNS = elapsedNS();
+
+    // How long ago a consumer should have been updated. Frames don't arrive
+    // at exact intervals, so consumers are considered due half a frame early
+    auto overdueNS = [this, consumersStartNS](const Consumer& c) -> int64_t {
+        return consumersStartNS - c.lastUpdateNS - updateInterval(c) + FRAME_INTERVAL_NS / 2;
+    };
+
+    // Run the most overdue consumers first, so that consumers which are
+    // due at the same time take turns when not all of them fit
+    rfcommon::SmallVector<int, 8> dueIdxs;
+    for (int i = 0; i != consumers_.count(); ++i)
+        if (consumers_[i].pending && overdueNS(consumers_[i]) >= 0)
+            dueIdxs.push(i);
+    std::sort(dueIdxs.begin(), dueIdxs.end(), [this, &overdueNS](int a, int b) {
+        return overdueNS(consumers_[a]) > overdueNS(consumers_[b]);
+    });
+
+    // Updates may add or remove consumers, which shifts the indices, so
+    // consumers are looked up again before each update
+    rfcommon::SmallVector<FrameSchedulerListener*, 8> due;
+    for (int consumerIdx : dueIdxs)
+        due.push(consumers_[consumerIdx].listener);
+
+    for (FrameSchedulerListener* listener : due)
+    {
+        const int consumerIdx = findConsumer(listener);
+        if (consumerIdx < 0 || consumers_[consumerIdx].pending == false)
+            continue;
+
+        const Consumer& c = consumers_[consumerIdx];
+        const int64_t now = elapsedNS();
+        const int64_t remaining = budgetNS_ - (now - frameStartNS_);
+
+        // A consumer that is too expensive to ever fit into a frame still
+        // has to run eventually
+        const bool starved = now - c.lastUpdateNS >= MAX_UPDATE_INTERVAL_NS;
+        if (c.costNS > remaining && starved == false)
+            continue;
+
+        runUpdate(consumerIdx);
+    }
+
+    const int64_t endNS = elapsedNS();
+    timings_.consumers->add(static_cast<uint64_t>(endNS - consumersStartNS));
+    timings_.frame->add(static_cast<uint64_t>(endNS - frameStartNS_));
+    if (endNS - frameStartNS_ > budgetNS_)
+        timings_.overBudget->add();
+
+    // Whatever didn't fit waits for the next frame, unless there is none
+    idleTimer_.stop();
+    for (const Consumer& c : consumers_)
+        if (c.pending)
+        {
+            idleTimer_.start();
+            break;
+        }
+}
+
+// ----------------------------------------------------------------------------
+void FrameScheduler::flush()
+{
+    idleTimer_.stop();
+
+    rfcommon::SmallVector<FrameSchedulerListener*, 8> pending;
+    for (const Consumer& c : consumers_)
+        if (c.pending)
+            pending.push(c.listener);
+
+    for (FrameSchedulerListener* listener : pending)
+    {
+        const int consumerIdx = findConsumer(listener);
+        if (consumerIdx >= 0 && consumers_[consumerIdx].pending)
+            runUpdate(consumerIdx);
+    }
+}
+
+// ----------------------------------------------------------------------------
+int FrameScheduler::findConsumer(FrameSchedulerListener* consumer) const
+{
+    for (int i = 0; i != consumers_.count(); ++i)
+        if (consumers_[i].listener == consumer)
+            return i;
+    return -1;
+}
+
+// ----------------------------------------------------------------------------
+int64_t FrameScheduler::elapsedNS() const
+{
+    return clock_.nsecsElapsed();
+}
+
+// ----------------------------------------------------------------------------
+int64_t FrameScheduler::updateInterval(const Consumer& consumer) const
+{
+    // A consumer that costs twice its share of the budget can only update
+    // every other frame
+    const double shareNS = budgetNS_ * CONSUMER_SHARE;
+    const double intervalNS = shareNS > 0.0 ? consumer.costNS / shareNS * FRAME_INTERVAL_NS : MAX_UPDATE_INTERVAL_NS;
+    return std::max<int64_t>(FRAME_INTERVAL_NS, std::min<int64_t>(MAX_UPDATE_INTERVAL_NS, static_cast<int64_t>(intervalNS)));
+}
+
+// ----------------------------------------------------------------------------
+void FrameScheduler::runUpdate(int consumerIdx)
+{
+    FrameSchedulerListener* listener = consumers_[consumerIdx].listener;
+    consumers_[consumerIdx].pending = false;
+
+    const int64_t startNS = elapsedNS();
+    listener->onFrameSchedulerUpdate();
+    const int64_t endNS = elapsedNS();
+
+    // The update may have added or removed consumers
+    consumerIdx = findConsumer(listener);
+    if (consumerIdx < 0)
+        return;
+
+    Consumer& c = consumers_[consumerIdx];
+    const double costNS = static_cast<double>(endNS - startNS);
+    c.costNS = c.lastUpdateNS == 0 ? costNS : c.costNS + COST_SMOOTHING * (costNS - c.costNS);
+    c.lastUpdateNS = startNS;
+    c.cost->add(static_cast<uint64_t>(costNS));
+}
@@ -1,72 +1,29 @@
 #include "decision-graph/models/Graph.hpp"
+#include "decision-graph/models/GraphBuilder.hpp"
+#include "decision-graph/models/TransitionMatrix.hpp"
+#include "decision-graph/util/DisjointSet.hpp"
+#include "decision-graph/util/Str.hpp"
 
 #include "rfcommon/MotionLabels.hpp"
-#include "rfcommon/LinearMap.hpp"
 
+#include <algorithm>
 #include <cstdio>
 #include <cinttypes>
 #include <cmath>
 
 namespace {
 
-template <int N>
-class VisitedBitmap
+struct TreeBranch
 {
-public:
-    static VisitedBitmap make(int nodeCount) { return VisitedBitmap(nodeCount); }
-    void reset() { memset(vec_.data(), 0, vec_.count()); }
-
-    bool canVisit(int nodeIdx)
-    {
-        const int idx = nodeIdx / 8;
-        const unsigned char bitPos = static_cast<unsigned int>(nodeIdx) & 0x07;
-        const unsigned char mask = 1 << bitPos;
-        bool notVisited = !(vec_[idx] & mask);
-        vec_[idx] |= mask;
-        return notVisited;
-    }
-
-    void visit(int nodeIdx)
-    {
-        canVisit(nodeIdx);
-    }
-
-    bool visited(int nodeIdx)
-    {
-        return !canVisit(nodeIdx);
-    }
-
-private:
-    VisitedBitmap(int nodeCount) : vec_(rfcommon::SmallVector<unsigned char, N/8+1>::makeResized(nodeCount)) {}
-    rfcommon::SmallVector<unsigned char, N/8+1> vec_;
-};
-
-// We only hash motion, status and flags, and NOT timings/position/shield/damage,
-// because for the purpose of searching for unique states and building graphs,
-// those values are irrelevant
-struct HasherNoSideData
-{
-    typedef uint32_t HashType;
-    HashType operator()(const State& node) const {
-        const uint32_t motion_l = node.motion.lower();
-        const uint16_t status = node.status.value();
-        const uint8_t motion_h = node.motion.upper();
-        const uint8_t interaction = node.interaction();
-
-        const uint32_t a = motion_l;
-        const uint32_t b = (status << 16) | (motion_h << 8) | (interaction << 0);
-        return rfcommon::hash32_combine(a, b);
-    }
+    int edge;
+    int pushedParent;
+    int weight;
 };
 
-struct CompareNoSideData
+struct LighterBranch
 {
-    bool operator()(const State& a, const State& b) const {
-        return
-            a.motion == b.motion &&
-            a.status == b.status &&
-            a.interaction() == b.interaction();
-    }
+    bool operator()(const TreeBranch& a, const TreeBranch& b) const
+        { return a.weight < b.weight; }
 };
 
 }
@@ -84,107 +41,74 @@ void Graph::clear()
 {
     nodes.clearCompact();
     edges.clearCompact();
+    outgoingOffsets_.clearCompact();
+    incomingOffsets_.clearCompact();
+    outgoingEdges_.clearCompact();
+    incomingEdges_.clearCompact();
 }
 
 // ----------------------------------------------------------------------------
-Graph& Graph::addStates(const States& states, const rfcommon::Vector<Range>& ranges)
+void Graph::finalize()
 {
-    // Maps state to a node index so we can look up existing nodes for a given state
-    rfcommon::HashMap<State, int, HasherNoSideData, CompareNoSideData> stateLookup;
-    // Maps edge connections to edge index so we can look up existing connections
-    rfcommon::HashMap<EdgeConnection, int, EdgeConnection::Hasher> edgeLookup;
+    const int nodeCount = nodes.count();
+    const int edgeCount = edges.count();
 
-    // Since this function can get called multiple times per graph, have to
-    // re-construct our temporary maps
-    for (int nodeIdx = 0; nodeIdx != nodes.count(); ++nodeIdx)
-        stateLookup.insertAlways(states[nodes[nodeIdx].stateIdx], nodeIdx);
-    for (int edgeIdx = 0; edgeIdx != edges.count(); ++edgeIdx)
-        edgeLookup.insertAlways(EdgeConnection(edges[edgeIdx].from, edges[edgeIdx].to), edgeIdx);
+    outgoingOffsets_.resize(nodeCount + 1);
+    incomingOffsets_.resize(nodeCount + 1);
+    for (int i = 0; i != nodeCount + 1; ++i)
+    {
+        outgoingOffsets_[i] = 0;
+        incomingOffsets_[i] = 0;
+    }
 
-    for (const Range& range : ranges)
+    // Count the number of edges of each node, then turn the counts into
+    // offsets
+    for (const Edge& edge : edges)
     {
-        int prevNodeIdx = -1;
-        for (int stateIdx = range.startIdx; stateIdx != range.endIdx; ++stateIdx)
-        {
-            const State& state = states[stateIdx];
-            auto nodeLookupResult = stateLookup.insertOrGet(state, -1);
-            if (nodeLookupResult->value() == -1)
-            {
-                nodes.emplace(stateIdx);
-                nodeLookupResult->value() = nodes.count() - 1;
-            }
-            const int currentNodeIdx = nodeLookupResult->value();
+        outgoingOffsets_[edge.from + 1]++;
+        incomingOffsets_[edge.to + 1]++;
+    }
+    for (int i = 0; i != nodeCount; ++i)
+    {
+        outgoingOffsets_[i + 1] += outgoingOffsets_[i];
+        incomingOffsets_[i + 1] += incomingOffsets_[i];
+    }
 
-            if (prevNodeIdx != -1)
-            {
-                auto edgeLookupResult = edgeLookup.insertOrGet(EdgeConnection(prevNodeIdx, currentNodeIdx), -1);
-                if (edgeLookupResult->value() == -1)
-                {
-                    edges.emplace(prevNodeIdx, currentNodeIdx);
-                    nodes[prevNodeIdx].outgoingEdges.push(edges.count() - 1);
-                    nodes[currentNodeIdx].incomingEdges.push(edges.count() - 1);
-
-                    edgeLookupResult->value() = edges.count() - 1;
-                }
-                else
-                    edges[edgeLookupResult->value()].weight++;
-            }
+    // Scatter edge indices into their slots. Edges are visited in order, so
+    // every node's edge list ends up sorted by edge index
+    auto outgoingCursor = rfcommon::Vector<int>::makeResized(nodeCount);
+    auto incomingCursor = rfcommon::Vector<int>::makeResized(nodeCount);
+    for (int i = 0; i != nodeCount; ++i)
+    {
+        outgoingCursor[i] = outgoingOffsets_[i];
+        incomingCursor[i] = incomingOffsets_[i];
+    }
 
-            prevNodeIdx = currentNodeIdx;
-        }
+    outgoingEdges_.resize(edgeCount);
+    incomingEdges_.resize(edgeCount);
+    for (int edgeIdx = 0; edgeIdx != edgeCount; ++edgeIdx)
+    {
+        outgoingEdges_[outgoingCursor[edges[edgeIdx].from]++] = edgeIdx;
+        incomingEdges_[incomingCursor[edges[edgeIdx].to]++] = edgeIdx;
     }
+}
 
+// ----------------------------------------------------------------------------
+Graph& Graph::addStates(const States& states, const rfcommon::Vector<Range>& ranges)
+{
+    // Since this function can get called multiple times per graph, the
+    // builder has to re-construct its lookup tables. Use GraphBuilder
+    // directly if you are adding states repeatedly.
+    GraphBuilder(this, states).addStates(states, ranges);
+    finalize();
     return *this;
 }
 
 // ----------------------------------------------------------------------------
 Graph& Graph::addStates(const States& states, const rfcommon::Vector<Sequence>& sequences)
 {
-    // Maps state to a node index so we can look up existing nodes for a given state
-    rfcommon::HashMap<State, int, HasherNoSideData, CompareNoSideData> stateLookup;
-    // Maps edge connections to edge index so we can look up existing connections
-    rfcommon::HashMap<EdgeConnection, int, EdgeConnection::Hasher> edgeLookup;
-
-    // Since this function can get called multiple times per graph, have to
-    // re-construct our temporary maps
-    for (int nodeIdx = 0; nodeIdx != nodes.count(); ++nodeIdx)
-        stateLookup.insertAlways(states[nodes[nodeIdx].stateIdx], nodeIdx);
-    for (int edgeIdx = 0; edgeIdx != edges.count(); ++edgeIdx)
-        edgeLookup.insertAlways(EdgeConnection(edges[edgeIdx].from, edges[edgeIdx].to), edgeIdx);
-
-    for (const Sequence& seq : sequences)
-    {
-        int prevNodeIdx = -1;
-        for (int stateIdx : seq.idxs)
-        {
-            const State& state = states[stateIdx];
-            auto nodeLookupResult = stateLookup.insertOrGet(state, -1);
-            if (nodeLookupResult->value() == -1)
-            {
-                nodes.emplace(stateIdx);
-                nodeLookupResult->value() = nodes.count() - 1;
-            }
-            const int currentNodeIdx = nodeLookupResult->value();
-
-            if (prevNodeIdx != -1)
-            {
-                auto edgeLookupResult = edgeLookup.insertOrGet(EdgeConnection(prevNodeIdx, currentNodeIdx), -1);
-                if (edgeLookupResult->value() == -1)
-                {
-                    edges.emplace(prevNodeIdx, currentNodeIdx);
-                    nodes[prevNodeIdx].outgoingEdges.push(edges.count() - 1);
-                    nodes[currentNodeIdx].incomingEdges.push(edges.count() - 1);
-
-                    edgeLookupResult->value() = edges.count() - 1;
-                }
-                else
-                    edges[edgeLookupResult->value()].weight++;
-            }
-
-            prevNodeIdx = currentNodeIdx;
-        }
-    }
-
+    GraphBuilder(this, states).addStates(states, sequences);
+    finalize();
     return *this;
 }
 
@@ -197,14 +121,6 @@ Graph& Graph::addIsland(const Graph& other)
     nodes.push(other.nodes);
     edges.push(other.edges);
 
-    for (int nodeIdx = nodeOffset; nodeIdx != nodes.count(); ++nodeIdx)
-    {
-        for (int& e : nodes[nodeIdx].outgoingEdges)
-            e += edgeOffset;
-        for (int& e : nodes[nodeIdx].incomingEdges)
-            e += edgeOffset;
-    }
-
     for (int edgeIdx = edgeOffset; edgeIdx != edges.count(); ++edgeIdx)
     {
         edges[edgeIdx].from += nodeOffset;
@@ -223,9 +139,9 @@ int Graph::findHighestThroughputNode() const
     {
         int outgoing = 0;
         int incoming = 0;
-        for (int edge : nodes[node].outgoingEdges)
+        for (int edge : outgoingEdges(node))
             outgoing += edges[edge].weight;
-        for (int edge : nodes[node].incomingEdges)
+        for (int edge : incomingEdges(node))
             incoming += edges[edge].weight;
 
         int throughput = outgoing < incoming ? outgoing : incoming;
@@ -239,6 +155,12 @@ int Graph::findHighestThroughputNode() const
     return idx;
 }
 
+// ----------------------------------------------------------------------------
+TransitionMatrix Graph::transitionMatrix() const
+{
+    return TransitionMatrix(*this);
+}
+
 // ----------------------------------------------------------------------------
 int Graph::findHighestThroughputEdge() const
 {
@@ -258,232 +180,166 @@ int Graph::findHighestThroughputEdge() const
 // ----------------------------------------------------------------------------
 rfcommon::Vector<Graph> Graph::islands() const
 {
-    rfcommon::Vector<Graph> islands;
-    rfcommon::SmallVector<int, 256> children;
-    rfcommon::SmallVector<int, 256> parents;
-    rfcommon::SmallVector<int, 256> pushedParents;
-    rfcommon::SmallLinearMap<int, int, 256> map;
-    auto visited = VisitedBitmap<256>::make(nodes.count());
+    DisjointSet components(nodes.count());
+    for (const Edge& edge : edges)
+        components.unite(edge.from, edge.to);
 
-    for (int root = 0; root != nodes.count(); ++root)
-    {
-        if (visited.visited(root))
-            continue;
+    return islands(components);
+}
 
-        Graph graph;
-        graph.nodes.emplace(nodes[root].stateIdx);
-        map.insertIfNew(root, 0);
-        visited.visit(root);
+// ----------------------------------------------------------------------------
+rfcommon::Vector<Graph> Graph::islands(DisjointSet& components) const
+{
+    assert(components.count() == nodes.count());
 
-        for (int edge : nodes[root].outgoingEdges)
-            if (visited.canVisit(edges[edge].to))
-            {
-                parents.push(root);
-                children.push(edges[edge].to);
-                pushedParents.push(0);
-            }
-        for (int edge : nodes[root].incomingEdges)
-            if (visited.canVisit(edges[edge].from))
-            {
-                parents.push(root);
-                children.push(edges[edge].from);
-                pushedParents.push(0);
-            }
+    rfcommon::Vector<Graph> islands;
+
+    // Number each component in the order its first node appears, and map
+    // each node to its index within that island
+    auto islandIdx = rfcommon::Vector<int>::makeResized(nodes.count());
+    auto islandNodeIdx = rfcommon::Vector<int>::makeResized(nodes.count());
+    auto rootToIsland = rfcommon::Vector<int>::makeResized(nodes.count());
+    rfcommon::Vector<int> islandNodeCount;
+    rfcommon::Vector<int> islandEdgeCount;
+    for (int& idx : rootToIsland)
+        idx = -1;
 
-        while (children.count())
+    for (int node = 0; node != nodes.count(); ++node)
+    {
+        const int root = components.find(node);
+        if (rootToIsland[root] == -1)
         {
-            int child = children.popValue();
-            int parent = parents.popValue();
-            int pushedParent = pushedParents.popValue();
-
-            // Insert new node (we call it the "pushed child")
-            int pushedChild = graph.nodes.count();
-            graph.nodes.emplace(nodes[child].stateIdx);
-            map.insertIfNew(child, pushedChild);
-
-            // Connect new node to parent. Can be incoming or outgoing connection
-            for (int edge : nodes[child].outgoingEdges)
-                if (edges[edge].to == parent)
-                {
-                    graph.edges.emplace(pushedChild, pushedParent, edges[edge].weight);
-                    graph.nodes[pushedChild].outgoingEdges.push(graph.edges.count() - 1);
-                    graph.nodes[pushedParent].incomingEdges.push(graph.edges.count() - 1);
-                    goto edge_pushed;
-                }
-            for (int edge : nodes[child].incomingEdges)
-                if (edges[edge].from == parent)
-                {
-                    graph.edges.emplace(pushedParent, pushedChild, edges[edge].weight);
-                    graph.nodes[pushedParent].outgoingEdges.push(graph.edges.count() - 1);
-                    graph.nodes[pushedChild].incomingEdges.push(graph.edges.count() - 1);
-                    goto edge_pushed;
-                }
-            assert(false);
-            edge_pushed:;
-
-            // Go to next children
-            for (int edge : nodes[child].outgoingEdges)
-                if (visited.canVisit(edges[edge].to))
-                {
-                    parents.push(child);
-                    children.push(edges[edge].to);
-                    pushedParents.push(pushedChild);
-                }
-                else  // May have to close loop, since this is a graph
-                {
-                    auto it = map.findKey(edges[edge].to);
-                    if (it == map.end())
-                        continue;
-                    int pushedVisitedNode = it->value();
-                    for (int pushedEdge : graph.nodes[pushedChild].outgoingEdges)
-                        if (graph.edges[pushedEdge].to == pushedVisitedNode)
-                            goto outgoing_edge_already_copied;
-
-                    graph.edges.emplace(pushedChild, pushedVisitedNode, edges[edge].weight);
-                    graph.nodes[pushedChild].outgoingEdges.push(graph.edges.count() - 1);
-                    graph.nodes[pushedVisitedNode].incomingEdges.push(graph.edges.count() - 1);
-                    outgoing_edge_already_copied: continue;
-                }
-            for (int edge : nodes[child].incomingEdges)
-                if (visited.canVisit(edges[edge].from))
-                {
-                    parents.push(child);
-                    children.push(edges[edge].from);
-                    pushedParents.push(pushedChild);
-                }
-                else  // May have to close loop, since this is a graph
-                {
-                    auto it = map.findKey(edges[edge].from);
-                    if (it == map.end())
-                        continue;
-                    int pushedVisitedNode = it->value();
-                    for (int pushedEdge : graph.nodes[pushedChild].incomingEdges)
-                        if (graph.edges[pushedEdge].from == pushedVisitedNode)
-                            goto incoming_edge_already_copied;
-
-                    graph.edges.emplace(pushedVisitedNode, pushedChild, edges[edge].weight);
-                    graph.nodes[pushedVisitedNode].outgoingEdges.push(graph.edges.count() - 1);
-                    graph.nodes[pushedChild].incomingEdges.push(graph.edges.count() - 1);
-                    incoming_edge_already_copied: continue;
-                }
+            rootToIsland[root] = islandNodeCount.count();
+            islandNodeCount.push(0);
+            islandEdgeCount.push(0);
         }
+        islandIdx[node] = rootToIsland[root];
+        islandNodeIdx[node] = islandNodeCount[islandIdx[node]]++;
+    }
+    for (const Edge& edge : edges)
+        islandEdgeCount[islandIdx[edge.from]]++;
 
-        islands.push(std::move(graph));
+    // Distribute nodes and edges into their buckets in a single pass each
+    for (int i = 0; i != islandNodeCount.count(); ++i)
+    {
+        Graph& graph = islands.emplace();
+        graph.nodes.reserve(islandNodeCount[i]);
+        graph.edges.reserve(islandEdgeCount[i]);
     }
+    for (int node = 0; node != nodes.count(); ++node)
+        islands[islandIdx[node]].nodes.emplace(nodes[node].stateIdx);
+    for (const Edge& edge : edges)
+        islands[islandIdx[edge.from]].edges.emplace(
+            islandNodeIdx[edge.from], islandNodeIdx[edge.to], edge.weight);
+
+    for (Graph& graph : islands)
+        graph.finalize();
 
     return islands;
 }
 
 // ----------------------------------------------------------------------------
-Graph Graph::outgoingTree(const States& states) const
+Graph Graph::outgoingTree(int maxDepth, int maxBranches) const
 {
-    rfcommon::SmallVector<int, 256> children;
-    rfcommon::SmallVector<int, 256> parents;
-    rfcommon::SmallVector<int, 256> pushedParents;
-    auto visited = VisitedBitmap<256>::make(nodes.count());
+    return neighborhoodTree(maxDepth, 0, maxBranches);
+}
 
-    Graph result;
+// ----------------------------------------------------------------------------
+Graph Graph::incomingTree(int maxDepth, int maxBranches) const
+{
+    return neighborhoodTree(0, maxDepth, maxBranches);
+}
+
+// ----------------------------------------------------------------------------
+Graph Graph::neighborhoodTree(int outgoingDepth, int incomingDepth, int maxBranches) const
+{
+    return neighborhoodTreeFrom(findHighestThroughputNode(), outgoingDepth, incomingDepth, maxBranches);
+}
 
-    int root = findHighestThroughputNode();
+// ----------------------------------------------------------------------------
+Graph Graph::neighborhoodTree(const TransitionMatrix& transitions, int outgoingDepth, int incomingDepth, int maxBranches) const
+{
+    assert(transitions.nodeCount() == nodes.count());
+    return neighborhoodTreeFrom(transitions.highestThroughputNode(), outgoingDepth, incomingDepth, maxBranches);
+}
+
+// ----------------------------------------------------------------------------
+Graph Graph::neighborhoodTreeFrom(int root, int outgoingDepth, int incomingDepth, int maxBranches) const
+{
+    Graph result;
     if (root == -1)
         return result;
 
+    // Maps node indices of this graph to node indices in the tree. Only
+    // nodes that end up in the tree are ever inserted, so the cost of
+    // extracting a small neighborhood does not depend on the graph's size
+    rfcommon::HashMap<int, int> emitted;
+    emitted.insertAlways(root, 0);
     result.nodes.emplace(nodes[root].stateIdx);
-    visited.visit(root);
 
-    for (int edge : nodes[root].outgoingEdges)
-        if (visited.canVisit(edges[edge].to))
-        {
-            parents.push(root);
-            children.push(edges[edge].to);
-            pushedParents.push(0);
-        }
-
-    while (children.count())
-    {
-        int child = children.popValue();
-        int parent = parents.popValue();
-        int pushedParent = pushedParents.popValue();
-
-        int pushedChild = result.nodes.count();
-        result.nodes.emplace(nodes[child].stateIdx);
-        for (int edge : nodes[child].incomingEdges)
-            if (edges[edge].from == parent)
-            {
-                result.edges.emplace(pushedParent, pushedChild, edges[edge].weight);
-                result.nodes[pushedParent].outgoingEdges.push(result.edges.count() - 1);
-                result.nodes[pushedChild].incomingEdges.push(result.edges.count() - 1);
-                goto edge_pushed;
-            }
-        assert(false);
-        edge_pushed:;
-
-        for (int edge : nodes[child].outgoingEdges)
-            if (visited.canVisit(edges[edge].to))
-            {
-                parents.push(child);
-                children.push(edges[edge].to);
-                pushedParents.push(pushedChild);
-            }
-    }
+    if (outgoingDepth != 0)
+        expandTree(&result, &emitted, root, true, outgoingDepth, maxBranches);
+    if (incomingDepth != 0)
+        expandTree(&result, &emitted, root, false, incomingDepth, maxBranches);
 
+    result.finalize();
     return result;
 }
 
 // ----------------------------------------------------------------------------
-Graph Graph::incomingTree(const States& states) const
+void Graph::expandTree(Graph* tree, rfcommon::HashMap<int, int>* emitted, int root, bool outgoing, int maxDepth, int maxBranches) const
 {
-    rfcommon::SmallVector<int, 256> children;
-    rfcommon::SmallVector<int, 256> parents;
-    rfcommon::SmallVector<int, 256> pushedParents;
-    auto visited = VisitedBitmap<256>::make(nodes.count());
-
-    Graph result;
-
-    int root = findHighestThroughputNode();
-    if (root == -1)
-        return result;
-
-    result.nodes.emplace(nodes[root].stateIdx);
-    visited.visit(root);
+    rfcommon::Vector<TreeBranch> branches;
+    rfcommon::Vector<int> level, nextLevel;
+    rfcommon::Vector<int> pushedLevel, pushedNextLevel;
 
-    for (int edge : nodes[root].incomingEdges)
-        if (visited.canVisit(edges[edge].from))
-        {
-            parents.push(root);
-            children.push(edges[edge].from);
-            pushedParents.push(0);
-        }
+    level.push(root);
+    pushedLevel.push(0);
 
-    while (children.count())
+    // Expand breadth-first, one level at a time. Note that a negative
+    // maxDepth never compares equal to depth, meaning the depth is unlimited
+    for (int depth = 0; depth != maxDepth && level.count() > 0; ++depth)
     {
-        int child = children.popValue();
-        int parent = parents.popValue();
-        int pushedParent = pushedParents.popValue();
-
-        int pushedChild = result.nodes.count();
-        result.nodes.emplace(nodes[child].stateIdx);
-        for (int edge : nodes[child].outgoingEdges)
-            if (edges[edge].to == parent)
+        // Gather all connections leading away from the current level to
+        // nodes that are not part of the tree yet
+        branches.clear();
+        for (int i = 0; i != level.count(); ++i)
+            for (int edge : outgoing ? outgoingEdges(level[i]) : incomingEdges(level[i]))
             {
-                result.edges.emplace(pushedChild, pushedParent, edges[edge].weight);
-                result.nodes[pushedChild].outgoingEdges.push(result.edges.count() - 1);
-                result.nodes[pushedParent].incomingEdges.push(result.edges.count() - 1);
-                goto edge_pushed;
+                const int child = outgoing ? edges[edge].to : edges[edge].from;
+                if (emitted->find(child) == emitted->end())
+                    branches.push({ edge, pushedLevel[i], edges[edge].weight });
             }
-        assert(false);
-        edge_pushed:;
 
-        for (int edge : nodes[child].incomingEdges)
-            if (visited.canVisit(edges[edge].from))
-            {
-                parents.push(child);
-                children.push(edges[edge].from);
-                pushedParents.push(pushedChild);
-            }
-    }
+        // Pop the heaviest branches off a heap until we have enough. The
+        // same child can be reachable from multiple parents, in which case
+        // it gets attached to the heaviest one
+        nextLevel.clear();
+        pushedNextLevel.clear();
+        std::make_heap(branches.begin(), branches.end(), LighterBranch());
+        for (TreeBranch* heapEnd = branches.end(); heapEnd != branches.begin() && nextLevel.count() != maxBranches; )
+        {
+            std::pop_heap(branches.begin(), heapEnd, LighterBranch());
+            const TreeBranch& branch = *--heapEnd;
+
+            const int child = outgoing ? edges[branch.edge].to : edges[branch.edge].from;
+            const int pushedChild = tree->nodes.count();
+            if (emitted->insertIfNew(child, pushedChild) == emitted->end())
+                continue;
+
+            tree->nodes.emplace(nodes[child].stateIdx);
+            if (outgoing)
+                tree->edges.emplace(branch.pushedParent, pushedChild, branch.weight);
+            else
+                tree->edges.emplace(pushedChild, branch.pushedParent, branch.weight);
+
+            nextLevel.push(child);
+            pushedNextLevel.push(pushedChild);
+        }
 
-    return result;
+        std::swap(level, nextLevel);
+        std::swap(pushedLevel, pushedNextLevel);
+    }
 }
 
 // ----------------------------------------------------------------------------
@@ -501,26 +357,34 @@ rfcommon::Vector<Graph::UniqueSequence> Graph::treeToUniuqeOutgoingSequences() c
     {
         int node = stack.popValue();
 
-        if (nodes[node].outgoingEdges.count() == 0)
+        if (outgoingEdges(node).count() == 0)
             leafNodes.push(node);
 
-        for (int edge : nodes[node].outgoingEdges)
+        for (int edge : outgoingEdges(node))
             stack.push(edges[edge].to);
     }
 
     while (leafNodes.count())
     {
         int node = leafNodes.popValue();
-        int weight = nodes[node].incomingEdges.count() ? edges[nodes[node].incomingEdges[0]].weight : 1;
+        int weight = incomingEdges(node).count() ? edges[incomingEdges(node)[0]].weight : 1;
+
+        // Measure the path to the root first, so the sequence can be filled
+        // back to front instead of inserting at the front for every node
+        int length = 1;
+        for (int n = node; incomingEdges(n).count(); n = edges[incomingEdges(n)[0]].from)
+        {
+            assert(incomingEdges(n).count() == 1);
+            length++;
+        }
 
         Sequence seq;
-        while (1)
+        seq.idxs.resize(length);
+        for (int i = length - 1; i >= 0; --i)
         {
-            seq.idxs.insert(0, nodes[node].stateIdx);
-            assert(nodes[node].incomingEdges.count() <= 1);
-            if (nodes[node].incomingEdges.count() == 0)
-                break;
-            node = edges[nodes[node].incomingEdges[0]].from;
+            seq.idxs[i] = nodes[node].stateIdx;
+            if (i > 0)
+                node = edges[incomingEdges(node)[0]].from;
         }
 
         result.emplace(std::move(seq), weight);
@@ -544,26 +408,26 @@ rfcommon::Vector<Graph::UniqueSequence> Graph::treeToUniqueIncomingSequences() c
     {
         int node = stack.popValue();
 
-        if (nodes[node].incomingEdges.count() == 0)
+        if (incomingEdges(node).count() == 0)
             leafNodes.push(node);
 
-        for (int edge : nodes[node].incomingEdges)
+        for (int edge : incomingEdges(node))
             stack.push(edges[edge].from);
     }
 
     while (leafNodes.count())
     {
         int node = leafNodes.popValue();
-        int weight = nodes[node].outgoingEdges.count() ? edges[nodes[node].outgoingEdges[0]].weight : 1;
+        int weight = outgoingEdges(node).count() ? edges[outgoingEdges(node)[0]].weight : 1;
 
         Sequence seq;
         while (1)
         {
             seq.idxs.push(nodes[node].stateIdx);
-            assert(nodes[node].outgoingEdges.count() <= 1);
-            if (nodes[node].outgoingEdges.count() == 0)
+            assert(outgoingEdges(node).count() <= 1);
+            if (outgoingEdges(node).count() == 0)
                 break;
-            node = edges[nodes[node].outgoingEdges[0]].to;
+            node = edges[outgoingEdges(node)[0]].to;
         }
 
         result.emplace(std::move(seq), weight);
@@ -573,11 +437,9 @@ rfcommon::Vector<Graph::UniqueSequence> Graph::treeToUniqueIncomingSequences() c
 }
 
 // ----------------------------------------------------------------------------
-void Graph::exportDOT(const char* fileName, const States& states, const rfcommon::MotionLabels* labels) const
+rfcommon::String Graph::toDOT(const States& states, const rfcommon::MotionLabels* labels) const
 {
-    FILE* fp = fopen(fileName, "wb");
-    if (fp == nullptr)
-        return;
+    rfcommon::String out;
 
     const float maxWeight = [this]() -> float {
         float weight = 1.0;
@@ -589,7 +451,7 @@ void Graph::exportDOT(const char* fileName, const States& states, const rfcommon
 
     auto accIncomingWeights = [this](int nodeIdx) -> float {
         float weight = 0.0;
-        for (const auto& edgeIdx : nodes[nodeIdx].incomingEdges)
+        for (const auto& edgeIdx : incomingEdges(nodeIdx))
             weight += edges[edgeIdx].weight;
         return weight;
     };
@@ -600,7 +462,7 @@ void Graph::exportDOT(const char* fileName, const States& states, const rfcommon
         return (2.0 / 3.0) - (weight * 2.0 / 3.0);  // hue goes from 0 (red) to 0.666 (blue)
     };
 
-    fprintf(fp, "digraph decisions {\n");
+    StrAppendf(&out, "digraph decisions {\n");
 
     for (int nodeIdx = 0; nodeIdx != nodes.count(); ++nodeIdx)
     {
@@ -619,7 +481,7 @@ void Graph::exportDOT(const char* fileName, const States& states, const rfcommon
         if (state.opponentInShieldlag())
             flags += rfcommon::String(flags.length() ? ", op shieldlag" : "| op shieldlag");
 
-        fprintf(fp, "  n%d [shape=record,color=\"%f 1.0 1.0\",label=\"{ %s %s }\"];\n",
+        StrAppendf(&out, "  n%d [shape=record,color=\"%f 1.0 1.0\",label=\"{ %s %s }\"];\n",
             nodeIdx,
             hue(accIncomingWeights(nodeIdx)),
             labels->toPreferredNotation(states.fighterID, state.motion),
@@ -628,13 +490,13 @@ void Graph::exportDOT(const char* fileName, const States& states, const rfcommon
 
     for (int edgeIdx = 0; edgeIdx != edges.count(); ++edgeIdx)
     {
-        fprintf(fp, "  n%d -> n%d [label=\"%d\", weight=%d];\n",
+        StrAppendf(&out, "  n%d -> n%d [label=\"%d\", weight=%d];\n",
                 edges[edgeIdx].from,
                 edges[edgeIdx].to,
                 edges[edgeIdx].weight,
                 edges[edgeIdx].weight);
     }
 
-    fprintf(fp, "}\n");
-    fclose(fp);
+    StrAppendf(&out, "}\n");
+    return out;
 }
@@ -0,0 +1,122 @@
+#include "decision-graph/models/GraphBuilder.hpp"
+#include "decision-graph/models/Graph.hpp"
+
+// ----------------------------------------------------------------------------
+GraphBuilder::GraphBuilder(Graph* graph)
+    : graph_(graph)
+{
+    assert(graph_->nodes.count() == 0);
+}
+
+// ----------------------------------------------------------------------------
+GraphBuilder::GraphBuilder(Graph* graph, const States& states)
+    : graph_(graph)
+{
+    reset(states);
+}
+
+// ----------------------------------------------------------------------------
+GraphBuilder::~GraphBuilder()
+{}
+
+// ----------------------------------------------------------------------------
+void GraphBuilder::clear()
+{
+    graph_->clear();
+    stateLookup_.clear();
+    edgeLookup_.clear();
+    components_.clear();
+}
+
+// ----------------------------------------------------------------------------
+void GraphBuilder::reset(const States& states)
+{
+    stateLookup_.clear();
+    edgeLookup_.clear();
+    components_ = DisjointSet(graph_->nodes.count());
+
+    for (int nodeIdx = 0; nodeIdx != graph_->nodes.count(); ++nodeIdx)
+        stateLookup_.insertAlways(states[graph_->nodes[nodeIdx].stateIdx], nodeIdx);
+    for (int edgeIdx = 0; edgeIdx != graph_->edges.count(); ++edgeIdx)
+    {
+        const Edge& edge = graph_->edges[edgeIdx];
+        edgeLookup_.insertAlways(EdgeConnection(edge.from, edge.to), edgeIdx);
+        components_.unite(edge.from, edge.to);
+    }
+}
+
+// ----------------------------------------------------------------------------
+GraphBuilder& GraphBuilder::addStates(const States& states, const rfcommon::Vector<Range>& ranges, int firstIdx)
+{
+    for (int i = firstIdx; i < ranges.count(); ++i)
+        addStates(states, ranges[i]);
+
+    return *this;
+}
+
+// ----------------------------------------------------------------------------
+GraphBuilder& GraphBuilder::addStates(const States& states, const rfcommon::Vector<Sequence>& sequences, int firstIdx)
+{
+    for (int i = firstIdx; i < sequences.count(); ++i)
+        addStates(states, sequences[i]);
+
+    return *this;
+}
+
+// ----------------------------------------------------------------------------
+GraphBuilder& GraphBuilder::addStates(const States& states, const Range& range)
+{
+    int prevNodeIdx = -1;
+    for (int stateIdx = range.startIdx; stateIdx != range.endIdx; ++stateIdx)
+    {
+        const int currentNodeIdx = addNode(states, stateIdx);
+        if (prevNodeIdx != -1)
+            addEdge(prevNodeIdx, currentNodeIdx);
+        prevNodeIdx = currentNodeIdx;
+    }
+
+    return *this;
+}
+
+// ----------------------------------------------------------------------------
+GraphBuilder& GraphBuilder::addStates(const States& states, const Sequence& sequence)
+{
+    int prevNodeIdx = -1;
+    for (int stateIdx : sequence.idxs)
+    {
+        const int currentNodeIdx = addNode(states, stateIdx);
+        if (prevNodeIdx != -1)
+            addEdge(prevNodeIdx, currentNodeIdx);
+        prevNodeIdx = currentNodeIdx;
+    }
+
+    return *this;
+}
+
+// ----------------------------------------------------------------------------
+int GraphBuilder::addNode(const States& states, int stateIdx)
+{
+    auto nodeLookupResult = stateLookup_.insertOrGet(states[stateIdx], -1);
+    if (nodeLookupResult->value() == -1)
+    {
+        graph_->nodes.emplace(stateIdx);
+        components_.add();
+        nodeLookupResult->value() = graph_->nodes.count() - 1;
+    }
+
+    return nodeLookupResult->value();
+}
+
+// ----------------------------------------------------------------------------
+void GraphBuilder::addEdge(int fromNodeIdx, int toNodeIdx)
+{
+    auto edgeLookupResult = edgeLookup_.insertOrGet(EdgeConnection(fromNodeIdx, toNodeIdx), -1);
+    if (edgeLookupResult->value() == -1)
+    {
+        graph_->edges.emplace(fromNodeIdx, toNodeIdx);
+        components_.unite(fromNodeIdx, toNodeIdx);
+        edgeLookupResult->value() = graph_->edges.count() - 1;
+    }
+    else
+        graph_->edges[edgeLookupResult->value()].weight++;
+}
@@ -0,0 +1,295 @@
+#include "decision-graph/models/Graph.hpp"
+#include "decision-graph/models/GraphItem.hpp"
+#include "decision-graph/models/GraphLayout.hpp"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include <cmath>
+
+// Edge labels and arrow heads may stick out of the bounding boxes of the
+// nodes and edges
+static const double LABEL_MARGIN = 30.0;
+
+// Below this zoom level text is unreadable, so don't bother drawing it
+static const double TEXT_MIN_LEVEL_OF_DETAIL = 0.3;
+
+// Labels are cached until there are this many different ones
+static const int MAX_CACHED_TEXTS = 4096;
+
+// ----------------------------------------------------------------------------
+GraphItem::GraphItem()
+{
+    // Required for option->exposedRect to be set in paint()
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+// ----------------------------------------------------------------------------
+GraphItem::~GraphItem()
+{}
+
+// ----------------------------------------------------------------------------
+void GraphItem::setGeometry(const Graph& graph, const GraphLayout& layout)
+{
+    prepareGeometryChange();
+
+    nodeRects_.clear();
+    edgePointOffsets_.clear();
+    edgePoints_.clear();
+    arrowHeads_.clear();
+    edgeLabelAnchors_.clear();
+    edgeLabelAngles_.clear();
+    nodeLabels_.clear();
+    hash40Strings_.clear();
+    hash40Values_.clear();
+    edgeLabels_.clear();
+
+    for (int nodeIdx = 0; nodeIdx != layout.nodeCount(); ++nodeIdx)
+    {
+        const double x = layout.nodeX[nodeIdx];
+        const double y = layout.nodeY[nodeIdx];
+        const double w = layout.nodeW[nodeIdx];
+        const double h = layout.nodeH[nodeIdx];
+        nodeRects_.emplace(x - w/2, y - h/2, w, h);
+    }
+
+    // When drawing edges, we need the lines to start and end on the boundary
+    // of the rectangle shape rather than in the center. Takes the center and
+    // width/height of a rectangle, and projects the point "p" onto the outline.
+    auto intersectRect = [](double cx, double cy, double w, double h, double px, double py) -> QPointF {
+        double dx = cx - px;
+        double dy = cy - py;
+
+        double off;
+        if (dy != 0.0)
+            off = dx / dy * h/2;
+        if (dy != 0.0 && off >= -w/2 && off <= w/2)
+        {
+            if (py > cy)
+                return QPointF(cx + off, cy + h/2);
+            else
+                return QPointF(cx - off, cy - h/2);
+        }
+        else
+        {
+            if (px > cx)
+                return QPointF(cx + w/2, cy + dy / dx * w/2);
+            else
+                return QPointF(cx - w/2, cy - dy / dx * w/2);
+        }
+    };
+
+    rfcommon::Vector<QRectF> edgeBoxes;
+    edgePointOffsets_.push(0);
+    for (int edgeIdx = 0; edgeIdx != layout.edgeCount(); ++edgeIdx)
+    {
+        const int source = graph.edges[edgeIdx].from;
+        const int target = graph.edges[edgeIdx].to;
+        const int firstBend = layout.bendOffsets[edgeIdx];
+        const int lastBend = layout.bendOffsets[edgeIdx + 1] - 1;
+        const bool hasBends = layout.bendCount(edgeIdx) > 0;
+
+        // --------------------------------------------------------------------
+        // Path
+        // --------------------------------------------------------------------
+
+        QPointF start(layout.nodeX[source], layout.nodeY[source]);
+        QPointF end(layout.nodeX[target], layout.nodeY[target]);
+
+        // Move start and end points to be on the surface of the node's shape,
+        // rather than the center
+        start = intersectRect(
+            start.x(), start.y(),
+            layout.nodeW[source], layout.nodeH[source],
+            hasBends ? layout.bendX[firstBend] : end.x(),
+            hasBends ? layout.bendY[firstBend] : end.y()
+        );
+        end = intersectRect(
+            end.x(), end.y(),
+            layout.nodeW[target], layout.nodeH[target],
+            hasBends ? layout.bendX[lastBend] : start.x(),
+            hasBends ? layout.bendY[lastBend] : start.y()
+        );
+
+        edgePoints_.push(start);
+        for (int bend = firstBend; bend <= lastBend; ++bend)
+            edgePoints_.emplace(layout.bendX[bend], layout.bendY[bend]);
+        edgePoints_.push(end);
+        edgePointOffsets_.push(edgePoints_.count());
+
+        // --------------------------------------------------------------------
+        // Arrow head
+        // --------------------------------------------------------------------
+
+        QPointF arrowStartPoint = hasBends ? QPointF(layout.bendX[lastBend], layout.bendY[lastBend]) : start;
+        QPointF arrowEndPoint = end;
+
+        qreal Pi = 3.14159;
+        qreal arrowSize = 10;
+
+        QLineF line(arrowEndPoint, arrowStartPoint);
+
+        double angle = ::acos(line.dx() / line.length());
+
+        if (line.dy() >= 0)
+            angle = (Pi * 2) - angle;
+
+        arrowHeads_.push(line.p1());
+        arrowHeads_.push(line.p1() + QPointF(sin(angle + Pi / 3) * arrowSize,
+            cos(angle + Pi / 3) * arrowSize));
+        arrowHeads_.push(line.p1() + QPointF(sin(angle + Pi - Pi / 3) * arrowSize,
+            cos(angle + Pi - Pi / 3) * arrowSize));
+
+        edgeLabelAnchors_.push(end);
+        edgeLabelAngles_.push(angle);
+
+        // Bounding box for the spatial index, including the label
+        QRectF box(start, start);
+        for (int i = edgePointOffsets_[edgeIdx]; i != edgePointOffsets_[edgeIdx + 1]; ++i)
+            box = box.united(QRectF(edgePoints_[i], edgePoints_[i]));
+        box.adjust(-LABEL_MARGIN, -LABEL_MARGIN, LABEL_MARGIN, LABEL_MARGIN);
+        edgeBoxes.push(box);
+    }
+
+    nodeGrid_.build(nodeRects_);
+    edgeGrid_.build(edgeBoxes);
+
+    bounds_ = QRectF();
+    for (const QRectF& rect : nodeRects_)
+        bounds_ = bounds_.united(rect);
+    for (const QRectF& box : edgeBoxes)
+        bounds_ = bounds_.united(box);
+    bounds_.adjust(-LABEL_MARGIN, -LABEL_MARGIN, LABEL_MARGIN, LABEL_MARGIN);
+
+    update();
+}
+
+// ----------------------------------------------------------------------------
+void GraphItem::setNodeLabels(
+        const rfcommon::Vector<QString>& labels,
+        const rfcommon::Vector<QString>& hash40Strings,
+        const rfcommon::Vector<QString>& hash40Values)
+{
+    nodeLabels_ = labels;
+    hash40Strings_ = hash40Strings;
+    hash40Values_ = hash40Values;
+    update();
+}
+
+// ----------------------------------------------------------------------------
+void GraphItem::setEdgeLabels(const rfcommon::Vector<QString>& labels)
+{
+    edgeLabels_ = labels;
+    update();
+}
+
+// ----------------------------------------------------------------------------
+int GraphItem::nodeAt(const QPointF& pos) const
+{
+    int found = -1;
+    nodeGrid_.query(QRectF(pos, pos), [this, &pos, &found](int nodeIdx) {
+        if (nodeRects_[nodeIdx].contains(pos))
+            found = nodeIdx;
+    });
+
+    return found;
+}
+
+// ----------------------------------------------------------------------------
+bool GraphItem::contains(const QPointF& pos) const
+{
+    return nodeAt(pos) != -1;
+}
+
+// ----------------------------------------------------------------------------
+QRectF GraphItem::boundingRect() const
+{
+    return bounds_;
+}
+
+// ----------------------------------------------------------------------------
+const QStaticText& GraphItem::staticText(const QString& text) const
+{
+    auto it = textCache_.find(text);
+    if (it != textCache_.end())
+        return it.value();
+
+    if (textCache_.size() >= MAX_CACHED_TEXTS)
+        textCache_.clear();
+
+    QStaticText staticText(text);
+    staticText.prepare();
+    return textCache_.insert(text, staticText).value();
+}
+
+// ----------------------------------------------------------------------------
+void GraphItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    const QRectF& exposed = option->exposedRect;
+    const bool drawText = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform()) >= TEXT_MIN_LEVEL_OF_DETAIL;
+    const QColor color("green");
+
+    // Shapes and text use different pens, so draw all shapes first to avoid
+    // switching back and forth for every edge and node
+
+    // ------------------------------------------------------------------------
+    // Shapes
+    // ------------------------------------------------------------------------
+
+    painter->setPen(QPen(color));
+    painter->setBrush(QBrush(color));
+    edgeGrid_.query(exposed, [this, painter](int edgeIdx) {
+        const int first = edgePointOffsets_[edgeIdx];
+        const int count = edgePointOffsets_[edgeIdx + 1] - first;
+        painter->drawPolyline(&edgePoints_[first], count);
+        painter->drawPolygon(&arrowHeads_[edgeIdx * 3], 3);
+    });
+
+    painter->setBrush(Qt::NoBrush);
+    nodeGrid_.query(exposed, [this, painter](int nodeIdx) {
+        painter->drawRect(nodeRects_[nodeIdx]);
+    });
+
+    if (drawText == false)
+        return;
+
+    // ------------------------------------------------------------------------
+    // Text
+    // ------------------------------------------------------------------------
+
+    painter->setPen(QPen(QColor("black")));
+    edgeGrid_.query(exposed, [this, painter](int edgeIdx) {
+        if (edgeIdx >= edgeLabels_.count())
+            return;
+
+        const QStaticText& text = staticText(edgeLabels_[edgeIdx]);
+        const QSizeF size = text.size();
+        const double angle = edgeLabelAngles_[edgeIdx];
+        QPointF pos = edgeLabelAnchors_[edgeIdx] - QPointF(size.width()/2, size.height()/2);
+        pos -= QPointF(-std::cos(angle), std::sin(angle)) * size.height();
+        painter->drawStaticText(pos, text);
+    });
+
+    const bool showHash40 = hash40Strings_.count() > 0;
+    auto drawLabel = [this, painter](const QString& label, const QRectF& rect, double yOffset) {
+        const QStaticText& text = staticText(label);
+        const QSizeF size = text.size();
+        painter->drawStaticText(QPointF(
+            rect.x() + (rect.width() - size.width()) / 2,
+            rect.y() + (rect.height() - size.height()) / 2 + yOffset), text);
+    };
+    nodeGrid_.query(exposed, [this, showHash40, &drawLabel](int nodeIdx) {
+        if (nodeIdx >= nodeLabels_.count())
+            return;
+
+        const QRectF& rect = nodeRects_[nodeIdx];
+        if (showHash40)
+        {
+            drawLabel(nodeLabels_[nodeIdx], rect, -rect.height()/4);
+            drawLabel(hash40Strings_[nodeIdx], rect, 0.0);
+            drawLabel(hash40Values_[nodeIdx], rect, rect.height()/4);
+        }
+        else
+            drawLabel(nodeLabels_[nodeIdx], rect, 0.0);
+    });
+}
@@ -0,0 +1,226 @@
+#include "decision-graph/models/Graph.hpp"
+#include "decision-graph/models/GraphLayout.hpp"
+
+#include "rfcommon/HighresTimer.hpp"
+
+#include "ogdf/basic/Graph.h"
+#include "ogdf/basic/GraphAttributes.h"
+#include "ogdf/energybased/FMMMLayout.h"
+#include "ogdf/layered/CoffmanGrahamRanking.h"
+#include "ogdf/layered/FastHierarchyLayout.h"
+#include "ogdf/layered/LongestPathRanking.h"
+#include "ogdf/layered/SugiyamaLayout.h"
+#include "ogdf/layered/MedianHeuristic.h"
+#include "ogdf/layered/OptimalHierarchyLayout.h"
+#include "ogdf/layered/OptimalRanking.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Above these sizes the LP based engine is never used, regardless of the
+// time budget
+static const int OPTIMAL_MAX_NODES = 250;
+static const int OPTIMAL_MAX_EDGES = 600;
+
+// Above these sizes even the fast hierarchical engine produces unreadable
+// results, so switch to a force directed layout
+static const int HIERARCHICAL_MAX_NODES = 1500;
+static const int HIERARCHICAL_MAX_EDGES = 4000;
+
+// ----------------------------------------------------------------------------
+static double optimalCostUnits(const Graph& graph)
+{
+    // Solving the ranking and coordinate assignment LPs grows roughly
+    // quadratically with the size of the graph
+    const double size = graph.nodes.count() + graph.edges.count();
+    return size * size;
+}
+
+// ----------------------------------------------------------------------------
+double GraphLayout::CostEstimate::predictOptimalMs(const Graph& graph) const
+{
+    if (optimalMsPerUnit_ < 0.0)
+        return -1.0;
+    return optimalMsPerUnit_ * optimalCostUnits(graph);
+}
+
+// ----------------------------------------------------------------------------
+void GraphLayout::CostEstimate::update(const Graph& graph, Engine engine, double elapsedMs)
+{
+    if (engine != OPTIMAL)
+        return;
+
+    const double units = optimalCostUnits(graph);
+    if (units <= 0.0)
+        return;
+
+    // Small graphs finish too quickly to say anything about large graphs
+    if (elapsedMs < 5.0)
+        return;
+
+    const double msPerUnit = elapsedMs / units;
+    if (optimalMsPerUnit_ < 0.0)
+        optimalMsPerUnit_ = msPerUnit;
+    else
+        optimalMsPerUnit_ = optimalMsPerUnit_ * 0.5 + msPerUnit * 0.5;
+}
+
+// ----------------------------------------------------------------------------
+GraphLayout::GraphLayout()
+{}
+
+// ----------------------------------------------------------------------------
+GraphLayout::~GraphLayout()
+{}
+
+// ----------------------------------------------------------------------------
+GraphLayout::Engine GraphLayout::selectEngine(const Graph& graph, int timeBudgetMs, const CostEstimate& estimate)
+{
+    const int nodes = graph.nodes.count();
+    const int edges = graph.edges.count();
+
+    if (nodes > HIERARCHICAL_MAX_NODES || edges > HIERARCHICAL_MAX_EDGES)
+        return FORCE_DIRECTED;
+    if (nodes > OPTIMAL_MAX_NODES || edges > OPTIMAL_MAX_EDGES)
+        return FAST;
+
+    const double predictedMs = estimate.predictOptimalMs(graph);
+    if (timeBudgetMs > 0 && predictedMs > timeBudgetMs)
+        return FAST;
+
+    return OPTIMAL;
+}
+
+// ----------------------------------------------------------------------------
+const char* GraphLayout::engineName(Engine engine)
+{
+    switch (engine)
+    {
+        case AUTO: return "Auto";
+        case OPTIMAL: return "Optimal";
+        case FAST: return "Fast";
+        case COMPACT: return "Compact";
+        case FORCE_DIRECTED: return "Force directed";
+    }
+
+    return "";
+}
+
+// ----------------------------------------------------------------------------
+GraphLayout GraphLayout::compute(
+        const Graph& graph,
+        const rfcommon::Vector<double>& widths,
+        const rfcommon::Vector<double>& heights,
+        Engine engine)
+{
+    if (engine == AUTO)
+        engine = OPTIMAL;
+
+    rfcommon::HighresTimer timer;
+    timer.start();
+
+    ogdf::Graph G;
+    ogdf::GraphAttributes GA(G,
+        ogdf::GraphAttributes::nodeGraphics
+      | ogdf::GraphAttributes::edgeGraphics
+      | ogdf::GraphAttributes::nodeLabel
+      | ogdf::GraphAttributes::edgeStyle
+      | ogdf::GraphAttributes::nodeStyle
+      | ogdf::GraphAttributes::nodeTemplate);
+
+    rfcommon::Vector<ogdf::node> ogdfNodes;
+    rfcommon::Vector<ogdf::edge> ogdfEdges;
+
+    for (int nodeIdx = 0; nodeIdx != graph.nodes.count(); ++nodeIdx)
+    {
+        ogdf::node N = G.newNode();
+        GA.width(N) = widths[nodeIdx];
+        GA.height(N) = heights[nodeIdx];
+        ogdfNodes.push(N);
+    }
+
+    for (int edgeIdx = 0; edgeIdx != graph.edges.count(); ++edgeIdx)
+    {
+        const int from = graph.edges[edgeIdx].from;
+        const int to = graph.edges[edgeIdx].to;
+        ogdf::edge E = G.newEdge(ogdfNodes[from], ogdfNodes[to]);
+        ogdfEdges.push(E);
+    }
+
+    ogdf::setSeed(42);
+    switch (engine)
+    {
+        case AUTO:
+        case OPTIMAL: {
+            ogdf::SugiyamaLayout layout;
+            layout.setRanking(new ogdf::OptimalRanking);
+            layout.setCrossMin(new ogdf::MedianHeuristic);
+
+            ogdf::OptimalHierarchyLayout* ohl = new ogdf::OptimalHierarchyLayout;
+            ohl->layerDistance(30.0);
+            ohl->nodeDistance(25.0);
+            ohl->weightBalancing(0.8);
+            layout.setLayout(ohl);
+            layout.call(GA);
+        } break;
+
+        case FAST:
+        case COMPACT: {
+            ogdf::SugiyamaLayout layout;
+            if (engine == COMPACT)
+            {
+                // Limit layer width to roughly the square root of the node
+                // count so the drawing ends up closer to square
+                ogdf::CoffmanGrahamRanking* ranking = new ogdf::CoffmanGrahamRanking;
+                ranking->width(std::max(3, (int)std::sqrt((double)graph.nodes.count())));
+                layout.setRanking(ranking);
+            }
+            else
+                layout.setRanking(new ogdf::LongestPathRanking);
+            layout.setCrossMin(new ogdf::MedianHeuristic);
+            layout.runs(4);
+
+            ogdf::FastHierarchyLayout* fhl = new ogdf::FastHierarchyLayout;
+            fhl->layerDistance(30.0);
+            fhl->nodeDistance(25.0);
+            layout.setLayout(fhl);
+            layout.call(GA);
+        } break;
+
+        case FORCE_DIRECTED: {
+            ogdf::FMMMLayout layout;
+            layout.useHighLevelOptions(true);
+            layout.unitEdgeLength(60.0);
+            layout.newInitialPlacement(true);
+            layout.qualityVersusSpeed(ogdf::FMMMOptions::QualityVsSpeed::NiceAndIncredibleSpeed);
+            layout.call(GA);
+        } break;
+    }
+
+    timer.stop();
+
+    GraphLayout result;
+    result.engine = engine;
+    result.elapsedMs = timer.timePassedNS() / 1e6;
+    for (int nodeIdx = 0; nodeIdx != ogdfNodes.count(); ++nodeIdx)
+    {
+        result.nodeX.push(GA.x(ogdfNodes[nodeIdx]));
+        result.nodeY.push(GA.y(ogdfNodes[nodeIdx]));
+        result.nodeW.push(GA.width(ogdfNodes[nodeIdx]));
+        result.nodeH.push(GA.height(ogdfNodes[nodeIdx]));
+    }
+
+    result.bendOffsets.push(0);
+    for (int edgeIdx = 0; edgeIdx != ogdfEdges.count(); ++edgeIdx)
+    {
+        const ogdf::DPolyline& bends = GA.bends(ogdfEdges[edgeIdx]);
+        for (ogdf::ListConstIterator<ogdf::DPoint> it = bends.begin(); it != bends.end(); ++it)
+        {
+            result.bendX.push((*it).m_x);
+            result.bendY.push((*it).m_y);
+        }
+        result.bendOffsets.push(result.bendX.count());
+    }
+
+    return result;
+}
@@ -0,0 +1,124 @@
+#include "decision-graph/models/Graph.hpp"
+#include "decision-graph/models/GraphLayoutCache.hpp"
+
+#include "rfcommon/Hashers.hpp"
+
+#include <cmath>
+
+// ----------------------------------------------------------------------------
+GraphLayoutCache::Key::Key()
+    : hash_(0)
+    , engine_(GraphLayout::AUTO)
+    , nodeCount_(-1)
+{}
+
+// ----------------------------------------------------------------------------
+GraphLayoutCache::Key::Key(
+        const Graph& graph,
+        const rfcommon::Vector<double>& widths,
+        const rfcommon::Vector<double>& heights,
+        GraphLayout::Engine engine)
+    : engine_(engine)
+    , nodeCount_(graph.nodes.count())
+{
+    uint32_t hash = rfcommon::hash32_combine(engine_, nodeCount_);
+
+    sizes_.reserve(nodeCount_ * 2);
+    for (int nodeIdx = 0; nodeIdx != nodeCount_; ++nodeIdx)
+    {
+        const int w = (int)std::ceil(widths[nodeIdx]);
+        const int h = (int)std::ceil(heights[nodeIdx]);
+        sizes_.push(w);
+        sizes_.push(h);
+        hash = rfcommon::hash32_combine(hash, rfcommon::hash32_combine(w, h));
+    }
+
+    edges_.reserve(graph.edges.count() * 2);
+    for (const auto& edge : graph.edges)
+    {
+        edges_.push(edge.from);
+        edges_.push(edge.to);
+        hash = rfcommon::hash32_combine(hash, rfcommon::hash32_combine(edge.from, edge.to));
+    }
+
+    hash_ = hash;
+}
+
+// ----------------------------------------------------------------------------
+bool GraphLayoutCache::Key::operator==(const Key& other) const
+{
+    if (hash_ != other.hash_)
+        return false;
+    if (engine_ != other.engine_ || nodeCount_ != other.nodeCount_)
+        return false;
+    if (edges_.count() != other.edges_.count() || sizes_.count() != other.sizes_.count())
+        return false;
+
+    for (int i = 0; i != edges_.count(); ++i)
+        if (edges_[i] != other.edges_[i])
+            return false;
+    for (int i = 0; i != sizes_.count(); ++i)
+        if (sizes_[i] != other.sizes_[i])
+            return false;
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+GraphLayoutCache::GraphLayoutCache(int capacity)
+    : capacity_(capacity)
+{}
+
+// ----------------------------------------------------------------------------
+GraphLayoutCache::~GraphLayoutCache()
+{}
+
+// ----------------------------------------------------------------------------
+const GraphLayout* GraphLayoutCache::find(const Key& key)
+{
+    for (auto& entry : entries_)
+        if (entry.key == key)
+        {
+            entry.lastUsed = ++useCounter_;
+            return &entry.layout;
+        }
+
+    return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+void GraphLayoutCache::insert(const Key& key, const GraphLayout& layout)
+{
+    for (auto& entry : entries_)
+        if (entry.key == key)
+        {
+            entry.layout = layout;
+            entry.lastUsed = ++useCounter_;
+            return;
+        }
+
+    if (capacity_ <= 0)
+        return;
+
+    if (entries_.count() < capacity_)
+    {
+        entries_.push({key, layout, ++useCounter_});
+        return;
+    }
+
+    // Replace the least recently used entry
+    Entry* oldest = &entries_[0];
+    for (auto& entry : entries_)
+        if (entry.lastUsed < oldest->lastUsed)
+            oldest = &entry;
+
+    oldest->key = key;
+    oldest->layout = layout;
+    oldest->lastUsed = ++useCounter_;
+}
+
+// ----------------------------------------------------------------------------
+void GraphLayoutCache::clear()
+{
+    entries_.clear();
+}
@@ -1,27 +1,63 @@
+#include "decision-graph/models/Diagnostics.hpp"
+#include "decision-graph/models/FrameScheduler.hpp"
+#include "decision-graph/models/GraphItem.hpp"
+#include "decision-graph/models/GraphLayout.hpp"
+#include "decision-graph/models/GraphLayoutCache.hpp"
 #include "decision-graph/models/GraphModel.hpp"
 #include "decision-graph/models/SequenceSearchModel.hpp"
 
 #include "rfcommon/MotionLabels.hpp"
 #include "rfcommon/Vector.hpp"
 
-#include "ogdf/basic/Graph.h"
-#include "ogdf/basic/GraphAttributes.h"
-#include "ogdf/planarity/PlanarizationLayout.h"
-#include "ogdf/energybased/FMMMLayout.h"
-#include "ogdf/layered/FastHierarchyLayout.h"
-#include "ogdf/layered/SugiyamaLayout.h"
-#include "ogdf/layered/MedianHeuristic.h"
-#include "ogdf/layered/OptimalHierarchyLayout.h"
-#include "ogdf/layered/OptimalRanking.h"
+#include <QFontMetricsF>
 
-#include <QGraphicsSimpleTextItem>
+// ----------------------------------------------------------------------------
+struct GraphModel::LayoutJob
+{
+    int generation;
+    Graph graph;
+    rfcommon::Vector<double> widths;
+    rfcommon::Vector<double> heights;
+    rfcommon::Vector<QString> labels;
+    rfcommon::Vector<QString> hash40Strings;
+    rfcommon::Vector<QString> hash40Values;
+    bool showHash40Values;
+    GraphLayout::Engine engine;
+    int timeBudgetMs;
+    GraphLayoutCache::Key key;
+    GraphLayout layout;
+    bool fromCache = false;
+};
+
+// ----------------------------------------------------------------------------
+static rfcommon::Vector<QString> edgeWeightLabels(const Graph& graph)
+{
+    rfcommon::Vector<QString> labels;
+    labels.reserve(graph.edges.count());
+    for (const auto& edge : graph.edges)
+        labels.push(QString::number(edge.weight));
+    return labels;
+}
 
 // ----------------------------------------------------------------------------
 GraphModel::GraphModel(SequenceSearchModel* searchModel, rfcommon::MotionLabels* labels)
     : searchModel_(searchModel)
     , labels_(labels)
     , preferredLayer_(labels->preferredLayer(rfcommon::MotionLabels::NOTATION))
+    , graphBuilder_(&graph_)
 {
+    // Layouts are calculated one at a time. If a new layout is requested
+    // while one is running, the running one is discarded when it finishes
+    layoutThreadPool_.setMaxThreadCount(1);
+
+    PipelineMetrics* metrics = searchModel_->diagnostics()->metrics();
+    timings_.build = metrics->histogram("graph.build");
+    timings_.islands = metrics->histogram("graph.islands");
+    timings_.tree = metrics->histogram("graph.tree");
+    timings_.layout = metrics->histogram("graph.layout");
+    timings_.scene = metrics->histogram("graph.scene");
+
+    searchModel_->frameScheduler()->addConsumer(this, "graph");
     searchModel_->dispatcher.addListener(this);
 }
 
@@ -29,6 +65,11 @@ GraphModel::GraphModel(SequenceSearchModel* searchModel, rfcommon::MotionLabels*
 GraphModel::~GraphModel()
 {
     searchModel_->dispatcher.removeListener(this);
+    searchModel_->frameScheduler()->removeConsumer(this);
+
+    ++layoutGeneration_;
+    layoutThreadPool_.clear();
+    layoutThreadPool_.waitForDone();
 }
 
 // ----------------------------------------------------------------------------
@@ -45,10 +86,18 @@ void GraphModel::setIncomingTreeSize(int size)
     redrawGraph();
 }
 
+// ----------------------------------------------------------------------------
+void GraphModel::setTreeBranchesPerLevel(int branches)
+{
+    treeBranches_ = branches;
+    redrawGraph();
+}
+
 // ----------------------------------------------------------------------------
 void GraphModel::setMergeBehavior(MergeBehavior behavior)
 {
     mergeBehavior_ = behavior;
+    invalidateGraph();
     redrawGraph();
 }
 
@@ -56,7 +105,14 @@ void GraphModel::setMergeBehavior(MergeBehavior behavior)
 void GraphModel::setPreferredLayer(int layerIdx)
 {
     preferredLayer_ = layerIdx;
-    redrawGraph();
+    // Label merging depends on the layer
+    if (mergeBehavior_ == LABEL_MERGE)
+    {
+        invalidateGraph();
+        redrawGraph();
+    }
+    else
+        relayoutGraph();
 }
 
 // ----------------------------------------------------------------------------
@@ -84,14 +140,57 @@ void GraphModel::setMergeQualifiers(bool enable)
 void GraphModel::setShowHash40Values(bool enable)
 {
     showHash40Values_ = enable;
-    redrawGraph();
+    relayoutGraph();
 }
 
 // ----------------------------------------------------------------------------
 void GraphModel::setShowQualifiers(bool enable)
 {
     showQualifiers_ = enable;
-    redrawGraph();
+    relayoutGraph();
+}
+
+// ----------------------------------------------------------------------------
+void GraphModel::setPruneMinWeight(int weight)
+{
+    pruneMinWeight_ = weight;
+    relayoutGraph();
+}
+
+// ----------------------------------------------------------------------------
+void GraphModel::setPrunePercentile(int percentile)
+{
+    prunePercentile_ = percentile;
+    relayoutGraph();
+}
+
+// ----------------------------------------------------------------------------
+void GraphModel::setPruneMaxNodes(int count)
+{
+    pruneMaxNodes_ = count;
+    relayoutGraph();
+}
+
+// ----------------------------------------------------------------------------
+void GraphModel::setPruneAggregate(bool enable)
+{
+    pruneAggregate_ = enable;
+    relayoutGraph();
+}
+
+// ----------------------------------------------------------------------------
+void GraphModel::setLayoutEngine(GraphLayout::Engine engine)
+{
+    layoutEngine_ = engine;
+    relayoutGraph();
+}
+
+// ----------------------------------------------------------------------------
+void GraphModel::setLayoutTimeBudget(int ms)
+{
+    layoutTimeBudget_ = ms;
+    if (layoutEngine_ == GraphLayout::AUTO)
+        relayoutGraph();
 }
 
 // ---------------------------------------------------------------------------
@@ -107,24 +206,195 @@ rfcommon::String GraphModel::availableLayerName(int idx) const
 }
 
 // ----------------------------------------------------------------------------
-void GraphModel::redrawGraph()
+void GraphModel::invalidateGraph()
 {
-    clear();
+    graphBuilder_.clear();
+    appliedQueries_.clearCompact();
+    transitions_.clear();
+    transitionsDirty_ = true;
+    graphPOV_ = -1;
+}
 
+// ----------------------------------------------------------------------------
+void GraphModel::updateGraph()
+{
     if (searchModel_->playerPOV() < 0)
+    {
+        invalidateGraph();
         return;
+    }
 
+    PipelineTimer timer(timings_.build);
     const States& states = searchModel_->fighterStates(searchModel_->playerPOV());
     rfcommon::FighterID fighterID = searchModel_->fighterID(searchModel_->playerPOV());
 
-    auto motionString = [this](rfcommon::FighterID fighterID, const State& state) -> rfcommon::String {
-        if (const char* notation = labels_->toGroupLabel(fighterID, state.motion, preferredLayer_))
-            return notation;
-        else if (const char* h40 = labels_->toHash40(state.motion))
-            return h40;
-        else
-            return state.motion.toHex();
-    };
+    // Check if the matches that were previously added to the graph are still
+    // the same. Queries only ever append matches when new frames arrive, so
+    // if the last added match still exists at the same index, the matches
+    // preceeding it are unchanged as well.
+    bool rebuild =
+            graphPOV_ != searchModel_->playerPOV() ||
+            appliedQueries_.count() != searchModel_->queryCount();
+    for (int queryIdx = 0; queryIdx != appliedQueries_.count() && !rebuild; ++queryIdx)
+    {
+        const AppliedQuery& applied = appliedQueries_[queryIdx];
+        const rfcommon::Vector<Range>& matches = searchModel_->matches(queryIdx);
+        if (matches.count() < applied.matchCount)
+            rebuild = true;
+        else if (applied.matchCount > 0)
+        {
+            const Range& match = matches[applied.matchCount - 1];
+            if (match.startIdx != applied.lastMatch.startIdx || match.endIdx != applied.lastMatch.endIdx)
+                rebuild = true;
+        }
+    }
+
+    if (rebuild)
+    {
+        invalidateGraph();
+        for (int queryIdx = 0; queryIdx != searchModel_->queryCount(); ++queryIdx)
+            appliedQueries_.emplace();
+        graphPOV_ = searchModel_->playerPOV();
+    }
+
+    // Convert new sequences to graph with the appropriate merge behavior
+    for (int queryIdx = 0; queryIdx != searchModel_->queryCount(); ++queryIdx)
+    {
+        AppliedQuery& applied = appliedQueries_[queryIdx];
+        const rfcommon::Vector<Range>& matches = searchModel_->matches(queryIdx);
+
+        switch (mergeBehavior_)
+        {
+            case DONT_MERGE:
+                graphBuilder_.addStates(states, matches, applied.matchCount);
+                break;
+
+            case QUERY_MERGE:
+                graphBuilder_.addStates(states, searchModel_->mergedMatches(queryIdx), applied.matchCount);
+                break;
+
+            case LABEL_MERGE:
+                for (int matchIdx = applied.matchCount; matchIdx < matches.count(); ++matchIdx)
+                {
+                    const Range& range = matches[matchIdx];
+                    Sequence seq;
+                    for (int stateIdx = range.startIdx; stateIdx != range.endIdx; ++stateIdx)
+                    {
+                        int mergeIdx = applied.labelLookup.insertOrGet(motionString(fighterID, states[stateIdx]), stateIdx)->value();
+                        seq.idxs.push(mergeIdx);
+                    }
+                    graphBuilder_.addStates(states, seq);
+                }
+                break;
+        }
+
+        applied.matchCount = matches.count();
+        if (matches.count() > 0)
+            applied.lastMatch = matches.back();
+    }
+
+    graph_.finalize();
+    transitionsDirty_ = true;
+}
+
+// ----------------------------------------------------------------------------
+const TransitionMatrix& GraphModel::transitions() const
+{
+    // Only rows whose edge weights changed are recalculated, unless new
+    // nodes or edges were added. A rebuilt graph may have a different
+    // topology with the same counts, but invalidateGraph() cleared the
+    // matrix, so it is built from scratch in that case
+    if (transitionsDirty_)
+    {
+        transitions_.update(graph_);
+        transitionsDirty_ = false;
+    }
+
+    return transitions_;
+}
+
+// ----------------------------------------------------------------------------
+rfcommon::String GraphModel::motionString(rfcommon::FighterID fighterID, const State& state) const
+{
+    if (const char* notation = labels_->toGroupLabel(fighterID, state.motion, preferredLayer_))
+        return notation;
+    else if (const char* h40 = labels_->toHash40(state.motion))
+        return h40;
+    else
+        return state.motion.toHex();
+}
+
+// ----------------------------------------------------------------------------
+void GraphModel::redrawGraph()
+{
+    updateGraph();
+    graphPruner_.clear();
+    selectedGraph_.clear();
+
+    if (searchModel_->playerPOV() < 0 || graph_.nodes.count() == 0)
+    {
+        relayoutGraph();
+        return;
+    }
+
+    if (outgoingTree_ > 0 || incomingTree_ > 0)
+    {
+        // Only show the neighborhood around the node with the highest
+        // throughput. The tree is bounded in depth and in the number of
+        // branches per level, so the layout only has to deal with the
+        // nodes the user asked to see
+        PipelineTimer timer(timings_.tree);
+        selectedGraph_ = graph_.neighborhoodTree(transitions(), outgoingTree_, incomingTree_, treeBranches_);
+    }
+    else
+    {
+        // If the user only wants to see the largest island, find that
+        // instead
+        PipelineTimer timer(timings_.islands);
+        rfcommon::Vector<Graph> islands = graph_.islands(graphBuilder_.components());
+        if (useLargestIsland_)
+        {
+            // Find largest island
+            int largest = 0;
+            int nodes = 0;
+            for (int i = 0; i != islands.count(); ++i)
+                if (nodes < islands[i].nodes.count())
+                {
+                    nodes = islands[i].nodes.count();
+                    largest = i;
+                }
+
+            Graph largestIsland = std::move(islands[largest]);
+            islands.clear();
+            islands.push(std::move(largestIsland));
+        }
+
+        for (const Graph& island : islands)
+            selectedGraph_.addIsland(island);
+        selectedGraph_.finalize();
+    }
+
+    // Sorting edges and nodes is done once here, so changing the pruning
+    // settings only requires a relayout
+    graphPruner_.setGraph(&selectedGraph_);
+
+    relayoutGraph();
+}
+
+// ----------------------------------------------------------------------------
+void GraphModel::relayoutGraph()
+{
+    // Any layout that is still queued or running is now out of date
+    const int generation = ++layoutGeneration_;
+
+    if (searchModel_->playerPOV() < 0 || selectedGraph_.nodes.count() == 0)
+    {
+        clearScene();
+        return;
+    }
+
+    const States& states = searchModel_->fighterStates(searchModel_->playerPOV());
+    rfcommon::FighterID fighterID = searchModel_->fighterID(searchModel_->playerPOV());
 
     auto hash40String = [this](const State& state) -> rfcommon::String {
         if (const char* h40 = labels_->toHash40(state.motion))
@@ -147,307 +417,195 @@ void GraphModel::redrawGraph()
         return flags;
     };
 
-    // Convert sequences to graph with the appropriate merge behavior
-    Graph graph;
-    switch (mergeBehavior_)
+    int minWeight = graphPruner_.weightAtPercentile(prunePercentile_);
+    if (minWeight < pruneMinWeight_)
+        minWeight = pruneMinWeight_;
+
+    // Everything the worker thread needs is copied into the job, because
+    // the graph and states may change while the layout is running
+    auto job = std::make_shared<LayoutJob>();
+    job->generation = generation;
+    job->graph = graphPruner_.prune(minWeight, pruneMaxNodes_, pruneAggregate_);
+    job->showHash40Values = showHash40Values_;
+    job->engine = layoutEngine_;
+    job->timeBudgetMs = layoutTimeBudget_;
+
+    // Node sizes depend on the labels, so those have to be known before the
+    // layout can be calculated. GraphItem draws text using the default
+    // font
+    const QFontMetricsF metrics((QFont()));
+    for (const auto& node : job->graph.nodes)
     {
-        case DONT_MERGE:
-            for (int queryIdx = 0; queryIdx != searchModel_->queryCount(); ++queryIdx)
-                graph.addStates(states, searchModel_->matches(queryIdx));
-            break;
-
-        case QUERY_MERGE:
-            for (int queryIdx = 0; queryIdx != searchModel_->queryCount(); ++queryIdx)
-                graph.addStates(states, searchModel_->mergedMatches(queryIdx));
-            break;
-
-        case LABEL_MERGE:
-            for (int queryIdx = 0; queryIdx != searchModel_->queryCount(); ++queryIdx)
-            {
-                rfcommon::Vector<Sequence> mergedSequences;
-                rfcommon::HashMap<rfcommon::String, int> lookup;
-                for (const Range& range : searchModel_->matches(queryIdx))
-                {
-                    Sequence& seq = mergedSequences.emplace();
-                    for (int stateIdx = range.startIdx; stateIdx != range.endIdx; ++stateIdx)
-                    {
-                        int mergeIdx = lookup.insertOrGet(motionString(fighterID, states[stateIdx]), stateIdx)->value();
-                        seq.idxs.push(mergeIdx);
-                    }
-                }
-                graph.addStates(states, mergedSequences);
-            }
-            break;
-    }
-
-    if (graph.nodes.count() == 0)
-        return;
-
-    // The algorithms for calculating incoming and outgoing trees assume that
-    // all nodes are connected. Need to create a list of islands and apply those
-    // algorithms on each one separately. Additionally, if the user only wants
-    // to see the the largest island, find that instead.
-    rfcommon::Vector<Graph> islands = graph.islands();
-    if (useLargestIsland_)
-    {
-        // Find largest island
-        int largest = 0;
-        int nodes = 0;
-        for (int i = 0; i != islands.count(); ++i)
-            if (nodes < islands[i].nodes.count())
+        // Summary nodes created by the pruner don't reference a state
+        if (node.stateIdx < 0)
+        {
+            job->labels.push(node.stateIdx == GraphPruner::OTHER_OUTGOING ? "other (out)" : "other (in)");
+            if (showHash40Values_)
             {
-                nodes = islands[i].nodes.count();
-                largest = i;
+                job->hash40Strings.emplace();
+                job->hash40Values.emplace();
             }
-
-        islands = rfcommon::Vector<Graph>({ islands[largest] });
-    }
-
-    graph = Graph();
-    for (const Graph& island : islands)
-        graph.addIsland(island);
-
-    ogdf::Graph G;
-    ogdf::GraphAttributes GA(G,
-        ogdf::GraphAttributes::nodeGraphics
-      | ogdf::GraphAttributes::edgeGraphics
-      | ogdf::GraphAttributes::nodeLabel
-      | ogdf::GraphAttributes::edgeStyle
-      | ogdf::GraphAttributes::nodeStyle
-      | ogdf::GraphAttributes::nodeTemplate);
-
-    rfcommon::Vector<ogdf::node> ogdfNodes;
-    rfcommon::Vector<ogdf::edge> ogdfEdges;
-    rfcommon::Vector<QGraphicsSimpleTextItem*> labels;
-    rfcommon::Vector<QGraphicsSimpleTextItem*> hash40Strings;
-    rfcommon::Vector<QGraphicsSimpleTextItem*> hash40Values;
-
-    for (const auto& node : graph.nodes)
-    {
-        if (showQualifiers_)
-        {
-            rfcommon::String label = motionString(fighterID, states[node.stateIdx]);
-            rfcommon::String qual = qualifiersString(states[node.stateIdx]);
-            if (qual.notEmpty())
-                label += " " + qual;
-            labels.push(new QGraphicsSimpleTextItem(QString::fromUtf8(
-                 label.cStr()
-            )));
         }
         else
         {
-            labels.push(new QGraphicsSimpleTextItem(QString::fromUtf8(
-                 motionString(fighterID, states[node.stateIdx]).cStr()
-            )));
-        }
+            rfcommon::String label = motionString(fighterID, states[node.stateIdx]);
+            if (showQualifiers_)
+            {
+                rfcommon::String qual = qualifiersString(states[node.stateIdx]);
+                if (qual.notEmpty())
+                    label += " " + qual;
+            }
+            job->labels.push(QString::fromUtf8(label.cStr()));
 
-        if (showHash40Values_)
-        {
-            hash40Strings.push(new QGraphicsSimpleTextItem(QString::fromUtf8(
-                hash40String(states[node.stateIdx]).cStr()
-            )));
-            hash40Values.push(new QGraphicsSimpleTextItem(QString::fromUtf8(
-                states[node.stateIdx].motion.toHex().cStr()
-            )));
+            if (showHash40Values_)
+            {
+                job->hash40Strings.push(QString::fromUtf8(hash40String(states[node.stateIdx]).cStr()));
+                job->hash40Values.push(QString::fromUtf8(states[node.stateIdx].motion.toHex().cStr()));
+            }
         }
 
-        double w = labels.back()->boundingRect().width();
-        double h = labels.back()->boundingRect().height();
+        double w = metrics.horizontalAdvance(job->labels.back());
+        double h = metrics.height();
 
         if (showHash40Values_)
         {
-            if (w < hash40Strings.back()->boundingRect().width())
-                w = hash40Strings.back()->boundingRect().width();
-            if (w < hash40Values.back()->boundingRect().width())
-                w = hash40Values.back()->boundingRect().width();
-            h += hash40Strings.back()->boundingRect().height() + 2;
-            h += hash40Values.back()->boundingRect().height() + 2;
+            if (w < metrics.horizontalAdvance(job->hash40Strings.back()))
+                w = metrics.horizontalAdvance(job->hash40Strings.back());
+            if (w < metrics.horizontalAdvance(job->hash40Values.back()))
+                w = metrics.horizontalAdvance(job->hash40Values.back());
+            h += metrics.height() + 2;
+            h += metrics.height() + 2;
         }
 
-        ogdf::node N = G.newNode();
-        GA.width(N) = w + 4;
-        GA.height(N) = h + 4;
-        ogdfNodes.push(N);
+        job->widths.push(w + 4);
+        job->heights.push(h + 4);
     }
 
-    for (int edgeIdx = 0; edgeIdx != graph.edges.count(); ++edgeIdx)
+    job->key = GraphLayoutCache::Key(job->graph, job->widths, job->heights, layoutEngine_);
+
+    // If the graph on screen has the same layout, then only labels or edge
+    // weights changed and there is no need to rebuild the scene
+    if (displayed_.item && job->key == displayed_.key && job->showHash40Values == displayed_.showHash40Values)
     {
-        const int from = graph.edges[edgeIdx].from;
-        const int to = graph.edges[edgeIdx].to;
-        ogdf::edge E = G.newEdge(ogdfNodes[from], ogdfNodes[to]);
-        ogdfEdges.push(E);
+        layoutThreadPool_.clear();
+        relabelScene(*job);
+        return;
     }
 
-    ogdf::setSeed(42);
-    ogdf::SugiyamaLayout layout;
-    layout.setRanking(new ogdf::OptimalRanking);
-    layout.setCrossMin(new ogdf::MedianHeuristic);
-
-    ogdf::OptimalHierarchyLayout* ohl = new ogdf::OptimalHierarchyLayout;
-    ohl->layerDistance(30.0);
-    ohl->nodeDistance(25.0);
-    ohl->weightBalancing(0.8);
-    layout.setLayout(ohl);
-    layout.call(GA);
-
-    for (int nodeIdx = 0; nodeIdx != ogdfNodes.count(); ++nodeIdx)
+    // Same graph as one we've laid out before
+    if (const GraphLayout* cached = layoutCache_.find(job->key))
     {
-        double x = GA.x(ogdfNodes[nodeIdx]);
-        double y = GA.y(ogdfNodes[nodeIdx]);
-        double w = GA.width(ogdfNodes[nodeIdx]);
-        double h = GA.height(ogdfNodes[nodeIdx]);
-
-        QRectF rect(x - w/2, y - h/2, w, h);
-        QGraphicsRectItem* nodeShape = addRect(rect, QPen(QColor("green")));
-
-        QGraphicsSimpleTextItem* label = labels[nodeIdx];
-        rect = label->boundingRect();
-        double cx = (w - rect.width()) / 2;
-        double cy = (h - rect.height()) / 2;
-        label->setParentItem(nodeShape);
+        job->layout = *cached;
+        job->fromCache = true;
+        layoutThreadPool_.clear();
+        onLayoutFinished(job);
+        return;
+    }
 
-        if (showHash40Values_)
-            label->setPos(x - w/2 + cx, y - h/4*3 + cy);
-        else
-            label->setPos(x - w/2 + cx, y - h/2 + cy);
+    // The pool only has one thread. Jobs that haven't started yet will never
+    // be needed, and the previous drawing stays visible until the new layout
+    // is ready
+    layoutThreadPool_.clear();
+    layoutThreadPool_.start([this, job] {
+        // A newer layout was requested before this one could start
+        if (job->generation != layoutGeneration_)
+            return;
+
+        GraphLayout::Engine engine = job->engine;
+        if (engine == GraphLayout::AUTO)
+            engine = GraphLayout::selectEngine(job->graph, job->timeBudgetMs, layoutCost_);
+
+        PipelineTimer timer(timings_.layout);
+        job->layout = GraphLayout::compute(job->graph, job->widths, job->heights, engine);
+        timer.stop();
+
+        // If an optimal layout overshoots the budget, the updated estimate
+        // makes AUTO fall back to the fast engine next time
+        layoutCost_.update(job->graph, job->layout.engine, job->layout.elapsedMs);
+
+        QMetaObject::invokeMethod(this, [this, job] {
+            onLayoutFinished(job);
+        }, Qt::QueuedConnection);
+    });
+}
 
-        if (showHash40Values_)
-        {
-            label = hash40Strings[nodeIdx];
-            rect = label->boundingRect();
-            cx = (w - rect.width()) / 2;
-            cy = (h - rect.height()) / 2;
-            label->setParentItem(nodeShape);
-            label->setPos(x - w/2 + cx, y - h/4*2 + cy);
-
-            label = hash40Values[nodeIdx];
-            rect = label->boundingRect();
-            cx = (w - rect.width()) / 2;
-            cy = (h - rect.height()) / 2;
-            label->setParentItem(nodeShape);
-            label->setPos(x - w/2 + cx, y - h/4*1 + cy);
-        }
-    }
+// ----------------------------------------------------------------------------
+void GraphModel::onLayoutFinished(const std::shared_ptr<LayoutJob>& job)
+{
+    // Discard layouts that were superseded while they were running
+    if (job->generation != layoutGeneration_)
+        return;
 
-    // When drawing edges, we need the lines to start and end on the boundary
-    // of the rectangle shape rather than in the center. Takes the center and
-    // width/height of a rectangle, and projects the point "p" onto the outline.
-    auto intersectRect = [](double cx, double cy, double w, double h, double px, double py) -> ogdf::DPoint {
-        double dx = cx - px;
-        double dy = cy - py;
-
-        double off;
-        if (dy != 0.0)
-            off = dx / dy * h/2;
-        if (dy != 0.0 && off >= -w/2 && off <= w/2)
-        {
-            if (py > cy)
-                return ogdf::DPoint(cx + off, cy + h/2);
-            else
-                return ogdf::DPoint(cx - off, cy - h/2);
-        }
-        else
-        {
-            if (px > cx)
-                return ogdf::DPoint(cx + w/2, cy + dy / dx * w/2);
-            else
-                return ogdf::DPoint(cx - w/2, cy - dy / dx * w/2);
-        }
-    };
+    PipelineTimer timer(timings_.scene);
+    clearScene();
+    if (job->fromCache == false)
+        layoutCache_.insert(job->key, job->layout);
+    displayed_.key = job->key;
+    displayed_.showHash40Values = job->showHash40Values;
+
+    const GraphLayout& layout = job->layout;
+
+    // The whole graph is drawn by a single item
+    displayed_.item = new GraphItem;
+    displayed_.item->setGeometry(job->graph, layout);
+    displayed_.item->setNodeLabels(job->labels, job->hash40Strings, job->hash40Values);
+    displayed_.item->setEdgeLabels(edgeWeightLabels(job->graph));
+    addItem(displayed_.item);
+    timer.stop();
+
+    lastLayoutEngine_ = layout.engine;
+    lastLayoutTime_ = layout.elapsedMs;
+    lastLayoutCached_ = job->fromCache;
+    dispatcher.dispatch(&GraphModelListener::onGraphModelLayoutFinished);
+}
 
-    for (int edgeIdx = 0; edgeIdx != ogdfEdges.count(); ++edgeIdx)
-    {
-        ogdf::edge edge = ogdfEdges[edgeIdx];
-
-        // --------------------------------------------------------------------
-        // Draw path
-        // --------------------------------------------------------------------
-
-        ogdf::DPoint start = GA.point(edge->source());
-        const ogdf::DPolyline& bends = GA.bends(edge);
-        ogdf::DPoint end = GA.point(edge->target());
-
-        // Move start and end points to be on the surface of the node's shape,
-        // rather than the center
-        start = intersectRect(
-            start.m_x, start.m_y,
-            GA.width(edge->source()), GA.height(edge->source()),
-            bends.empty() ? end.m_x : bends.front().m_x,
-            bends.empty() ? end.m_y : bends.front().m_y
-        );
-        end = intersectRect(
-            end.m_x, end.m_y,
-            GA.width(edge->target()), GA.height(edge->target()),
-            bends.empty() ? start.m_x : bends.back().m_x,
-            bends.empty() ? start.m_y : bends.back().m_y
-        );
-
-        QPainterPath path(QPointF(start.m_x, start.m_y));
-        for (ogdf::ListConstIterator<ogdf::DPoint> it = bends.begin(); it != bends.end(); ++it)
-            path.lineTo(QPointF((*it).m_x, (*it).m_y));
-        path.lineTo(QPointF(end.m_x, end.m_y));
-
-        QGraphicsPathItem* pathItem = addPath(path, QPen(QColor("green")));
-
-        // --------------------------------------------------------------------
-        // Draw arrow head
-        // --------------------------------------------------------------------
-
-        ogdf::DPoint arrowStartPoint = bends.empty() ? start : bends.back();
-        ogdf::DPoint arrowEndPoint = end;
-
-        qreal Pi = 3.14159;
-        qreal arrowSize = 10;
-
-        QLineF line(
-            QPointF(arrowEndPoint.m_x, arrowEndPoint.m_y),
-            QPointF(arrowStartPoint.m_x, arrowStartPoint.m_y)
-        );
-
-        double angle = ::acos(line.dx() / line.length());
-
-        if (line.dy() >= 0)
-            angle = (Pi * 2) - angle;
-
-        QPointF arrowP1 = line.p1() + QPointF(sin(angle + Pi / 3) * arrowSize,
-            cos(angle + Pi / 3) * arrowSize);
-        QPointF arrowP2 = line.p1() + QPointF(sin(angle + Pi - Pi / 3) * arrowSize,
-            cos(angle + Pi - Pi / 3) * arrowSize);
-
-        QPolygonF arrowHead;
-        arrowHead << line.p1() << arrowP1 << arrowP2;
-
-        addPolygon(arrowHead, QPen(QColor("green")), QBrush(QColor("green")));
-
-        // --------------------------------------------------------------------
-        // Draw edge label
-        // --------------------------------------------------------------------
-
-        //QGraphicsSimpleTextItem* edgeLabel = new QGraphicsSimpleTextItem(QString::number(graph.edges[edgeIdx].weight()));
-        //edgeLabel->setParentItem(pathItem);
-        QGraphicsSimpleTextItem* edgeLabel = addSimpleText(QString::number(graph.edges[edgeIdx].weight));
-        QPointF edgeLabelPos(
-            end.m_x - edgeLabel->boundingRect().width()/2,
-            end.m_y - edgeLabel->boundingRect().height()/2
-        );
-        edgeLabelPos -= QPointF(-std::cos(angle), std::sin(angle)) * edgeLabel->boundingRect().height();
-        edgeLabel->setPos(edgeLabelPos);
-    }
+// ----------------------------------------------------------------------------
+void GraphModel::relabelScene(const LayoutJob& job)
+{
+    displayed_.item->setNodeLabels(job.labels, job.hash40Strings, job.hash40Values);
+    displayed_.item->setEdgeLabels(edgeWeightLabels(job.graph));
+}
 
-    //ogdf::GraphIO::write(GA, "graph.svg", ogdf::GraphIO::drawSVG);
+// ----------------------------------------------------------------------------
+void GraphModel::clearScene()
+{
+    clear();
+    displayed_ = DisplayedGraph();
 }
 
 // ----------------------------------------------------------------------------
 void GraphModel::onNewSessions() {}
 void GraphModel::onClearAll()
 {
-    clear();
+    invalidateGraph();
+    graphPruner_.clear();
+    selectedGraph_.clear();
+    relayoutGraph();
 }
 void GraphModel::onDataAdded() {}
-void GraphModel::onPOVChanged() {}
-void GraphModel::onQueriesChanged() {}
-void GraphModel::onQueryCompiled(int queryIdx, bool success, const char* error, bool oppSuccess, const char* oppError) {}
+void GraphModel::onPOVChanged()
+{
+    invalidateGraph();
+}
+void GraphModel::onQueriesChanged()
+{
+    invalidateGraph();
+}
+void GraphModel::onQueryCompiled(int queryIdx, bool success, const char* error, bool oppSuccess, const char* oppError)
+{
+    invalidateGraph();
+}
 void GraphModel::onQueriesApplied()
+{
+    // Building the graph is the most expensive update during live games.
+    // The layout itself already runs on a worker thread
+    if (searchModel_->frameScheduler()->deferUpdate(this))
+        return;
+    redrawGraph();
+}
+
+// ----------------------------------------------------------------------------
+void GraphModel::onFrameSchedulerUpdate()
 {
     redrawGraph();
 }
@@ -0,0 +1,168 @@
+#include "decision-graph/models/GraphPruner.hpp"
+#include "decision-graph/models/Graph.hpp"
+
+#include <algorithm>
+
+// ----------------------------------------------------------------------------
+GraphPruner::GraphPruner()
+{}
+
+// ----------------------------------------------------------------------------
+GraphPruner::~GraphPruner()
+{}
+
+// ----------------------------------------------------------------------------
+void GraphPruner::setGraph(const Graph* graph)
+{
+    graph_ = graph;
+    const int nodeCount = graph_->nodes.count();
+    const int edgeCount = graph_->edges.count();
+
+    edgesByWeight_.resize(edgeCount);
+    for (int i = 0; i != edgeCount; ++i)
+        edgesByWeight_[i] = i;
+    std::stable_sort(edgesByWeight_.begin(), edgesByWeight_.end(), [this](int a, int b) {
+        return graph_->edges[a].weight > graph_->edges[b].weight;
+    });
+
+    // A node's throughput is the number of times it was visited, which is
+    // the larger of its incoming and outgoing weights. Using the larger of
+    // the two keeps the first and last states of sequences from being
+    // considered unimportant
+    auto throughput = rfcommon::Vector<int>::makeResized(nodeCount);
+    for (int node = 0; node != nodeCount; ++node)
+    {
+        int outgoing = 0;
+        int incoming = 0;
+        for (int edge : graph_->outgoingEdges(node))
+            outgoing += graph_->edges[edge].weight;
+        for (int edge : graph_->incomingEdges(node))
+            incoming += graph_->edges[edge].weight;
+        throughput[node] = outgoing > incoming ? outgoing : incoming;
+    }
+
+    nodesByThroughput_.resize(nodeCount);
+    for (int i = 0; i != nodeCount; ++i)
+        nodesByThroughput_[i] = i;
+    std::stable_sort(nodesByThroughput_.begin(), nodesByThroughput_.end(), [&throughput](int a, int b) {
+        return throughput[a] > throughput[b];
+    });
+}
+
+// ----------------------------------------------------------------------------
+void GraphPruner::clear()
+{
+    graph_ = nullptr;
+    edgesByWeight_.clearCompact();
+    nodesByThroughput_.clearCompact();
+}
+
+// ----------------------------------------------------------------------------
+int GraphPruner::weightAtPercentile(int percentile) const
+{
+    if (edgesByWeight_.count() == 0)
+        return 1;
+
+    // Edges are sorted heaviest first, so the lightest edge is at the end
+    const int count = edgesByWeight_.count();
+    int idx = (count - 1) - percentile * count / 100;
+    if (idx < 0)
+        idx = 0;
+    if (idx > count - 1)
+        idx = count - 1;
+
+    return graph_->edges[edgesByWeight_[idx]].weight;
+}
+
+// ----------------------------------------------------------------------------
+Graph GraphPruner::prune(int minWeight, int maxNodes, bool aggregate) const
+{
+    Graph result;
+    if (graph_ == nullptr || graph_->nodes.count() == 0)
+        return result;
+
+    const Graph& graph = *graph_;
+    const int nodeCount = graph.nodes.count();
+    const int keepNodeCount = maxNodes > 0 && maxNodes < nodeCount ? maxNodes : nodeCount;
+
+    // Every node among the N with the highest throughput is kept, even if
+    // none of its edges survive the weight threshold. Dropping those would
+    // hide isolated nodes and single-state matches entirely
+    auto keep = rfcommon::Vector<char>::makeResized(nodeCount);
+    for (int node = 0; node != nodeCount; ++node)
+        keep[node] = 0;
+    for (int i = 0; i != keepNodeCount; ++i)
+        keep[nodesByThroughput_[i]] = 1;
+
+    auto map = rfcommon::Vector<int>::makeResized(nodeCount);
+    for (int node = 0; node != nodeCount; ++node)
+    {
+        if (keep[node])
+        {
+            map[node] = result.nodes.count();
+            result.nodes.emplace(graph.nodes[node].stateIdx);
+        }
+        else
+            map[node] = -1;
+    }
+
+    // Copy surviving edges and accumulate the weight of everything that was
+    // removed on the side of the node that survived. Every dropped edge is
+    // counted once. If both of its nodes survived, it counts as leaving the
+    // source node
+    auto otherOutgoing = rfcommon::Vector<int>::makeResized(nodeCount);
+    auto otherIncoming = rfcommon::Vector<int>::makeResized(nodeCount);
+    for (int node = 0; node != nodeCount; ++node)
+    {
+        otherOutgoing[node] = 0;
+        otherIncoming[node] = 0;
+    }
+
+    for (const Edge& edge : graph.edges)
+    {
+        const bool fromKept = map[edge.from] != -1;
+        const bool toKept = map[edge.to] != -1;
+        if (fromKept && toKept && edge.weight >= minWeight)
+        {
+            result.edges.emplace(map[edge.from], map[edge.to], edge.weight);
+            continue;
+        }
+
+        if (fromKept)
+            otherOutgoing[edge.from] += edge.weight;
+        else if (toKept)
+            otherIncoming[edge.to] += edge.weight;
+    }
+
+    // A single sink and a single source are shared by all nodes, so
+    // aggregating adds at most two nodes to the layout
+    if (aggregate)
+    {
+        int sink = -1;
+        int source = -1;
+        for (int node = 0; node != nodeCount; ++node)
+        {
+            if (otherOutgoing[node] > 0)
+            {
+                if (sink == -1)
+                {
+                    sink = result.nodes.count();
+                    result.nodes.emplace(OTHER_OUTGOING);
+                }
+                result.edges.emplace(map[node], sink, otherOutgoing[node]);
+            }
+            if (otherIncoming[node] > 0)
+            {
+                if (source == -1)
+                {
+                    source = result.nodes.count();
+                    result.nodes.emplace(OTHER_INCOMING);
+                }
+                result.edges.emplace(source, map[node], otherIncoming[node]);
+            }
+        }
+    }
+
+    result.finalize();
+    return result;
+}
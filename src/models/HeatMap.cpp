@@ -0,0 +1,296 @@
+#include "decision-graph/models/HeatMap.hpp"
+#include "decision-graph/models/Sequence.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Number of states binned per batch. Cell indices for a whole batch are
+// computed first without any branches so the loop can be vectorized, then
+// the counters are incremented in a second pass
+constexpr int BIN_BATCH_SIZE = 256;
+
+// ----------------------------------------------------------------------------
+QRgb colorMap(float t)
+{
+    struct Stop { float t; int r, g, b; };
+    static const Stop stops[] = {
+        {0.00f, 255, 255, 255},
+        {0.15f,  49,  54, 149},
+        {0.40f,  69, 117, 180},
+        {0.60f, 254, 224, 144},
+        {0.80f, 244, 109,  67},
+        {1.00f, 165,   0,  38},
+    };
+
+    // Build lookup table once
+    static const auto lut = [] {
+        rfcommon::Vector<QRgb> lut;
+        for (int i = 0; i != 256; ++i)
+        {
+            const float t = i / 255.0f;
+            int s = 1;
+            while (stops[s].t < t)
+                s++;
+            const Stop& a = stops[s - 1];
+            const Stop& b = stops[s];
+            const float f = (t - a.t) / (b.t - a.t);
+            lut.push(qRgb(
+                static_cast<int>(a.r + (b.r - a.r) * f),
+                static_cast<int>(a.g + (b.g - a.g) * f),
+                static_cast<int>(a.b + (b.b - a.b) * f)));
+        }
+        return lut;
+    }();
+
+    const int i = static_cast<int>(t * 255.0f + 0.5f);
+    return lut[std::clamp(i, 0, 255)];
+}
+
+}
+
+// ----------------------------------------------------------------------------
+HeatMap::HeatMap(int width, int height)
+    : width_(width)
+    , height_(height)
+{
+    clear();
+}
+
+// ----------------------------------------------------------------------------
+HeatMap::~HeatMap()
+{}
+
+// ----------------------------------------------------------------------------
+void HeatMap::setExtents(float left, float right, float bottom, float top)
+{
+    if (left_ == left && right_ == right && bottom_ == bottom && top_ == top)
+        return;
+
+    left_ = left;
+    right_ = right;
+    bottom_ = bottom;
+    top_ = top;
+
+    // Force every session to be re-binned on the next update
+    const int count = sessions_.count();
+    clear();
+    setSessionCount(count);
+}
+
+// ----------------------------------------------------------------------------
+void HeatMap::setBlurRadius(float sigma)
+{
+    sigma_ = sigma;
+    imageDirty_ = true;
+}
+
+// ----------------------------------------------------------------------------
+void HeatMap::setLogScale(bool enable)
+{
+    logScale_ = enable;
+    imageDirty_ = true;
+}
+
+// ----------------------------------------------------------------------------
+void HeatMap::clear()
+{
+    const int cells = width_ * height_;
+
+    sessions_.clear();
+    total_.resize(cells);
+    std::fill(total_.begin(), total_.end(), 0);
+    sampleCount_ = 0;
+    imageDirty_ = true;
+}
+
+// ----------------------------------------------------------------------------
+void HeatMap::setSessionCount(int count)
+{
+    while (sessions_.count() > count)
+    {
+        const Session& session = sessions_.back();
+        for (int i = 0; i != session.grid.count(); ++i)
+            total_[i] -= session.grid[i];
+        sampleCount_ -= session.sampleCount;
+        sessions_.erase(sessions_.count() - 1);
+        imageDirty_ = true;
+    }
+
+    while (sessions_.count() < count)
+        sessions_.emplace();
+}
+
+// ----------------------------------------------------------------------------
+bool HeatMap::updateSession(int sessionIdx, const States& states, const rfcommon::Vector<const rfcommon::Vector<Range>*>& rangeLists)
+{
+    const int cells = width_ * height_;
+    Session& session = sessions_[sessionIdx];
+
+    // Matches are usually identical for most sessions between two applies,
+    // e.g. when a new session was added or when the same query is applied
+    // again. Comparing a hash of the ranges is much cheaper than binning
+    uint64_t signature = 14695981039346656037ull;
+    auto mix = [&signature](uint64_t value) {
+        signature = (signature ^ value) * 1099511628211ull;
+    };
+    for (const rfcommon::Vector<Range>* ranges : rangeLists)
+    {
+        mix(ranges->count());
+        for (const Range& range : *ranges)
+        {
+            mix(range.startIdx);
+            mix(range.endIdx);
+        }
+    }
+
+    if (session.grid.count() > 0 && session.signature == signature)
+        return false;
+
+    // Remove the session's previous contribution from the total
+    for (int i = 0; i != session.grid.count(); ++i)
+        total_[i] -= session.grid[i];
+    sampleCount_ -= session.sampleCount;
+
+    // One extra cell at the end collects all positions that fall outside of
+    // the grid
+    session.grid.resize(cells + 1);
+    std::fill(session.grid.begin(), session.grid.end(), 0);
+    for (const rfcommon::Vector<Range>* ranges : rangeLists)
+        for (const Range& range : *ranges)
+            binRange(&session.grid, states, range);
+    session.grid.resize(cells);
+
+    session.sampleCount = 0;
+    for (int i = 0; i != cells; ++i)
+    {
+        total_[i] += session.grid[i];
+        session.sampleCount += session.grid[i];
+    }
+    sampleCount_ += session.sampleCount;
+    session.signature = signature;
+
+    imageDirty_ = true;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+void HeatMap::binRange(rfcommon::Vector<uint32_t>* grid, const States& states, const Range& range) const
+{
+    const float scaleX = width_ / (right_ - left_);
+    const float scaleY = height_ / (top_ - bottom_);
+    const int outside = width_ * height_;
+    int cellIdxs[BIN_BATCH_SIZE];
+
+    for (int start = range.startIdx; start < range.endIdx; start += BIN_BATCH_SIZE)
+    {
+        const int count = std::min(BIN_BATCH_SIZE, range.endIdx - start);
+
+        for (int i = 0; i != count; ++i)
+        {
+            const rfcommon::Vec2& pos = states[start + i].sideData.position;
+            const float fx = (pos.x() - left_) * scaleX;
+            const float fy = (top_ - pos.y()) * scaleY;  // Row 0 is the top
+            const int x = static_cast<int>(fx);
+            const int y = static_cast<int>(fy);
+            const bool inside = (fx >= 0.0f) & (fy >= 0.0f) & (x < width_) & (y < height_);
+            cellIdxs[i] = inside ? y * width_ + x : outside;
+        }
+
+        uint32_t* cells = grid->data();
+        for (int i = 0; i != count; ++i)
+            cells[cellIdxs[i]]++;
+    }
+}
+
+// ----------------------------------------------------------------------------
+void HeatMap::blur(rfcommon::Vector<float>* values) const
+{
+    if (sigma_ <= 0.0f)
+        return;
+
+    const int radius = static_cast<int>(std::ceil(sigma_ * 3.0f));
+    rfcommon::Vector<float> kernel;
+    float sum = 0.0f;
+    for (int i = -radius; i <= radius; ++i)
+    {
+        const float w = std::exp(-0.5f * i * i / (sigma_ * sigma_));
+        kernel.push(w);
+        sum += w;
+    }
+    for (float& w : kernel)
+        w /= sum;
+
+    // Separable: Blur rows into a temporary buffer, then blur the columns of
+    // that buffer back into the input. Cells beyond the edges count as 0
+    rfcommon::Vector<float> tmp;
+    tmp.resize(width_ * height_);
+    float* in = values->data();
+    float* out = tmp.data();
+
+    for (int y = 0; y != height_; ++y)
+        for (int x = 0; x != width_; ++x)
+        {
+            const int from = std::max(-radius, -x);
+            const int to = std::min(radius, width_ - 1 - x);
+            float acc = 0.0f;
+            for (int k = from; k <= to; ++k)
+                acc += in[y * width_ + x + k] * kernel[k + radius];
+            out[y * width_ + x] = acc;
+        }
+
+    for (int y = 0; y != height_; ++y)
+    {
+        const int from = std::max(-radius, -y);
+        const int to = std::min(radius, height_ - 1 - y);
+        for (int x = 0; x != width_; ++x)
+            in[y * width_ + x] = 0.0f;
+        for (int k = from; k <= to; ++k)
+        {
+            // Row-wise accumulation keeps the inner loop contiguous
+            const float w = kernel[k + radius];
+            const float* src = out + (y + k) * width_;
+            float* dst = in + y * width_;
+            for (int x = 0; x != width_; ++x)
+                dst[x] += src[x] * w;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+const QImage& HeatMap::image()
+{
+    if (imageDirty_ == false)
+        return image_;
+    imageDirty_ = false;
+
+    const int cells = width_ * height_;
+    rfcommon::Vector<float> values;
+    values.resize(cells);
+    for (int i = 0; i != cells; ++i)
+        values[i] = static_cast<float>(total_[i]);
+
+    blur(&values);
+
+    float maxValue = 0.0f;
+    for (int i = 0; i != cells; ++i)
+    {
+        if (logScale_)
+            values[i] = std::log1p(values[i]);
+        maxValue = std::max(maxValue, values[i]);
+    }
+    const float scale = maxValue > 0.0f ? 1.0f / maxValue : 0.0f;
+
+    if (image_.isNull() || image_.width() != width_ || image_.height() != height_)
+        image_ = QImage(width_, height_, QImage::Format_RGB32);
+
+    for (int y = 0; y != height_; ++y)
+    {
+        QRgb* line = reinterpret_cast<QRgb*>(image_.scanLine(y));
+        for (int x = 0; x != width_; ++x)
+            line[x] = colorMap(values[y * width_ + x] * scale);
+    }
+
+    return image_;
+}
@@ -0,0 +1,259 @@
+#include "decision-graph/models/PipelineMetrics.hpp"
+#include "decision-graph/util/Str.hpp"
+
+#include <QFile>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Rates are averaged over windows of this length
+constexpr int64_t RATE_WINDOW_NS = 1000000000;
+
+// If no event arrives for this long, the source is considered paused
+constexpr int64_t RATE_PAUSE_NS = 3 * RATE_WINDOW_NS;
+
+int mostSignificantBit(uint64_t value)
+{
+    int msb = 0;
+    if (value >> 32) { value >>= 32; msb += 32; }
+    if (value >> 16) { value >>= 16; msb += 16; }
+    if (value >> 8)  { value >>= 8;  msb += 8; }
+    if (value >> 4)  { value >>= 4;  msb += 4; }
+    if (value >> 2)  { value >>= 2;  msb += 2; }
+    if (value >> 1)  { msb += 1; }
+    return msb;
+}
+
+void appendValue(rfcommon::String* out, uint64_t value, PipelineHistogram::Unit unit)
+{
+    if (unit == PipelineHistogram::COUNT)
+        StrAppendf(out, " %10llu", static_cast<unsigned long long>(value));
+    else if (value < 1000)
+        StrAppendf(out, " %7llu ns", static_cast<unsigned long long>(value));
+    else if (value < 1000000)
+        StrAppendf(out, " %7.2f us", value / 1e3);
+    else if (value < 1000000000)
+        StrAppendf(out, " %7.2f ms", value / 1e6);
+    else
+        StrAppendf(out, " %7.2f s ", value / 1e9);
+}
+
+}
+
+// ----------------------------------------------------------------------------
+PipelineHistogram::PipelineHistogram(const char* name, Unit unit)
+    : name_(name)
+    , unit_(unit)
+{
+    reset();
+}
+
+// ----------------------------------------------------------------------------
+int PipelineHistogram::bucketIdx(uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+        return static_cast<int>(value);
+
+    // The bits following the most significant bit select the sub-bucket
+    const int msb = mostSignificantBit(value);
+    const int sub = static_cast<int>(value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (msb - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+// ----------------------------------------------------------------------------
+uint64_t PipelineHistogram::bucketUpperBound(int bucketIdx)
+{
+    if (bucketIdx < SUB_BUCKETS)
+        return static_cast<uint64_t>(bucketIdx);
+
+    const int msb = bucketIdx / SUB_BUCKETS - 1 + SUB_BUCKET_BITS;
+    const uint64_t sub = bucketIdx % SUB_BUCKETS;
+    const uint64_t lower = (SUB_BUCKETS + sub) << (msb - SUB_BUCKET_BITS);
+    const uint64_t width = uint64_t(1) << (msb - SUB_BUCKET_BITS);
+    return lower + (width - 1);
+}
+
+// ----------------------------------------------------------------------------
+void PipelineHistogram::add(uint64_t value)
+{
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    last_.store(value, std::memory_order_relaxed);
+    buckets_[bucketIdx(value)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (max < value && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+}
+
+// ----------------------------------------------------------------------------
+void PipelineHistogram::reset()
+{
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+    last_.store(0, std::memory_order_relaxed);
+    for (auto& bucket : buckets_)
+        bucket.store(0, std::memory_order_relaxed);
+}
+
+// ----------------------------------------------------------------------------
+double PipelineHistogram::mean() const
+{
+    const uint64_t n = count();
+    return n > 0 ? static_cast<double>(sum()) / n : 0.0;
+}
+
+// ----------------------------------------------------------------------------
+uint64_t PipelineHistogram::percentile(double p) const
+{
+    // Buckets may be updated while we read them, so count them again instead
+    // of relying on count_
+    uint64_t total = 0;
+    for (const auto& bucket : buckets_)
+        total += bucket.load(std::memory_order_relaxed);
+    if (total == 0)
+        return 0;
+
+    const uint64_t rank = static_cast<uint64_t>(p * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i != BUCKET_COUNT; ++i)
+    {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return std::min(bucketUpperBound(i), max());
+    }
+
+    return max();
+}
+
+// ----------------------------------------------------------------------------
+PipelineCounter::PipelineCounter(const char* name)
+    : name_(name)
+    , value_(0)
+{}
+
+// ----------------------------------------------------------------------------
+PipelineMetrics::PipelineMetrics()
+{
+    clock_.start();
+}
+
+// ----------------------------------------------------------------------------
+PipelineMetrics::~PipelineMetrics()
+{}
+
+// ----------------------------------------------------------------------------
+PipelineHistogram* PipelineMetrics::histogram(const char* name, PipelineHistogram::Unit unit)
+{
+    for (const auto& histogram : histograms_)
+        if (histogram->name() == name)
+            return histogram.get();
+
+    histograms_.push(std::unique_ptr<PipelineHistogram>(new PipelineHistogram(name, unit)));
+    return histograms_.back().get();
+}
+
+// ----------------------------------------------------------------------------
+PipelineCounter* PipelineMetrics::counter(const char* name)
+{
+    for (const auto& counter : counters_)
+        if (counter->name() == name)
+            return counter.get();
+
+    counters_.push(std::unique_ptr<PipelineCounter>(new PipelineCounter(name)));
+    return counters_.back().get();
+}
+
+// ----------------------------------------------------------------------------
+void PipelineMetrics::tickRate(PipelineHistogram* rate, PipelineCounter* events)
+{
+    events->add(1);
+
+    const int64_t now = clock_.nsecsElapsed();
+    for (RateWindow& window : rateWindows_)
+    {
+        if (window.rate != rate)
+            continue;
+
+        const int64_t elapsed = now - window.startNS;
+        if (elapsed >= RATE_PAUSE_NS)
+        {
+            // Events stopped arriving for a while. Start over instead of
+            // recording a rate that only reflects the pause
+            window.startNS = now;
+            window.startCount = events->value();
+        }
+        else if (elapsed >= RATE_WINDOW_NS)
+        {
+            rate->add(static_cast<uint64_t>((events->value() - window.startCount) * 1e9 / elapsed));
+            window.startNS = now;
+            window.startCount = events->value();
+        }
+        return;
+    }
+
+    rateWindows_.push({rate, now, events->value()});
+}
+
+// ----------------------------------------------------------------------------
+void PipelineMetrics::reset()
+{
+    for (const auto& histogram : histograms_)
+        histogram->reset();
+    for (const auto& counter : counters_)
+        counter->reset();
+    rateWindows_.clear();
+}
+
+// ----------------------------------------------------------------------------
+rfcommon::String PipelineMetrics::toString() const
+{
+    rfcommon::Vector<const PipelineHistogram*> histograms;
+    for (const auto& histogram : histograms_)
+        histograms.push(histogram.get());
+    std::sort(histograms.begin(), histograms.end(), [](const PipelineHistogram* a, const PipelineHistogram* b) {
+        return strcmp(a->name().cStr(), b->name().cStr()) < 0;
+    });
+
+    rfcommon::Vector<const PipelineCounter*> counters;
+    for (const auto& counter : counters_)
+        counters.push(counter.get());
+    std::sort(counters.begin(), counters.end(), [](const PipelineCounter* a, const PipelineCounter* b) {
+        return strcmp(a->name().cStr(), b->name().cStr()) < 0;
+    });
+
+    rfcommon::String out;
+    StrAppendf(&out, "%-24s %10s %10s %10s %10s %10s %10s %10s\n",
+        "stage", "count", "last", "mean", "p50", "p90", "p99", "max");
+    for (const PipelineHistogram* h : histograms)
+    {
+        StrAppendf(&out, "%-24s %10llu", h->name().cStr(), static_cast<unsigned long long>(h->count()));
+        appendValue(&out, h->last(), h->unit());
+        appendValue(&out, static_cast<uint64_t>(h->mean()), h->unit());
+        appendValue(&out, h->percentile(0.5), h->unit());
+        appendValue(&out, h->percentile(0.9), h->unit());
+        appendValue(&out, h->percentile(0.99), h->unit());
+        appendValue(&out, h->max(), h->unit());
+        out += "\n";
+    }
+
+    if (counters.count() > 0)
+        out += "\n";
+    for (const PipelineCounter* c : counters)
+        StrAppendf(&out, "%-24s %10lld\n", c->name().cStr(), static_cast<long long>(c->value()));
+
+    return out;
+}
+
+// ----------------------------------------------------------------------------
+bool PipelineMetrics::dump(const QString& fileName) const
+{
+    const rfcommon::String text = toString();
+
+    QFile file(fileName);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text) == false)
+        return false;
+    return file.write(text.cStr(), text.length()) == text.length();
+}
@@ -1,9 +1,11 @@
 #include "decision-graph/models/Query.hpp"
+#include "decision-graph/models/RegionIndex.hpp"
+#include "decision-graph/util/Arena.hpp"
 #include "decision-graph/parsers/QueryParser.y.hpp"
 #include "decision-graph/parsers/QueryScanner.lex.hpp"
 #include "decision-graph/parsers/QueryASTNode.hpp"
+#include "decision-graph/util/Str.hpp"
 
-#include "rfcommon/HashMap.hpp"
 #include "rfcommon/MotionLabels.hpp"
 
 #include <cstdio>
@@ -22,7 +24,7 @@ Matcher Matcher::start()
 }
 
 // ----------------------------------------------------------------------------
-Matcher Matcher::wildCard(uint8_t ctxQualFlags)
+Matcher Matcher::wildCard(uint16_t ctxQualFlags)
 {
     return Matcher(
         rfcommon::FighterMotion::makeInvalid(),
@@ -33,7 +35,7 @@ Matcher Matcher::wildCard(uint8_t ctxQualFlags)
 }
 
 // ----------------------------------------------------------------------------
-Matcher Matcher::motion(rfcommon::FighterMotion motion, uint8_t ctxQualFlags)
+Matcher Matcher::motion(rfcommon::FighterMotion motion, uint16_t ctxQualFlags)
 {
     return Matcher(
         motion,
@@ -47,12 +49,14 @@ Matcher Matcher::motion(rfcommon::FighterMotion motion, uint8_t ctxQualFlags)
 Matcher::Matcher(
         rfcommon::FighterMotion motion,
         rfcommon::FighterStatus status,
-        uint8_t ctxQualFlags,
+        uint16_t ctxQualFlags,
         uint8_t matchFlags)
     : motion_(motion)
     , status_(status)
     , ctxQualFlags_(ctxQualFlags)
     , matchFlags_(matchFlags)
+    , nextBegin_(0)
+    , nextEnd_(0)
 {}
 
 // ----------------------------------------------------------------------------
@@ -66,24 +70,21 @@ bool Matcher::matches(const State& state) const
         if (state.motion != motion_)
             return false;
 
-    if (ctxQualFlags_)
-    {
-        bool onHit = state.opponentInHitlag();
-        bool onShield = state.opponentInShieldlag();
-        bool onWhiff = !state.opponentInHitlag() && !state.opponentInShieldlag();
-        uint8_t compare =
-                (static_cast<uint8_t>(onHit) << 0)
-              | (static_cast<uint8_t>(onWhiff) << 1)
-              | (static_cast<uint8_t>(onShield) << 2);
-        if (!(ctxQualFlags_ & compare))
-            return false;
-    }
+    // The state's flags already contain every qualifier, so each group is a
+    // single mask test
+    const uint16_t interaction = ctxQualFlags_ & INTERACTION_QUALIFIERS;
+    if (interaction && !(state.flags & interaction))
+        return false;
+
+    const uint16_t kinematic = ctxQualFlags_ & KINEMATIC_QUALIFIERS;
+    if (kinematic && !(state.flags & kinematic))
+        return false;
 
     return true;
 }
 
 // ----------------------------------------------------------------------------
-QueryASTNode* Query::parse(const rfcommon::String& text)
+QueryASTNode* Query::parse(const rfcommon::String& text, Arena* arena)
 {
     qpscan_t scanner;
     qppstate* parser;
@@ -93,7 +94,7 @@ QueryASTNode* Query::parse(const rfcommon::String& text)
     int parse_result;
     QueryASTNode* ast = nullptr;
 
-    if (qplex_init(&scanner) != 0)
+    if (qplex_init_extra(arena, &scanner) != 0)
         goto init_scanner_failed;
     buf = qp_scan_bytes(text.cStr(), text.length(), scanner);
     if (buf == nullptr)
@@ -105,17 +106,16 @@ QueryASTNode* Query::parse(const rfcommon::String& text)
     do
     {
         pushed_char = qplex(&pushed_value, scanner);
-        parse_result = qppush_parse(parser, pushed_char, &pushed_value, &ast);
+        parse_result = qppush_parse(parser, pushed_char, &pushed_value, &ast, arena);
     } while (parse_result == YYPUSH_MORE);
 
     qppstate_delete(parser);
     qp_delete_buffer(buf, scanner);
     qplex_destroy(scanner);
 
+    // Nodes created before an error are released with the arena
     if (parse_result == 0)
         return ast;
-    if (ast)
-        QueryASTNode::destroyRecurse(ast);
     return nullptr;
 
     init_parser_failed  : qp_delete_buffer(buf, scanner);
@@ -138,41 +138,92 @@ QueryASTNode* Query::parse(const rfcommon::String& text)
  */
 struct Fragment
 {
-    rfcommon::SmallVector<int, 4> in;
-    rfcommon::SmallVector<int, 4> out;
+    explicit Fragment(Arena* arena) : in(arena), out(arena) {}
+
+    ArenaVector<int> in;
+    ArenaVector<int> out;
     bool bridge = false;
 };
 
+/*
+ * Everything that is only needed while compiling. Matchers are appended
+ * directly to the query, but their transitions are collected in per-matcher
+ * lists first, because they are added and duplicated in any order. The
+ * lists are flattened into the query once the NFA is complete.
+ */
+struct NFABuilder
+{
+    NFABuilder(Arena* arena, rfcommon::Vector<Matcher>* matchers)
+        : arena(arena)
+        , matchers(matchers)
+        , next(arena)
+        , fstack(arena)
+        , qstack(arena)
+    {}
+
+    int addMatcher(const Matcher& matcher)
+    {
+        matchers->push(matcher);
+        next.push(ArenaVector<int>(arena));
+        return matchers->count() - 1;
+    }
+
+    Fragment& pushFragment()
+    {
+        fstack.push(Fragment(arena));
+        return fstack.back();
+    }
+
+    void pushFragment(int matcherIdx)
+    {
+        Fragment& f = pushFragment();
+        f.in.push(matcherIdx);
+        f.out.push(matcherIdx);
+    }
+
+    Arena* const arena;
+    rfcommon::Vector<Matcher>* const matchers;
+    ArenaVector<ArenaVector<int>> next;  // Transitions of each matcher
+    ArenaVector<Fragment> fstack;        // "fragment stack"
+    ArenaVector<uint8_t> qstack;         // "qualifier stack"
+};
+
 // ----------------------------------------------------------------------------
-static void duplicateMatchers(int idx, rfcommon::Vector<Matcher>* matchers, rfcommon::HashMap<int, int>* indexMap)
+static void duplicateMatchers(int idx, NFABuilder* nfa, int* indexMap)
 {
-    if (indexMap->insertIfNew(idx, matchers->count()) == indexMap->end())
+    if (indexMap[idx] != -1)
         return;
 
-    matchers->push(Matcher(matchers->at(idx)));
-    for (int i : matchers->at(idx).next)
-        duplicateMatchers(i, matchers, indexMap);
+    const Matcher matcher = nfa->matchers->at(idx);
+    indexMap[idx] = nfa->addMatcher(matcher);
+
+    const ArenaVector<int> next = nfa->next[idx];
+    for (int i : next)
+        duplicateMatchers(i, nfa, indexMap);
 }
-static Fragment duplicateFragment(const Fragment& f, rfcommon::Vector<Matcher>* matchers)
+static Fragment duplicateFragment(const Fragment& f, NFABuilder* nfa)
 {
-    Fragment dup;
-    rfcommon::HashMap<int, int> indexMap;  // Map indices of old matchers to the newly inserted matchers
+    // Map indices of old matchers to the newly inserted matchers
+    const int oldCount = nfa->matchers->count();
+    int* indexMap = nfa->arena->allocateArray<int>(oldCount);
+    for (int i = 0; i != oldCount; ++i)
+        indexMap[i] = -1;
+
     for (int i : f.in)
-        duplicateMatchers(i, matchers, &indexMap);
+        duplicateMatchers(i, nfa, indexMap);
 
-    // Fix transitions
-    for (auto kv : indexMap)
-    {
-        Matcher& newMatcher = matchers->at(kv.value());
-        for (int& i : newMatcher.next)
-            i = indexMap.find(i)->value();
-    }
+    // Copy transitions
+    for (int i = 0; i != oldCount; ++i)
+        if (indexMap[i] != -1)
+            for (int n : nfa->next[i])
+                nfa->next[indexMap[i]].push(indexMap[n]);
 
     // Fragment inputs/outputs
+    Fragment dup(nfa->arena);
     for (int i : f.in)
-        dup.in.push(indexMap.find(i)->value());
+        dup.in.push(indexMap[i]);
     for (int i : f.out)
-        dup.out.push(indexMap.find(i)->value());
+        dup.out.push(indexMap[i]);
 
     return dup;
 }
@@ -183,15 +234,13 @@ static bool compileASTRecurse(
         const rfcommon::MotionLabels* labels,
         rfcommon::FighterID fighterID,
         rfcommon::String* error,
-        rfcommon::Vector<Matcher>* matchers,
         rfcommon::Vector<rfcommon::SmallVector<rfcommon::FighterMotion, 4>>* mergeMotions,
-        rfcommon::SmallVector<Fragment, 16>* fstack,
-        rfcommon::SmallVector<uint8_t, 16>* qstack)
+        NFABuilder* nfa)
 {
     // OR all flags currently on the stack
-    auto calcContextQualifierFlags = [](rfcommon::SmallVector<uint8_t, 16>* qstack) -> uint8_t {
-        uint8_t contextQualifierFlags = 0;
-        for (uint8_t flag : *qstack)
+    auto calcContextQualifierFlags = [](const ArenaVector<uint8_t>& qstack) -> uint16_t {
+        uint16_t contextQualifierFlags = 0;
+        for (uint8_t flag : qstack)
         {
             if (!!(flag & QueryASTNode::HIT))
                 contextQualifierFlags |= Matcher::HIT;
@@ -199,6 +248,12 @@ static bool compileASTRecurse(
                 contextQualifierFlags |= Matcher::WHIFF;
             if (!!(flag & QueryASTNode::OS))
                 contextQualifierFlags |= Matcher::SHIELD;
+            if (!!(flag & QueryASTNode::RISING))
+                contextQualifierFlags |= Matcher::RISING;
+            if (!!(flag & QueryASTNode::FALLING))
+                contextQualifierFlags |= Matcher::FALLING;
+            if (!!(flag & QueryASTNode::GROUNDED))
+                contextQualifierFlags |= Matcher::GROUNDED;
         }
         return contextQualifierFlags;
     };
@@ -206,24 +261,24 @@ static bool compileASTRecurse(
     switch (node->type)
     {
     case QueryASTNode::STATEMENT: {
-        if (!compileASTRecurse(node->statement.child, labels, fighterID, error, matchers, mergeMotions, fstack, qstack)) return false;
-        if (!compileASTRecurse(node->statement.next, labels, fighterID, error, matchers, mergeMotions, fstack, qstack)) return false;
-        if (fstack->count() < 2)
+        if (!compileASTRecurse(node->statement.child, labels, fighterID, error, mergeMotions, nfa)) return false;
+        if (!compileASTRecurse(node->statement.next, labels, fighterID, error, mergeMotions, nfa)) return false;
+        if (nfa->fstack.count() < 2)
         {
             *error = "Incomplete statement";
             return false;
         }
 
-        Fragment& right = fstack->back(1);
-        Fragment& left = fstack->back(2);
+        Fragment& right = nfa->fstack.back(1);
+        Fragment& left = nfa->fstack.back(2);
         for (int o : left.out)
             for (int i : right.in)
-                matchers->at(o).next.push(i);
+                nfa->next[o].push(i);
 
         if (right.bridge)
-            left.out.push(std::move(right.out));
+            left.out.push(right.out);
         else
-            left.out = std::move(right.out);
+            left.out.assign(right.out);
 
         if (left.bridge)
         {
@@ -232,12 +287,12 @@ static bool compileASTRecurse(
             left.bridge = false;
         }
 
-        fstack->pop();
+        nfa->fstack.pop();
     } break;
 
     case QueryASTNode::REPITITION: {
-        if (!compileASTRecurse(node->repitition.child, labels, fighterID, error, matchers, mergeMotions, fstack, qstack)) return false;
-        if (fstack->count() < 1)
+        if (!compileASTRecurse(node->repitition.child, labels, fighterID, error, mergeMotions, nfa)) return false;
+        if (nfa->fstack.count() < 1)
         {
             *error = "Incomplete repitition";
             return false;
@@ -250,7 +305,7 @@ static bool compileASTRecurse(
             return false;
         }
 
-        Fragment& f = fstack->back();
+        Fragment& f = nfa->fstack.back();
 
         // Mark the entire fragment as optional if minreps or maxreps is 0
         if (node->repitition.minreps == 0 || node->repitition.maxreps == 0)
@@ -260,29 +315,29 @@ static bool compileASTRecurse(
         {
             // We will need min-1 duplicates of the current fragment to implement the
             // repitition logic
-            rfcommon::SmallVector<Fragment, 8> fragments;
+            ArenaVector<Fragment> fragments(nfa->arena);
             for (int n = 1; n < node->repitition.minreps; ++n)
-                fragments.push(duplicateFragment(f, matchers));
+                fragments.push(duplicateFragment(f, nfa));
 
             // Add repeat to fragment
             for (int a : f.out)
                 for (int b : f.in)
-                    matchers->at(a).next.push(b);
+                    nfa->next[a].push(b);
 
             // Wire up outputs among duplicates
             for (int n = 1; n < fragments.count(); ++n)
             {
                 for (int o : fragments[n].out)
                     for (int i : fragments[n-1].in)
-                        matchers->at(o).next.push(i);
+                        nfa->next[o].push(i);
             }
 
             if (fragments.count() > 0)
             {
                 for (int i : f.in)
                     for (int o : fragments[0].out)
-                        matchers->at(o).next.push(i);
-                f.in = std::move(fragments.back().in);
+                        nfa->next[o].push(i);
+                f.in.assign(fragments.back().in);
             }
         }
         else
@@ -312,22 +367,22 @@ static bool compileASTRecurse(
 
             // We will need max-1 duplicates of the current fragment to implement the
             // repitition logic
-            rfcommon::SmallVector<Fragment, 8> fragments;
+            ArenaVector<Fragment> fragments(nfa->arena);
             for (int n = 1; n != node->repitition.maxreps; ++n)
-                fragments.push(duplicateFragment(f, matchers));
+                fragments.push(duplicateFragment(f, nfa));
 
             // Wire up outputs among duplicates
             for (int n = 1; n != fragments.count(); ++n)
             {
                 for (int o : fragments[n].out)
                     for (int i : fragments[n-1].in)
-                        matchers->at(o).next.push(i);
+                        nfa->next[o].push(i);
             }
 
             // Wire up outputs to original fragment
             for (int o : fragments[0].out)
                 for (int i : f.in)
-                    matchers->at(o).next.push(i);
+                    nfa->next[o].push(i);
 
             // Wire up inputs to original fragment
             if (node->repitition.minreps > 1)
@@ -341,47 +396,46 @@ static bool compileASTRecurse(
     } break;
 
     case QueryASTNode::UNION: {
-        if (!compileASTRecurse(node->union_.child, labels, fighterID, error, matchers, mergeMotions, fstack, qstack)) return false;
-        if (!compileASTRecurse(node->union_.next, labels, fighterID, error, matchers, mergeMotions, fstack, qstack)) return false;
-        if (fstack->count() < 2)
+        if (!compileASTRecurse(node->union_.child, labels, fighterID, error, mergeMotions, nfa)) return false;
+        if (!compileASTRecurse(node->union_.next, labels, fighterID, error, mergeMotions, nfa)) return false;
+        if (nfa->fstack.count() < 2)
         {
             *error = "Incomplete union";
             return false;
         }
 
-        Fragment& f1 = fstack->back(1);
-        Fragment& f2 = fstack->back(2);
+        Fragment& f1 = nfa->fstack.back(1);
+        Fragment& f2 = nfa->fstack.back(2);
 
-        f2.in.push(std::move(f1.in));
-        f2.out.push(std::move(f1.out));
+        f2.in.push(f1.in);
+        f2.out.push(f1.out);
         f2.bridge = (f1.bridge || f2.bridge);
 
-        fstack->pop();
+        nfa->fstack.pop();
     } break;
 
     case QueryASTNode::INVERSION:
-        if (!compileASTRecurse(node->inversion.child, labels, fighterID, error, matchers, mergeMotions, fstack, qstack)) return false;
+        if (!compileASTRecurse(node->inversion.child, labels, fighterID, error, mergeMotions, nfa)) return false;
         break;
 
     case QueryASTNode::WILDCARD: {
-        fstack->push({{matchers->count()}, {matchers->count()}});
-        matchers->push(Matcher::wildCard(calcContextQualifierFlags(qstack)));
+        nfa->pushFragment(nfa->addMatcher(Matcher::wildCard(calcContextQualifierFlags(nfa->qstack))));
     } break;
 
     case QueryASTNode::LABEL: {
-        uint8_t ctxtQualFlags = calcContextQualifierFlags(qstack);
+        uint16_t ctxtQualFlags = calcContextQualifierFlags(nfa->qstack);
 
         // Assume label is a user label and maps to one or more motion
         // values
-        auto motions = labels->toMotions(fighterID, node->labels.label.cStr());
+        auto motions = labels->toMotions(fighterID, node->labels.label);
         if (motions.count() > 0)
         {
-            Fragment& fragment = fstack->emplace();
+            Fragment& fragment = nfa->pushFragment();
             for (const auto& motion : motions)
             {
-                fragment.in.push(matchers->count());
-                fragment.out.push(matchers->count());
-                matchers->push(Matcher::motion(motion, ctxtQualFlags));
+                const int matcherIdx = nfa->addMatcher(Matcher::motion(motion, ctxtQualFlags));
+                fragment.in.push(matcherIdx);
+                fragment.out.push(matcherIdx);
             }
 
             // If the user label maps to multiple motions a, b, c, then
@@ -390,7 +444,7 @@ static bool compileASTRecurse(
             {
                 for (int a = 1; a <= motions.count(); ++a)
                     for (int b = 1; b <= motions.count(); ++b)
-                        matchers->back(a).next.push(matchers->count() - b);
+                        nfa->next.back(a).push(nfa->matchers->count() - b);
             }
 
             // Store list of motions so they can be used to merge states in
@@ -401,20 +455,18 @@ static bool compileASTRecurse(
 
         // Assume label is actually a hash40 string and maps to a single motion
         // value
-        auto motion = labels->toMotion(node->labels.label.cStr());
+        auto motion = labels->toMotion(node->labels.label);
         if (motion.isValid())
         {
-            fstack->push({{matchers->count()}, {matchers->count()}});
-            matchers->push(Matcher::motion(motion, ctxtQualFlags));
+            nfa->pushFragment(nfa->addMatcher(Matcher::motion(motion, ctxtQualFlags)));
             break;
         }
 
         // Assume string is hex describing a hash40 motion value
-        motion = rfcommon::FighterMotion::fromHexString(node->labels.label.cStr());
+        motion = rfcommon::FighterMotion::fromHexString(node->labels.label);
         if (motion.isValid())
         {
-            fstack->push({{matchers->count()}, {matchers->count()}});
-            matchers->push(Matcher::motion(motion, ctxtQualFlags));
+            nfa->pushFragment(nfa->addMatcher(Matcher::motion(motion, ctxtQualFlags)));
             break;
         }
 
@@ -423,9 +475,22 @@ static bool compileASTRecurse(
     } break;
 
     case QueryASTNode::CONTEXT_QUALIFIER: {
-        qstack->push(node->contextQualifier.flags);
-        if (!compileASTRecurse(node->contextQualifier.child, labels, fighterID, error, matchers, mergeMotions, fstack, qstack)) return false;
-        qstack->pop();
+        // These qualifiers need information the states don't carry yet. Fail
+        // instead of silently matching everything
+        if (!!(node->contextQualifier.flags & QueryASTNode::IDJ))
+        {
+            *error = "The \"idj\" qualifier is not supported yet";
+            return false;
+        }
+        if (!!(node->contextQualifier.flags & QueryASTNode::OOS))
+        {
+            *error = "The \"oos\" qualifier is not supported yet";
+            return false;
+        }
+
+        nfa->qstack.push(node->contextQualifier.flags);
+        if (!compileASTRecurse(node->contextQualifier.child, labels, fighterID, error, mergeMotions, nfa)) return false;
+        nfa->qstack.pop();
     } break;
     }
 
@@ -433,38 +498,48 @@ static bool compileASTRecurse(
 }
 
 // ----------------------------------------------------------------------------
-Query* Query::compileAST(const QueryASTNode* ast, const rfcommon::MotionLabels* labels, rfcommon::FighterID fighterID, rfcommon::String* error)
+Query* Query::compileAST(const QueryASTNode* ast, const rfcommon::MotionLabels* labels, rfcommon::FighterID fighterID, rfcommon::String* error, Arena* arena)
 {
     std::unique_ptr<Query> query(new Query);
-    query->matchers_.push(Matcher::start());
+    NFABuilder nfa(arena, &query->matchers_);
+    nfa.addMatcher(Matcher::start());
 
-    rfcommon::SmallVector<Fragment, 16> fstack;  // "fragment stack"
-    rfcommon::SmallVector<uint8_t, 16> qstack;   // "qualifier stack"
-
-    if (!compileASTRecurse(ast, labels, fighterID, error, &query->matchers_, &query->mergeableLabels_, &fstack, &qstack))
+    if (!compileASTRecurse(ast, labels, fighterID, error, &query->mergeableLabels_, &nfa))
         return nullptr;
-    if (fstack.count() != 1)
+    if (nfa.fstack.count() != 1)
         return nullptr;
 
     // Patch in starting matcher, which is always at index 0
-    for (int i : fstack[0].in)
-        query->matchers_[0].next.push(i);
+    for (int i : nfa.fstack[0].in)
+        nfa.next[0].push(i);
 
     // Mark all matchers with dangling outgoing transitions with the accept condition
-    for (int i : fstack[0].out)
+    for (int i : nfa.fstack[0].out)
         query->matchers_[i].setAcceptCondition();
 
-    // Removes duplicate state transitions
-    for (Matcher& matcher : query->matchers_)
+    // Flatten the transitions of all matchers into a single array. Duplicate
+    // transitions are removed, keeping the first occurrence
+    const int matcherCount = query->matchers_.count();
+    int transitionCount = 0;
+    for (int i = 0; i != matcherCount; ++i)
+        transitionCount += nfa.next[i].count();
+
+    int* lastSeenFrom = arena->allocateArray<int>(matcherCount);
+    for (int i = 0; i != matcherCount; ++i)
+        lastSeenFrom[i] = -1;
+
+    query->transitions_.reserve(transitionCount);
+    for (int from = 0; from != matcherCount; ++from)
     {
-        try_again:
-        for (int a = 0; a != matcher.next.count(); ++a)
-            for (int b = a + 1; b < matcher.next.count(); ++b)
-                if (matcher.next[a] == matcher.next[b])
-                {
-                    matcher.next.erase(b);
-                    goto try_again;
-                }
+        Matcher& matcher = query->matchers_[from];
+        matcher.nextBegin_ = query->transitions_.count();
+        for (int to : nfa.next[from])
+            if (lastSeenFrom[to] != from)
+            {
+                lastSeenFrom[to] = from;
+                query->transitions_.push(to);
+            }
+        matcher.nextEnd_ = query->transitions_.count();
     }
 
     return query.release();
@@ -479,11 +554,17 @@ Query* Query::compileAST(const QueryASTNode* ast, const rfcommon::MotionLabels*
 //
 // This function expects "clist", "nlist" and "lastLists" to be arrays of size
 // "matchers_.count()". They don't have to be initialized.
+//
+// If "regionMask" is not 0, states outside of all of those regions can't be
+// matched by any matcher.
 static int runNFA(
     const States& states,
     const rfcommon::Vector<Matcher>& matchers,
+    const rfcommon::Vector<int>& transitions,
     const int startIdx,
     const int endIdx,
+    const RegionIndex* regions,
+    const uint32_t regionMask,
     int* clist,
     int* nlist,
     int* lastLists)
@@ -497,14 +578,26 @@ static int runNFA(
     int listid = 0;
     int clistLen = 0;
     int nlistLen = 0;
-    for (int i : matchers[0].next)
-        clist[clistLen++] = i;
+    for (int t = matchers[0].nextBegin(); t != matchers[0].nextEnd(); ++t)
+        clist[clistLen++] = transitions[t];
 
     // List IDs start at 0
     memset(lastLists, 0, sizeof(*lastLists) * matchers.count());
 
+    // One lookup per state instead of a geometry test per matcher
+    auto inRegion = [&states, regions, regionMask](int stateIdx) -> bool {
+        if (regionMask == 0)
+            return true;
+        const rfcommon::Vec2& pos = states[stateIdx].sideData.position;
+        return regions->contains(regionMask, pos.x(), pos.y());
+    };
+
     while (true)
     {
+        // No matcher can match a state outside of the regions
+        if (inRegion(stateIdx) == false)
+            return startIdx;
+
         // We use a running "list ID" to keep track of which matchers were
         // already visited. This avoids adding the same matcher to nlist
         // more than once
@@ -524,12 +617,15 @@ static int runNFA(
             // The current NFA node matched, which means we need to explore
             // all of its children. Only add child to nlist if we haven't
             // already, by checking the list ID.
-            for (int nextMatcherIdx : node.next)
+            for (int t = node.nextBegin(); t != node.nextEnd(); ++t)
+            {
+                const int nextMatcherIdx = transitions[t];
                 if (lastLists[nextMatcherIdx] != listid)
                 {
                     lastLists[nextMatcherIdx] = listid;
                     nlist[nlistLen++] = nextMatcherIdx;
                 }
+            }
 
             // We have run out of states to match
             if (stateIdx + 1 >= endIdx /*|| stateIdx >= startIdx + maxMatchLength*/)
@@ -545,8 +641,8 @@ static int runNFA(
             if (node.isAcceptCondition())
             {
                 // If there are still children that can match, continue
-                for (int nextMatcherIdx : node.next)
-                    if (matchers[nextMatcherIdx].matches(states[stateIdx + 1]))
+                for (int t = node.nextBegin(); t != node.nextEnd(); ++t)
+                    if (matchers[transitions[t]].matches(states[stateIdx + 1]) && inRegion(stateIdx + 1))
                         goto skip_return;
 
                 // Success, return the end of the matched range = last matched index + 1
@@ -569,6 +665,13 @@ static int runNFA(
     }
 }
 
+// ----------------------------------------------------------------------------
+void Query::setRegionConstraint(const RegionIndex* regions, uint32_t regionMask)
+{
+    regions_ = regions;
+    regionMask_ = regions ? regionMask : 0;
+}
+
 // ----------------------------------------------------------------------------
 #define STACKMEMSIZE 64
 Range Query::findFirst(const States& states, const Range& range) const
@@ -578,13 +681,13 @@ Range Query::findFirst(const States& states, const Range& range) const
 
     // Nothing to do
     /*
-    if (matchers_.count() == 0 || matchers_[0].next.count() == 0)
+    if (matchers_.count() == 0 || matchers_[0].nextBegin() == matchers_[0].nextEnd())
         return Range(0, 0);*/
 
     // Go through each state and try to run the NFA on it
     for (int startIdx = range.startIdx; startIdx < range.endIdx; ++startIdx)
     {
-        const int endIdx = runNFA(states, matchers_, startIdx, range.endIdx, listmem, listmem + matchers_.count(), listmem + matchers_.count() * 2);
+        const int endIdx = runNFA(states, matchers_, transitions_, startIdx, range.endIdx, regions_, regionMask_, listmem, listmem + matchers_.count(), listmem + matchers_.count() * 2);
         if (endIdx > startIdx)
         {
             if (matchers_.count() > STACKMEMSIZE)
@@ -603,22 +706,50 @@ Range Query::findFirst(const States& states, const Range& range) const
 rfcommon::Vector<Range> Query::findAll(const States& states, const Range& range) const
 {
     rfcommon::Vector<Range> result;
+    int startIdx = range.startIdx;
+    continueFindAll(states, range, &startIdx, range.endIdx, &result);
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+rfcommon::Vector<Range> Query::findAllOverlapping(
+        const Query* otherQuery,
+        const States& states, const Range& range,
+        const States& otherStates, const Range& otherRange) const
+{
+    rfcommon::Vector<Range> result;
+    int startIdx = range.startIdx;
+    int otherStartIdx = otherRange.startIdx;
+    continueFindAllOverlapping(otherQuery, states, range, otherStates, otherRange, &startIdx, &otherStartIdx, range.endIdx, &result);
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+void Query::continueFindAll(
+        const States& states, const Range& range,
+        int* startIdxInOut, int stopIdx,
+        rfcommon::Vector<Range>* result) const
+{
     int liststackmem[STACKMEMSIZE * 3];
     int* listmem = matchers_.count() > STACKMEMSIZE ? (int*)malloc(sizeof(int) * matchers_.count()) : liststackmem;
 
     // Nothing to do
     /*
-    if (matchers_.count() == 0 || matchers_[0].next.count() == 0)
-        return result;*/
+    if (matchers_.count() == 0 || matchers_[0].nextBegin() == matchers_[0].nextEnd())
+        return;*/
+
+    if (stopIdx > range.endIdx)
+        stopIdx = range.endIdx;
 
     // We search the sequence of states rather than the graph, because we are
     // interested in matching sequences of decisions
-    for (int startIdx = range.startIdx; startIdx < range.endIdx; ++startIdx)
+    int startIdx = *startIdxInOut;
+    for (; startIdx < stopIdx; ++startIdx)
     {
-        const int endIdx = runNFA(states, matchers_, startIdx, range.endIdx, listmem, listmem + matchers_.count(), listmem + matchers_.count() * 2);
+        const int endIdx = runNFA(states, matchers_, transitions_, startIdx, range.endIdx, regions_, regionMask_, listmem, listmem + matchers_.count(), listmem + matchers_.count() * 2);
         if (endIdx > startIdx)
         {
-            result.emplace(startIdx, endIdx);
+            result->emplace(startIdx, endIdx);
             startIdx = endIdx - 1;
         }
     }
@@ -626,29 +757,34 @@ rfcommon::Vector<Range> Query::findAll(const States& states, const Range& range)
     if (matchers_.count() > STACKMEMSIZE)
         free(listmem);
 
-    return result;
+    *startIdxInOut = startIdx;
 }
 
 // ----------------------------------------------------------------------------
-rfcommon::Vector<Range> Query::findAllOverlapping(
+void Query::continueFindAllOverlapping(
         const Query* otherQuery,
         const States& states, const Range& range,
-        const States& otherStates, const Range& otherRange) const
+        const States& otherStates, const Range& otherRange,
+        int* startIdxInOut, int* otherStartIdxInOut, int stopIdx,
+        rfcommon::Vector<Range>* result) const
 {
     using rfcommon::FrameIndex;
 
-    rfcommon::Vector<Range> result;
     int liststackmem[STACKMEMSIZE * 3];
     int* listmem = matchers_.count() > STACKMEMSIZE ? (int*)malloc(sizeof(int) * matchers_.count()) : liststackmem;
 
-    int otherStartIdx = otherRange.startIdx;
+    if (stopIdx > range.endIdx)
+        stopIdx = range.endIdx;
 
-    for (int startIdx = range.startIdx; startIdx < range.endIdx; ++startIdx)
+    int startIdx = *startIdxInOut;
+    int otherStartIdx = *otherStartIdxInOut;
+    for (; startIdx < stopIdx; ++startIdx)
     {
         // Run first search
         int endIdx = runNFA(
-            states, matchers_,
+            states, matchers_, transitions_,
             startIdx, range.endIdx,
+            regions_, regionMask_,
             listmem, listmem + matchers_.count(), listmem + matchers_.count() * 2
         );
         if (endIdx == startIdx)
@@ -664,8 +800,9 @@ rfcommon::Vector<Range> Query::findAllOverlapping(
 
             // Run second search
             const int otherEndIdx = runNFA(
-                otherStates, otherQuery->matchers_,
+                otherStates, otherQuery->matchers_, otherQuery->transitions_,
                 otherStartIdx, otherRange.endIdx,
+                otherQuery->regions_, otherQuery->regionMask_,
                 listmem, listmem + otherQuery->matchers_.count(), listmem + otherQuery->matchers_.count() * 2
             );
             if (otherEndIdx == otherStartIdx)
@@ -725,7 +862,7 @@ rfcommon::Vector<Range> Query::findAllOverlapping(
             }
 
             assert(endIdx <= states.count());
-            result.emplace(startIdx, endIdx);
+            result->emplace(startIdx, endIdx);
             startIdx = endIdx - 1;
         }
     }
@@ -733,14 +870,15 @@ rfcommon::Vector<Range> Query::findAllOverlapping(
     if (matchers_.count() > STACKMEMSIZE)
         free(listmem);
 
-    return result;
+    *startIdxInOut = startIdx;
+    *otherStartIdxInOut = otherStartIdx;
 }
 
 // ----------------------------------------------------------------------------
-void Query::exportDOT(const char* filename, const rfcommon::MotionLabels* labels, rfcommon::FighterID fighterID)
+rfcommon::String Query::toDOT(const rfcommon::MotionLabels* labels, rfcommon::FighterID fighterID) const
 {
-    FILE* fp = fopen(filename, "w");
-    fprintf(fp, "digraph query {\n");
+    rfcommon::String out;
+    StrAppendf(&out, "digraph query {\n");
 
     auto toHash40OrHex = [labels](rfcommon::FighterMotion motion) -> rfcommon::String {
         if (const char* h40 = labels->toHash40(motion))
@@ -755,23 +893,29 @@ void Query::exportDOT(const char* filename, const rfcommon::MotionLabels* labels
                 matchers_[i].isWildcard() ? "." :
                 toHash40OrHex(matchers_[i].motion_);
         const char* color = matchers_[i].isAcceptCondition() ? "red" : "black";
-        fprintf(fp, "m%d [shape=\"record\",color=\"%s\",label=\"%s", i, color, label.cStr());
+        StrAppendf(&out, "m%d [shape=\"record\",color=\"%s\",label=\"%s", i, color, label.cStr());
 
         if (matchers_[i].inContext(Matcher::HIT))
-            fprintf(fp, " | HIT");
+            StrAppendf(&out, " | HIT");
         if (matchers_[i].inContext(Matcher::WHIFF))
-            fprintf(fp, " | WHIFF");
+            StrAppendf(&out, " | WHIFF");
         if (matchers_[i].inContext(Matcher::SHIELD))
-            fprintf(fp, " | OS");
-        fprintf(fp, "\"];\n");
+            StrAppendf(&out, " | OS");
+        if (matchers_[i].inContext(Matcher::RISING))
+            StrAppendf(&out, " | RISING");
+        if (matchers_[i].inContext(Matcher::FALLING))
+            StrAppendf(&out, " | FALLING");
+        if (matchers_[i].inContext(Matcher::GROUNDED))
+            StrAppendf(&out, " | GROUNDED");
+        StrAppendf(&out, "\"];\n");
     }
 
     for (int i = 0; i != matchers_.count(); ++i)
     {
-        for (int e : matchers_[i].next)
-            fprintf(fp, "m%d -> m%d;\n", i, e);
+        for (int t = matchers_[i].nextBegin(); t != matchers_[i].nextEnd(); ++t)
+            StrAppendf(&out, "m%d -> m%d;\n", i, transitions_[t]);
     }
 
-    fprintf(fp, "}\n");
-    fclose(fp);
+    StrAppendf(&out, "}\n");
+    return out;
 }
@@ -0,0 +1,157 @@
+#include "decision-graph/models/QueryApplyScheduler.hpp"
+#include "decision-graph/models/FrameScheduler.hpp"
+
+// ----------------------------------------------------------------------------
+QueryApplyScheduler::QueryApplyScheduler(SequenceSearchModel* model, int idleIntervalMs)
+    : model_(model)
+{
+    // Jobs run one at a time. A cancelled job stops at the next session
+    // boundary, so the job replacing it doesn't wait long
+    threadPool_.setMaxThreadCount(1);
+
+    idleTimer_.setSingleShot(true);
+    idleTimer_.setInterval(idleIntervalMs);
+    connect(&idleTimer_, &QTimer::timeout, this, &QueryApplyScheduler::startNextJob);
+}
+
+// ----------------------------------------------------------------------------
+QueryApplyScheduler::~QueryApplyScheduler()
+{
+    cancelAll();
+    threadPool_.waitForDone();
+}
+
+// ----------------------------------------------------------------------------
+void QueryApplyScheduler::schedule(int queryIdx)
+{
+    // During live games every query is matched again in time slices as frames
+    // come in, which already picks up the edit. A job started now would only
+    // be discarded on the next frame
+    if (model_->frameScheduler()->isRealtime())
+    {
+        if (runningJob_ && runningJob_->queryIdx == queryIdx)
+            runningJob_->cancelled = true;
+        return;
+    }
+
+    if (pendingQueries_.findFirst(queryIdx) == pendingQueries_.end())
+        pendingQueries_.push(queryIdx);
+
+    // The query was edited again, so whatever is being matched is out of date
+    if (runningJob_ && runningJob_->queryIdx == queryIdx)
+        runningJob_->cancelled = true;
+
+    idleTimer_.start();
+}
+
+// ----------------------------------------------------------------------------
+void QueryApplyScheduler::removeQuery(int queryIdx)
+{
+    for (int i = 0; i != pendingQueries_.count(); )
+    {
+        if (pendingQueries_[i] == queryIdx)
+        {
+            pendingQueries_.erase(i);
+            continue;
+        }
+        if (pendingQueries_[i] > queryIdx)
+            pendingQueries_[i]--;
+        i++;
+    }
+
+    // The running job refers to the query by its old index, so it can't
+    // publish anything. If its query is still around, match it again under
+    // the new index
+    if (runningJob_ && runningJob_->queryIdx >= queryIdx)
+    {
+        const int newIdx = runningJob_->queryIdx - 1;
+        if (runningJob_->queryIdx > queryIdx && pendingQueries_.findFirst(newIdx) == pendingQueries_.end())
+            pendingQueries_.push(newIdx);
+        runningJob_->cancelled = true;
+    }
+
+    if (pendingQueries_.count() > 0)
+        idleTimer_.start();
+}
+
+// ----------------------------------------------------------------------------
+void QueryApplyScheduler::cancelAll()
+{
+    idleTimer_.stop();
+    pendingQueries_.clear();
+    threadPool_.clear();
+    if (runningJob_)
+        runningJob_->cancelled = true;
+    runningJob_.reset();
+    anyApplied_ = false;
+}
+
+// ----------------------------------------------------------------------------
+void QueryApplyScheduler::startNextJob()
+{
+    // Only one job is in flight at a time. The rest start when it finishes
+    if (runningJob_ && runningJob_->cancelled == false)
+        return;
+
+    runningJob_.reset();
+
+    // A live game started while the timer was running. See schedule()
+    if (model_->frameScheduler()->isRealtime())
+        pendingQueries_.clear();
+
+    while (pendingQueries_.count() > 0)
+    {
+        const int queryIdx = pendingQueries_[0];
+        pendingQueries_.erase(0);
+
+        // Queries that didn't compile keep their previous results
+        runningJob_ = model_->prepareApply(queryIdx);
+        if (runningJob_)
+            break;
+    }
+
+    if (runningJob_ == nullptr)
+    {
+        if (anyApplied_)
+            model_->notifyQueriesApplied();
+        anyApplied_ = false;
+        return;
+    }
+
+    std::shared_ptr<SequenceSearchModel::ApplyJob> job = runningJob_;
+    threadPool_.start([this, job] {
+        model_->runApply(job.get());
+        QMetaObject::invokeMethod(this, [this, job] {
+            onJobFinished(job);
+        }, Qt::QueuedConnection);
+    });
+}
+
+// ----------------------------------------------------------------------------
+void QueryApplyScheduler::onJobFinished(const std::shared_ptr<SequenceSearchModel::ApplyJob>& job)
+{
+    // Superseded jobs don't get to publish anything. finishApply() also
+    // rejects jobs whose data changed while they were running
+    if (job != runningJob_)
+        return;
+
+    runningJob_.reset();
+    if (model_->finishApply(job.get()))
+        anyApplied_ = true;
+    else if (job->cancelled.load(std::memory_order_relaxed) == false &&
+             model_->frameScheduler()->isRealtime() == false)
+    {
+        // Rejected because something else changed while the job was running,
+        // e.g. another query was edited or failed to compile. This query's
+        // results are still outdated. Wait for the data to settle instead of
+        // retrying right away. During live games there is nothing to retry,
+        // see schedule()
+        if (pendingQueries_.findFirst(job->queryIdx) == pendingQueries_.end())
+            pendingQueries_.push(job->queryIdx);
+        idleTimer_.start();
+        return;
+    }
+
+    if (idleTimer_.isActive() == false)
+        startNextJob();
+}
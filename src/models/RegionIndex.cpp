@@ -0,0 +1,104 @@
+#include "decision-graph/models/RegionIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// ----------------------------------------------------------------------------
+RegionIndex::RegionIndex(float left, float right, float bottom, float top, float cellSize)
+    : left_(left)
+    , bottom_(bottom)
+    , cellSize_(cellSize)
+    , invCellSize_(1.0f / cellSize)
+    , cellsX_(static_cast<int>(std::ceil((right - left) / cellSize)))
+    , cellsY_(static_cast<int>(std::ceil((top - bottom) / cellSize)))
+{
+    inside_.resize(cellsX_ * cellsY_);
+    edge_.resize(cellsX_ * cellsY_);
+    clear();
+}
+
+// ----------------------------------------------------------------------------
+RegionIndex::~RegionIndex()
+{}
+
+// ----------------------------------------------------------------------------
+void RegionIndex::clear()
+{
+    std::fill(inside_.begin(), inside_.end(), 0);
+    std::fill(edge_.begin(), edge_.end(), 0);
+    for (QRectF& area : areas_)
+        area = QRectF();
+    usedMask_ = 0;
+}
+
+// ----------------------------------------------------------------------------
+void RegionIndex::setRegion(int regionIdx, const QRectF& area)
+{
+    if (hasRegion(regionIdx))
+        rasterize(regionIdx, areas_[regionIdx], false);
+
+    areas_[regionIdx] = area.normalized();
+    usedMask_ |= 1u << regionIdx;
+    rasterize(regionIdx, areas_[regionIdx], true);
+}
+
+// ----------------------------------------------------------------------------
+void RegionIndex::removeRegion(int regionIdx)
+{
+    if (hasRegion(regionIdx) == false)
+        return;
+
+    rasterize(regionIdx, areas_[regionIdx], false);
+    areas_[regionIdx] = QRectF();
+    usedMask_ &= ~(1u << regionIdx);
+}
+
+// ----------------------------------------------------------------------------
+void RegionIndex::rasterize(int regionIdx, const QRectF& area, bool set)
+{
+    const uint32_t bit = 1u << regionIdx;
+
+    // Range of cells touched by the area, clamped to the grid
+    const int x1 = std::max(static_cast<int>(std::floor((area.left() - left_) * invCellSize_)), 0);
+    const int y1 = std::max(static_cast<int>(std::floor((area.top() - bottom_) * invCellSize_)), 0);
+    const int x2 = std::min(static_cast<int>(std::floor((area.right() - left_) * invCellSize_)), cellsX_ - 1);
+    const int y2 = std::min(static_cast<int>(std::floor((area.bottom() - bottom_) * invCellSize_)), cellsY_ - 1);
+
+    for (int y = y1; y <= y2; ++y)
+        for (int x = x1; x <= x2; ++x)
+        {
+            const int cell = y * cellsX_ + x;
+            if (set == false)
+            {
+                inside_[cell] &= ~bit;
+                edge_[cell] &= ~bit;
+                continue;
+            }
+
+            const float cellLeft = left_ + x * cellSize_;
+            const float cellBottom = bottom_ + y * cellSize_;
+            const bool covered =
+                    cellLeft >= area.left() && cellLeft + cellSize_ <= area.right() &&
+                    cellBottom >= area.top() && cellBottom + cellSize_ <= area.bottom();
+            if (covered)
+                inside_[cell] |= bit;
+            else
+                edge_[cell] |= bit;
+        }
+}
+
+// ----------------------------------------------------------------------------
+uint32_t RegionIndex::testAreas(float x, float y, uint32_t regionMask) const
+{
+    uint32_t result = 0;
+    for (int i = 0; regionMask; ++i, regionMask >>= 1)
+    {
+        if ((regionMask & 1) == 0)
+            continue;
+
+        const QRectF& a = areas_[i];
+        if (x >= a.left() && x <= a.right() && y >= a.top() && y <= a.bottom())
+            result |= 1u << i;
+    }
+    return result;
+}
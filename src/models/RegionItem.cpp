@@ -1,7 +1,9 @@
 #include "decision-graph/models/RegionItem.hpp"
+#include "decision-graph/models/RegionScene.hpp"
 
 // ----------------------------------------------------------------------------
-RegionItem::RegionItem()
+RegionItem::RegionItem(int regionIdx)
+    : regionIdx_(regionIdx)
 {
     setAcceptHoverEvents(true);
     setFlags(flags()
@@ -14,3 +16,33 @@ RegionItem::RegionItem()
 // ----------------------------------------------------------------------------
 RegionItem::~RegionItem()
 {}
+
+// ----------------------------------------------------------------------------
+QRectF RegionItem::stageArea() const
+{
+    const QRectF r = mapRectToScene(rect());
+    return QRectF(r.left(), -r.bottom(), r.width(), r.height());
+}
+
+// ----------------------------------------------------------------------------
+QVariant RegionItem::itemChange(GraphicsItemChange change, const QVariant& value)
+{
+    // Keeping the index up to date while dragging is cheap, because only
+    // the cells covered by this region are updated
+    if (change == ItemPositionHasChanged)
+        if (RegionScene* regionScene = static_cast<RegionScene*>(scene()))
+            regionScene->onRegionMoved(this);
+
+    return QGraphicsRectItem::itemChange(change, value);
+}
+
+// ----------------------------------------------------------------------------
+void RegionItem::mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
+{
+    QGraphicsRectItem::mouseReleaseEvent(event);
+
+    // Re-applying queries is expensive, so only do it once the user is done
+    // moving the region
+    if (RegionScene* regionScene = static_cast<RegionScene*>(scene()))
+        regionScene->onRegionEdited(this);
+}
@@ -1,7 +1,74 @@
+#include "decision-graph/listeners/RegionSceneListener.hpp"
+#include "decision-graph/models/RegionItem.hpp"
 #include "decision-graph/models/RegionScene.hpp"
+#include "decision-graph/models/SequenceSearchModel.hpp"
 
-RegionScene::RegionScene()
+#include <QBrush>
+#include <QColor>
+
+// ----------------------------------------------------------------------------
+RegionScene::RegionScene(SequenceSearchModel* model)
+    : model_(model)
 {}
 
+// ----------------------------------------------------------------------------
 RegionScene::~RegionScene()
 {}
+
+// ----------------------------------------------------------------------------
+RegionItem* RegionScene::addRegion(const QRectF& stageArea)
+{
+    int regionIdx = 0;
+    while (regionIdx != RegionIndex::MAX_REGIONS && items_[regionIdx] != nullptr)
+        regionIdx++;
+    if (regionIdx == RegionIndex::MAX_REGIONS)
+        return nullptr;
+
+    RegionItem* item = new RegionItem(regionIdx);
+    item->setRect(stageArea.left(), -stageArea.bottom(), stageArea.width(), stageArea.height());
+    item->setBrush(QColor(0, 120, 215, 60));
+    items_[regionIdx] = item;
+    addItem(item);
+
+    model_->setRegion(regionIdx, item->stageArea());
+    dispatcher.dispatch(&RegionSceneListener::onRegionAdded, regionIdx);
+    return item;
+}
+
+// ----------------------------------------------------------------------------
+void RegionScene::removeRegion(RegionItem* item)
+{
+    const int regionIdx = item->regionIdx();
+    items_[regionIdx] = nullptr;
+    removeItem(item);
+    delete item;
+
+    // Removing the region also removes it from the queries' constraints, so
+    // remember which queries have to be re-applied beforehand
+    rfcommon::SmallVector<int, 8> affectedQueries;
+    for (int queryIdx = 0; queryIdx != model_->queryCount(); ++queryIdx)
+        if (model_->queryRegions(queryIdx) & (1u << regionIdx))
+            affectedQueries.push(queryIdx);
+
+    model_->removeRegion(regionIdx);
+
+    bool applied = false;
+    for (int queryIdx : affectedQueries)
+        applied |= model_->applyQuery(queryIdx);
+    if (applied)
+        model_->notifyQueriesApplied();
+    dispatcher.dispatch(&RegionSceneListener::onRegionRemoved, regionIdx);
+}
+
+// ----------------------------------------------------------------------------
+void RegionScene::onRegionMoved(RegionItem* item)
+{
+    model_->setRegion(item->regionIdx(), item->stageArea());
+}
+
+// ----------------------------------------------------------------------------
+void RegionScene::onRegionEdited(RegionItem* item)
+{
+    if (model_->applyQueriesUsingRegion(item->regionIdx()))
+        model_->notifyQueriesApplied();
+}
@@ -1,22 +1,50 @@
 #include "decision-graph/listeners/SequenceSearchListener.hpp"
+#include "decision-graph/models/AnalysisCache.hpp"
+#include "decision-graph/models/Diagnostics.hpp"
+#include "decision-graph/models/FrameScheduler.hpp"
 #include "decision-graph/parsers/QueryASTNode.hpp"
 #include "decision-graph/models/Query.hpp"
 #include "decision-graph/models/SequenceSearchModel.hpp"
+#include "decision-graph/models/StageGeometry.hpp"
+#include "decision-graph/models/StateCache.hpp"
 
 #include "rfcommon/FighterState.hpp"
 #include "rfcommon/FrameData.hpp"
 #include "rfcommon/GameMetadata.hpp"
+#include "rfcommon/HighresTimer.hpp"
 #include "rfcommon/MappingInfo.hpp"
 #include "rfcommon/MotionLabels.hpp"
 #include "rfcommon/ReplayFilename.hpp"
 
 #include <cstdio>
 
+// How many states continueApplyAllQueries() matches between checking the
+// time budget
+static const int SLICE_STATES = 1024;
+
 // ----------------------------------------------------------------------------
-SequenceSearchModel::SequenceSearchModel(const rfcommon::MotionLabels* labels)
+SequenceSearchModel::SequenceSearchModel(const rfcommon::MotionLabels* labels, Diagnostics* diagnostics)
     : labels_(labels)
+    , diagnostics_(diagnostics)
+    , analysis_(new AnalysisCache(this, labels))
+    , frameScheduler_(new FrameScheduler(diagnostics->metrics()))
     , previousFighterID_(rfcommon::FighterID::makeInvalid())
     , previousOpponentID_(rfcommon::FighterID::makeInvalid())
+{
+    PipelineMetrics* metrics = diagnostics_->metrics();
+    timings_.parse = metrics->histogram("query.parse");
+    timings_.compile = metrics->histogram("query.compile");
+    timings_.nfaSize = metrics->histogram("query.nfa_size", PipelineHistogram::COUNT);
+    timings_.apply = metrics->histogram("query.apply");
+    timings_.applyAsync = metrics->histogram("query.apply_async");
+    timings_.applySlice = metrics->histogram("query.apply_slice");
+    timings_.applyDiscarded = metrics->counter("query.apply_discarded");
+    timings_.matchSession = metrics->histogram("match.session");
+    timings_.merge = metrics->histogram("match.merge");
+}
+
+// ----------------------------------------------------------------------------
+SequenceSearchModel::~SequenceSearchModel()
 {}
 
 // ----------------------------------------------------------------------------
@@ -38,6 +66,58 @@ void SequenceSearchModel::startNewSession(const rfcommon::MappingInfo* map, cons
         return mdata->playerTag(fighterIdx);
     };
 
+    rfcommon::SmallVector<SessionFighter, 8> fighters;
+    for (int i = 0; i != mdata->fighterCount(); ++i)
+        fighters.push({
+            mdata->playerFighterID(i),
+            getPlayerName(mdata, i),
+            map->fighter.toName(mdata->playerFighterID(i))
+        });
+
+    beginSession(
+        mdata->timeStarted(),
+        rfcommon::ReplayFilename::fromMetadata(map, mdata),
+        map->stage.toName(mdata->stageID()),
+        fighters);
+}
+
+// ----------------------------------------------------------------------------
+void SequenceSearchModel::addCachedSession(const StateCache& cache)
+{
+    rfcommon::SmallVector<SessionFighter, 8> fighters;
+    for (int i = 0; i != cache.fighterCount(); ++i)
+    {
+        const States& states = cache.fighterStates(i);
+        fighters.push({states.fighterID, states.playerName, states.fighterName});
+    }
+
+    beginSession(
+        rfcommon::TimeStamp::fromMillisSinceEpoch(cache.timeStarted()),
+        cache.sessionName(),
+        cache.stageName().cStr(),
+        fighters);
+
+    // States were already classified when the cache was written
+    for (int i = 0; i != cache.fighterCount(); ++i)
+    {
+        const int fighterIdx = fighterIdxMapFromSession_[i];
+        States& states = mutableFighterStates(fighterIdx);
+        for (const State& state : cache.fighterStates(i))
+            states.push(state);
+        sessions_.back().fighterStatesRange[fighterIdx].endIdx = states.count();
+    }
+}
+
+// ----------------------------------------------------------------------------
+void SequenceSearchModel::beginSession(
+        const rfcommon::TimeStamp& timeStarted,
+        const rfcommon::String& sessionName,
+        const char* stageName,
+        const rfcommon::SmallVector<SessionFighter, 8>& fighters)
+{
+    analysis_->invalidate();
+    ++applyGeneration_;
+
     // It's possible that the players switch fighters between games,
     // especially when multiple sessions from different days are
     // accumulated. For this we set up a mapping table that maps the
@@ -48,12 +128,12 @@ void SequenceSearchModel::startNewSession(const rfcommon::MappingInfo* map, cons
     // two different players when they play the same character, and it
     // doesn't make sense to clump together frame data from the same player
     // when he plays different characters.
-    fighterIdxMapFromSession_.resize(mdata->fighterCount());
-    for (int i = 0; i != mdata->fighterCount(); ++i)
+    fighterIdxMapFromSession_.resize(fighters.count());
+    for (int i = 0; i != fighters.count(); ++i)
     {
         for (int j = 0; j != fighterStates_.count(); ++j)
-            if (fighterStates_[j].fighterID == mdata->playerFighterID(i) &&
-                fighterStates_[j].playerName == getPlayerName(mdata, i))
+            if (fighterStates_[j]->fighterID == fighters[i].fighterID &&
+                fighterStates_[j]->playerName == fighters[i].playerName)
             {
                 fighterIdxMapFromSession_[i] = j;
                 goto skip_add;
@@ -61,11 +141,11 @@ void SequenceSearchModel::startNewSession(const rfcommon::MappingInfo* map, cons
 
         // Create new fighter entry with ID and name
         fighterIdxMapFromSession_[i] = fighterStates_.count();
-        fighterStates_.emplace(
-            mdata->playerFighterID(i),
-            getPlayerName(mdata, i),
-            map->fighter.toName(mdata->playerFighterID(i))
-        );
+        fighterStates_.push(std::make_shared<States>(
+            fighters[i].fighterID,
+            fighters[i].playerName,
+            fighters[i].fighterName
+        ));
 
         // We need to make sure that for the existing sessions, we insert
         // empty ranges so the vectors always have the same size as each other.
@@ -77,16 +157,18 @@ void SequenceSearchModel::startNewSession(const rfcommon::MappingInfo* map, cons
 
     // Create session
     auto sessionData = sessions_.push({
-        mdata->timeStarted(),
+        timeStarted,
         rfcommon::Vector<Range>::makeReserved(fighterStates_.count()),
-        rfcommon::ReplayFilename::fromMetadata(map, mdata)
+        sessionName,
+        stageName,
+        stageLibrary_.find(stageName)
     });
 
     // For new sessions, point the session ranges to the end of each
     // sequence
     for (int i = 0; i != fighterStates_.count(); ++i)
     {
-        const int endIdx = fighterStates_[i].count();
+        const int endIdx = fighterStates_[i]->count();
         sessionData->fighterStatesRange.emplace(endIdx, endIdx);
     }
 
@@ -102,9 +184,9 @@ void SequenceSearchModel::startNewSession(const rfcommon::MappingInfo* map, cons
     // fighter. This is a small QoL that helps with scanning through replays.
     if (playerPOV_ >= 0 && playerPOV_ < fighterStates_.count())
     {
-        for (int i = 0; i != mdata->fighterCount(); ++i)
-            if (fighterStates_[playerPOV_].fighterID == mdata->playerFighterID(i) &&
-                fighterStates_[playerPOV_].playerName == getPlayerName(mdata, i))
+        for (int i = 0; i != fighters.count(); ++i)
+            if (fighterStates_[playerPOV_]->fighterID == fighters[i].fighterID &&
+                fighterStates_[playerPOV_]->playerName == fighters[i].playerName)
             {
                 playerPOV_ = fighterIdxMapFromSession_[i];
                 break;
@@ -112,9 +194,9 @@ void SequenceSearchModel::startNewSession(const rfcommon::MappingInfo* map, cons
     }
     if (playerPOV_ < 0 || playerPOV_ >= fighterStates_.count())
     {
-        for (int i = 0; i != mdata->fighterCount(); ++i)
-            if (previousFighterID_ == mdata->playerFighterID(i) &&
-                previousPlayerName_ == getPlayerName(mdata, i))
+        for (int i = 0; i != fighters.count(); ++i)
+            if (previousFighterID_ == fighters[i].fighterID &&
+                previousPlayerName_ == fighters[i].playerName)
             {
                 playerPOV_ = fighterIdxMapFromSession_[i];
                 break;
@@ -147,19 +229,35 @@ const char* SequenceSearchModel::sessionName(int sessionIdx) const
     return sessions_[sessionIdx].sessionName.cStr();
 }
 
+// ----------------------------------------------------------------------------
+const char* SequenceSearchModel::sessionStageName(int sessionIdx) const
+{
+    return sessions_[sessionIdx].stageName.cStr();
+}
+
+// ----------------------------------------------------------------------------
+const rfcommon::TimeStamp& SequenceSearchModel::sessionTimeStarted(int sessionIdx) const
+{
+    return sessions_[sessionIdx].timeStarted;
+}
+
 // ----------------------------------------------------------------------------
 void SequenceSearchModel::clearAllAndNotify()
 {
+    analysis_->invalidate();
+    ++applyGeneration_;
     sessions_.clearCompact();
     fighterStates_.clearCompact();
     fighterIdxMapFromSession_.clearCompact();
     playerPOV_ = -1;
     opponentPOV_ = -1;
+    sequenceTrie_.clear();
 
     for (int i = 0; i != queryCount(); ++i)
     {
         queryResults_[i].matches.clearCompact();
         queryResults_[i].mergedMatches.clearCompact();
+        queryResults_[i].mergedMatchSequenceIDs.clearCompact();
         queryResults_[i].sessionMatches.clearCompact();
         queryResults_[i].sessionMergedMatches.clearCompact();
     }
@@ -170,6 +268,13 @@ void SequenceSearchModel::clearAllAndNotify()
 // ----------------------------------------------------------------------------
 void SequenceSearchModel::addFrame(int frameIdx, const rfcommon::FrameData* fdata)
 {
+    // New frames only extend the last session, so a sliced apply that is
+    // in progress can continue
+    const bool slicedApplyValid = slicedApply_.generation == applyGeneration_;
+    ++applyGeneration_;
+    if (slicedApplyValid)
+        slicedApply_.generation = applyGeneration_;
+
     for (int sessionFighterIdx = 0; sessionFighterIdx != fdata->fighterCount(); ++sessionFighterIdx)
     {
         const auto& fighterState = fdata->stateAt(sessionFighterIdx, frameIdx);
@@ -214,7 +319,7 @@ void SequenceSearchModel::addFrame(int frameIdx, const rfcommon::FrameData* fdat
         // Only add state if it is meaningfully different from the previously
         // added state
         const int fighterIdx = fighterIdxMapFromSession_[sessionFighterIdx];
-        States& states = fighterStates_[fighterIdx];
+        States& states = mutableFighterStates(fighterIdx);
         if (states.count() > 0 &&
                 fighterState.motion() == states.back().motion &&
                 fighterState.status() == states.back().status)
@@ -222,7 +327,7 @@ void SequenceSearchModel::addFrame(int frameIdx, const rfcommon::FrameData* fdat
             // It's possible that a move starts before it hits a shield/hits
             // an opponent. If this happens, we update the already added state
             // to include this flag
-            states.back().flags |= State::makeFlags(inHitlag, false, inShieldlag, opponentInHitlag, false, opponentInShieldlag);
+            states.back().addInteractionFlags(State::makeFlags(inHitlag, false, inShieldlag, opponentInHitlag, false, opponentInShieldlag));
             continue;
         }
 
@@ -239,6 +344,22 @@ void SequenceSearchModel::addFrame(int frameIdx, const rfcommon::FrameData* fdat
             opponentInHitlag, opponentInHitstun, opponentInShieldlag
         ));
 
+        // Classifying the position once here means stage-aware queries and
+        // visualizations only need to test a bit later. Without stage
+        // geometry, a fighter that is neither rising nor falling is assumed
+        // to be on the ground
+        State& state = states.back();
+        bool isGrounded = !isRising && !isFalling;
+        if (const StageGeometry* stage = sessions_.back().stage)
+        {
+            state.setStageFlags(stage->classify(fighterState.pos().x(), fighterState.pos().y()));
+            isGrounded = !!(state.stageFlags() & (StageGeometry::GROUNDED | StageGeometry::PLATFORM));
+        }
+
+        // Kinematic qualifiers describe the first frame of the state, e.g.
+        // "rising nair" means the nair was started while rising
+        state.flags |= State::makeKinematicFlags(isRising, isFalling, isGrounded);
+
         // Update sequence ranges for current session
         Range& sessionFighterSeq = sessions_.back().fighterStatesRange[fighterIdx];
         sessionFighterSeq.endIdx = states.count();
@@ -261,26 +382,38 @@ void SequenceSearchModel::notifyFramesAdded()
 // ----------------------------------------------------------------------------
 void SequenceSearchModel::setPlayerPOV(int fighterIdx)
 {
+    analysis_->invalidate();
+    ++applyGeneration_;
     playerPOV_ = fighterIdx;
-    previousFighterID_ = fighterStates_[fighterIdx].fighterID;
-    previousPlayerName_ = fighterStates_[fighterIdx].playerName;
+
+    // Interned sequences refer to the previous player's states
+    sequenceTrie_.clear();
+    for (int i = 0; i != queryCount(); ++i)
+        queryResults_[i].mergedMatchSequenceIDs.clear();
+
+    previousFighterID_ = fighterStates_[fighterIdx]->fighterID;
+    previousPlayerName_ = fighterStates_[fighterIdx]->playerName;
     dispatcher.dispatch(&SequenceSearchListener::onPOVChanged);
 }
 
 // ----------------------------------------------------------------------------
 void SequenceSearchModel::setOpponentPOV(int fighterIdx)
 {
+    analysis_->invalidate();
+    ++applyGeneration_;
     opponentPOV_ = fighterIdx;
-    previousFighterID_ = fighterStates_[fighterIdx].fighterID;
-    previousPlayerName_ = fighterStates_[fighterIdx].playerName;
+    previousFighterID_ = fighterStates_[fighterIdx]->fighterID;
+    previousPlayerName_ = fighterStates_[fighterIdx]->playerName;
     dispatcher.dispatch(&SequenceSearchListener::onPOVChanged);
 }
 
 // ----------------------------------------------------------------------------
 int SequenceSearchModel::addQuery()
 {
+    analysis_->invalidate();
     compiledQueries_.emplace();
     queryStrings_.emplace();
+    queryRegionMasks_.push(0);
     auto& results = queryResults_.emplace();
 
     results.sessionMatches.resize(sessionCount());
@@ -292,6 +425,8 @@ int SequenceSearchModel::addQuery()
 // ----------------------------------------------------------------------------
 void SequenceSearchModel::setQuery(int queryIdx, const char* queryStr, const char* oppQueryStr)
 {
+    analysis_->invalidate();
+    ++applyGeneration_;
     compiledQueries_[queryIdx].player.reset();
     compiledQueries_[queryIdx].opponent.reset();
     queryStrings_[queryIdx] = { queryStr, oppQueryStr };
@@ -301,8 +436,14 @@ void SequenceSearchModel::setQuery(int queryIdx, const char* queryStr, const cha
 // ----------------------------------------------------------------------------
 void SequenceSearchModel::removeQuery(int queryIdx)
 {
+    analysis_->invalidate();
+    ++applyGeneration_;
+    for (int sequenceID : queryResults_[queryIdx].mergedMatchSequenceIDs)
+        sequenceTrie_.release(sequenceID);
+
     compiledQueries_.erase(queryIdx);
     queryStrings_.erase(queryIdx);
+    queryRegionMasks_.erase(queryIdx);
     queryResults_.erase(queryIdx);
 }
 // ----------------------------------------------------------------------------
@@ -326,9 +467,13 @@ bool SequenceSearchModel::compileQuery(int queryIdx)
     const rfcommon::String& playerStr = queryStrings_[queryIdx].player;
     const rfcommon::String& oppStr = queryStrings_[queryIdx].opponent;
 
-    // Parse strings into ASTs
-    QueryASTNode* ast = Query::parse(queryStrings_[queryIdx].player);
-    QueryASTNode* oppAst = oppStr.length() ? Query::parse(oppStr) : nullptr;
+    // Parse strings into ASTs. Everything allocated from the arena is only
+    // needed until both queries are compiled
+    compileArena_.reset();
+    PipelineTimer parseTimer(timings_.parse);
+    QueryASTNode* ast = Query::parse(queryStrings_[queryIdx].player, &compileArena_);
+    QueryASTNode* oppAst = oppStr.length() ? Query::parse(oppStr, &compileArena_) : nullptr;
+    parseTimer.stop();
 
     if (ast == nullptr || (oppStr.length() && oppAst == nullptr))
     {
@@ -340,17 +485,17 @@ bool SequenceSearchModel::compileQuery(int queryIdx)
             oppSuccess, oppSuccess ? "" : "Syntax Error");
         return false;
     }
-    ast->exportDOT("query-ast.dot");
-    if (oppAst)
-        oppAst->exportDOT("query-opp-ast.dot");
+    if (diagnostics_->shouldWrite("query-ast.dot"))
+        diagnostics_->write("query-ast.dot", ast->toDOT());
+    if (oppAst && diagnostics_->shouldWrite("query-opp-ast.dot"))
+        diagnostics_->write("query-opp-ast.dot", oppAst->toDOT());
 
     // Compile ASTs into NFAs
     rfcommon::String queryError, oppQueryError;
-    std::unique_ptr<Query> query(Query::compileAST(ast, labels_, fighterID(playerPOV_), &queryError));
-    std::unique_ptr<Query> oppQuery(oppAst ? Query::compileAST(oppAst, labels_, fighterID(opponentPOV_), &oppQueryError) : nullptr);
-    QueryASTNode::destroyRecurse(ast);
-    if (oppAst)
-        QueryASTNode::destroyRecurse(oppAst);
+    PipelineTimer compileTimer(timings_.compile);
+    std::unique_ptr<Query> query(Query::compileAST(ast, labels_, fighterID(playerPOV_), &queryError, &compileArena_));
+    std::unique_ptr<Query> oppQuery(oppAst ? Query::compileAST(oppAst, labels_, fighterID(opponentPOV_), &oppQueryError, &compileArena_) : nullptr);
+    compileTimer.stop();
 
     if (query == nullptr || (oppStr.length() && oppQuery == nullptr))
     {
@@ -362,11 +507,18 @@ bool SequenceSearchModel::compileQuery(int queryIdx)
             oppSuccess, oppSuccess ? "" : oppQueryError.cStr());
         return false;
     }
-    query->exportDOT("query.dot", labels_, fighterID(playerPOV_));
+    if (diagnostics_->shouldWrite("query.dot"))
+        diagnostics_->write("query.dot", query->toDOT(labels_, fighterID(playerPOV_)));
+    if (oppQuery && diagnostics_->shouldWrite("query-opp.dot"))
+        diagnostics_->write("query-opp.dot", oppQuery->toDOT(labels_, fighterID(opponentPOV_)));
+
+    timings_.nfaSize->add(query->matcherCount());
     if (oppQuery)
-        oppQuery->exportDOT("query-opp.dot", labels_, fighterID(opponentPOV_));
+        timings_.nfaSize->add(oppQuery->matcherCount());
 
+    query->setRegionConstraint(&regionIndex_, queryRegionMasks_[queryIdx]);
     compiledQueries_[queryIdx].player = std::move(query);
+    ++applyGeneration_;
     compiledQueries_[queryIdx].opponent = std::move(oppQuery);
 
     dispatcher.dispatch(&SequenceSearchListener::onQueryCompiled, queryIdx, true, "", true, "");
@@ -382,6 +534,50 @@ bool SequenceSearchModel::compileAllQueries()
     return success;
 }
 
+// ----------------------------------------------------------------------------
+void SequenceSearchModel::setRegion(int regionIdx, const QRectF& area)
+{
+    regionIndex_.setRegion(regionIdx, area);
+    regionSnapshot_.reset();
+    ++applyGeneration_;
+}
+
+// ----------------------------------------------------------------------------
+void SequenceSearchModel::removeRegion(int regionIdx)
+{
+    regionIndex_.removeRegion(regionIdx);
+    regionSnapshot_.reset();
+    ++applyGeneration_;
+
+    // Queries constrained only to this region would otherwise never match
+    // anything again
+    for (int i = 0; i != queryCount(); ++i)
+        if (queryRegionMasks_[i] & (1u << regionIdx))
+            setQueryRegions(i, queryRegionMasks_[i] & ~(1u << regionIdx));
+}
+
+// ----------------------------------------------------------------------------
+void SequenceSearchModel::setQueryRegions(int queryIdx, uint32_t regionMask)
+{
+    queryRegionMasks_[queryIdx] = regionMask;
+    ++applyGeneration_;
+
+    // The constraint is evaluated by the matcher, so there is no need to
+    // re-compile the query
+    if (compiledQueries_[queryIdx].player)
+        compiledQueries_[queryIdx].player->setRegionConstraint(&regionIndex_, regionMask);
+}
+
+// ----------------------------------------------------------------------------
+bool SequenceSearchModel::applyQueriesUsingRegion(int regionIdx)
+{
+    bool success = false;
+    for (int i = 0; i != queryCount(); ++i)
+        if (queryRegionMasks_[i] & (1u << regionIdx))
+            success |= applyQuery(i);
+    return success;
+}
+
 // ----------------------------------------------------------------------------
 bool SequenceSearchModel::applyQuery(int queryIdx)
 {
@@ -397,68 +593,123 @@ bool SequenceSearchModel::applyQuery(int queryIdx)
     if (playerPOV_ < 0 || opponentPOV_ < 0)
         return false;
 
+    // Anything derived from the previous results is now stale
+    analysis_->invalidate();
+
+    PipelineTimer applyTimer(timings_.apply);
+
     // Do search on a per-session basis, as we don't want to match ranges that
     // span over the boundaries of sessions
-    results.matches.clear();
-    results.mergedMatches.clear();
     for (int sessionIdx = 0; sessionIdx != sessionCount(); ++sessionIdx)
+        matchSession(
+            query.get(), oppQuery.get(),
+            *fighterStates_[playerPOV_], sessions_[sessionIdx].fighterStatesRange[playerPOV_],
+            *fighterStates_[opponentPOV_], sessions_[sessionIdx].fighterStatesRange[opponentPOV_],
+            &results.sessionMatches[sessionIdx],
+            &results.sessionMergedMatches[sessionIdx]);
+
+    collectResults(queryIdx);
+    applyTimer.stop();
+
+    dumpResults(queryIdx);
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+void SequenceSearchModel::matchSession(
+        const Query* query, const Query* oppQuery,
+        const States& states, const Range& range,
+        const States& oppStates, const Range& oppRange,
+        rfcommon::Vector<Range>* matches,
+        rfcommon::Vector<Sequence>* mergedMatches) const
+{
+    PipelineTimer matchTimer(timings_.matchSession);
+    if (oppQuery != nullptr)
     {
-        if (oppQuery.get() != nullptr)
-        {
-            // If there is a query for the opponent, we want to apply the query to the
-            // range of opponent states that occurred at the same time as our search
-            // result
-            results.sessionMatches[sessionIdx] = query->findAllOverlapping(
-                oppQuery.get(),
-                fighterStates_[playerPOV_],
-                sessions_[sessionIdx].fighterStatesRange[playerPOV_],
-                fighterStates_[opponentPOV_],
-                sessions_[sessionIdx].fighterStatesRange[opponentPOV_]
-            );
-        }
-        else
-        {
-            // The opponent query is empty, so just find all ranges that match
-            // the player query
-            results.sessionMatches[sessionIdx] = query->findAll(
-                fighterStates_[playerPOV_],
-                sessions_[sessionIdx].fighterStatesRange[playerPOV_]
-            );
-        }
+        // If there is a query for the opponent, we want to apply the query to the
+        // range of opponent states that occurred at the same time as our search
+        // result
+        *matches = query->findAllOverlapping(oppQuery, states, range, oppStates, oppRange);
+    }
+    else
+    {
+        // The opponent query is empty, so just find all ranges that match
+        // the player query
+        *matches = query->findAll(states, range);
+    }
 
-        // Often, motion values that belong to the same label need to be merged
-        // when e.g. being displayed back to the user or when constructing a graph.
-        auto canMergeMotions = [this, &query](rfcommon::FighterMotion m1, rfcommon::FighterMotion m2) -> bool {
-            for (const auto& mergeableMotions : query->mergeableMotions())
-                if (mergeableMotions.findFirst(m1) != mergeableMotions.end() &&
-                    mergeableMotions.findFirst(m2) != mergeableMotions.end())
-                {
-                    return true;
-                }
-            return false;
-        };
-
-        results.sessionMergedMatches[sessionIdx].clear();
-        for (const auto& range : results.sessionMatches[sessionIdx])
-        {
-            Sequence& seq = results.sessionMergedMatches[sessionIdx].emplace();
-            seq.idxs.push(range.startIdx);
-            for (int idx = range.startIdx + 1; idx < range.endIdx; ++idx)
+    matchTimer.stop();
+
+    mergeMatches(query, states, *matches, mergedMatches);
+}
+
+// ----------------------------------------------------------------------------
+void SequenceSearchModel::mergeMatches(
+        const Query* query, const States& states,
+        const rfcommon::Vector<Range>& matches,
+        rfcommon::Vector<Sequence>* mergedMatches) const
+{
+    // Often, motion values that belong to the same label need to be merged
+    // when e.g. being displayed back to the user or when constructing a graph.
+    auto canMergeMotions = [query](rfcommon::FighterMotion m1, rfcommon::FighterMotion m2) -> bool {
+        for (const auto& mergeableMotions : query->mergeableMotions())
+            if (mergeableMotions.findFirst(m1) != mergeableMotions.end() &&
+                mergeableMotions.findFirst(m2) != mergeableMotions.end())
             {
-                if (canMergeMotions(fighterStates_[playerPOV_][idx - 1].motion, fighterStates_[playerPOV_][idx].motion))
-                    continue;
-                seq.idxs.push(idx);
+                return true;
             }
+        return false;
+    };
+
+    PipelineTimer mergeTimer(timings_.merge);
+    mergedMatches->clear();
+    for (const auto& match : matches)
+    {
+        Sequence& seq = mergedMatches->emplace();
+        seq.idxs.push(match.startIdx);
+        for (int idx = match.startIdx + 1; idx < match.endIdx; ++idx)
+        {
+            if (canMergeMotions(states[idx - 1].motion, states[idx].motion))
+                continue;
+            seq.idxs.push(idx);
         }
+    }
+}
+
+// ----------------------------------------------------------------------------
+void SequenceSearchModel::collectResults(int queryIdx)
+{
+    auto& results = queryResults_[queryIdx];
 
-        // Accumulate results into global results
+    // Accumulate per-session results into global results
+    results.matches.clear();
+    results.mergedMatches.clear();
+    for (int sessionIdx = 0; sessionIdx != sessionCount(); ++sessionIdx)
+    {
         results.matches.push(results.sessionMatches[sessionIdx]);
         results.mergedMatches.push(results.sessionMergedMatches[sessionIdx]);
     }
 
-    Graph().addStates(fighterStates_[playerPOV_], results.mergedMatches).exportDOT("decision_graph_search.dot", fighterStates_[playerPOV_], labels_);
+    for (int sequenceID : results.mergedMatchSequenceIDs)
+        sequenceTrie_.release(sequenceID);
+    results.mergedMatchSequenceIDs.clear();
+    for (const Sequence& seq : results.mergedMatches)
+        results.mergedMatchSequenceIDs.push(sequenceTrie_.insert(*fighterStates_[playerPOV_], seq));
+}
+
+// ----------------------------------------------------------------------------
+void SequenceSearchModel::dumpResults(int queryIdx)
+{
+    // Building this graph is only needed for the dump
+    if (diagnostics_->shouldWrite("decision_graph_search.dot"))
+    {
+        const Graph graph = Graph().addStates(*fighterStates_[playerPOV_], queryResults_[queryIdx].mergedMatches);
+        diagnostics_->write("decision_graph_search.dot", graph.toDOT(*fighterStates_[playerPOV_], labels_));
+    }
 
 #ifndef NDEBUG
+    const auto& results = queryResults_[queryIdx];
     auto toHash40OrHex = [this](rfcommon::FighterMotion motion) -> rfcommon::String {
         if (const char* h40 = labels_->toHash40(motion))
             return h40;
@@ -473,7 +724,7 @@ bool SequenceSearchModel::applyQuery(int queryIdx)
         {
             if (i != range.startIdx)
                 printf(" -> ");
-            printf("0x%lx (%s) | %x", fighterStates_[playerPOV_][i].motion.value(), toHash40OrHex(fighterStates_[playerPOV_][i].motion).cStr(), fighterStates_[playerPOV_][i].flags);
+            printf("0x%lx (%s) | %x", (*fighterStates_[playerPOV_])[i].motion.value(), toHash40OrHex((*fighterStates_[playerPOV_])[i].motion).cStr(), (*fighterStates_[playerPOV_])[i].flags);
         }
         printf("\n");
     }
@@ -486,11 +737,114 @@ bool SequenceSearchModel::applyQuery(int queryIdx)
             int idx = seq.idxs[i];
             if (i != 0)
                 printf(" -> ");
-            printf("0x%lx (%s) | %x", fighterStates_[playerPOV_][idx].motion.value(), toHash40OrHex(fighterStates_[playerPOV_][idx].motion).cStr(), fighterStates_[playerPOV_][idx].flags);
+            printf("0x%lx (%s) | %x", (*fighterStates_[playerPOV_])[idx].motion.value(), toHash40OrHex((*fighterStates_[playerPOV_])[idx].motion).cStr(), (*fighterStates_[playerPOV_])[idx].flags);
         }
         printf("\n");
     }
 #endif
+}
+
+// ----------------------------------------------------------------------------
+States& SequenceSearchModel::mutableFighterStates(int fighterIdx)
+{
+    // Only the main thread creates new references, so if there are none
+    // other than ours, no job can start reading while we write. Jobs that
+    // finish in the meantime only make the count drop
+    std::shared_ptr<States>& states = fighterStates_[fighterIdx];
+    if (states.use_count() > 1)
+        states = std::make_shared<States>(*states);
+    return *states;
+}
+
+// ----------------------------------------------------------------------------
+SequenceSearchModel::ApplyJob::ApplyJob(
+        std::shared_ptr<const States> states,
+        std::shared_ptr<const States> oppStates,
+        std::shared_ptr<const RegionIndex> regions)
+    : states(std::move(states))
+    , oppStates(std::move(oppStates))
+    , regions(std::move(regions))
+    , generation(0)
+    , queryIdx(-1)
+    , cancelled(false)
+{}
+
+// ----------------------------------------------------------------------------
+SequenceSearchModel::ApplyJob::~ApplyJob()
+{}
+
+// ----------------------------------------------------------------------------
+std::shared_ptr<SequenceSearchModel::ApplyJob> SequenceSearchModel::prepareApply(int queryIdx) const
+{
+    const QueryNFAs& compiled = compiledQueries_[queryIdx];
+    if (compiled.player == nullptr)
+        return nullptr;
+    if (playerPOV_ < 0 || opponentPOV_ < 0)
+        return nullptr;
+
+    // Nothing is copied here except for the regions, and those only after
+    // they changed
+    if (regionSnapshot_ == nullptr)
+        regionSnapshot_ = std::make_shared<const RegionIndex>(regionIndex_);
+    auto job = std::make_shared<ApplyJob>(fighterStates_[playerPOV_], fighterStates_[opponentPOV_], regionSnapshot_);
+    job->generation = applyGeneration_;
+    job->queryIdx = queryIdx;
+
+    // The region constraint has to point to the job's copy of the index
+    job->query.reset(new Query(*compiled.player));
+    job->query->setRegionConstraint(job->regions.get(), queryRegionMasks_[queryIdx]);
+    if (compiled.opponent)
+        job->oppQuery.reset(new Query(*compiled.opponent));
+
+    for (const Session& session : sessions_)
+    {
+        job->sessionRanges.push(session.fighterStatesRange[playerPOV_]);
+        job->oppSessionRanges.push(session.fighterStatesRange[opponentPOV_]);
+    }
+    job->sessionMatches.resize(sessionCount());
+    job->sessionMergedMatches.resize(sessionCount());
+
+    return job;
+}
+
+// ----------------------------------------------------------------------------
+void SequenceSearchModel::runApply(ApplyJob* job) const
+{
+    PipelineTimer applyTimer(timings_.applyAsync);
+    for (int sessionIdx = 0; sessionIdx != job->sessionRanges.count(); ++sessionIdx)
+    {
+        if (job->cancelled.load(std::memory_order_relaxed))
+            return;
+
+        matchSession(
+            job->query.get(), job->oppQuery.get(),
+            *job->states, job->sessionRanges[sessionIdx],
+            *job->oppStates, job->oppSessionRanges[sessionIdx],
+            &job->sessionMatches[sessionIdx],
+            &job->sessionMergedMatches[sessionIdx]);
+    }
+}
+
+// ----------------------------------------------------------------------------
+bool SequenceSearchModel::finishApply(ApplyJob* job)
+{
+    if (job->cancelled.load(std::memory_order_relaxed) || job->generation != applyGeneration_)
+    {
+        timings_.applyDiscarded->add();
+        return false;
+    }
+
+    analysis_->invalidate();
+
+    auto& results = queryResults_[job->queryIdx];
+    for (int sessionIdx = 0; sessionIdx != sessionCount(); ++sessionIdx)
+    {
+        results.sessionMatches[sessionIdx] = std::move(job->sessionMatches[sessionIdx]);
+        results.sessionMergedMatches[sessionIdx] = std::move(job->sessionMergedMatches[sessionIdx]);
+    }
+
+    collectResults(job->queryIdx);
+    dumpResults(job->queryIdx);
 
     return true;
 }
@@ -505,6 +859,119 @@ bool SequenceSearchModel::applyAllQueries()
     return success;
 }
 
+// ----------------------------------------------------------------------------
+bool SequenceSearchModel::continueApplyAllQueries(int64_t budgetNS)
+{
+    SlicedApply& pass = slicedApply_;
+    if (pass.generation != applyGeneration_)
+    {
+        // Queries, sessions or POVs changed, start over
+        pass.generation = applyGeneration_;
+        pass.queryIdx = 0;
+        pass.sessionIdx = 0;
+        pass.startIdx = -1;
+        pass.anyApplied = false;
+    }
+
+    // Don't even start matching if the frame is already over budget. The
+    // pass continues in a later frame, or is replaced by applyAllQueries()
+    // once the game ends
+    if (budgetNS <= 0)
+        return false;
+
+    PipelineTimer sliceTimer(timings_.applySlice);
+    rfcommon::HighresTimer timer;
+    timer.start();
+    while (pass.queryIdx < queryCount())
+    {
+        const int queryIdx = pass.queryIdx;
+        const QueryNFAs& compiled = compiledQueries_[queryIdx];
+
+        // Same as applyQuery(), queries that can't be applied keep their
+        // previous results
+        if (compiled.player == nullptr || playerPOV_ < 0 || opponentPOV_ < 0 || sessionCount() == 0)
+        {
+            pass.queryIdx++;
+            continue;
+        }
+
+        if (pass.sessionIdx == 0 && pass.startIdx < 0)
+        {
+            pass.sessionMatches.resize(sessionCount());
+            pass.sessionMergedMatches.resize(sessionCount());
+        }
+
+        // Frames are appended to the last session while it is being matched,
+        // so the ranges are looked up again on every call
+        const int sessionIdx = pass.sessionIdx;
+        const States& states = *fighterStates_[playerPOV_];
+        const States& oppStates = *fighterStates_[opponentPOV_];
+        const Range& range = sessions_[sessionIdx].fighterStatesRange[playerPOV_];
+        const Range& oppRange = sessions_[sessionIdx].fighterStatesRange[opponentPOV_];
+        if (pass.startIdx < 0)
+        {
+            pass.startIdx = range.startIdx;
+            pass.oppStartIdx = oppRange.startIdx;
+            pass.sessionMatches[sessionIdx].clear();
+        }
+
+        // Same as matchSession(), but only a few states at a time so the
+        // budget can be checked in between
+        const int stopIdx = pass.startIdx + SLICE_STATES;
+        if (compiled.opponent)
+            compiled.player->continueFindAllOverlapping(
+                compiled.opponent.get(),
+                states, range, oppStates, oppRange,
+                &pass.startIdx, &pass.oppStartIdx, stopIdx,
+                &pass.sessionMatches[sessionIdx]);
+        else
+            compiled.player->continueFindAll(
+                states, range,
+                &pass.startIdx, stopIdx,
+                &pass.sessionMatches[sessionIdx]);
+
+        if (pass.startIdx >= range.endIdx)
+        {
+            mergeMatches(compiled.player.get(), states,
+                pass.sessionMatches[sessionIdx],
+                &pass.sessionMergedMatches[sessionIdx]);
+            pass.sessionIdx++;
+            pass.startIdx = -1;
+        }
+
+        if (pass.sessionIdx == sessionCount())
+        {
+            analysis_->invalidate();
+
+            auto& results = queryResults_[queryIdx];
+            for (int i = 0; i != sessionCount(); ++i)
+            {
+                results.sessionMatches[i] = std::move(pass.sessionMatches[i]);
+                results.sessionMergedMatches[i] = std::move(pass.sessionMergedMatches[i]);
+            }
+
+            collectResults(queryIdx);
+            dumpResults(queryIdx);
+
+            pass.anyApplied = true;
+            pass.queryIdx++;
+            pass.sessionIdx = 0;
+        }
+
+        timer.stop();
+        if (static_cast<int64_t>(timer.timePassedNS()) >= budgetNS)
+            break;
+    }
+
+    if (pass.queryIdx < queryCount())
+        return false;
+
+    const bool anyApplied = pass.anyApplied;
+    pass.queryIdx = 0;
+    pass.anyApplied = false;
+    return anyApplied;
+}
+
 // ----------------------------------------------------------------------------
 void SequenceSearchModel::notifyQueriesApplied()
 {
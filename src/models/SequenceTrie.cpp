@@ -0,0 +1,121 @@
+#include "decision-graph/models/Sequence.hpp"
+#include "decision-graph/models/SequenceTrie.hpp"
+
+#include <cassert>
+
+// ----------------------------------------------------------------------------
+SequenceTrie::SequenceTrie()
+{
+    nodes_.emplace(-1, -1, 0);
+}
+
+// ----------------------------------------------------------------------------
+SequenceTrie::~SequenceTrie()
+{}
+
+// ----------------------------------------------------------------------------
+void SequenceTrie::clear()
+{
+    nodes_.clear();
+    nodes_.emplace(-1, -1, 0);
+    classes_.clear();
+    children_.clear();
+    classCount_ = 0;
+    totalCount_ = 0;
+    mostCommon_ = -1;
+    mostCommonDirty_ = false;
+}
+
+// ----------------------------------------------------------------------------
+int SequenceTrie::stateClass(const State& state)
+{
+    const uint64_t key = (state.motion.value() << 16) | state.status.value();
+    auto it = classes_.insertOrGet(key, -1);
+    if (it->value() == -1)
+        it->value() = classCount_++;
+    return it->value();
+}
+
+// ----------------------------------------------------------------------------
+int SequenceTrie::insert(const States& states, const Sequence& seq)
+{
+    int node = 0;
+    for (int stateIdx : seq.idxs)
+    {
+        const uint64_t key = (static_cast<uint64_t>(node) << 32) | static_cast<uint32_t>(stateClass(states[stateIdx]));
+        auto it = children_.insertOrGet(key, -1);
+        if (it->value() == -1)
+        {
+            const int depth = nodes_[node].depth + 1;
+            nodes_.emplace(node, stateIdx, depth);
+            it->value() = nodes_.count() - 1;
+        }
+        node = it->value();
+    }
+
+    nodes_[node].count++;
+    totalCount_++;
+    if (mostCommonDirty_ == false && (mostCommon_ < 0 || nodes_[mostCommon_].count < nodes_[node].count))
+        mostCommon_ = node;
+
+    return node;
+}
+
+// ----------------------------------------------------------------------------
+void SequenceTrie::release(int sequenceID)
+{
+    assert(nodes_[sequenceID].count > 0);
+    nodes_[sequenceID].count--;
+
+    // Nobody is holding on to any IDs anymore. Start over so that nodes of
+    // sequences that no longer exist don't pile up
+    if (--totalCount_ == 0)
+    {
+        clear();
+        return;
+    }
+
+    // Some other sequence may now be the most common one. Defer the search
+    // until someone asks, as usually many sequences are released at once
+    if (sequenceID == mostCommon_)
+        mostCommonDirty_ = true;
+}
+
+// ----------------------------------------------------------------------------
+Sequence SequenceTrie::sequence(int sequenceID) const
+{
+    // Walk up from the leaf, filling the indices back to front
+    Sequence seq;
+    seq.idxs.resize(nodes_[sequenceID].depth);
+    for (int node = sequenceID, i = seq.idxs.count() - 1; node > 0; node = nodes_[node].parent, --i)
+        seq.idxs[i] = nodes_[node].stateIdx;
+
+    return seq;
+}
+
+// ----------------------------------------------------------------------------
+int SequenceTrie::mostCommon() const
+{
+    if (mostCommonDirty_)
+    {
+        mostCommon_ = -1;
+        for (int node = 0; node != nodes_.count(); ++node)
+            if (nodes_[node].count > 0 && (mostCommon_ < 0 || nodes_[mostCommon_].count < nodes_[node].count))
+                mostCommon_ = node;
+        mostCommonDirty_ = false;
+    }
+
+    if (mostCommon_ >= 0 && nodes_[mostCommon_].count == 0)
+        return -1;
+    return mostCommon_;
+}
+
+// ----------------------------------------------------------------------------
+rfcommon::Vector<int> SequenceTrie::uniqueSequences() const
+{
+    rfcommon::Vector<int> result;
+    for (int node = 0; node != nodes_.count(); ++node)
+        if (nodes_[node].count > 0)
+            result.push(node);
+    return result;
+}
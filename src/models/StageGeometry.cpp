@@ -0,0 +1,375 @@
+#include "decision-graph/models/StageGeometry.hpp"
+
+#include <QFile>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Fighter positions are at the fighter's feet. Standing fighters are exactly
+// on the surface, but landing and slopes cause small offsets
+constexpr float SURFACE_TOLERANCE = 3.0f;
+
+// Area around a ledge in which a fighter counts as being at the ledge. This
+// covers hanging on the ledge as well as ledge options ending near it
+constexpr float LEDGE_RADIUS_X = 20.0f;
+constexpr float LEDGE_RADIUS_Y = 20.0f;
+
+// Every object in an LVD file starts with a common block of this size. It
+// contains the object's name, subname, start position and some flags, none
+// of which we need except for a signature to validate the layout
+constexpr int ENTRY_SIZE = 0xEA;
+constexpr uint8_t ENTRY_SIGNATURE[] = {0x01, 0x01, 0x77, 0x35, 0xbb, 0x75};
+
+constexpr int MATERIAL_SIZE = 13;
+constexpr int COLLISION_UNKNOWN_SIZE = 328;
+
+/*!
+ * \brief Bounds checked reader for the big-endian LVD format. Once a read
+ * fails, all following reads fail too, so the parser only has to check for
+ * errors once per object.
+ */
+class LVDReader
+{
+public:
+    LVDReader(const uint8_t* data, int size)
+        : data_(data), size_(size)
+    {}
+
+    bool ok() const { return ok_; }
+
+    bool skip(int bytes)
+    {
+        if (ok_ == false || bytes < 0 || size_ - pos_ < bytes)
+            return ok_ = false;
+        pos_ += bytes;
+        return true;
+    }
+
+    uint8_t u8()
+    {
+        const int at = pos_;
+        return skip(1) ? data_[at] : 0;
+    }
+
+    uint32_t u32()
+    {
+        const int at = pos_;
+        if (skip(4) == false)
+            return 0;
+        return (uint32_t(data_[at + 0]) << 24)
+             | (uint32_t(data_[at + 1]) << 16)
+             | (uint32_t(data_[at + 2]) << 8)
+             | (uint32_t(data_[at + 3]) << 0);
+    }
+
+    float f32()
+    {
+        const uint32_t bits = u32();
+        float value;
+        memcpy(&value, &bits, 4);
+        return value;
+    }
+
+    const uint8_t* bytes(int count)
+    {
+        const int at = pos_;
+        return skip(count) ? data_ + at : nullptr;
+    }
+
+    // Most values are prefixed with a 0x01 byte
+    bool tag()
+    {
+        if (u8() != 0x01)
+            return ok_ = false;
+        return true;
+    }
+
+    // Lists are a tag followed by the number of elements. The count is
+    // limited by the remaining size so a corrupt file can't make us loop or
+    // skip beyond the end of the data
+    int count(int elementSize=1)
+    {
+        if (tag() == false)
+            return 0;
+        const uint32_t n = u32();
+        if (n > static_cast<uint32_t>((size_ - pos_) / elementSize))
+        {
+            ok_ = false;
+            return 0;
+        }
+        return static_cast<int>(n);
+    }
+
+    QPointF vec2()
+    {
+        if (tag() == false)
+            return QPointF();
+        const float x = f32();
+        const float y = f32();
+        return QPointF(x, y);
+    }
+
+    // Version byte followed by the common entry block
+    bool entry()
+    {
+        u8();
+        const uint8_t* e = bytes(ENTRY_SIZE);
+        if (e == nullptr || memcmp(e + 1, ENTRY_SIGNATURE, sizeof(ENTRY_SIGNATURE)) != 0)
+            return ok_ = false;
+        return true;
+    }
+
+    // Left, right, top, bottom
+    QRectF bounds()
+    {
+        if (tag() == false)
+            return QRectF();
+        const float left = f32();
+        const float right = f32();
+        const float top = f32();
+        const float bottom = f32();
+        return QRectF(QPointF(left, bottom), QPointF(right, top));
+    }
+
+private:
+    const uint8_t* const data_;
+    const int size_;
+    int pos_ = 0;
+    bool ok_ = true;
+};
+
+}
+
+// ----------------------------------------------------------------------------
+StageGeometry::StageGeometry()
+{}
+
+// ----------------------------------------------------------------------------
+StageGeometry::~StageGeometry()
+{}
+
+// ----------------------------------------------------------------------------
+void StageGeometry::clear()
+{
+    surfaces_.clear();
+    ledges_.clear();
+    spawns_.clear();
+    blastZone_ = QRectF();
+    cameraBounds_ = QRectF();
+    surfaceIndex_.clear();
+    stageLeft_ = 0.0f;
+    stageRight_ = 0.0f;
+    stageBottom_ = 0.0f;
+}
+
+// ----------------------------------------------------------------------------
+bool StageGeometry::load(const QString& fileName)
+{
+    clear();
+
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly) == false)
+        return false;
+
+    const qint64 size = file.size();
+    if (size <= 0 || size > 0x7FFFFFFF)
+        return false;
+
+    const uchar* data = file.map(0, size);
+    if (data == nullptr)
+        return false;
+
+    const bool result = load(data, static_cast<int>(size));
+    file.unmap(const_cast<uchar*>(data));
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+bool StageGeometry::load(const uint8_t* data, int size)
+{
+    clear();
+
+    LVDReader r(data, size);
+    if (r.u32() != 1)
+        return false;
+    r.u8();  // Version
+    r.tag();
+    const uint8_t* magic = r.bytes(4);
+    if (magic == nullptr || memcmp(magic, "LVD1", 4) != 0)
+        return false;
+
+    float stageBottom = 0.0f;
+    bool haveStage = false;
+
+    const int collisionCount = r.count();
+    for (int c = 0; c != collisionCount && r.ok(); ++c)
+    {
+        r.entry();
+        const uint8_t* flags = r.bytes(4);
+        const bool isPlatform = flags && flags[3] != 0;
+
+        rfcommon::SmallVector<QPointF, 16> vertices;
+        const int vertexCount = r.count();
+        for (int i = 0; i != vertexCount && r.ok(); ++i)
+            vertices.push(r.vec2());
+
+        // One normal per line segment
+        const int normalCount = r.count();
+        for (int i = 0; i != normalCount && r.ok(); ++i)
+        {
+            const QPointF n = r.vec2();
+            if (i + 1 >= vertices.count())
+                continue;
+
+            // Only keep surfaces that can be stood on. Walls and ceilings
+            // only matter for the stage's extents
+            if (n.y() < 0.5)
+                continue;
+            const QPointF& a = vertices[i];
+            const QPointF& b = vertices[i + 1];
+            surfaces_.push({
+                static_cast<float>(a.x()), static_cast<float>(a.y()),
+                static_cast<float>(b.x()), static_cast<float>(b.y()),
+                isPlatform});
+        }
+
+        if (isPlatform == false)
+            for (const QPointF& v : vertices)
+            {
+                stageBottom = haveStage ? std::min(stageBottom, static_cast<float>(v.y())) : static_cast<float>(v.y());
+                haveStage = true;
+            }
+
+        const int cliffCount = r.count();
+        for (int i = 0; i != cliffCount && r.ok(); ++i)
+        {
+            r.entry();
+            ledges_.push(r.vec2());
+            r.f32();  // Angle
+            r.u32();  // Index of the line the ledge belongs to
+        }
+
+        r.skip(r.count(MATERIAL_SIZE) * MATERIAL_SIZE);
+        r.skip(r.count(COLLISION_UNKNOWN_SIZE) * COLLISION_UNKNOWN_SIZE);
+    }
+
+    const int spawnCount = r.count();
+    for (int i = 0; i != spawnCount && r.ok(); ++i)
+    {
+        r.entry();
+        spawns_.push(r.vec2());
+    }
+
+    const int respawnCount = r.count();
+    for (int i = 0; i != respawnCount && r.ok(); ++i)
+    {
+        r.entry();
+        r.vec2();
+    }
+
+    const int cameraCount = r.count();
+    for (int i = 0; i != cameraCount && r.ok(); ++i)
+    {
+        r.entry();
+        const QRectF bounds = r.bounds();
+        if (i == 0)
+            cameraBounds_ = bounds;
+    }
+
+    const int blastZoneCount = r.count();
+    for (int i = 0; i != blastZoneCount && r.ok(); ++i)
+    {
+        r.entry();
+        const QRectF bounds = r.bounds();
+        if (i == 0)
+            blastZone_ = bounds;
+    }
+
+    // The remaining sections (item spawners, PTrainer data, ...) are not
+    // needed
+    if (r.ok() == false)
+    {
+        clear();
+        return false;
+    }
+
+    // The main stage is everything that isn't a platform. Files without one
+    // are boss or event layouts (e.g. Master Hand's version of Final
+    // Destination is only made of floating plates). Classifying positions
+    // against those would mark a fighter on the real floor as offstage, so
+    // it's better to have no geometry at all
+    const bool haveFloor = std::any_of(surfaces_.begin(), surfaces_.end(),
+            [](const Segment& s) { return s.isPlatform == false; });
+    if (haveFloor == false || haveStage == false)
+    {
+        clear();
+        return false;
+    }
+
+    stageLeft_ = std::numeric_limits<float>::max();
+    stageRight_ = std::numeric_limits<float>::lowest();
+    for (const Segment& s : surfaces_)
+        if (s.isPlatform == false)
+        {
+            stageLeft_ = std::min({stageLeft_, s.x0, s.x1});
+            stageRight_ = std::max({stageRight_, s.x0, s.x1});
+        }
+    stageBottom_ = stageBottom;
+
+    buildIndex();
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+void StageGeometry::buildIndex()
+{
+    rfcommon::Vector<QRectF> boxes;
+    boxes.reserve(surfaces_.count());
+    for (const Segment& s : surfaces_)
+    {
+        const QRectF box(
+                QPointF(std::min(s.x0, s.x1), std::min(s.y0, s.y1)),
+                QPointF(std::max(s.x0, s.x1), std::max(s.y0, s.y1)));
+        boxes.push(box.adjusted(-SURFACE_TOLERANCE, -SURFACE_TOLERANCE, SURFACE_TOLERANCE, SURFACE_TOLERANCE));
+    }
+    surfaceIndex_.build(boxes);
+}
+
+// ----------------------------------------------------------------------------
+uint8_t StageGeometry::classify(float x, float y) const
+{
+    // Nothing was loaded, or the file had no main stage (see load())
+    if (isEmpty())
+        return 0;
+
+    uint8_t flags = 0;
+    const QRectF area(x - SURFACE_TOLERANCE, y - SURFACE_TOLERANCE, 2 * SURFACE_TOLERANCE, 2 * SURFACE_TOLERANCE);
+    surfaceIndex_.query(area, [this, x, y, &flags](int idx) {
+        const Segment& s = surfaces_[idx];
+        const float left = std::min(s.x0, s.x1);
+        const float right = std::max(s.x0, s.x1);
+        if (x < left || x > right)
+            return;
+
+        const float t = right > left ? (x - s.x0) / (s.x1 - s.x0) : 0.0f;
+        const float surfaceY = s.y0 + (s.y1 - s.y0) * t;
+        if (std::fabs(y - surfaceY) <= SURFACE_TOLERANCE)
+            flags |= s.isPlatform ? PLATFORM : GROUNDED;
+    });
+
+    for (const QPointF& ledge : ledges_)
+        if (std::fabs(x - ledge.x()) <= LEDGE_RADIUS_X && std::fabs(y - ledge.y()) <= LEDGE_RADIUS_Y)
+        {
+            flags |= LEDGE;
+            break;
+        }
+
+    if (x < stageLeft_ || x > stageRight_ || y < stageBottom_)
+        flags |= OFFSTAGE;
+
+    return flags;
+}
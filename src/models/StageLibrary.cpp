@@ -0,0 +1,182 @@
+#include "decision-graph/models/StageLibrary.hpp"
+#include "decision-graph/models/StageGeometry.hpp"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <cctype>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   include <Windows.h>
+#else
+#   include <dlfcn.h>
+#endif
+
+namespace {
+
+// Stage names as shown by ReFramed mapped to the game's internal directory
+// names. Stages whose directory name is the same as the displayed name with
+// spaces and punctuation removed (e.g. "Duck Hunt" -> "duckhunt") don't need
+// an entry
+const struct { const char* name; const char* dir; } stageDirs[] = {
+    {"75 m",                     "75m"},
+    {"Town and City",            "animal_city"},
+    {"Tortimer Island",          "animal_island"},
+    {"Smashville",               "animal_village"},
+    {"Big Battlefield",          "battlefield_l"},
+    {"Small Battlefield",        "battlefield_s"},
+    {"Umbra Clock Tower",        "bayo_clock"},
+    {"Yggdrasil's Altar",        "brave_altar"},
+    {"Spiral Mountain",          "buddy_spiral"},
+    {"Mishima Dojo",             "demon_dojo"},
+    {"Kongo Jungle 64",          "dk_jungle"},
+    {"Jungle Japes",             "dk_lodge"},
+    {"Kongo Falls",              "dk_waterfall"},
+    {"King of Fighters Stadium", "dolly_stadium"},
+    {"Dracula's Castle",         "dracula_castle"},
+    {"Final Destination",        "end"},
+    {"Arena Ferox",              "fe_arena"},
+    {"Coliseum",                 "fe_colloseum"},
+    {"Garreg Mach Monastery",    "fe_shrine"},
+    {"Castle Siege",             "fe_siege"},
+    {"Northern Cave",            "ff_cave"},
+    {"Midgar",                   "ff_midgar"},
+    {"Flat Zone X",              "flatzonex"},
+};
+
+// ----------------------------------------------------------------------------
+// Lower case, only letters and digits, "&" becomes "and". Makes the lookup
+// insensitive to small differences in how stage names are written
+QString normalize(const char* name)
+{
+    QString result;
+    for (const char* c = name; *c; ++c)
+    {
+        if (*c == '&')
+            result += "and";
+        else if (std::isalnum(static_cast<unsigned char>(*c)))
+            result += QLatin1Char(static_cast<char>(std::tolower(static_cast<unsigned char>(*c))));
+    }
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+// Directory of the shared library or executable this code was linked into.
+// The plugin is loaded by ReFramed, so the working directory and the
+// application's directory say nothing about where the plugin's files are
+QString moduleDir()
+{
+#if defined(_WIN32)
+    HMODULE module = nullptr;
+    if (GetModuleHandleExW(
+            GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+            reinterpret_cast<LPCWSTR>(&moduleDir), &module) == 0)
+        return QString();
+
+    wchar_t path[MAX_PATH];
+    const DWORD len = GetModuleFileNameW(module, path, MAX_PATH);
+    if (len == 0 || len == MAX_PATH)
+        return QString();
+    return QFileInfo(QString::fromWCharArray(path, static_cast<int>(len))).absolutePath();
+#else
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void*>(&moduleDir), &info) == 0 || info.dli_fname == nullptr)
+        return QString();
+    return QFileInfo(QString::fromLocal8Bit(info.dli_fname)).absolutePath();
+#endif
+}
+
+}
+
+// ----------------------------------------------------------------------------
+StageLibrary::StageLibrary()
+    : dataDir_(defaultDataDir())
+{}
+
+// ----------------------------------------------------------------------------
+StageLibrary::StageLibrary(const QString& dataDir)
+    : dataDir_(dataDir)
+{}
+
+// ----------------------------------------------------------------------------
+StageLibrary::~StageLibrary()
+{}
+
+// ----------------------------------------------------------------------------
+QString StageLibrary::defaultDataDir()
+{
+    const QString dir = moduleDir();
+    if (dir.isEmpty() == false)
+    {
+        const QString installed = QDir(dir).filePath("decision-graph/stage");
+        if (QFileInfo(installed).isDir())
+            return installed;
+    }
+
+    return "data/stage";
+}
+
+// ----------------------------------------------------------------------------
+void StageLibrary::setDataDir(const QString& dataDir)
+{
+    dataDir_ = dataDir;
+    entries_.clearCompact();
+}
+
+// ----------------------------------------------------------------------------
+const StageGeometry* StageLibrary::find(const char* stageName)
+{
+    for (const Entry& entry : entries_)
+        if (entry.stageName == stageName)
+            return entry.geometry.get();
+
+    std::unique_ptr<StageGeometry> geometry;
+    const QString fileName = findFile(stageName);
+    if (fileName.isEmpty() == false)
+    {
+        geometry.reset(new StageGeometry);
+        if (geometry->load(fileName) == false)
+            geometry.reset();
+    }
+
+    Entry& entry = entries_.emplace();
+    entry.stageName = stageName;
+    entry.geometry = std::move(geometry);
+    return entry.geometry.get();
+}
+
+// ----------------------------------------------------------------------------
+QString StageLibrary::findFile(const char* stageName) const
+{
+    const QString key = normalize(stageName);
+    const QDir root(dataDir_);
+
+    QString dirName;
+    for (const auto& stage : stageDirs)
+        if (normalize(stage.name) == key)
+        {
+            dirName = stage.dir;
+            break;
+        }
+
+    if (dirName.isEmpty())
+        for (const QString& dir : root.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+            if (normalize(dir.toUtf8().constData()) == key)
+            {
+                dirName = dir;
+                break;
+            }
+
+    if (dirName.isEmpty())
+        return QString();
+
+    // Stages with multiple layouts (e.g. transforming stages) have several
+    // files. The first one is the base layout
+    const QDir paramDir(root.filePath(dirName + "/normal/param"));
+    const QStringList files = paramDir.entryList(QStringList() << "*.lvd", QDir::Files, QDir::Name);
+    if (files.isEmpty())
+        return QString();
+
+    return paramDir.filePath(files.front());
+}
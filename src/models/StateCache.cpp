@@ -0,0 +1,292 @@
+#include "decision-graph/models/SequenceSearchModel.hpp"
+#include "decision-graph/models/StateCache.hpp"
+
+#include <QByteArray>
+#include <QFile>
+
+#include <cstring>
+
+namespace {
+
+constexpr char MAGIC[4] = {'D', 'G', 'S', 'C'};
+constexpr uint32_t VERSION = 1;
+constexpr int STATE_SIZE = 36;
+
+class CacheWriter
+{
+public:
+    explicit CacheWriter(QByteArray* out) : out_(out) {}
+
+    void bytes(const void* data, int count) { out_->append(static_cast<const char*>(data), count); }
+    void u8(uint8_t value) { bytes(&value, 1); }
+    void u16(uint16_t value)
+    {
+        const uint8_t b[2] = {uint8_t(value), uint8_t(value >> 8)};
+        bytes(b, 2);
+    }
+    void u32(uint32_t value)
+    {
+        const uint8_t b[4] = {uint8_t(value), uint8_t(value >> 8), uint8_t(value >> 16), uint8_t(value >> 24)};
+        bytes(b, 4);
+    }
+    void u64(uint64_t value)
+    {
+        u32(static_cast<uint32_t>(value));
+        u32(static_cast<uint32_t>(value >> 32));
+    }
+    void f32(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, 4);
+        u32(bits);
+    }
+    void str(const rfcommon::String& s)
+    {
+        const int len = s.length() < 0xFFFF ? s.length() : 0xFFFF;
+        u16(static_cast<uint16_t>(len));
+        bytes(s.cStr(), len);
+    }
+
+private:
+    QByteArray* out_;
+};
+
+/*!
+ * \brief Bounds checked reader. Once a read fails, all following reads fail
+ * too, so the parser only has to check for errors once per fighter.
+ */
+class CacheReader
+{
+public:
+    CacheReader(const uint8_t* data, int size)
+        : data_(data), size_(size)
+    {}
+
+    bool ok() const { return ok_; }
+
+    const uint8_t* bytes(int count)
+    {
+        if (ok_ == false || count < 0 || size_ - pos_ < count)
+        {
+            ok_ = false;
+            return nullptr;
+        }
+        const uint8_t* at = data_ + pos_;
+        pos_ += count;
+        return at;
+    }
+
+    uint8_t u8()
+    {
+        const uint8_t* b = bytes(1);
+        return b ? b[0] : 0;
+    }
+
+    uint16_t u16()
+    {
+        const uint8_t* b = bytes(2);
+        return b ? uint16_t(b[0] | (b[1] << 8)) : 0;
+    }
+
+    uint32_t u32()
+    {
+        const uint8_t* b = bytes(4);
+        if (b == nullptr)
+            return 0;
+        return (uint32_t(b[0]) << 0)
+             | (uint32_t(b[1]) << 8)
+             | (uint32_t(b[2]) << 16)
+             | (uint32_t(b[3]) << 24);
+    }
+
+    uint64_t u64()
+    {
+        const uint64_t lower = u32();
+        const uint64_t upper = u32();
+        return lower | (upper << 32);
+    }
+
+    float f32()
+    {
+        const uint32_t bits = u32();
+        float value;
+        memcpy(&value, &bits, 4);
+        return value;
+    }
+
+    rfcommon::String str()
+    {
+        const int len = u16();
+        const uint8_t* b = bytes(len);
+        return b ? rfcommon::String(reinterpret_cast<const char*>(b), len) : rfcommon::String();
+    }
+
+    int remaining() const { return size_ - pos_; }
+
+private:
+    const uint8_t* const data_;
+    const int size_;
+    int pos_ = 0;
+    bool ok_ = true;
+};
+
+}
+
+// ----------------------------------------------------------------------------
+StateCache::StateCache()
+{}
+
+// ----------------------------------------------------------------------------
+StateCache::~StateCache()
+{}
+
+// ----------------------------------------------------------------------------
+void StateCache::clear()
+{
+    fighterStates_.clear();
+    sessionName_ = "";
+    stageName_ = "";
+    timeStarted_ = 0;
+}
+
+// ----------------------------------------------------------------------------
+bool StateCache::copyFrom(const SequenceSearchModel& model, int sessionIdx)
+{
+    clear();
+
+    if (sessionIdx < 0 || sessionIdx >= model.sessionCount())
+        return false;
+
+    timeStarted_ = model.sessionTimeStarted(sessionIdx).millisSinceEpoch();
+    sessionName_ = model.sessionName(sessionIdx);
+    stageName_ = model.sessionStageName(sessionIdx);
+
+    for (int fighterIdx = 0; fighterIdx != model.fighterCount(); ++fighterIdx)
+    {
+        const Range& range = model.sessionStateRange(sessionIdx, fighterIdx);
+        if (range.startIdx == range.endIdx)
+            continue;
+
+        const States& src = model.fighterStates(fighterIdx);
+        States& dst = fighterStates_.emplace(src.fighterID, src.playerName, src.fighterName);
+        for (int i = range.startIdx; i != range.endIdx; ++i)
+            dst.push(src[i]);
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+bool StateCache::save(const QString& fileName) const
+{
+    QByteArray data;
+    CacheWriter w(&data);
+
+    w.bytes(MAGIC, 4);
+    w.u32(VERSION);
+    w.u64(timeStarted_);
+    w.str(sessionName_);
+    w.str(stageName_);
+    w.u8(static_cast<uint8_t>(fighterStates_.count()));
+
+    for (const States& states : fighterStates_)
+    {
+        w.u8(states.fighterID.value());
+        w.str(states.playerName);
+        w.str(states.fighterName);
+        w.u32(static_cast<uint32_t>(states.count()));
+        for (const State& state : states)
+        {
+            w.u64(state.motion.value());
+            w.u32(static_cast<uint32_t>(state.sideData.frameIndex.index()));
+            w.f32(state.sideData.position.x());
+            w.f32(state.sideData.position.y());
+            w.f32(state.sideData.damage);
+            w.f32(state.sideData.shield);
+            w.u16(state.status.value());
+            w.u16(state.flags);
+        }
+    }
+
+    QFile file(fileName);
+    if (file.open(QIODevice::WriteOnly) == false)
+        return false;
+    return file.write(data) == data.size();
+}
+
+// ----------------------------------------------------------------------------
+bool StateCache::load(const QString& fileName)
+{
+    clear();
+
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly) == false)
+        return false;
+
+    const qint64 size = file.size();
+    if (size <= 0 || size > 0x7FFFFFFF)
+        return false;
+
+    const uchar* data = file.map(0, size);
+    if (data == nullptr)
+        return false;
+
+    const bool result = load(data, static_cast<int>(size));
+    file.unmap(const_cast<uchar*>(data));
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+bool StateCache::load(const uint8_t* data, int size)
+{
+    clear();
+
+    CacheReader r(data, size);
+    const uint8_t* magic = r.bytes(4);
+    if (magic == nullptr || memcmp(magic, MAGIC, 4) != 0)
+        return false;
+    if (r.u32() != VERSION)
+        return false;
+
+    timeStarted_ = r.u64();
+    sessionName_ = r.str();
+    stageName_ = r.str();
+
+    const int fighterCount = r.u8();
+    for (int fighterIdx = 0; fighterIdx != fighterCount; ++fighterIdx)
+    {
+        const auto fighterID = rfcommon::FighterID::fromValue(r.u8());
+        const rfcommon::String playerName = r.str();
+        const rfcommon::String fighterName = r.str();
+        const uint32_t stateCount = r.u32();
+
+        // Check the size up front instead of trusting the count when reserving
+        if (r.ok() == false || stateCount > static_cast<uint32_t>(r.remaining() / STATE_SIZE))
+            goto fail;
+
+        States& states = fighterStates_.emplace(fighterID, playerName, fighterName);
+        states.reserve(static_cast<int>(stateCount));
+        for (uint32_t i = 0; i != stateCount; ++i)
+        {
+            const auto motion = rfcommon::FighterMotion::fromValue(r.u64());
+            const auto frameIndex = rfcommon::FrameIndex::fromValue(r.u32());
+            const float x = r.f32();
+            const float y = r.f32();
+            const float damage = r.f32();
+            const float shield = r.f32();
+            const auto status = rfcommon::FighterStatus::fromValue(r.u16());
+            const uint16_t flags = r.u16();
+
+            states.push(State(
+                State::SideData(frameIndex, rfcommon::Vec2::fromValues(x, y), damage, shield),
+                motion, status, flags));
+        }
+    }
+
+    if (r.ok())
+        return true;
+
+fail:
+    clear();
+    return false;
+}
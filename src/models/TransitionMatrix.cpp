@@ -0,0 +1,213 @@
+#include "decision-graph/models/Graph.hpp"
+#include "decision-graph/models/TransitionMatrix.hpp"
+
+#include <cmath>
+
+// ----------------------------------------------------------------------------
+TransitionMatrix::TransitionMatrix()
+{}
+
+// ----------------------------------------------------------------------------
+TransitionMatrix::TransitionMatrix(const Graph& graph)
+{
+    build(graph);
+}
+
+// ----------------------------------------------------------------------------
+TransitionMatrix::~TransitionMatrix()
+{}
+
+// ----------------------------------------------------------------------------
+void TransitionMatrix::clear()
+{
+    rowOffsets_.clear();
+    targets_.clear();
+    edges_.clear();
+    weights_.clear();
+    probabilities_.clear();
+    edgeEntries_.clear();
+    edgeSources_.clear();
+    outgoingTotals_.clear();
+    incomingTotals_.clear();
+    entropies_.clear();
+    stationary_.clear();
+    stationaryDamping_ = -1.0;
+}
+
+// ----------------------------------------------------------------------------
+void TransitionMatrix::build(const Graph& graph)
+{
+    clear();
+
+    const int nodeCount = graph.nodes.count();
+    const int edgeCount = graph.edges.count();
+
+    rowOffsets_.reserve(nodeCount + 1);
+    targets_.reserve(edgeCount);
+    edges_.reserve(edgeCount);
+    weights_.reserve(edgeCount);
+    probabilities_.resize(edgeCount);
+    edgeEntries_.resize(edgeCount);
+    edgeSources_.resize(edgeCount);
+    outgoingTotals_.resize(nodeCount);
+    incomingTotals_.resize(nodeCount);
+    entropies_.resize(nodeCount);
+
+    // The graph's outgoing adjacency lists are already in CSR form, so the
+    // rows can be copied directly
+    rowOffsets_.push(0);
+    for (int nodeIdx = 0; nodeIdx != nodeCount; ++nodeIdx)
+    {
+        incomingTotals_[nodeIdx] = 0;
+        for (int edgeIdx : graph.outgoingEdges(nodeIdx))
+        {
+            edgeEntries_[edgeIdx] = targets_.count();
+            edgeSources_[edgeIdx] = nodeIdx;
+            targets_.push(graph.edges[edgeIdx].to);
+            edges_.push(edgeIdx);
+            weights_.push(graph.edges[edgeIdx].weight);
+        }
+        rowOffsets_.push(targets_.count());
+    }
+
+    for (const auto& edge : graph.edges)
+        incomingTotals_[edge.to] += edge.weight;
+
+    for (int nodeIdx = 0; nodeIdx != nodeCount; ++nodeIdx)
+        updateRow(nodeIdx);
+}
+
+// ----------------------------------------------------------------------------
+void TransitionMatrix::update(const Graph& graph)
+{
+    if (graph.nodes.count() != nodeCount() || graph.edges.count() != edgeCount())
+    {
+        build(graph);
+        return;
+    }
+
+    for (int edgeIdx = 0; edgeIdx != graph.edges.count(); ++edgeIdx)
+        if (weights_[edgeEntries_[edgeIdx]] != graph.edges[edgeIdx].weight)
+            setEdgeWeight(edgeIdx, graph.edges[edgeIdx].weight);
+}
+
+// ----------------------------------------------------------------------------
+void TransitionMatrix::setEdgeWeight(int edgeIdx, int weight)
+{
+    const int entry = edgeEntries_[edgeIdx];
+    const int delta = weight - weights_[entry];
+    if (delta == 0)
+        return;
+
+    weights_[entry] = weight;
+    incomingTotals_[targets_[entry]] += delta;
+    updateRow(edgeSources_[edgeIdx]);
+}
+
+// ----------------------------------------------------------------------------
+void TransitionMatrix::updateRow(int nodeIdx)
+{
+    const int begin = rowOffsets_[nodeIdx];
+    const int end = rowOffsets_[nodeIdx + 1];
+
+    int total = 0;
+    for (int i = begin; i != end; ++i)
+        total += weights_[i];
+    outgoingTotals_[nodeIdx] = total;
+
+    double entropy = 0.0;
+    for (int i = begin; i != end; ++i)
+    {
+        const double p = total > 0 ? (double)weights_[i] / total : 0.0;
+        probabilities_[i] = p;
+        if (p > 0.0)
+            entropy -= p * std::log2(p);
+    }
+    entropies_[nodeIdx] = entropy;
+
+    // Any change invalidates the stationary distribution
+    stationaryDamping_ = -1.0;
+}
+
+// ----------------------------------------------------------------------------
+double TransitionMatrix::probability(int fromNodeIdx, int toNodeIdx) const
+{
+    for (int i = rowOffsets_[fromNodeIdx]; i != rowOffsets_[fromNodeIdx + 1]; ++i)
+        if (targets_[i] == toNodeIdx)
+            return probabilities_[i];
+    return 0.0;
+}
+
+// ----------------------------------------------------------------------------
+int TransitionMatrix::throughput(int nodeIdx) const
+{
+    const int outgoing = outgoingTotals_[nodeIdx];
+    const int incoming = incomingTotals_[nodeIdx];
+    return outgoing < incoming ? outgoing : incoming;
+}
+
+// ----------------------------------------------------------------------------
+int TransitionMatrix::highestThroughputNode() const
+{
+    int highestSeen = 0;
+    int idx = -1;
+    for (int nodeIdx = 0; nodeIdx != nodeCount(); ++nodeIdx)
+        if (highestSeen < throughput(nodeIdx))
+        {
+            highestSeen = throughput(nodeIdx);
+            idx = nodeIdx;
+        }
+
+    return idx;
+}
+
+// ----------------------------------------------------------------------------
+const rfcommon::Vector<double>& TransitionMatrix::stationaryDistribution(
+        double damping, int maxIterations, double tolerance) const
+{
+    const int n = nodeCount();
+    if (stationaryDamping_ == damping && stationary_.count() == n)
+        return stationary_;
+
+    stationary_.resize(n);
+    stationaryDamping_ = damping;
+    if (n == 0)
+        return stationary_;
+
+    rfcommon::Vector<double> next;
+    next.resize(n);
+    for (int i = 0; i != n; ++i)
+        stationary_[i] = 1.0 / n;
+
+    for (int iteration = 0; iteration != maxIterations; ++iteration)
+    {
+        // Mass of dead ends plus the teleport mass is spread evenly
+        double spread = 1.0 - damping;
+        for (int i = 0; i != n; ++i)
+            if (rowOffsets_[i] == rowOffsets_[i + 1])
+                spread += damping * stationary_[i];
+
+        for (int i = 0; i != n; ++i)
+            next[i] = spread / n;
+
+        // Sparse vector-matrix product: next += damping * stationary * P
+        for (int from = 0; from != n; ++from)
+        {
+            const double mass = damping * stationary_[from];
+            for (int i = rowOffsets_[from]; i != rowOffsets_[from + 1]; ++i)
+                next[targets_[i]] += mass * probabilities_[i];
+        }
+
+        double diff = 0.0;
+        for (int i = 0; i != n; ++i)
+        {
+            diff += std::fabs(next[i] - stationary_[i]);
+            stationary_[i] = next[i];
+        }
+
+        if (diff < tolerance)
+            break;
+    }
+
+    return stationary_;
+}
@@ -1,90 +1,54 @@
 #include "decision-graph/parsers/QueryASTNode.hpp"
+#include "decision-graph/util/Arena.hpp"
+#include "decision-graph/util/Str.hpp"
 #include "rfcommon/HashMap.hpp"
-#include <cstdio>
 
 // ----------------------------------------------------------------------------
-QueryASTNode* QueryASTNode::newStatement(QueryASTNode* child, QueryASTNode* next)
+QueryASTNode* QueryASTNode::newStatement(Arena* arena, QueryASTNode* child, QueryASTNode* next)
 {
-    return new QueryASTNode(Statement(child, next));
+    return new (arena->allocate(sizeof(QueryASTNode), alignof(QueryASTNode))) QueryASTNode(Statement(child, next));
 }
 
 // ----------------------------------------------------------------------------
-QueryASTNode* QueryASTNode::newRepitition(QueryASTNode* child, int minreps, int maxreps)
+QueryASTNode* QueryASTNode::newRepitition(Arena* arena, QueryASTNode* child, int minreps, int maxreps)
 {
-    return new QueryASTNode(Repitition(child, minreps, maxreps));
+    return new (arena->allocate(sizeof(QueryASTNode), alignof(QueryASTNode))) QueryASTNode(Repitition(child, minreps, maxreps));
 }
 
 // ----------------------------------------------------------------------------
-QueryASTNode* QueryASTNode::newUnion(QueryASTNode* child, QueryASTNode* next)
+QueryASTNode* QueryASTNode::newUnion(Arena* arena, QueryASTNode* child, QueryASTNode* next)
 {
-    return new QueryASTNode(Union(child, next));
+    return new (arena->allocate(sizeof(QueryASTNode), alignof(QueryASTNode))) QueryASTNode(Union(child, next));
 }
 
 // ----------------------------------------------------------------------------
-QueryASTNode* QueryASTNode::newInversion(QueryASTNode* child)
+QueryASTNode* QueryASTNode::newInversion(Arena* arena, QueryASTNode* child)
 {
-    return new QueryASTNode(Inversion(child));
+    return new (arena->allocate(sizeof(QueryASTNode), alignof(QueryASTNode))) QueryASTNode(Inversion(child));
 }
 
 // ----------------------------------------------------------------------------
-QueryASTNode* QueryASTNode::newWildcard()
+QueryASTNode* QueryASTNode::newWildcard(Arena* arena)
 {
-    return new QueryASTNode(WILDCARD);
+    return new (arena->allocate(sizeof(QueryASTNode), alignof(QueryASTNode))) QueryASTNode(WILDCARD);
 }
 
 // ----------------------------------------------------------------------------
-QueryASTNode* QueryASTNode::newLabel(const char* label)
+QueryASTNode* QueryASTNode::newLabel(Arena* arena, const char* label)
 {
-    return new QueryASTNode(label);
+    return new (arena->allocate(sizeof(QueryASTNode), alignof(QueryASTNode))) QueryASTNode(label);
 }
 
 // ----------------------------------------------------------------------------
-QueryASTNode* QueryASTNode::newLabel(const char* label, const char* oppLabel)
+QueryASTNode* QueryASTNode::newLabel(Arena* arena, const char* label, const char* oppLabel)
 {
-    return new QueryASTNode(label, oppLabel);
+    return new (arena->allocate(sizeof(QueryASTNode), alignof(QueryASTNode))) QueryASTNode(label, oppLabel);
 }
 
 // ----------------------------------------------------------------------------
-QueryASTNode* QueryASTNode::newContextQualifier(QueryASTNode* child, uint8_t contextQualifierFlags)
+QueryASTNode* QueryASTNode::newContextQualifier(Arena* arena, QueryASTNode* child, uint8_t contextQualifierFlags)
 {
-    return new QueryASTNode(ContextQualifier(child, contextQualifierFlags));
-}
-
-// ----------------------------------------------------------------------------
-void QueryASTNode::destroySingle(QueryASTNode* node)
-{
-    delete node;
-}
-
-// ----------------------------------------------------------------------------
-void QueryASTNode::destroyRecurse(QueryASTNode* node)
-{
-    switch (node->type)
-    {
-    case STATEMENT:
-        destroyRecurse(node->statement.child);
-        destroyRecurse(node->statement.next);
-        break;
-    case REPITITION:
-        destroyRecurse(node->repitition.child);
-        break;
-    case UNION:
-        destroyRecurse(node->union_.child);
-        destroyRecurse(node->union_.next);
-        break;
-    case INVERSION:
-        destroyRecurse(node->inversion.child);
-        break;
-    case WILDCARD:
-        break;
-    case LABEL:
-        break;
-    case CONTEXT_QUALIFIER:
-        destroyRecurse(node->contextQualifier.child);
-        break;
-    }
-
-    destroySingle(node);
+    return new (arena->allocate(sizeof(QueryASTNode), alignof(QueryASTNode))) QueryASTNode(ContextQualifier(child, contextQualifierFlags));
 }
 
 // ----------------------------------------------------------------------------
@@ -119,116 +83,126 @@ static void calculateNodeIDs(const QueryASTNode* node, rfcommon::HashMap<const Q
     }
 }
 
-static void writeNodes(const QueryASTNode* node, FILE* fp, const rfcommon::HashMap<const QueryASTNode*, int>& nodeIDs)
+static void writeNodes(const QueryASTNode* node, rfcommon::String* out, const rfcommon::HashMap<const QueryASTNode*, int>& nodeIDs)
 {
     const int nodeID = nodeIDs.find(node)->value();
     switch (node->type)
     {
     case QueryASTNode::STATEMENT:
-        fprintf(fp, "  n%d [label=\"->\"];\n", nodeID);
-        writeNodes(node->statement.child, fp, nodeIDs);
-        writeNodes(node->statement.next, fp, nodeIDs);
+        StrAppendf(out, "  n%d [label=\"->\"];\n", nodeID);
+        writeNodes(node->statement.child, out, nodeIDs);
+        writeNodes(node->statement.next, out, nodeIDs);
         break;
     case QueryASTNode::REPITITION:
-        fprintf(fp, "  n%d [label=\"rep %d,%d\"];\n",
+        StrAppendf(out, "  n%d [label=\"rep %d,%d\"];\n",
                 nodeID, node->repitition.minreps, node->repitition.maxreps);
-        writeNodes(node->repitition.child, fp, nodeIDs);
+        writeNodes(node->repitition.child, out, nodeIDs);
         break;
     case QueryASTNode::UNION:
-        fprintf(fp, "  n%d [label=\"|\"];\n", nodeID);
-        writeNodes(node->union_.child, fp, nodeIDs);
-        writeNodes(node->union_.next, fp, nodeIDs);
+        StrAppendf(out, "  n%d [label=\"|\"];\n", nodeID);
+        writeNodes(node->union_.child, out, nodeIDs);
+        writeNodes(node->union_.next, out, nodeIDs);
         break;
     case QueryASTNode::INVERSION:
-        fprintf(fp, "  n%d [label=\"!\"];\n", nodeID);
-        writeNodes(node->inversion.child, fp, nodeIDs);
+        StrAppendf(out, "  n%d [label=\"!\"];\n", nodeID);
+        writeNodes(node->inversion.child, out, nodeIDs);
         break;
     case QueryASTNode::WILDCARD:
-        fprintf(fp, "  n%d [shape=\"rectangle\",label=\".\"];\n", nodeID);
+        StrAppendf(out, "  n%d [shape=\"rectangle\",label=\".\"];\n", nodeID);
         break;
     case QueryASTNode::LABEL:
-        if (node->labels.oppLabel.length())
-            fprintf(fp, "  n%d [shape=\"rectangle\",label=\"%s [%s]\"];\n",
-                    nodeID, node->labels.label.cStr(), node->labels.oppLabel.cStr());
+        if (node->labels.oppLabel[0] != '\0')
+            StrAppendf(out, "  n%d [shape=\"rectangle\",label=\"%s [%s]\"];\n",
+                    nodeID, node->labels.label, node->labels.oppLabel);
         else
-            fprintf(fp, "  n%d [shape=\"rectangle\",label=\"%s\"];\n",
-                    nodeID, node->labels.label.cStr());
+            StrAppendf(out, "  n%d [shape=\"rectangle\",label=\"%s\"];\n",
+                    nodeID, node->labels.label);
         break;
     case QueryASTNode::CONTEXT_QUALIFIER: {
-        rfcommon::SmallVector<rfcommon::SmallString<5>, 5> flags;
+        rfcommon::SmallVector<rfcommon::SmallString<8>, 8> flags;
         if (!!(node->contextQualifier.flags & QueryASTNode::OS))
             flags.emplace("OS");
         if (!!(node->contextQualifier.flags & QueryASTNode::HIT))
             flags.emplace("HIT");
+        if (!!(node->contextQualifier.flags & QueryASTNode::OOS))
+            flags.emplace("OOS");
         if (!!(node->contextQualifier.flags & QueryASTNode::WHIFF))
             flags.emplace("WHIFF");
-
-        fprintf(fp, "  n%d [shape=\"record\",label=\"", nodeID);
+        if (!!(node->contextQualifier.flags & QueryASTNode::RISING))
+            flags.emplace("RISING");
+        if (!!(node->contextQualifier.flags & QueryASTNode::FALLING))
+            flags.emplace("FALLING");
+        if (!!(node->contextQualifier.flags & QueryASTNode::IDJ))
+            flags.emplace("IDJ");
+        if (!!(node->contextQualifier.flags & QueryASTNode::GROUNDED))
+            flags.emplace("GROUNDED");
+
+        StrAppendf(out, "  n%d [shape=\"record\",label=\"", nodeID);
         for (int i = 0; i != flags.count(); ++i)
         {
             if (i == 0)
-                fprintf(fp, "%s", flags[i].cStr());
+                StrAppendf(out, "%s", flags[i].cStr());
             else
-                fprintf(fp, " | %s", flags[i].cStr());
+                StrAppendf(out, " | %s", flags[i].cStr());
         }
-        fprintf(fp, "\"];\n");
-        writeNodes(node->contextQualifier.child, fp, nodeIDs);
+        StrAppendf(out, "\"];\n");
+        writeNodes(node->contextQualifier.child, out, nodeIDs);
     } break;
     }
 }
 
-static void writeEdges(const QueryASTNode* node, FILE* fp, const rfcommon::HashMap<const QueryASTNode*, int>& nodeIDs)
+static void writeEdges(const QueryASTNode* node, rfcommon::String* out, const rfcommon::HashMap<const QueryASTNode*, int>& nodeIDs)
 {
     switch (node->type)
     {
     case QueryASTNode::STATEMENT:
-        fprintf(fp, "  n%d -> n%d;\n",
+        StrAppendf(out, "  n%d -> n%d;\n",
             nodeIDs.find(node)->value(), nodeIDs.find(node->statement.child)->value());
-        fprintf(fp, "  n%d -> n%d;\n",
+        StrAppendf(out, "  n%d -> n%d;\n",
             nodeIDs.find(node)->value(), nodeIDs.find(node->statement.next)->value());
-        writeEdges(node->statement.child, fp, nodeIDs);
-        writeEdges(node->statement.next, fp, nodeIDs);
+        writeEdges(node->statement.child, out, nodeIDs);
+        writeEdges(node->statement.next, out, nodeIDs);
         break;
     case QueryASTNode::REPITITION:
-        fprintf(fp, "  n%d -> n%d;\n",
+        StrAppendf(out, "  n%d -> n%d;\n",
             nodeIDs.find(node)->value(), nodeIDs.find(node->repitition.child)->value());
-        writeEdges(node->repitition.child, fp, nodeIDs);
+        writeEdges(node->repitition.child, out, nodeIDs);
         break;
     case QueryASTNode::UNION:
-        fprintf(fp, "  n%d -> n%d;\n",
+        StrAppendf(out, "  n%d -> n%d;\n",
             nodeIDs.find(node)->value(), nodeIDs.find(node->union_.child)->value());
-        fprintf(fp, "  n%d -> n%d;\n",
+        StrAppendf(out, "  n%d -> n%d;\n",
             nodeIDs.find(node)->value(), nodeIDs.find(node->union_.next)->value());
-        writeEdges(node->union_.child, fp, nodeIDs);
-        writeEdges(node->union_.next, fp, nodeIDs);
+        writeEdges(node->union_.child, out, nodeIDs);
+        writeEdges(node->union_.next, out, nodeIDs);
         break;
     case QueryASTNode::INVERSION:
-        fprintf(fp, "  n%d -> n%d;\n",
+        StrAppendf(out, "  n%d -> n%d;\n",
             nodeIDs.find(node)->value(), nodeIDs.find(node->inversion.child)->value());
-        writeEdges(node->inversion.child, fp, nodeIDs);
+        writeEdges(node->inversion.child, out, nodeIDs);
         break;
     case QueryASTNode::WILDCARD:
         break;
     case QueryASTNode::LABEL:
         break;
     case QueryASTNode::CONTEXT_QUALIFIER:
-        fprintf(fp, "  n%d -> n%d;\n",
+        StrAppendf(out, "  n%d -> n%d;\n",
             nodeIDs.find(node)->value(), nodeIDs.find(node->contextQualifier.child)->value());
-        writeEdges(node->contextQualifier.child, fp, nodeIDs);
+        writeEdges(node->contextQualifier.child, out, nodeIDs);
         break;
     }
 }
 
-void QueryASTNode::exportDOT(const char* filename) const
+rfcommon::String QueryASTNode::toDOT() const
 {
     int counter = 0;
     rfcommon::HashMap<const QueryASTNode*, int> nodeIDs;
     calculateNodeIDs(this, &nodeIDs, &counter);
 
-    FILE* fp = fopen(filename, "w");
-    fprintf(fp, "digraph ast {\n");
-        writeNodes(this, fp, nodeIDs);
-        writeEdges(this, fp, nodeIDs);
-    fprintf(fp, "}\n");
-    fclose(fp);
+    rfcommon::String out;
+    StrAppendf(&out, "digraph ast {\n");
+        writeNodes(this, &out, nodeIDs);
+        writeEdges(this, &out, nodeIDs);
+    StrAppendf(&out, "}\n");
+    return out;
 }
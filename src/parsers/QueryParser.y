@@ -6,10 +6,10 @@
     #include "decision-graph/parsers/QueryParser.y.hpp"
     #include "decision-graph/parsers/QueryScanner.lex.hpp"
     #include "decision-graph/parsers/QueryASTNode.hpp"
-    #include "decision-graph/util/Str.hpp"
+    #include "decision-graph/util/Arena.hpp"
 
     static void addDamageRangeChild(QueryASTNode* root, QueryASTNode* child);
-    static void qperror(qpscan_t scanner, const char* msg, ...);
+    static void qperror(QueryASTNode** ast, Arena* arena, const char* msg, ...);
 }
 
 %code requires
@@ -22,6 +22,7 @@
 
     typedef void* qpscan_t;
     typedef struct qppstate qppstate;
+    class Arena;
 }
 
 /*
@@ -56,6 +57,12 @@
  */
 %parse-param {QueryASTNode** ast}
 
+/*
+ * Nodes and label strings are allocated from this arena, so nothing has to be
+ * freed if parsing fails half way
+ */
+%parse-param {Arena* arena}
+
 %define api.token.prefix {TOK_}
 
 /* This is the union that will become known as QPSTYPE in the generated code */
@@ -66,9 +73,6 @@
     struct QueryASTNode* node_value;
 }
 
-%destructor { StrFree($$); } <string_value>
-%destructor { QueryASTNode::destroyRecurse($$); } <node_value>
-
 %token '.' '*' '+' '?' '(' ')' '|' '!'
 %token INTO
 %token OS
@@ -81,6 +85,7 @@
 %token FH
 %token DJ
 %token IDJ
+%token GROUNDED
 %token<integer_value> NUM
 %token<integer_value> PERCENT
 %token<string_value> LABEL
@@ -97,37 +102,37 @@ query
   : stmnts                        { *ast = $1; }
   ;
 stmnts
-  : stmnts INTO stmnt             { $$ = QueryASTNode::newStatement($1, $3); }
+  : stmnts INTO stmnt             { $$ = QueryASTNode::newStatement(arena, $1, $3); }
   | stmnt                         { $$ = $1; }
   ;
 stmnt
-  : pre_qual union post_qual      { $$ = QueryASTNode::newContextQualifier($2, $1 | $3); }
-  | union post_qual               { $$ = QueryASTNode::newContextQualifier($1, $2); }
-  | pre_qual union                { $$ = QueryASTNode::newContextQualifier($2, $1); }
+  : pre_qual union post_qual      { $$ = QueryASTNode::newContextQualifier(arena, $2, $1 | $3); }
+  | union post_qual               { $$ = QueryASTNode::newContextQualifier(arena, $1, $2); }
+  | pre_qual union                { $$ = QueryASTNode::newContextQualifier(arena, $2, $1); }
   | union                         { $$ = $1; }
   ;
 union
-  : union '|' union               { $$ = QueryASTNode::newUnion($1, $3); }
+  : union '|' union               { $$ = QueryASTNode::newUnion(arena, $1, $3); }
   | repitition                    { $$ = $1; }
   ;
 repitition
-  : inversion '+'                 { $$ = QueryASTNode::newRepitition($1, 1, -1); }
-  | inversion '*'                 { $$ = QueryASTNode::newRepitition($1, 0, -1); }
-  | inversion '?'                 { $$ = QueryASTNode::newRepitition($1, 0, 1); }
-  | inversion NUM                 { $$ = QueryASTNode::newRepitition($1, $2, $2); }
-  | inversion NUM ',' NUM         { $$ = QueryASTNode::newRepitition($1, $2, $4); }
-  | inversion NUM ',' '+'         { $$ = QueryASTNode::newRepitition($1, $2, -1); }
-  | inversion NUM ',' '*'         { $$ = QueryASTNode::newRepitition($1, $2, -1); }
+  : inversion '+'                 { $$ = QueryASTNode::newRepitition(arena, $1, 1, -1); }
+  | inversion '*'                 { $$ = QueryASTNode::newRepitition(arena, $1, 0, -1); }
+  | inversion '?'                 { $$ = QueryASTNode::newRepitition(arena, $1, 0, 1); }
+  | inversion NUM                 { $$ = QueryASTNode::newRepitition(arena, $1, $2, $2); }
+  | inversion NUM ',' NUM         { $$ = QueryASTNode::newRepitition(arena, $1, $2, $4); }
+  | inversion NUM ',' '+'         { $$ = QueryASTNode::newRepitition(arena, $1, $2, -1); }
+  | inversion NUM ',' '*'         { $$ = QueryASTNode::newRepitition(arena, $1, $2, -1); }
   | inversion                     { $$ = $1; }
   ;
 inversion
-  : '!' label                     { $$ = QueryASTNode::newInversion($2); }
+  : '!' label                     { $$ = QueryASTNode::newInversion(arena, $2); }
   | label                         { $$ = $1; }
-  | '.'                           { $$ = QueryASTNode::newWildcard(); }
+  | '.'                           { $$ = QueryASTNode::newWildcard(arena); }
   | '(' stmnts ')'                { $$ = $2; }
   ;
 label
-  : LABEL                         { $$ = QueryASTNode::newLabel($1); StrFree($1); }
+  : LABEL                         { $$ = QueryASTNode::newLabel(arena, $1); }
   ;
 pre_qual
   : pre_qual '|' pre_qual         { $$ = $1; $$ |= $3; }
@@ -135,6 +140,7 @@ pre_qual
   | IDJ                           { $$ = QueryASTNode::IDJ; }
   | FALLING                       { $$ = QueryASTNode::FALLING; }
   | RISING                        { $$ = QueryASTNode::RISING; }
+  | GROUNDED                      { $$ = QueryASTNode::GROUNDED; }
   ;
 post_qual
   : post_qual '|' post_qual       { $$ = $1; $$ |= $3; }
@@ -146,6 +152,6 @@ post_qual
   ;
 %%
 
-static void qperror(qpscan_t scanner, const char* msg, ...)
+static void qperror(QueryASTNode** ast, Arena* arena, const char* msg, ...)
 {
 }
@@ -0,0 +1,68 @@
+#include "decision-graph/util/Arena.hpp"
+
+#include <cstdlib>
+
+// ----------------------------------------------------------------------------
+Arena::Arena(int blockSize)
+    : blockSize_(blockSize)
+{}
+
+// ----------------------------------------------------------------------------
+Arena::~Arena()
+{
+    while (blocks_)
+    {
+        Block* next = blocks_->next;
+        free(blocks_);
+        blocks_ = next;
+    }
+}
+
+// ----------------------------------------------------------------------------
+void* Arena::allocateBlock(int size, int align)
+{
+    // Blocks double in size so the number of blocks stays logarithmic in the
+    // total amount allocated
+    int blockSize = blocks_ ? blocks_->size * 2 : blockSize_;
+    while (blockSize < size + align + static_cast<int>(sizeof(Block)))
+        blockSize *= 2;
+
+    Block* block = static_cast<Block*>(malloc(blockSize));
+    block->next = blocks_;
+    block->size = blockSize;
+    blocks_ = block;
+
+    const uintptr_t p = (reinterpret_cast<uintptr_t>(block + 1) + (align - 1)) & ~static_cast<uintptr_t>(align - 1);
+    head_ = reinterpret_cast<char*>(p + size);
+    end_ = reinterpret_cast<char*>(block) + blockSize;
+    return reinterpret_cast<void*>(p);
+}
+
+// ----------------------------------------------------------------------------
+void Arena::reset()
+{
+    if (blocks_ == nullptr)
+        return;
+
+    // The most recent block is also the largest
+    Block* next = blocks_->next;
+    while (next)
+    {
+        Block* after = next->next;
+        free(next);
+        next = after;
+    }
+    blocks_->next = nullptr;
+
+    head_ = reinterpret_cast<char*>(blocks_ + 1);
+    end_ = reinterpret_cast<char*>(blocks_) + blocks_->size;
+}
+
+// ----------------------------------------------------------------------------
+int Arena::capacity() const
+{
+    int total = 0;
+    for (const Block* block = blocks_; block; block = block->next)
+        total += block->size;
+    return total;
+}
@@ -0,0 +1,54 @@
+#include "decision-graph/util/DisjointSet.hpp"
+#include <utility>
+
+// ----------------------------------------------------------------------------
+DisjointSet::DisjointSet()
+{}
+
+// ----------------------------------------------------------------------------
+DisjointSet::DisjointSet(int count)
+    : parents_(rfcommon::Vector<int>::makeResized(count))
+    , sizes_(rfcommon::Vector<int>::makeResized(count))
+    , setCount_(count)
+{
+    for (int i = 0; i != count; ++i)
+    {
+        parents_[i] = i;
+        sizes_[i] = 1;
+    }
+}
+
+// ----------------------------------------------------------------------------
+void DisjointSet::clear()
+{
+    parents_.clearCompact();
+    sizes_.clearCompact();
+    setCount_ = 0;
+}
+
+// ----------------------------------------------------------------------------
+int DisjointSet::add()
+{
+    parents_.push(parents_.count());
+    sizes_.push(1);
+    setCount_++;
+    return parents_.count() - 1;
+}
+
+// ----------------------------------------------------------------------------
+bool DisjointSet::unite(int a, int b)
+{
+    a = find(a);
+    b = find(b);
+    if (a == b)
+        return false;
+
+    // Union by size keeps the trees shallow
+    if (sizes_[a] < sizes_[b])
+        std::swap(a, b);
+    parents_[b] = a;
+    sizes_[a] += sizes_[b];
+    setCount_--;
+
+    return true;
+}
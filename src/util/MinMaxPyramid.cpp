@@ -0,0 +1,124 @@
+#include "decision-graph/util/MinMaxPyramid.hpp"
+
+#include <algorithm>
+
+// ----------------------------------------------------------------------------
+MinMaxPyramid::MinMaxPyramid()
+{}
+
+// ----------------------------------------------------------------------------
+MinMaxPyramid::~MinMaxPyramid()
+{}
+
+// ----------------------------------------------------------------------------
+void MinMaxPyramid::clear()
+{
+    x_.clear();
+    y_.clear();
+    levels_.clear();
+}
+
+// ----------------------------------------------------------------------------
+void MinMaxPyramid::buildLevel(int level)
+{
+    // Summarizes the entire level below. This only happens when the number
+    // of samples doubles, so the cost is amortized
+    rfcommon::Vector<Block>& blocks = levels_[level];
+    blocks.clear();
+
+    if (level == 0)
+    {
+        for (int i = 0; i < x_.count(); i += 2)
+        {
+            const int j = std::min(i + 1, x_.count() - 1);
+            blocks.push({x_[i], x_[j], std::min(y_[i], y_[j]), std::max(y_[i], y_[j])});
+        }
+    }
+    else
+    {
+        const rfcommon::Vector<Block>& below = levels_[level - 1];
+        for (int i = 0; i < below.count(); i += 2)
+        {
+            const int j = std::min(i + 1, below.count() - 1);
+            blocks.push({
+                below[i].xFirst, below[j].xLast,
+                std::min(below[i].min, below[j].min),
+                std::max(below[i].max, below[j].max)});
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+void MinMaxPyramid::append(double x, float y)
+{
+    x_.push(x);
+    y_.push(y);
+
+    const int sampleIdx = x_.count() - 1;
+    for (int level = 0; ; ++level)
+    {
+        if (level == levels_.count())
+        {
+            // Only add another level once the level below has more than one
+            // entry to summarize
+            const int below = level == 0 ? x_.count() : levels_[level - 1].count();
+            if (below <= 1)
+                break;
+
+            levels_.emplace();
+            buildLevel(level);
+            continue;
+        }
+
+        rfcommon::Vector<Block>& blocks = levels_[level];
+        const int blockIdx = sampleIdx >> (level + 1);
+        if (blockIdx == blocks.count())
+            blocks.push({x, x, y, y});
+        else
+        {
+            Block& block = blocks.back();
+            block.xLast = x;
+            block.min = std::min(block.min, y);
+            block.max = std::max(block.max, y);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+void MinMaxPyramid::query(double xMin, double xMax, int maxPoints, QVector<QPointF>* out) const
+{
+    if (x_.count() == 0)
+        return;
+
+    // Range of raw samples, plus one on either side
+    int lo = static_cast<int>(std::lower_bound(x_.begin(), x_.end(), xMin) - x_.begin());
+    int hi = static_cast<int>(std::upper_bound(x_.begin(), x_.end(), xMax) - x_.begin());
+    lo = std::max(lo - 1, 0);
+    hi = std::min(hi + 1, x_.count());
+    if (lo >= hi)
+        return;
+
+    if (hi - lo <= maxPoints)
+    {
+        for (int i = lo; i != hi; ++i)
+            out->push_back(QPointF(x_[i], y_[i]));
+        return;
+    }
+
+    // Each block produces two points. Find the finest level that stays
+    // within the budget
+    int level = 0;
+    while (level < levels_.count() - 1 && (((hi - lo) >> (level + 1)) + 1) * 2 > maxPoints)
+        level++;
+
+    const rfcommon::Vector<Block>& blocks = levels_[level];
+    const int first = lo >> (level + 1);
+    const int last = std::min((hi - 1) >> (level + 1), blocks.count() - 1);
+    for (int i = first; i <= last; ++i)
+    {
+        const Block& block = blocks[i];
+        const double x = (block.xFirst + block.xLast) / 2.0;
+        out->push_back(QPointF(x, block.min));
+        out->push_back(QPointF(x, block.max));
+    }
+}
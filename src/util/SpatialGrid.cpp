@@ -0,0 +1,100 @@
+#include "decision-graph/util/SpatialGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Upper limit on the number of cells along each axis
+static const int MAX_CELLS_PER_AXIS = 256;
+
+// ----------------------------------------------------------------------------
+SpatialGrid::SpatialGrid()
+{}
+
+// ----------------------------------------------------------------------------
+SpatialGrid::~SpatialGrid()
+{}
+
+// ----------------------------------------------------------------------------
+void SpatialGrid::clear()
+{
+    bounds_ = QRectF();
+    cellsX_ = 0;
+    cellsY_ = 0;
+    cellOffsets_.clear();
+    cellItems_.clear();
+    stamps_.clear();
+    stamp_ = 0;
+}
+
+// ----------------------------------------------------------------------------
+bool SpatialGrid::cellRange(const QRectF& area, int* x1, int* y1, int* x2, int* y2) const
+{
+    if (area.right() < bounds_.left() || area.left() > bounds_.right())
+        return false;
+    if (area.bottom() < bounds_.top() || area.top() > bounds_.bottom())
+        return false;
+
+    *x1 = std::clamp((int)((area.left() - bounds_.left()) / cellW_), 0, cellsX_ - 1);
+    *y1 = std::clamp((int)((area.top() - bounds_.top()) / cellH_), 0, cellsY_ - 1);
+    *x2 = std::clamp((int)((area.right() - bounds_.left()) / cellW_), 0, cellsX_ - 1);
+    *y2 = std::clamp((int)((area.bottom() - bounds_.top()) / cellH_), 0, cellsY_ - 1);
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+void SpatialGrid::build(const rfcommon::Vector<QRectF>& boxes)
+{
+    clear();
+    if (boxes.count() == 0)
+        return;
+
+    double totalArea = 0.0;
+    bounds_ = boxes[0];
+    for (const QRectF& box : boxes)
+    {
+        bounds_ = bounds_.united(box);
+        totalArea += box.width() * box.height();
+    }
+
+    // Aim for cells that are a few times larger than the average box, so
+    // most boxes only land in one or two cells
+    const double avgSide = std::sqrt(totalArea / boxes.count());
+    const double cellSize = std::max(avgSide * 4.0, 1.0);
+    cellsX_ = std::clamp((int)std::ceil(bounds_.width() / cellSize), 1, MAX_CELLS_PER_AXIS);
+    cellsY_ = std::clamp((int)std::ceil(bounds_.height() / cellSize), 1, MAX_CELLS_PER_AXIS);
+    cellW_ = std::max(bounds_.width() / cellsX_, 1e-6);
+    cellH_ = std::max(bounds_.height() / cellsY_, 1e-6);
+
+    // Two passes: count items per cell, then fill (counting sort)
+    cellOffsets_.resize(cellsX_ * cellsY_ + 1);
+    for (auto& offset : cellOffsets_)
+        offset = 0;
+
+    for (const QRectF& box : boxes)
+    {
+        int x1, y1, x2, y2;
+        cellRange(box, &x1, &y1, &x2, &y2);
+        for (int y = y1; y <= y2; ++y)
+            for (int x = x1; x <= x2; ++x)
+                cellOffsets_[y * cellsX_ + x + 1]++;
+    }
+
+    for (int cell = 0; cell != cellsX_ * cellsY_; ++cell)
+        cellOffsets_[cell + 1] += cellOffsets_[cell];
+
+    rfcommon::Vector<int> insertPos = cellOffsets_;
+    cellItems_.resize(cellOffsets_.back());
+    for (int idx = 0; idx != boxes.count(); ++idx)
+    {
+        int x1, y1, x2, y2;
+        cellRange(boxes[idx], &x1, &y1, &x2, &y2);
+        for (int y = y1; y <= y2; ++y)
+            for (int x = x1; x <= x2; ++x)
+                cellItems_[insertPos[y * cellsX_ + x]++] = idx;
+    }
+
+    stamps_.resize(boxes.count());
+    for (auto& s : stamps_)
+        s = 0;
+}
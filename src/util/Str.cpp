@@ -1,6 +1,9 @@
 #include "decision-graph/util/Str.hpp"
+#include "rfcommon/String.hpp"
 #include <cstring>
 #include <cstdlib>
+#include <cstdio>
+#include <cstdarg>
 
 // ----------------------------------------------------------------------------
 char* StrDup(const char* s)
@@ -16,3 +19,30 @@ void StrFree(char* s)
 {
     free(s);
 }
+
+// ----------------------------------------------------------------------------
+void StrAppendf(rfcommon::String* str, const char* fmt, ...)
+{
+    char stackBuf[256];
+    va_list args;
+
+    va_start(args, fmt);
+    int len = vsnprintf(stackBuf, sizeof(stackBuf), fmt, args);
+    va_end(args);
+
+    if (len < 0)
+        return;
+    if (len < (int)sizeof(stackBuf))
+    {
+        *str += stackBuf;
+        return;
+    }
+
+    char* heapBuf = (char*)malloc(len + 1);
+    va_start(args, fmt);
+    vsnprintf(heapBuf, len + 1, fmt, args);
+    va_end(args);
+
+    *str += heapBuf;
+    free(heapBuf);
+}
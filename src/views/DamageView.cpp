@@ -1,12 +1,30 @@
 #include "decision-graph/views/DamageView.hpp"
+#include "decision-graph/models/Diagnostics.hpp"
 #include "decision-graph/models/SequenceSearchModel.hpp"
 
+#include "qwt_plot.h"
+#include "qwt_plot_histogram.h"
+
+#include <QVBoxLayout>
+
 // ----------------------------------------------------------------------------
 DamageView::DamageView(SequenceSearchModel* model, rfcommon::MotionLabels* labels, QWidget* parent)
     : QWidget(parent)
     , model_(model)
     , labels_(labels)
+    , plot_(new QwtPlot)
 {
+    plot_->setPalette(Qt::white);
+    plot_->setTitle("Damage Distribution");
+    plot_->setAxisTitle(QwtPlot::xBottom, "Damage (%)");
+    plot_->setAxisAutoScale(QwtPlot::xBottom);
+    plot_->setAxisAutoScale(QwtPlot::yLeft);
+
+    QVBoxLayout* l = new QVBoxLayout;
+    l->addWidget(plot_);
+    setLayout(l);
+
+    updateTime_ = model_->diagnostics()->metrics()->histogram("view.damage");
     model_->dispatcher.addListener(this);
 }
 
@@ -16,11 +34,99 @@ DamageView::~DamageView()
     model_->dispatcher.removeListener(this);
 }
 
+// ----------------------------------------------------------------------------
+void DamageView::setBucketSize(int percent)
+{
+    // Re-bucketing only searches the already sorted damage values
+    histogram_.setBucketSize(static_cast<float>(percent));
+    updatePlot();
+}
+
+// ----------------------------------------------------------------------------
+void DamageView::updateHistogram()
+{
+    if (model_->playerPOV() < 0)
+    {
+        histogram_.clear();
+        updatePlot();
+        return;
+    }
+
+    const States& states = model_->fighterStates(model_->playerPOV());
+    histogram_.setSize(model_->queryCount(), model_->sessionCount());
+    for (int queryIdx = 0; queryIdx != model_->queryCount(); ++queryIdx)
+        for (int sessionIdx = 0; sessionIdx != model_->sessionCount(); ++sessionIdx)
+            histogram_.updateSession(queryIdx, sessionIdx, states, model_->sessionMatches(queryIdx, sessionIdx));
+
+    updatePlot();
+}
+
+// ----------------------------------------------------------------------------
+void DamageView::updatePlot()
+{
+    while (plotData_.count() > histogram_.queryCount())
+    {
+        plotData_.back()->detach();
+        delete plotData_.back();
+        plotData_.erase(plotData_.count() - 1);
+    }
+    while (plotData_.count() < histogram_.queryCount())
+    {
+        QwtPlotHistogram* data = new QwtPlotHistogram;
+        data->attach(plot_);
+        plotData_.push(data);
+    }
+
+    const int queryCount = histogram_.queryCount();
+    const double bucketSize = histogram_.bucketSize();
+    for (int queryIdx = 0; queryIdx != queryCount; ++queryIdx)
+    {
+        // Same color scheme as the breakdown chart in PieChartView
+        QColor color = queryCount == 1 ?
+            QColor::fromHsv(200, 219, 64) : queryIdx * 2 < queryCount ?
+            QColor::fromHsv(200, queryIdx * (219 - 30) * 2 / queryCount + 30, 255) :
+            QColor::fromHsv(200, 219, (queryCount - queryIdx - 1) * 2 * (255 - 64) / queryCount + 64);
+        color.setAlpha(queryCount == 1 ? 255 : 160);
+
+        // Bars of different queries are placed side by side within a bucket
+        const double barWidth = bucketSize / queryCount;
+        QVector<QwtIntervalSample> samples;
+        const auto& counts = histogram_.counts(queryIdx);
+        for (int i = 0; i != counts.count(); ++i)
+        {
+            const double start = i * bucketSize + queryIdx * barWidth;
+            samples.push_back(QwtIntervalSample(counts[i], start, start + barWidth));
+        }
+
+        if (queryIdx < model_->queryCount())
+            plotData_[queryIdx]->setTitle(QString::fromUtf8(model_->playerQuery(queryIdx).cStr()));
+        plotData_[queryIdx]->setBrush(color);
+        plotData_[queryIdx]->setSamples(samples);
+    }
+
+    plot_->replot();
+}
+
 // ----------------------------------------------------------------------------
 void DamageView::onNewSessions() {}
-void DamageView::onClearAll() {}
+void DamageView::onClearAll()
+{
+    histogram_.clear();
+    updatePlot();
+}
 void DamageView::onDataAdded() {}
-void DamageView::onPOVChanged() {}
+void DamageView::onPOVChanged()
+{
+    // Damage values belong to a different fighter now. The sessions'
+    // signatures only cover the match ranges, so they have to be dropped
+    // before the next update reads the new fighter's states
+    histogram_.clear();
+    updatePlot();
+}
 void DamageView::onQueriesChanged() {}
 void DamageView::onQueryCompiled(int queryIdx, bool success, const char* error, bool oppSuccess, const char* oppError) {}
-void DamageView::onQueriesApplied() {}
+void DamageView::onQueriesApplied()
+{
+    PipelineTimer timer(updateTime_);
+    updateHistogram();
+}
@@ -1,12 +1,18 @@
 #include "decision-graph/views/HeatMapView.hpp"
+#include "decision-graph/models/Diagnostics.hpp"
+#include "decision-graph/models/FrameScheduler.hpp"
 #include "decision-graph/models/SequenceSearchModel.hpp"
 
+#include <QPainter>
+
 // ----------------------------------------------------------------------------
 HeatMapView::HeatMapView(SequenceSearchModel* model, rfcommon::MotionLabels* labels, QWidget* parent)
     : QWidget(parent)
     , model_(model)
     , labels_(labels)
 {
+    updateTime_ = model_->diagnostics()->metrics()->histogram("view.heatmap");
+    model_->frameScheduler()->addConsumer(this, "heatmap");
     model_->dispatcher.addListener(this);
 }
 
@@ -14,13 +20,104 @@ HeatMapView::HeatMapView(SequenceSearchModel* model, rfcommon::MotionLabels* lab
 HeatMapView::~HeatMapView()
 {
     model_->dispatcher.removeListener(this);
+    model_->frameScheduler()->removeConsumer(this);
+}
+
+// ----------------------------------------------------------------------------
+void HeatMapView::setBlurRadius(float sigma)
+{
+    heatMap_.setBlurRadius(sigma);
+    update();
+}
+
+// ----------------------------------------------------------------------------
+void HeatMapView::setLogScale(bool enable)
+{
+    heatMap_.setLogScale(enable);
+    update();
+}
+
+// ----------------------------------------------------------------------------
+void HeatMapView::updateHeatMap()
+{
+    if (model_->playerPOV() < 0)
+    {
+        heatMap_.clear();
+        update();
+        return;
+    }
+
+    // Only sessions whose matches changed are re-binned
+    const States& states = model_->fighterStates(model_->playerPOV());
+    heatMap_.setSessionCount(model_->sessionCount());
+    rfcommon::Vector<const rfcommon::Vector<Range>*> rangeLists;
+    for (int sessionIdx = 0; sessionIdx != model_->sessionCount(); ++sessionIdx)
+    {
+        rangeLists.clear();
+        for (int queryIdx = 0; queryIdx != model_->queryCount(); ++queryIdx)
+            rangeLists.push(&model_->sessionMatches(queryIdx, sessionIdx));
+        heatMap_.updateSession(sessionIdx, states, rangeLists);
+    }
+
+    update();
+}
+
+// ----------------------------------------------------------------------------
+void HeatMapView::paintEvent(QPaintEvent* event)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::white);
+
+    if (heatMap_.sampleCount() == 0)
+        return;
+
+    // Keep the aspect ratio of stage space. The image is only regenerated if
+    // the data or the settings changed, so resizing is cheap
+    const float stageW = heatMap_.right() - heatMap_.left();
+    const float stageH = heatMap_.top() - heatMap_.bottom();
+    const qreal scale = std::min(width() / stageW, height() / stageH);
+    const QSizeF size(stageW * scale, stageH * scale);
+    const QRectF target(
+        QPointF((width() - size.width()) / 2, (height() - size.height()) / 2),
+        size);
+
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.drawImage(target, heatMap_.image());
+
+    // Mark the stage origin, which is usually the center of the main platform
+    const qreal originX = target.left() + (0.0f - heatMap_.left()) * scale;
+    const qreal originY = target.top() + (heatMap_.top() - 0.0f) * scale;
+    painter.setPen(QPen(Qt::gray, 1, Qt::DashLine));
+    painter.drawLine(QLineF(target.left(), originY, target.right(), originY));
+    painter.drawLine(QLineF(originX, target.top(), originX, target.bottom()));
 }
 
 // ----------------------------------------------------------------------------
 void HeatMapView::onNewSessions() {}
-void HeatMapView::onClearAll() {}
+void HeatMapView::onClearAll()
+{
+    heatMap_.clear();
+    update();
+}
 void HeatMapView::onDataAdded() {}
-void HeatMapView::onPOVChanged() {}
+void HeatMapView::onPOVChanged()
+{
+    // Positions belong to a different fighter now
+    heatMap_.clear();
+    update();
+}
 void HeatMapView::onQueriesChanged() {}
 void HeatMapView::onQueryCompiled(int queryIdx, bool success, const char* error, bool oppSuccess, const char* oppError) {}
-void HeatMapView::onQueriesApplied() {}
+void HeatMapView::onQueriesApplied()
+{
+    if (model_->frameScheduler()->deferUpdate(this))
+        return;
+    onFrameSchedulerUpdate();
+}
+
+// ----------------------------------------------------------------------------
+void HeatMapView::onFrameSchedulerUpdate()
+{
+    PipelineTimer timer(updateTime_);
+    updateHeatMap();
+}
@@ -1,4 +1,7 @@
 #include "decision-graph/views/PieChartView.hpp"
+#include "decision-graph/models/AnalysisCache.hpp"
+#include "decision-graph/models/Diagnostics.hpp"
+#include "decision-graph/models/FrameScheduler.hpp"
 #include "decision-graph/models/SequenceSearchModel.hpp"
 
 #include <QVBoxLayout>
@@ -84,6 +87,8 @@ PieChartView::PieChartView(SequenceSearchModel* model, rfcommon::MotionLabels* l
     l->setStretch(1, 2);
     setLayout(l);
 
+    updateTime_ = model_->diagnostics()->metrics()->histogram("view.pie_chart");
+    model_->frameScheduler()->addConsumer(this, "pie_chart");
     model_->dispatcher.addListener(this);
 }
 
@@ -91,6 +96,7 @@ PieChartView::PieChartView(SequenceSearchModel* model, rfcommon::MotionLabels* l
 PieChartView::~PieChartView()
 {
     model_->dispatcher.removeListener(this);
+    model_->frameScheduler()->removeConsumer(this);
 }
 
 // ----------------------------------------------------------------------------
@@ -126,29 +132,26 @@ void PieChartView::updateIOCharts()
             return;
         const States& states = model_->fighterStates(model_->playerPOV());
 
-        // Find largest island
-        const auto islands = Graph().addStates(states, model_->mergedMatches(0)).islands();
-        if (islands.count() == 0)
+        // Trees are shared with other views, so they are only built once per
+        // apply
+        AnalysisCache* analysis = model_->analysis();
+        const Graph* largestIsland = analysis->largestIsland(0);
+        if (largestIsland == nullptr)
             return;
 
-        int largest = 0;
-        int nodes = 0;
-        for (int i = 0; i != islands.count(); ++i)
-            if (nodes < islands[i].nodes.count())
-            {
-                nodes = islands[i].nodes.count();
-                largest = i;
-            }
+        const Graph& graph = *largestIsland;
+        const Graph& outgoingTree = analysis->outgoingTree(0);
+        const Graph& incomingTree = analysis->incomingTree(0);
+        const auto& incomingSequences = analysis->incomingSequences(0);
+        const auto& outgoingSequences = analysis->outgoingSequences(0);
 
-        const Graph& graph = islands[largest];
-        const Graph& outgoingTree = graph.outgoingTree(states);
-        const Graph& incomingTree = graph.incomingTree(states);
-        const auto& incomingSequences = incomingTree.treeToUniqueIncomingSequences();
-        const auto& outgoingSequences = outgoingTree.treeToUniuqeOutgoingSequences();
-
-        graph.exportDOT("largest_island.dot", states, labels_);
-        outgoingTree.exportDOT("outgoing_tree.dot", states, labels_);
-        incomingTree.exportDOT("incoming_tree.dot", states, labels_);
+        Diagnostics* diagnostics = model_->diagnostics();
+        if (diagnostics->shouldWrite("largest_island.dot"))
+            diagnostics->write("largest_island.dot", graph.toDOT(states, labels_));
+        if (diagnostics->shouldWrite("outgoing_tree.dot"))
+            diagnostics->write("outgoing_tree.dot", outgoingTree.toDOT(states, labels_));
+        if (diagnostics->shouldWrite("incoming_tree.dot"))
+            diagnostics->write("incoming_tree.dot", incomingTree.toDOT(states, labels_));
 
         for (int i = 0; i != outgoingSequences.count(); ++i)
         {
@@ -265,6 +268,17 @@ void PieChartView::onQueriesChanged() {}
 void PieChartView::onQueryCompiled(int queryIdx, bool success, const char* error, bool oppSuccess, const char* oppError) {}
 void PieChartView::onQueriesApplied()
 {
+    // During live games the scheduler decides when the charts are worth
+    // updating
+    if (model_->frameScheduler()->deferUpdate(this))
+        return;
+    onFrameSchedulerUpdate();
+}
+
+// ----------------------------------------------------------------------------
+void PieChartView::onFrameSchedulerUpdate()
+{
+    PipelineTimer timer(updateTime_);
     updateVisible();
     updateIOCharts();
     updateBreakdownCharts();
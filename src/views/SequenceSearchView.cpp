@@ -11,6 +11,7 @@
 #include "decision-graph/views/TimingsView.hpp"
 #include "decision-graph/widgets/PropertyWidget_Damage.hpp"
 #include "decision-graph/widgets/PropertyWidget_DamageConstraints.hpp"
+#include "decision-graph/widgets/PropertyWidget_Diagnostics.hpp"
 #include "decision-graph/widgets/PropertyWidget_Graph.hpp"
 #include "decision-graph/widgets/PropertyWidget_HeatMap.hpp"
 #include "decision-graph/widgets/PropertyWidget_PositionConstraints.hpp"
@@ -62,14 +63,16 @@ SequenceSearchView::SequenceSearchView(
     ui_->tab_timings->setLayout(new QVBoxLayout);
     ui_->tab_timings->layout()->addWidget(new TimingsView(model, labels));
 
+    DamageView* damageView = new DamageView(model, labels);
     ui_->tab_damage->setLayout(new QVBoxLayout);
-    ui_->tab_damage->layout()->addWidget(new DamageView(model, labels));
+    ui_->tab_damage->layout()->addWidget(damageView);
 
     ui_->tab_shield->setLayout(new QVBoxLayout);
     ui_->tab_shield->layout()->addWidget(new ShieldHealthView(model, labels));
 
+    HeatMapView* heatMapView = new HeatMapView(model, labels);
     ui_->tab_heatmap->setLayout(new QVBoxLayout);
-    ui_->tab_heatmap->layout()->addWidget(new HeatMapView(model, labels));
+    ui_->tab_heatmap->layout()->addWidget(heatMapView);
 
     RegionEditorView* regionEditor = new RegionEditorView;
     regionEditor->setScene(regionModel);
@@ -78,22 +81,26 @@ SequenceSearchView::SequenceSearchView(
 
     PropertyWidget* pwPOV = new PropertyWidget_POV(seqSearchModel_);
     PropertyWidget* pwQuery = new PropertyWidget_Query(seqSearchModel_);
+    PropertyWidget* pwPosition = new PropertyWidget_PositionConstraints(regionModel, seqSearchModel_);
     PropertyWidget* pwGraph = new PropertyWidget_Graph(graphModel, seqSearchModel_, labels);
     PropertyWidget* pwTimings = new PropertyWidget_Timings(seqSearchModel_);
-    PropertyWidget* pwDamage = new PropertyWidget_Damage(seqSearchModel_);
+    PropertyWidget* pwDamage = new PropertyWidget_Damage(damageView, seqSearchModel_);
     PropertyWidget* pwShield = new PropertyWidget_Shield(seqSearchModel_);
-    PropertyWidget* pwHeatMap = new PropertyWidget_HeatMap(seqSearchModel_);
-    PropertyWidget* pwTemplates = new PropertyWidget_Templates(seqSearchModel_);
+    PropertyWidget* pwHeatMap = new PropertyWidget_HeatMap(heatMapView, seqSearchModel_);
+    PropertyWidget* pwTemplates = new PropertyWidget_Templates(damageView, seqSearchModel_);
+    PropertyWidget* pwDiagnostics = new PropertyWidget_Diagnostics(seqSearchModel_);
 
     QVBoxLayout* propertiesLayout = new QVBoxLayout;
     propertiesLayout->addWidget(pwPOV);
     propertiesLayout->addWidget(pwQuery);
+    propertiesLayout->addWidget(pwPosition);
     propertiesLayout->addWidget(pwGraph);
     propertiesLayout->addWidget(pwTimings);
     propertiesLayout->addWidget(pwDamage);
     propertiesLayout->addWidget(pwShield);
     propertiesLayout->addWidget(pwHeatMap);
     propertiesLayout->addWidget(pwTemplates);
+    propertiesLayout->addWidget(pwDiagnostics);
     propertiesLayout->addSpacerItem(new QSpacerItem(0, 0, QSizePolicy::Minimum, QSizePolicy::Expanding));
 
     // Fix initial splitter sizes before adding it
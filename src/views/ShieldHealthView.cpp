@@ -1,12 +1,66 @@
 #include "decision-graph/views/ShieldHealthView.hpp"
+#include "decision-graph/models/Diagnostics.hpp"
 #include "decision-graph/models/SequenceSearchModel.hpp"
 
+#include "qwt_plot.h"
+#include "qwt_plot_curve.h"
+#include "qwt_plot_magnifier.h"
+#include "qwt_plot_panner.h"
+#include "qwt_scale_div.h"
+#include "qwt_scale_widget.h"
+#include "qwt_symbol.h"
+
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+namespace {
+
+// Empty space between two sessions on the time axis, in frames
+constexpr double SESSION_GAP = 60.0;
+
+// Upper limit of points handed to each curve
+constexpr int MAX_CURVE_POINTS = 4000;
+
+}
+
 // ----------------------------------------------------------------------------
 ShieldHealthView::ShieldHealthView(SequenceSearchModel* model, rfcommon::MotionLabels* labels, QWidget* parent)
     : QWidget(parent)
     , model_(model)
     , labels_(labels)
+    , plot_(new QwtPlot)
+    , shieldCurve_(new QwtPlotCurve("Shield"))
+    , matchCurve_(new QwtPlotCurve("Matches"))
 {
+    plot_->setPalette(Qt::white);
+    plot_->setTitle("Shield Health");
+    plot_->setAxisTitle(QwtPlot::xBottom, "Frame");
+    plot_->setAxisScale(QwtPlot::yLeft, 0.0, 50.0);
+
+    shieldCurve_->setPen(QColor::fromHsv(200, 219, 160), 1.0);
+    shieldCurve_->attach(plot_);
+
+    matchCurve_->setStyle(QwtPlotCurve::NoCurve);
+    matchCurve_->setSymbol(new QwtSymbol(QwtSymbol::Ellipse, QBrush(Qt::red), QPen(Qt::darkRed), QSize(5, 5)));
+    matchCurve_->attach(plot_);
+
+    // Zooming and panning only along the time axis
+    QwtPlotPanner* panner = new QwtPlotPanner(plot_->canvas());
+    panner->setAxisEnabled(QwtPlot::yLeft, false);
+    QwtPlotMagnifier* magnifier = new QwtPlotMagnifier(plot_->canvas());
+    magnifier->setAxisEnabled(QwtPlot::yLeft, false);
+
+    // Pick the level of detail for the new visible range
+    connect(plot_->axisWidget(QwtPlot::xBottom), &QwtScaleWidget::scaleDivChanged, [this] {
+        refreshCurves();
+    });
+
+    QVBoxLayout* l = new QVBoxLayout;
+    l->addWidget(plot_);
+    setLayout(l);
+
+    updateTime_ = model_->diagnostics()->metrics()->histogram("view.shield");
     model_->dispatcher.addListener(this);
 }
 
@@ -16,11 +70,134 @@ ShieldHealthView::~ShieldHealthView()
     model_->dispatcher.removeListener(this);
 }
 
+// ----------------------------------------------------------------------------
+void ShieldHealthView::clearSeries()
+{
+    shield_.clear();
+    sessionOffsets_.clear();
+    nextStateIdx_ = 0;
+    followedX_ = 0.0;
+    matches_.clear();
+}
+
+// ----------------------------------------------------------------------------
+void ShieldHealthView::updateSeries()
+{
+    if (model_->playerPOV() < 0)
+        return;
+
+    const int fighterIdx = model_->playerPOV();
+    const States& states = model_->fighterStates(fighterIdx);
+
+    // Sessions that were completely appended before won't change anymore,
+    // so resume at the last session we saw
+    for (int sessionIdx = std::max(0, sessionOffsets_.count() - 1); sessionIdx < model_->sessionCount(); ++sessionIdx)
+    {
+        if (sessionIdx == sessionOffsets_.count())
+            sessionOffsets_.push(shield_.count() ? shield_.lastX() + SESSION_GAP : 0.0);
+
+        const Range& range = model_->sessionStateRange(sessionIdx, fighterIdx);
+        for (int stateIdx = std::max(range.startIdx, nextStateIdx_); stateIdx < range.endIdx; ++stateIdx)
+        {
+            const auto& sideData = states[stateIdx].sideData;
+            shield_.append(sessionOffsets_[sessionIdx] + sideData.frameIndex.index(), sideData.shield);
+        }
+        nextStateIdx_ = std::max(nextStateIdx_, range.endIdx);
+    }
+}
+
+// ----------------------------------------------------------------------------
+void ShieldHealthView::updateMatches()
+{
+    matches_.clear();
+    if (model_->playerPOV() < 0)
+        return;
+
+    const States& states = model_->fighterStates(model_->playerPOV());
+    const int sessionCount = std::min(model_->sessionCount(), sessionOffsets_.count());
+    for (int queryIdx = 0; queryIdx != model_->queryCount(); ++queryIdx)
+        for (int sessionIdx = 0; sessionIdx != sessionCount; ++sessionIdx)
+            for (const Range& range : model_->sessionMatches(queryIdx, sessionIdx))
+            {
+                const auto& sideData = states[range.startIdx].sideData;
+                matches_.push(QPointF(sessionOffsets_[sessionIdx] + sideData.frameIndex.index(), sideData.shield));
+            }
+
+    // Matches of each query are already in order. Only needs sorting if
+    // there are multiple queries
+    if (model_->queryCount() > 1)
+        std::sort(matches_.begin(), matches_.end(), [](const QPointF& a, const QPointF& b) {
+            return a.x() < b.x();
+        });
+}
+
+// ----------------------------------------------------------------------------
+void ShieldHealthView::updateVisibleRange()
+{
+    if (shield_.count() == 0)
+    {
+        plot_->setAxisScale(QwtPlot::xBottom, 0.0, 1.0);
+        refreshCurves();
+        return;
+    }
+
+    // If the end of the series was visible before, keep following it as data
+    // is added. Otherwise the user zoomed or panned somewhere else and we
+    // don't want to interfere
+    const QwtScaleDiv& div = plot_->axisScaleDiv(QwtPlot::xBottom);
+    if (div.upperBound() >= followedX_)
+        plot_->setAxisScale(QwtPlot::xBottom, shield_.firstX(), shield_.lastX());
+    followedX_ = shield_.lastX();
+
+    refreshCurves();
+}
+
+// ----------------------------------------------------------------------------
+void ShieldHealthView::refreshCurves()
+{
+    const QwtScaleDiv& div = plot_->axisScaleDiv(QwtPlot::xBottom);
+    const double xMin = div.lowerBound();
+    const double xMax = div.upperBound();
+
+    // Two points per pixel is all a min/max envelope needs
+    const int maxPoints = std::min(MAX_CURVE_POINTS, std::max(500, plot_->canvas()->width() * 2));
+
+    QVector<QPointF> shieldPoints;
+    shield_.query(xMin, xMax, maxPoints, &shieldPoints);
+    shieldCurve_->setSamples(shieldPoints);
+
+    const QPointF* begin = std::lower_bound(matches_.begin(), matches_.end(), xMin, [](const QPointF& p, double x) { return p.x() < x; });
+    const QPointF* end = std::upper_bound(begin, matches_.end(), xMax, [](double x, const QPointF& p) { return x < p.x(); });
+    const int visible = static_cast<int>(end - begin);
+    const int stride = visible / maxPoints + 1;
+    QVector<QPointF> matchPoints;
+    for (const QPointF* p = begin; p < end; p += stride)
+        matchPoints.push_back(*p);
+    matchCurve_->setSamples(matchPoints);
+
+    plot_->replot();
+}
+
 // ----------------------------------------------------------------------------
 void ShieldHealthView::onNewSessions() {}
-void ShieldHealthView::onClearAll() {}
+void ShieldHealthView::onClearAll()
+{
+    clearSeries();
+    updateVisibleRange();
+}
 void ShieldHealthView::onDataAdded() {}
-void ShieldHealthView::onPOVChanged() {}
+void ShieldHealthView::onPOVChanged()
+{
+    // The series belongs to a different fighter now
+    clearSeries();
+    updateVisibleRange();
+}
 void ShieldHealthView::onQueriesChanged() {}
 void ShieldHealthView::onQueryCompiled(int queryIdx, bool success, const char* error, bool oppSuccess, const char* oppError) {}
-void ShieldHealthView::onQueriesApplied() {}
+void ShieldHealthView::onQueriesApplied()
+{
+    PipelineTimer timer(updateTime_);
+    updateSeries();
+    updateMatches();
+    updateVisibleRange();
+}
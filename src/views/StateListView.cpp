@@ -1,4 +1,6 @@
 #include "decision-graph/views/StateListView.hpp"
+#include "decision-graph/models/AnalysisCache.hpp"
+#include "decision-graph/models/Diagnostics.hpp"
 #include "decision-graph/models/SequenceSearchModel.hpp"
 #include "decision-graph/models/Sequence.hpp"
 
@@ -18,6 +20,7 @@ StateListView::StateListView(SequenceSearchModel* model, rfcommon::MotionLabels*
     l->addWidget(textEdit_);
     setLayout(l);
 
+    updateTime_ = model_->diagnostics()->metrics()->histogram("view.state_list");
     model_->dispatcher.addListener(this);
 }
 
@@ -26,8 +29,7 @@ void StateListView::updateText()
 {
     textEdit_->clear();
 
-    const States& states = model_->fighterStates(model_->playerPOV());
-
+    AnalysisCache* analysis = model_->analysis();
     for (int queryIdx = 0; queryIdx != model_->queryCount(); ++queryIdx)
     {
         QTextCursor cursor = textEdit_->textCursor();
@@ -36,8 +38,8 @@ void StateListView::updateText()
         for (int sessionIdx = 0; sessionIdx != model_->sessionCount(); ++sessionIdx)
         {
             cursor.insertText("  Replay: " + QString::fromUtf8(model_->sessionName(sessionIdx)) + "\n");
-            for (const Range& range : model_->sessionMatches(queryIdx, sessionIdx))
-                cursor.insertText("    " + QString::fromUtf8(toString(states, range, labels_).cStr()) + "\n");
+            for (const rfcommon::String& match : analysis->matchStrings(queryIdx, sessionIdx))
+                cursor.insertText("    " + QString::fromUtf8(match.cStr()) + "\n");
         }
     }
 }
@@ -55,4 +57,8 @@ void StateListView::onDataAdded() {}
 void StateListView::onPOVChanged() {}
 void StateListView::onQueriesChanged() {}
 void StateListView::onQueryCompiled(int queryIdx, bool success, const char* error, bool oppSuccess, const char* oppError) {}
-void StateListView::onQueriesApplied() { updateText(); }
+void StateListView::onQueriesApplied()
+{
+    PipelineTimer timer(updateTime_);
+    updateText();
+}
@@ -1,4 +1,6 @@
 #include "decision-graph/views/TimingsView.hpp"
+#include "decision-graph/models/AnalysisCache.hpp"
+#include "decision-graph/models/Diagnostics.hpp"
 #include "decision-graph/models/SequenceSearchModel.hpp"
 
 #include "qwt_plot.h"
@@ -25,6 +27,7 @@ TimingsView::TimingsView(SequenceSearchModel* model, rfcommon::MotionLabels* lab
     l->addWidget(relativePlot_);
     setLayout(l);
 
+    updateTime_ = model_->diagnostics()->metrics()->histogram("view.timings");
     model_->dispatcher.addListener(this);
 }
 
@@ -43,80 +46,17 @@ void TimingsView::onQueriesChanged() {}
 void TimingsView::onQueryCompiled(int queryIdx, bool success, const char* error, bool oppSuccess, const char* oppError) {}
 void TimingsView::onQueriesApplied()
 {
-    struct SeqRef
-    {
-        SeqRef(const States& states, const Sequence& seq)
-            : states(states), seq(seq)
-        {}
-
-        struct Hasher {
-            typedef uint32_t HashType;
-            HashType operator()(const SeqRef& ref) const {
-                HashType hash = 0;
-                for (int idx : ref.seq.idxs)
-                {
-                    const State& state = ref.states[idx];
-                    const uint32_t motion_l = state.motion.lower();
-                    const uint16_t status = state.status.value();
-                    const uint8_t motion_h = state.motion.upper();
-                    const uint32_t a = motion_l;
-                    const uint32_t b = (status << 8) | motion_l;
-                    hash = rfcommon::hash32_combine(hash, rfcommon::hash32_combine(a, b));
-                }
-                return hash;
-            }
-        };
-
-        struct Compare {
-            bool operator()(const SeqRef& a, const SeqRef& b) const {
-                if (a.seq.idxs.count() != b.seq.idxs.count())
-                    return false;
-                for (int i = 0; i != a.seq.idxs.count(); ++i)
-                {
-                    const State& sa = a.states[a.seq.idxs[i]];
-                    const State& sb = b.states[b.seq.idxs[i]];
-                    if (sa.motion != sb.motion) return false;
-                    if (sa.status != sb.status) return false;
-                }
-                return true;
-            }
-        };
-
-        const States& states;
-        const Sequence& seq;
-    };
-
-    const States& states = model_->fighterStates(model_->playerPOV());
-
-    rfcommon::HashMap<SeqRef, int, SeqRef::Hasher, SeqRef::Compare> sequenceFrequencies;
-    for (int queryIdx = 0; queryIdx != model_->queryCount(); ++queryIdx)
-        for (const auto& seq : model_->mergedMatches(queryIdx))
-            sequenceFrequencies.insertOrGet(SeqRef(states, seq), 0)->value()++;
-
-    const SeqRef* mostCommon = nullptr;
-    int highestCount = 0;
-    for (const auto it : sequenceFrequencies)
-        if (highestCount < it->value())
-        {
-            highestCount = it->value();
-            mostCommon = &it->key();
-        }
-
+    PipelineTimer timer(updateTime_);
     // Frames, Frequency
     rfcommon::HashMap<int, int> histogram;
-    if (mostCommon)
+    const auto& timings = model_->analysis()->mostCommonSequence();
+    if (timings.sequence)
     {
-        for (int queryIdx = 0; queryIdx != model_->queryCount(); ++queryIdx)
-            for (const auto& seq : model_->mergedMatches(queryIdx))
-                if (SeqRef::Compare()(SeqRef(states, seq), *mostCommon))
-                {
-                    const auto& first = states[seq.idxs.front()];
-                    const auto& last = states[seq.idxs.back()];
-                    int diffFrames = last.sideData.frameIndex.index() - first.sideData.frameIndex.index();
-                    histogram.insertOrGet(diffFrames / 3, 0)->value()++;
-                }
+        for (int diffFrames : timings.frameDurations)
+            histogram.insertOrGet(diffFrames / 3, 0)->value()++;
 
-        auto seqName = toString(states, mostCommon->seq, labels_);
+        const States& states = model_->fighterStates(model_->playerPOV());
+        auto seqName = toString(states, *timings.sequence, labels_);
         relativePlot_->setTitle(QString("Relative Timings for ") + seqName.cStr());
     }
 
@@ -1,3 +1,4 @@
+#include "decision-graph/views/DamageView.hpp"
 #include "decision-graph/widgets/PropertyWidget_Damage.hpp"
 
 #include <QGridLayout>
@@ -6,8 +7,9 @@
 #include <QToolButton>
 
 // ----------------------------------------------------------------------------
-PropertyWidget_Damage::PropertyWidget_Damage(SequenceSearchModel* model, QWidget* parent)
+PropertyWidget_Damage::PropertyWidget_Damage(DamageView* damageView, SequenceSearchModel* model, QWidget* parent)
     : PropertyWidget(model, parent)
+    , damageView_(damageView)
 {
     setTitle("Damage settings");
 
@@ -15,7 +17,7 @@ PropertyWidget_Damage::PropertyWidget_Damage(SequenceSearchModel* model, QWidget
     spinBox_bucketSize->setMinimum(5);
     spinBox_bucketSize->setMaximum(100);
     spinBox_bucketSize->setSingleStep(5);
-    spinBox_bucketSize->setValue(20);
+    spinBox_bucketSize->setValue(damageView_->bucketSize());
     spinBox_bucketSize->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
 
     QLabel* label_bucketSize = new QLabel("Bucket size:");
@@ -31,6 +33,10 @@ PropertyWidget_Damage::PropertyWidget_Damage(SequenceSearchModel* model, QWidget
 
     contentWidget()->setLayout(l);
     updateSize();
+
+    connect(spinBox_bucketSize, qOverload<int>(&QSpinBox::valueChanged), [this](int value) {
+        damageView_->setBucketSize(value);
+    });
 }
 
 // ----------------------------------------------------------------------------
@@ -0,0 +1,114 @@
+#include "decision-graph/models/Diagnostics.hpp"
+#include "decision-graph/models/SequenceSearchModel.hpp"
+#include "decision-graph/widgets/PropertyWidget_Diagnostics.hpp"
+
+#include <QCheckBox>
+#include <QFileDialog>
+#include <QFontDatabase>
+#include <QGridLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMessageBox>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QTimer>
+
+// ----------------------------------------------------------------------------
+PropertyWidget_Diagnostics::PropertyWidget_Diagnostics(SequenceSearchModel* model, QWidget* parent)
+    : PropertyWidget(model, parent)
+{
+    setTitle("Diagnostics");
+
+    Diagnostics* diagnostics = seqSearchModel_->diagnostics();
+
+    QCheckBox* checkBox_enable = new QCheckBox("Write DOT files");
+    checkBox_enable->setChecked(diagnostics->isEnabled());
+    checkBox_enable->setToolTip(
+        "Writes the query ASTs, compiled queries and search graphs as\n"
+        "graphviz DOT files. Only useful for debugging.");
+
+    QLineEdit* lineEdit_directory = new QLineEdit;
+    lineEdit_directory->setText(diagnostics->outputDirectory());
+    lineEdit_directory->setPlaceholderText("Working directory");
+
+    QPushButton* pushButton_browse = new QPushButton("...");
+
+    QSpinBox* spinBox_interval = new QSpinBox;
+    spinBox_interval->setRange(0, 60000);
+    spinBox_interval->setSingleStep(100);
+    spinBox_interval->setSuffix(" ms");
+    spinBox_interval->setValue(diagnostics->minInterval());
+    spinBox_interval->setToolTip("Each file is written at most once per this interval.");
+
+    QPlainTextEdit* textEdit_metrics = new QPlainTextEdit;
+    textEdit_metrics->setReadOnly(true);
+    textEdit_metrics->setLineWrapMode(QPlainTextEdit::NoWrap);
+    textEdit_metrics->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    textEdit_metrics->setMinimumHeight(200);
+    textEdit_metrics->setToolTip(
+        "Time spent in each stage of the pipeline since the plugin was\n"
+        "loaded or since the last reset. Sizes and rates are counts.");
+
+    QPushButton* pushButton_dump = new QPushButton("Dump...");
+    QPushButton* pushButton_reset = new QPushButton("Reset");
+
+    // Polling is cheaper than notifying on every recorded value, and the
+    // text only needs updating while someone is looking at it
+    QTimer* timer_refresh = new QTimer(this);
+    timer_refresh->setInterval(1000);
+    timer_refresh->start();
+
+    QGridLayout* l = new QGridLayout;
+    l->addWidget(checkBox_enable, 0, 0, 1, 3);
+    l->addWidget(new QLabel("Directory:"), 1, 0);
+    l->addWidget(lineEdit_directory, 1, 1);
+    l->addWidget(pushButton_browse, 1, 2);
+    l->addWidget(new QLabel("Minimum interval:"), 2, 0);
+    l->addWidget(spinBox_interval, 2, 1, 1, 2);
+    l->addWidget(new QLabel("Pipeline timings:"), 3, 0, 1, 3);
+    l->addWidget(textEdit_metrics, 4, 0, 1, 3);
+    l->addWidget(pushButton_reset, 5, 1);
+    l->addWidget(pushButton_dump, 5, 2);
+    contentWidget()->setLayout(l);
+    updateSize();
+
+    connect(checkBox_enable, &QCheckBox::toggled, [diagnostics](bool checked) {
+        diagnostics->setEnabled(checked);
+    });
+    connect(lineEdit_directory, &QLineEdit::editingFinished, [diagnostics, lineEdit_directory] {
+        diagnostics->setOutputDirectory(lineEdit_directory->text());
+    });
+    connect(pushButton_browse, &QPushButton::clicked, [this, diagnostics, lineEdit_directory] {
+        QString dir = QFileDialog::getExistingDirectory(this, "Diagnostics directory", diagnostics->outputDirectory());
+        if (dir.isEmpty())
+            return;
+        lineEdit_directory->setText(dir);
+        diagnostics->setOutputDirectory(dir);
+    });
+    connect(spinBox_interval, qOverload<int>(&QSpinBox::valueChanged), [diagnostics](int value) {
+        diagnostics->setMinInterval(value);
+    });
+
+    auto refreshMetrics = [this, diagnostics, textEdit_metrics] {
+        if (isVisible() == false || isExpanded() == false)
+            return;
+        textEdit_metrics->setPlainText(QString::fromUtf8(diagnostics->metrics()->toString().cStr()));
+    };
+    connect(timer_refresh, &QTimer::timeout, refreshMetrics);
+    connect(pushButton_reset, &QPushButton::clicked, [diagnostics, refreshMetrics] {
+        diagnostics->metrics()->reset();
+        refreshMetrics();
+    });
+    connect(pushButton_dump, &QPushButton::clicked, [this, diagnostics] {
+        QString fileName = QFileDialog::getSaveFileName(this, "Dump pipeline timings", diagnostics->outputDirectory(), "Text files (*.txt)");
+        if (fileName.isEmpty())
+            return;
+        if (diagnostics->metrics()->dump(fileName) == false)
+            QMessageBox::critical(this, "Error", "Failed to write file \"" + fileName + "\"");
+    });
+}
+
+// ----------------------------------------------------------------------------
+PropertyWidget_Diagnostics::~PropertyWidget_Diagnostics()
+{}
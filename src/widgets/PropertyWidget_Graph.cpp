@@ -9,6 +9,7 @@
 #include <QCheckBox>
 #include <QGroupBox>
 #include <QRadioButton>
+#include <QSlider>
 #include <QSpinBox>
 
 // ----------------------------------------------------------------------------
@@ -17,6 +18,7 @@ PropertyWidget_Graph::PropertyWidget_Graph(GraphModel* graphModel, SequenceSearc
     , graphModel_(graphModel)
     , labels_(labels)
     , comboBox_layer(new QComboBox)
+    , label_layoutTime(new QLabel)
 {
     setTitle("Graph settings");
 
@@ -37,14 +39,34 @@ PropertyWidget_Graph::PropertyWidget_Graph(GraphModel* graphModel, SequenceSearc
     spinBox_incomingTree->setValue(graphModel_->incomingTreeSize());
     spinBox_incomingTree->setEnabled(graphModel_->incomingTreeSize() > 0);
 
+    checkBox_outgoingTree->setToolTip(
+        "Only show the moves following the most frequent node, up to the\n"
+        "specified number of levels deep.");
+    checkBox_incomingTree->setToolTip(
+        "Only show the moves leading into the most frequent node, up to the\n"
+        "specified number of levels deep.");
+
+    QLabel* label_treeBranches = new QLabel("Branches per level:");
+    label_treeBranches->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::Preferred);
+
+    QSpinBox* spinBox_treeBranches = new QSpinBox;
+    spinBox_treeBranches->setRange(1, 100);
+    spinBox_treeBranches->setValue(graphModel_->treeBranchesPerLevel());
+    spinBox_treeBranches->setEnabled(graphModel_->outgoingTreeSize() > 0 || graphModel_->incomingTreeSize() > 0);
+    spinBox_treeBranches->setToolTip(
+        "When expanding a tree, only the most frequent connections of each\n"
+        "level are followed.");
+
     QGroupBox* groupBox_graphType = new QGroupBox;
     groupBox_graphType->setTitle("Graph type");
 
     QGridLayout* layout_graphType = new QGridLayout;
     layout_graphType->addWidget(checkBox_outgoingTree, 0, 0);
     layout_graphType->addWidget(checkBox_incomingTree, 1, 0);
+    layout_graphType->addWidget(label_treeBranches, 2, 0);
     layout_graphType->addWidget(spinBox_outgoingTree, 0, 1);
     layout_graphType->addWidget(spinBox_incomingTree, 1, 1);
+    layout_graphType->addWidget(spinBox_treeBranches, 2, 1);
     groupBox_graphType->setLayout(layout_graphType);
 
     updateAvailableLayersDropdown();
@@ -90,6 +112,77 @@ PropertyWidget_Graph::PropertyWidget_Graph(GraphModel* graphModel, SequenceSearc
     layout_mergeSettings->addWidget(radioButton_mergeLabel);
     groupBox_mergeSettings->setLayout(layout_mergeSettings);
 
+    QSpinBox* spinBox_pruneMinWeight = new QSpinBox;
+    spinBox_pruneMinWeight->setRange(1, 10000);
+    spinBox_pruneMinWeight->setValue(graphModel_->pruneMinWeight());
+    spinBox_pruneMinWeight->setToolTip("Connections that occurred fewer times than this are hidden.");
+
+    QLabel* label_prunePercentile = new QLabel(QString::number(graphModel_->prunePercentile()) + "%");
+    QSlider* slider_prunePercentile = new QSlider(Qt::Horizontal);
+    slider_prunePercentile->setRange(0, 99);
+    slider_prunePercentile->setValue(graphModel_->prunePercentile());
+    slider_prunePercentile->setToolTip("Hides the given percentage of the least frequent connections.");
+
+    QSpinBox* spinBox_pruneMaxNodes = new QSpinBox;
+    spinBox_pruneMaxNodes->setRange(0, 10000);
+    spinBox_pruneMaxNodes->setSpecialValueText("No limit");
+    spinBox_pruneMaxNodes->setValue(graphModel_->pruneMaxNodes());
+    spinBox_pruneMaxNodes->setToolTip("Only shows this many of the most frequently visited nodes.");
+
+    QCheckBox* checkBox_pruneAggregate = new QCheckBox;
+    checkBox_pruneAggregate->setText("Summarize hidden connections");
+    checkBox_pruneAggregate->setToolTip(
+        "Instead of removing hidden connections entirely, their weights are\n"
+        "added to \"other\" nodes so the remaining weights still add up.");
+    checkBox_pruneAggregate->setChecked(graphModel_->pruneAggregate());
+
+    QGroupBox* groupBox_pruneSettings = new QGroupBox;
+    groupBox_pruneSettings->setTitle("Pruning");
+
+    QGridLayout* layout_pruneSettings = new QGridLayout;
+    layout_pruneSettings->addWidget(new QLabel("Minimum edge weight:"), 0, 0);
+    layout_pruneSettings->addWidget(spinBox_pruneMinWeight, 0, 1, 1, 2);
+    layout_pruneSettings->addWidget(new QLabel("Hide least frequent:"), 1, 0);
+    layout_pruneSettings->addWidget(slider_prunePercentile, 1, 1);
+    layout_pruneSettings->addWidget(label_prunePercentile, 1, 2);
+    layout_pruneSettings->addWidget(new QLabel("Maximum nodes:"), 2, 0);
+    layout_pruneSettings->addWidget(spinBox_pruneMaxNodes, 2, 1, 1, 2);
+    layout_pruneSettings->addWidget(checkBox_pruneAggregate, 3, 0, 1, 3);
+    groupBox_pruneSettings->setLayout(layout_pruneSettings);
+
+    QComboBox* comboBox_layoutEngine = new QComboBox;
+    for (int engine = GraphLayout::AUTO; engine <= GraphLayout::FORCE_DIRECTED; ++engine)
+        comboBox_layoutEngine->addItem(GraphLayout::engineName(static_cast<GraphLayout::Engine>(engine)));
+    comboBox_layoutEngine->setCurrentIndex(graphModel_->layoutEngine());
+    comboBox_layoutEngine->setToolTip(
+        "Optimal: Best looking, but can take a long time for large graphs.\n"
+        "Fast: Hierarchical layout using cheaper heuristics.\n"
+        "Compact: Like fast, but limits how many nodes are placed side by side.\n"
+        "Force directed: For very large graphs. Edges are drawn as straight lines.\n"
+        "Auto: Chooses based on the size of the graph and the time budget.");
+
+    QSpinBox* spinBox_layoutTimeBudget = new QSpinBox;
+    spinBox_layoutTimeBudget->setRange(0, 60000);
+    spinBox_layoutTimeBudget->setSingleStep(100);
+    spinBox_layoutTimeBudget->setSuffix(" ms");
+    spinBox_layoutTimeBudget->setSpecialValueText("No limit");
+    spinBox_layoutTimeBudget->setValue(graphModel_->layoutTimeBudget());
+    spinBox_layoutTimeBudget->setEnabled(graphModel_->layoutEngine() == GraphLayout::AUTO);
+    spinBox_layoutTimeBudget->setToolTip(
+        "In auto mode, if the optimal layout is expected to take longer than\n"
+        "this, the fast layout is used instead.");
+
+    QGroupBox* groupBox_layoutSettings = new QGroupBox;
+    groupBox_layoutSettings->setTitle("Layout");
+
+    QGridLayout* layout_layoutSettings = new QGridLayout;
+    layout_layoutSettings->addWidget(new QLabel("Engine:"), 0, 0);
+    layout_layoutSettings->addWidget(comboBox_layoutEngine, 0, 1);
+    layout_layoutSettings->addWidget(new QLabel("Time budget:"), 1, 0);
+    layout_layoutSettings->addWidget(spinBox_layoutTimeBudget, 1, 1);
+    layout_layoutSettings->addWidget(label_layoutTime, 2, 0, 1, 2);
+    groupBox_layoutSettings->setLayout(layout_layoutSettings);
+
     QCheckBox* checkBox_showQualifiers = new QCheckBox;
     checkBox_showQualifiers->setText("Show qualifiers");
     checkBox_showQualifiers->setChecked(graphModel_->showQualifiers());
@@ -114,17 +207,21 @@ PropertyWidget_Graph::PropertyWidget_Graph(GraphModel* graphModel, SequenceSearc
     QVBoxLayout* l = new QVBoxLayout;
     l->addWidget(groupBox_graphType);
     l->addWidget(groupBox_mergeSettings);
+    l->addWidget(groupBox_pruneSettings);
+    l->addWidget(groupBox_layoutSettings);
     l->addWidget(groupBox_visualSettings);
 
     contentWidget()->setLayout(l);
     updateSize();
 
-    connect(checkBox_outgoingTree, &QCheckBox::toggled, [this, graphModel, spinBox_outgoingTree](bool checked) {
+    connect(checkBox_outgoingTree, &QCheckBox::toggled, [this, graphModel, spinBox_outgoingTree, spinBox_treeBranches, checkBox_incomingTree](bool checked) {
         spinBox_outgoingTree->setEnabled(checked);
+        spinBox_treeBranches->setEnabled(checked || checkBox_incomingTree->isChecked());
         graphModel->setOutgoingTreeSize(checked ? spinBox_outgoingTree->value() : 0);
     });
-    connect(checkBox_incomingTree, &QCheckBox::toggled, [this, graphModel, spinBox_incomingTree](bool checked) {
+    connect(checkBox_incomingTree, &QCheckBox::toggled, [this, graphModel, spinBox_incomingTree, spinBox_treeBranches, checkBox_outgoingTree](bool checked) {
         spinBox_incomingTree->setEnabled(checked);
+        spinBox_treeBranches->setEnabled(checked || checkBox_outgoingTree->isChecked());
         graphModel->setIncomingTreeSize(checked ? spinBox_incomingTree->value() : 0);
     });
     connect(spinBox_outgoingTree, qOverload<int>(&QSpinBox::valueChanged), [this, graphModel](int value) {
@@ -133,6 +230,9 @@ PropertyWidget_Graph::PropertyWidget_Graph(GraphModel* graphModel, SequenceSearc
     connect(spinBox_incomingTree, qOverload<int>(&QSpinBox::valueChanged), [this, graphModel](int value) {
         graphModel->setIncomingTreeSize(value);
     });
+    connect(spinBox_treeBranches, qOverload<int>(&QSpinBox::valueChanged), [this, graphModel](int value) {
+        graphModel->setTreeBranchesPerLevel(value);
+    });
 
     connect(checkBox_largestIsland, &QCheckBox::toggled, [this, graphModel](bool checked) {
         graphModel->setUseLargestIsland(checked);
@@ -157,6 +257,28 @@ PropertyWidget_Graph::PropertyWidget_Graph(GraphModel* graphModel, SequenceSearc
             graphModel->setMergeBehavior(GraphModel::LABEL_MERGE);
     });
 
+    connect(spinBox_pruneMinWeight, qOverload<int>(&QSpinBox::valueChanged), [this, graphModel](int value) {
+        graphModel->setPruneMinWeight(value);
+    });
+    connect(slider_prunePercentile, &QSlider::valueChanged, [this, graphModel, label_prunePercentile](int value) {
+        label_prunePercentile->setText(QString::number(value) + "%");
+        graphModel->setPrunePercentile(value);
+    });
+    connect(spinBox_pruneMaxNodes, qOverload<int>(&QSpinBox::valueChanged), [this, graphModel](int value) {
+        graphModel->setPruneMaxNodes(value);
+    });
+    connect(checkBox_pruneAggregate, &QCheckBox::toggled, [this, graphModel](bool checked) {
+        graphModel->setPruneAggregate(checked);
+    });
+
+    connect(comboBox_layoutEngine, qOverload<int>(&QComboBox::currentIndexChanged), [this, graphModel, spinBox_layoutTimeBudget](int index) {
+        spinBox_layoutTimeBudget->setEnabled(index == GraphLayout::AUTO);
+        graphModel->setLayoutEngine(static_cast<GraphLayout::Engine>(index));
+    });
+    connect(spinBox_layoutTimeBudget, qOverload<int>(&QSpinBox::valueChanged), [this, graphModel](int value) {
+        graphModel->setLayoutTimeBudget(value);
+    });
+
     connect(comboBox_layer, qOverload<int>(&QComboBox::currentIndexChanged), [this, graphModel](int index) {
         graphModel->setPreferredLayer(index);
     });
@@ -168,6 +290,9 @@ PropertyWidget_Graph::PropertyWidget_Graph(GraphModel* graphModel, SequenceSearc
         graphModel->setShowQualifiers(checked);
     });
 
+    onGraphModelLayoutFinished();
+
+    graphModel_->dispatcher.addListener(this);
     labels_->dispatcher.addListener(this);
 }
 
@@ -175,6 +300,7 @@ PropertyWidget_Graph::PropertyWidget_Graph(GraphModel* graphModel, SequenceSearc
 PropertyWidget_Graph::~PropertyWidget_Graph()
 {
     labels_->dispatcher.removeListener(this);
+    graphModel_->dispatcher.removeListener(this);
 }
 
 // ----------------------------------------------------------------------------
@@ -192,6 +318,21 @@ void PropertyWidget_Graph::onGraphModelPreferredLayerChanged()
     comboBox_layer->setCurrentIndex(graphModel_->preferredLayer());
 }
 
+// ----------------------------------------------------------------------------
+void PropertyWidget_Graph::onGraphModelLayoutFinished()
+{
+    if (graphModel_->lastLayoutTime() <= 0.0)
+    {
+        label_layoutTime->setText("");
+        return;
+    }
+
+    label_layoutTime->setText(QString("Last layout: %1, %2 ms%3")
+        .arg(GraphLayout::engineName(graphModel_->lastLayoutEngine()))
+        .arg(graphModel_->lastLayoutTime(), 0, 'f', 0)
+        .arg(graphModel_->lastLayoutCached() ? " (cached)" : ""));
+}
+
 // ----------------------------------------------------------------------------
 void PropertyWidget_Graph::onMotionLabelsLoaded() { updateAvailableLayersDropdown(); }
 void PropertyWidget_Graph::onMotionLabelsHash40sUpdated() {}
@@ -1,15 +1,40 @@
+#include "decision-graph/views/HeatMapView.hpp"
 #include "decision-graph/widgets/PropertyWidget_HeatMap.hpp"
 
+#include <QCheckBox>
+#include <QDoubleSpinBox>
 #include <QGridLayout>
 #include <QLabel>
-#include <QComboBox>
 
 // ----------------------------------------------------------------------------
-PropertyWidget_HeatMap::PropertyWidget_HeatMap(SequenceSearchModel* model, QWidget* parent)
+PropertyWidget_HeatMap::PropertyWidget_HeatMap(HeatMapView* heatMapView, SequenceSearchModel* model, QWidget* parent)
     : PropertyWidget(model, parent)
+    , heatMapView_(heatMapView)
 {
     setTitle("Heat map settings");
+
+    QDoubleSpinBox* spinBox_blur = new QDoubleSpinBox;
+    spinBox_blur->setRange(0.0, 10.0);
+    spinBox_blur->setSingleStep(0.5);
+    spinBox_blur->setValue(heatMapView_->blurRadius());
+    spinBox_blur->setToolTip("Standard deviation of the gaussian blur, in cells. 0 disables blurring.");
+
+    QCheckBox* checkBox_log = new QCheckBox("Logarithmic scale");
+    checkBox_log->setChecked(heatMapView_->logScale());
+
+    QGridLayout* l = new QGridLayout;
+    l->addWidget(new QLabel("Blur:"), 0, 0);
+    l->addWidget(spinBox_blur, 0, 1);
+    l->addWidget(checkBox_log, 1, 0, 1, 2);
+    contentWidget()->setLayout(l);
     updateSize();
+
+    connect(spinBox_blur, qOverload<double>(&QDoubleSpinBox::valueChanged), [this](double value) {
+        heatMapView_->setBlurRadius(static_cast<float>(value));
+    });
+    connect(checkBox_log, &QCheckBox::toggled, [this](bool checked) {
+        heatMapView_->setLogScale(checked);
+    });
 }
 
 // ----------------------------------------------------------------------------
@@ -1,18 +1,119 @@
+#include "decision-graph/models/RegionScene.hpp"
+#include "decision-graph/models/SequenceSearchModel.hpp"
 #include "decision-graph/widgets/PropertyWidget_PositionConstraints.hpp"
 
+#include <QCheckBox>
+#include <QComboBox>
 #include <QGridLayout>
 #include <QLabel>
-#include <QComboBox>
+#include <QVBoxLayout>
 
 // ----------------------------------------------------------------------------
-PropertyWidget_PositionConstraints::PropertyWidget_PositionConstraints(SequenceSearchModel* model, QWidget* parent)
+PropertyWidget_PositionConstraints::PropertyWidget_PositionConstraints(RegionScene* regionScene, SequenceSearchModel* model, QWidget* parent)
     : PropertyWidget(model, parent)
+    , regionScene_(regionScene)
+    , comboBox_query(new QComboBox)
+    , layout_regions(new QVBoxLayout)
 {
     setTitle("Position constraints");
-    updateSize();
+
+    QLabel* label_query = new QLabel("Query:");
+    label_query->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Preferred);
+    comboBox_query->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::Preferred);
+
+    QLabel* label_regions = new QLabel("Only match states inside of:");
+    label_regions->setToolTip("If no region is checked, states can be anywhere");
+
+    QGridLayout* l = new QGridLayout;
+    l->addWidget(label_query, 0, 0);
+    l->addWidget(comboBox_query, 0, 1);
+    l->addWidget(label_regions, 1, 0, 1, 2);
+    l->addLayout(layout_regions, 2, 0, 1, 2);
+    contentWidget()->setLayout(l);
+
+    updateQueries();
+
+    connect(comboBox_query, qOverload<int>(&QComboBox::currentIndexChanged), [this] { updateRegions(); });
+
+    seqSearchModel_->dispatcher.addListener(this);
+    regionScene_->dispatcher.addListener(this);
 }
 
 // ----------------------------------------------------------------------------
 PropertyWidget_PositionConstraints::~PropertyWidget_PositionConstraints()
 {
+    regionScene_->dispatcher.removeListener(this);
+    seqSearchModel_->dispatcher.removeListener(this);
+}
+
+// ----------------------------------------------------------------------------
+void PropertyWidget_PositionConstraints::updateQueries()
+{
+    QSignalBlocker blockQuery(comboBox_query);
+
+    const int current = comboBox_query->currentIndex();
+    comboBox_query->clear();
+    for (int i = 0; i != seqSearchModel_->queryCount(); ++i)
+        comboBox_query->addItem(QString::number(i + 1) + ": " + QString::fromUtf8(seqSearchModel_->playerQuery(i).cStr()));
+    if (seqSearchModel_->queryCount() > 0)
+        comboBox_query->setCurrentIndex(current >= 0 && current < seqSearchModel_->queryCount() ? current : 0);
+
+    updateRegions();
+}
+
+// ----------------------------------------------------------------------------
+void PropertyWidget_PositionConstraints::updateRegions()
+{
+    for (QCheckBox* checkBox : checkBoxes_)
+        delete checkBox;
+    checkBoxes_.clear();
+
+    const int queryIdx = comboBox_query->currentIndex();
+    const uint32_t mask = queryIdx >= 0 ? seqSearchModel_->queryRegions(queryIdx) : 0;
+    for (int regionIdx = 0; regionIdx != RegionIndex::MAX_REGIONS; ++regionIdx)
+    {
+        if (regionScene_->region(regionIdx) == nullptr)
+            continue;
+
+        QCheckBox* checkBox = new QCheckBox("Region " + QString::number(regionIdx + 1));
+        checkBox->setProperty("regionIdx", regionIdx);
+        checkBox->setChecked(!!(mask & (1u << regionIdx)));
+        checkBox->setEnabled(queryIdx >= 0);
+        layout_regions->addWidget(checkBox);
+        checkBoxes_.push_back(checkBox);
+
+        connect(checkBox, &QCheckBox::toggled, [this] { onRegionToggled(); });
+    }
+
+    updateSize();
 }
+
+// ----------------------------------------------------------------------------
+void PropertyWidget_PositionConstraints::onRegionToggled()
+{
+    const int queryIdx = comboBox_query->currentIndex();
+    if (queryIdx < 0)
+        return;
+
+    uint32_t mask = 0;
+    for (QCheckBox* checkBox : checkBoxes_)
+        if (checkBox->isChecked())
+            mask |= 1u << checkBox->property("regionIdx").toInt();
+
+    seqSearchModel_->setQueryRegions(queryIdx, mask);
+    if (seqSearchModel_->applyQuery(queryIdx))
+        seqSearchModel_->notifyQueriesApplied();
+}
+
+// ----------------------------------------------------------------------------
+void PropertyWidget_PositionConstraints::onNewSessions() {}
+void PropertyWidget_PositionConstraints::onClearAll() {}
+void PropertyWidget_PositionConstraints::onDataAdded() {}
+void PropertyWidget_PositionConstraints::onPOVChanged() {}
+void PropertyWidget_PositionConstraints::onQueriesChanged() { updateQueries(); }
+void PropertyWidget_PositionConstraints::onQueryCompiled(int queryIdx, bool success, const char* error, bool oppSuccess, const char* oppError) {}
+void PropertyWidget_PositionConstraints::onQueriesApplied() {}
+
+// ----------------------------------------------------------------------------
+void PropertyWidget_PositionConstraints::onRegionAdded(int regionIdx) { updateRegions(); }
+void PropertyWidget_PositionConstraints::onRegionRemoved(int regionIdx) { updateRegions(); }
@@ -28,6 +28,7 @@ static void clearLayout(QLayout* layout)
 PropertyWidget_Query::PropertyWidget_Query(SequenceSearchModel* model, QWidget* parent)
     : PropertyWidget(model, parent)
     , toolButton_addQuery(new QToolButton)
+    , applyScheduler_(model)
 {
     setTitle("Query");
 
@@ -121,6 +122,9 @@ void PropertyWidget_Query::addQueryBox()
         clearLayout(boxLayout->layout());
         delete boxLayout;
 
+        // Scheduled applies refer to queries by index
+        applyScheduler_.removeQuery(index);
+
         // Remove widgets from array and remove query from search model
         queryBoxes_.erase(index);
         seqSearchModel_->removeQuery(index);
@@ -158,9 +162,10 @@ void PropertyWidget_Query::onLineEditQueryTextChanged(int index, const QString&
         box.opponentQuery->text().toUtf8().constData());
     seqSearchModel_->notifyQueriesChanged();
 
+    // Compiling is cheap and shows errors while typing. Applying is not, so
+    // wait until the user stops typing
     if (seqSearchModel_->compileQuery(index))
-        if (seqSearchModel_->applyQuery(index))
-            seqSearchModel_->notifyQueriesApplied();
+        applyScheduler_.schedule(index);
 }
 
 // ----------------------------------------------------------------------------
@@ -1,4 +1,5 @@
 #include "decision-graph/models/SequenceSearchModel.hpp"
+#include "decision-graph/views/DamageView.hpp"
 #include "decision-graph/widgets/PropertyWidget_Templates.hpp"
 
 #include <QHBoxLayout>
@@ -14,8 +15,9 @@
 #include <QMessageBox>
 
 // ----------------------------------------------------------------------------
-PropertyWidget_Templates::PropertyWidget_Templates(SequenceSearchModel* model, QWidget* parent)
+PropertyWidget_Templates::PropertyWidget_Templates(DamageView* damageView, SequenceSearchModel* model, QWidget* parent)
     : PropertyWidget(model, parent)
+    , damageView_(damageView)
     , listWidget(new QListWidget)
 {
     setTitle("Templates");
@@ -103,7 +105,7 @@ bool PropertyWidget_Templates::saveToTemplate(const QString& filePath)
 
     QJsonObject jDamageSettings
     {
-        {"bucketsize", 20}
+        {"bucketsize", damageView_->bucketSize()}
     };
 
     QJsonObject jRoot
@@ -137,6 +139,10 @@ bool PropertyWidget_Templates::loadTemplate(const QString& filePath)
 
     QJsonObject jRoot = QJsonDocument::fromJson(f.readAll()).object();
 
+    QJsonObject jDamageSettings = jRoot["damage"].toObject();
+    const int bucketSize = jDamageSettings["bucketsize"].toInt();
+    if (bucketSize > 0)
+        damageView_->setBucketSize(bucketSize);
 
     return true;
 }